@@ -651,6 +651,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      outputs,
                      sampler,
                      &llvm->draw->vs.vertex_shader->info,
+                     NULL,
                      NULL);
 
    {
@@ -2206,7 +2207,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      outputs,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -63,6 +63,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -157,6 +158,11 @@ struct lp_bld_tgsi_system_values {
    LLVMValueRef instance_id;
    LLVMValueRef vertex_id;
    LLVMValueRef prim_id;
+   /* compute shaders: thread_id is a vector, the others are scalars */
+   LLVMValueRef thread_id[3];
+   LLVMValueRef block_id[3];
+   LLVMValueRef block_size[3];
+   LLVMValueRef grid_size[3];
 };
 
 
@@ -231,7 +237,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[4],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -420,6 +427,28 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Compute shader interface.
+ *
+ * The kernel starts at the BGNSUB at entry_pc.  LOAD and STORE are done
+ * one lane at a time, with the dword address of each lane computed by
+ * resource_ptr from the (scalar) RAW address of that lane; addresses of
+ * inactive lanes are zero.
+ */
+struct lp_build_tgsi_cs_iface
+{
+   unsigned entry_pc;
+   LLVMValueRef (*resource_ptr)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                                struct lp_build_tgsi_context * bld_base,
+                                unsigned resource,
+                                unsigned lane,
+                                LLVMValueRef x,
+                                LLVMValueRef y,
+                                LLVMValueRef z);
+   void (*barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                   struct lp_build_tgsi_context * bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -428,6 +457,7 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
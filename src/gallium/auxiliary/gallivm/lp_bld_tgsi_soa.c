@@ -688,7 +688,12 @@ static void lp_exec_mask_bgnsub(struct lp_exec_mask *mask)
 
 static void lp_exec_mask_endsub(struct lp_exec_mask *mask, int *pc)
 {
-   assert(mask->call_stack_size);
+   if (mask->call_stack_size == 0) {
+      /* end of a compute kernel, which starts at its BGNSUB */
+      *pc = -1;
+      return;
+   }
+
    mask->call_stack_size--;
    *pc = mask->call_stack[mask->call_stack_size].pc;
    mask->ret_mask = mask->call_stack[mask->call_stack_size].ret_mask;
@@ -1337,6 +1342,21 @@ emit_fetch_temporary(
    return res;
 }
 
+/**
+ * Broadcast one of the scalar compute system values; the w channel,
+ * which has no meaning for them, is zero.
+ */
+static LLVMValueRef
+cs_system_value(struct lp_build_tgsi_context *bld_base,
+                const LLVMValueRef values[3],
+                unsigned swizzle)
+{
+   if (swizzle > 2)
+      return bld_base->uint_bld.zero;
+
+   return lp_build_broadcast_scalar(&bld_base->uint_bld, values[swizzle]);
+}
+
 static LLVMValueRef
 emit_fetch_system_value(
    struct lp_build_tgsi_context * bld_base,
@@ -1369,6 +1389,27 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = cs_system_value(bld_base, bld->system_values.block_id, swizzle);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = cs_system_value(bld_base, bld->system_values.block_size, swizzle);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = cs_system_value(bld_base, bld->system_values.grid_size, swizzle);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -1673,6 +1714,10 @@ emit_store(
    if(info->num_dst) {
       LLVMValueRef pred[TGSI_NUM_CHANNELS];
 
+      /* STORE and the fences write resources through their own actions */
+      if (inst->Dst[0].Register.File == TGSI_FILE_RESOURCE)
+         return;
+
       emit_fetch_predicate( bld, inst, pred );
 
       TGSI_FOR_EACH_DST0_ENABLED_CHANNEL( inst, chan_index ) {
@@ -2857,6 +2902,174 @@ mask_vec(struct lp_build_tgsi_context *bld_base)
                        exec_mask->exec_mask, "");
 }
 
+/**
+ * Fetch channel \p chan of the RAW address operand of a LOAD or STORE,
+ * as integers, optionally zeroed in the lanes not in \p exec_mask.
+ */
+static LLVMValueRef
+cs_fetch_address(struct lp_build_tgsi_context *bld_base,
+                 const struct tgsi_full_instruction *inst,
+                 unsigned src_op,
+                 unsigned chan,
+                 LLVMValueRef exec_mask)
+{
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef addr = lp_build_emit_fetch(bld_base, inst, src_op, chan);
+
+   addr = LLVMBuildBitCast(builder, addr, bld_base->uint_bld.vec_type, "");
+   if (exec_mask)
+      addr = LLVMBuildAnd(builder, addr, exec_mask, "");
+
+   return addr;
+}
+
+/**
+ * Pointer to the first dword a lane of a LOAD or STORE accesses.
+ */
+static LLVMValueRef
+cs_lane_pointer(struct lp_build_tgsi_soa_context *bld,
+                unsigned resource,
+                unsigned lane,
+                const LLVMValueRef addr[3])
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef index = lp_build_const_int32(gallivm, lane);
+   LLVMValueRef x, y, z, ptr;
+
+   x = LLVMBuildExtractElement(builder, addr[0], index, "");
+   y = LLVMBuildExtractElement(builder, addr[1], index, "");
+   z = LLVMBuildExtractElement(builder, addr[2], index, "");
+
+   ptr = bld->cs_iface->resource_ptr(bld->cs_iface, &bld->bld_base,
+                                     resource, lane, x, y, z);
+
+   return LLVMBuildBitCast(builder, ptr,
+                           LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0),
+                           "");
+}
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef exec_mask = mask_vec(bld_base);
+   LLVMValueRef addr[3];
+   LLVMValueRef res[TGSI_NUM_CHANNELS];
+   unsigned lane, chan;
+
+   /* Inactive lanes load from address zero rather than branching around
+    * the load; the resource callback makes sure that's valid memory.
+    */
+   for (chan = 0; chan < 3; chan++)
+      addr[chan] = cs_fetch_address(bld_base, inst, 1, chan, exec_mask);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      res[chan] = bld_base->uint_bld.undef;
+   }
+
+   for (lane = 0; lane < bld_base->base.type.length; lane++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, lane);
+      LLVMValueRef ptr = cs_lane_pointer(bld, inst->Src[0].Register.Index,
+                                         lane, addr);
+
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         unsigned swizzle =
+            tgsi_util_get_full_src_register_swizzle(&inst->Src[0], chan);
+         LLVMValueRef offset = lp_build_const_int32(gallivm, swizzle);
+         LLVMValueRef value;
+
+         value = LLVMBuildLoad(builder,
+                               LLVMBuildGEP(builder, ptr, &offset, 1, ""), "");
+         res[chan] = LLVMBuildInsertElement(builder, res[chan], value,
+                                            index, "");
+      }
+   }
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = LLVMBuildBitCast(builder, res[chan],
+                                                 bld_base->base.vec_type, "");
+   }
+}
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   LLVMValueRef exec_mask = mask_vec(bld_base);
+   LLVMValueRef addr[3];
+   LLVMValueRef values[TGSI_NUM_CHANNELS];
+   unsigned lane, chan;
+
+   for (chan = 0; chan < 3; chan++)
+      addr[chan] = cs_fetch_address(bld_base, inst, 0, chan, NULL);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      values[chan] = LLVMBuildBitCast(builder,
+                                      lp_build_emit_fetch(bld_base, inst, 1, chan),
+                                      bld_base->uint_bld.vec_type, "");
+   }
+
+   for (lane = 0; lane < bld_base->base.type.length; lane++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, lane);
+      struct lp_build_if_state ifthen;
+      LLVMValueRef active, ptr;
+
+      active = LLVMBuildExtractElement(builder, exec_mask, index, "");
+      active = LLVMBuildICmp(builder, LLVMIntNE, active,
+                             lp_build_const_int32(gallivm, 0), "");
+
+      lp_build_if(&ifthen, gallivm, active);
+
+      ptr = cs_lane_pointer(bld, inst->Dst[0].Register.Index, lane, addr);
+
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         LLVMValueRef offset = lp_build_const_int32(gallivm, chan);
+         LLVMValueRef value =
+            LLVMBuildExtractElement(builder, values[chan], index, "");
+
+         LLVMBuildStore(builder, value,
+                        LLVMBuildGEP(builder, ptr, &offset, 1, ""));
+      }
+
+      lp_build_endif(&ifthen);
+   }
+}
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   bld->cs_iface->barrier(bld->cs_iface, bld_base);
+}
+
+static void
+fence_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   /* All the threads of a block run on the same CPU thread, and nothing
+    * is promised about the ordering between blocks.
+    */
+}
+
 static void
 increment_vec_ptr_by_mask(struct lp_build_tgsi_context * bld_base,
                           LLVMValueRef ptr,
@@ -3437,7 +3650,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3548,6 +3762,19 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                                 max_output_vertices);
    }
 
+   if (cs_iface) {
+      /* LOAD/STORE need a mask to tell the active lanes */
+      assert(mask);
+      bld.cs_iface = cs_iface;
+      bld.bld_base.pc = cs_iface->entry_pc;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_MFENCE].emit = fence_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_LFENCE].emit = fence_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_SFENCE].emit = fence_emit;
+   }
+
    lp_exec_mask_init(&bld.exec_mask, &bld.bld_base.int_bld);
 
    bld.system_values = *system_values;
@@ -20,14 +20,18 @@
 #endif
 
 
+/* num_threads is the number of rasterizer threads for the drivers that have
+ * them, or -1 for the driver's default.
+ */
 static INLINE struct pipe_screen *
-sw_screen_create_named(struct sw_winsys *winsys, const char *driver)
+sw_screen_create_named_threads(struct sw_winsys *winsys, const char *driver,
+                               int num_threads)
 {
    struct pipe_screen *screen = NULL;
 
 #if defined(GALLIUM_LLVMPIPE)
    if (screen == NULL && strcmp(driver, "llvmpipe") == 0)
-      screen = llvmpipe_create_screen(winsys);
+      screen = llvmpipe_create_screen_threads(winsys, num_threads);
 #endif
 
 #if defined(GALLIUM_SOFTPIPE)
@@ -40,7 +44,14 @@ sw_screen_create_named(struct sw_winsys *winsys, const char *driver)
 
 
 static INLINE struct pipe_screen *
-sw_screen_create(struct sw_winsys *winsys)
+sw_screen_create_named(struct sw_winsys *winsys, const char *driver)
+{
+   return sw_screen_create_named_threads(winsys, driver, -1);
+}
+
+
+static INLINE struct pipe_screen *
+sw_screen_create_threads(struct sw_winsys *winsys, int num_threads)
 {
    const char *default_driver;
    const char *driver;
@@ -54,7 +65,14 @@ sw_screen_create(struct sw_winsys *winsys)
 #endif
 
    driver = debug_get_option("GALLIUM_DRIVER", default_driver);
-   return sw_screen_create_named(winsys, driver);
+   return sw_screen_create_named_threads(winsys, driver, num_threads);
+}
+
+
+static INLINE struct pipe_screen *
+sw_screen_create(struct sw_winsys *winsys)
+{
+   return sw_screen_create_threads(winsys, -1);
 }
 
 
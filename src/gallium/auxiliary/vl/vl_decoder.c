@@ -27,10 +27,12 @@
 
 #include "pipe/p_video_codec.h"
 
+#include "util/u_debug.h"
 #include "util/u_video.h"
 
 #include "vl_decoder.h"
 #include "vl_mpeg12_decoder.h"
+#include "vl_mpeg12_cpu_decoder.h"
 
 bool
 vl_profile_supported(struct pipe_screen *screen, enum pipe_video_profile profile,
@@ -92,3 +94,23 @@ vl_create_decoder(struct pipe_context *pipe,
    }
    return NULL;
 }
+
+struct pipe_video_codec *
+vl_create_cpu_decoder(struct pipe_context *pipe,
+                      const struct pipe_video_codec *templat)
+{
+   assert(pipe);
+   assert(templat->width > 0 && templat->height > 0);
+
+   /* allow comparing against the shader based decoder */
+   if (!debug_get_bool_option("VL_CPU_DECODE", TRUE))
+      return vl_create_decoder(pipe, templat);
+
+   switch (u_reduce_video_profile(templat->profile)) {
+      case PIPE_VIDEO_FORMAT_MPEG12:
+         return vl_create_mpeg12_cpu_decoder(pipe, templat);
+
+      default:
+         return NULL;
+   }
+}
@@ -51,4 +51,12 @@ struct pipe_video_codec *
 vl_create_decoder(struct pipe_context *pipe,
                   const struct pipe_video_codec *templat);
 
+/**
+ * implementation of pipe->create_video_codec for software rasterizers,
+ * decodes on the CPU instead of emulating the shader based decoder
+ */
+struct pipe_video_codec *
+vl_create_cpu_decoder(struct pipe_context *pipe,
+                      const struct pipe_video_codec *templat);
+
 #endif /* vl_decoder_h */
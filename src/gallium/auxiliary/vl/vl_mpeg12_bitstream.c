@@ -675,6 +675,16 @@ motion_vector_frame(struct vl_mpg12_bs *bs, int s, struct pipe_mpeg12_macroblock
       mb->PMV[1][s][0] = wrap(mb->PMV[1][s][0] + delta[0], bs->desc->f_code[s][0]);
       mb->PMV[1][s][1] = wrap(DIV2DOWN(mb->PMV[1][s][1]) + delta[1], bs->desc->f_code[s][1]) * 2;
 
+   } else if (dmv) {
+      /* a field vector, see section 7.6.3.1 of the spec */
+      motion_vector(bs, 0, s, dmv, delta, dmvector);
+      mb->PMV[0][s][0] = wrap(mb->PMV[0][s][0] + delta[0], bs->desc->f_code[s][0]);
+      mb->PMV[0][s][1] = wrap(DIV2DOWN(mb->PMV[0][s][1]) + delta[1], bs->desc->f_code[s][1]) * 2;
+      mb->PMV[1][s][0] = mb->PMV[0][s][0];
+      mb->PMV[1][s][1] = mb->PMV[0][s][1];
+      mb->dmvector[0] = dmvector[0];
+      mb->dmvector[1] = dmvector[1];
+
    } else {
       motion_vector(bs, 0, s, dmv, delta, dmvector);
       mb->PMV[0][s][0] = wrap(mb->PMV[0][s][0] + delta[0], bs->desc->f_code[s][0]);
@@ -0,0 +1,1026 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * MPEG-1/2 decoding on the CPU.
+ *
+ * The shader based decoder in vl_mpeg12_decoder.c renders the IDCT and the
+ * motion compensation, which on software rasterizers means running every
+ * pass through the emulated pipeline. This decoder uses the same bitstream
+ * parser but does the dequantisation, IDCT and motion compensation directly
+ * on the mapped video buffers, with SSE2 kernels where available, and
+ * splits the slices of a picture across a number of threads.
+ */
+
+#include <assert.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_state.h"
+
+#include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sse.h"
+#include "util/u_video.h"
+
+#include "vl_mpeg12_cpu_decoder.h"
+#include "vl_video_buffer.h"
+#include "vl_zscan.h"
+
+/* row pitch of the reference samples fetched for one prediction */
+#define FETCH_STRIDE 32
+
+/*
+ * 8 point IDCT basis, idct_matrix[y][v] = C(v) / 2 * cos((2y + 1) * v * PI / 16)
+ * in 2.14 fixed point. The first pass keeps two extra bits of precision.
+ */
+#define IDCT_SHIFT_1 12
+#define IDCT_SHIFT_2 16
+
+static const short idct_matrix[8][8] = {
+   { 5793,  8035,  7568,  6811,  5793,  4551,  3135,  1598 },
+   { 5793,  6811,  3135, -1598, -5793, -8035, -7568, -4551 },
+   { 5793,  4551, -3135, -8035, -5793,  1598,  7568,  6811 },
+   { 5793,  1598, -7568, -4551,  5793,  6811, -3135, -8035 },
+   { 5793, -1598, -7568,  4551,  5793, -6811, -3135,  8035 },
+   { 5793, -4551, -3135,  8035, -5793, -1598,  7568, -6811 },
+   { 5793, -6811,  3135,  1598, -5793,  8035, -7568,  4551 },
+   { 5793, -8035,  7568, -6811,  5793, -4551,  3135, -1598 }
+};
+
+#if defined(PIPE_ARCH_SSE)
+
+/* the rows of idct_matrix as pairs of coefficients for _mm_madd_epi16 */
+#define PAIR(a, b) ((int)(((unsigned)(b) << 16) | ((unsigned)(a) & 0xffff)))
+
+static const int idct_pairs[8][4] = {
+   { PAIR( 5793,  8035), PAIR( 7568,  6811), PAIR( 5793,  4551), PAIR( 3135,  1598) },
+   { PAIR( 5793,  6811), PAIR( 3135, -1598), PAIR(-5793, -8035), PAIR(-7568, -4551) },
+   { PAIR( 5793,  4551), PAIR(-3135, -8035), PAIR(-5793,  1598), PAIR( 7568,  6811) },
+   { PAIR( 5793,  1598), PAIR(-7568, -4551), PAIR( 5793,  6811), PAIR(-3135, -8035) },
+   { PAIR( 5793, -1598), PAIR(-7568,  4551), PAIR( 5793, -6811), PAIR(-3135,  8035) },
+   { PAIR( 5793, -4551), PAIR(-3135,  8035), PAIR(-5793, -1598), PAIR( 7568, -6811) },
+   { PAIR( 5793, -6811), PAIR( 3135,  1598), PAIR(-5793,  8035), PAIR(-7568,  4551) },
+   { PAIR( 5793, -8035), PAIR( 7568, -6811), PAIR( 5793, -4551), PAIR( 3135, -1598) }
+};
+
+#undef PAIR
+
+static INLINE void
+transpose_8x8_sse2(__m128i r[8])
+{
+   __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+   __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+   a0 = _mm_unpacklo_epi16(r[0], r[1]);
+   a1 = _mm_unpackhi_epi16(r[0], r[1]);
+   a2 = _mm_unpacklo_epi16(r[2], r[3]);
+   a3 = _mm_unpackhi_epi16(r[2], r[3]);
+   a4 = _mm_unpacklo_epi16(r[4], r[5]);
+   a5 = _mm_unpackhi_epi16(r[4], r[5]);
+   a6 = _mm_unpacklo_epi16(r[6], r[7]);
+   a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+   b0 = _mm_unpacklo_epi32(a0, a2);
+   b1 = _mm_unpackhi_epi32(a0, a2);
+   b2 = _mm_unpacklo_epi32(a1, a3);
+   b3 = _mm_unpackhi_epi32(a1, a3);
+   b4 = _mm_unpacklo_epi32(a4, a6);
+   b5 = _mm_unpackhi_epi32(a4, a6);
+   b6 = _mm_unpacklo_epi32(a5, a7);
+   b7 = _mm_unpackhi_epi32(a5, a7);
+
+   r[0] = _mm_unpacklo_epi64(b0, b4);
+   r[1] = _mm_unpackhi_epi64(b0, b4);
+   r[2] = _mm_unpacklo_epi64(b1, b5);
+   r[3] = _mm_unpackhi_epi64(b1, b5);
+   r[4] = _mm_unpacklo_epi64(b2, b6);
+   r[5] = _mm_unpackhi_epi64(b2, b6);
+   r[6] = _mm_unpacklo_epi64(b3, b7);
+   r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/**
+ * one dimensional IDCT down the columns of r, all eight columns at once
+ */
+static INLINE void
+idct_pass_sse2(__m128i r[8], int shift)
+{
+   const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+   const __m128i count = _mm_cvtsi32_si128(shift);
+   __m128i lo[4], hi[4];
+   unsigned y, v;
+
+   for (v = 0; v < 4; ++v) {
+      lo[v] = _mm_unpacklo_epi16(r[2 * v], r[2 * v + 1]);
+      hi[v] = _mm_unpackhi_epi16(r[2 * v], r[2 * v + 1]);
+   }
+
+   for (y = 0; y < 8; ++y) {
+      __m128i sum_lo = round, sum_hi = round;
+
+      for (v = 0; v < 4; ++v) {
+         __m128i c = _mm_set1_epi32(idct_pairs[y][v]);
+         sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(lo[v], c));
+         sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(hi[v], c));
+      }
+
+      r[y] = _mm_packs_epi32(_mm_sra_epi32(sum_lo, count),
+                             _mm_sra_epi32(sum_hi, count));
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+/**
+ * 8x8 inverse DCT in place, columns first then rows
+ */
+static void
+idct_8x8(short block[64])
+{
+#if defined(PIPE_ARCH_SSE)
+   __m128i r[8];
+   unsigned i;
+
+   for (i = 0; i < 8; ++i)
+      r[i] = _mm_load_si128((const __m128i *)(block + i * 8));
+
+   idct_pass_sse2(r, IDCT_SHIFT_1);
+   transpose_8x8_sse2(r);
+   idct_pass_sse2(r, IDCT_SHIFT_2);
+   transpose_8x8_sse2(r);
+
+   for (i = 0; i < 8; ++i)
+      _mm_store_si128((__m128i *)(block + i * 8), r[i]);
+#else
+   short tmp[64];
+   unsigned x, y, v;
+
+   for (y = 0; y < 8; ++y) {
+      for (x = 0; x < 8; ++x) {
+         int sum = 1 << (IDCT_SHIFT_1 - 1);
+         for (v = 0; v < 8; ++v)
+            sum += idct_matrix[y][v] * block[v * 8 + x];
+         tmp[y * 8 + x] = CLAMP(sum >> IDCT_SHIFT_1, -32768, 32767);
+      }
+   }
+
+   for (y = 0; y < 8; ++y) {
+      for (x = 0; x < 8; ++x) {
+         int sum = 1 << (IDCT_SHIFT_2 - 1);
+         for (v = 0; v < 8; ++v)
+            sum += idct_matrix[x][v] * tmp[y * 8 + v];
+         block[y * 8 + x] = CLAMP(sum >> IDCT_SHIFT_2, -32768, 32767);
+      }
+   }
+#endif
+}
+
+/**
+ * inverse DCT of a block with only a DC coefficient, same result as idct_8x8
+ */
+static INLINE void
+idct_dc(short block[64])
+{
+   int dc = (block[0] * idct_matrix[0][0] + (1 << (IDCT_SHIFT_1 - 1))) >> IDCT_SHIFT_1;
+   unsigned i;
+
+   dc = (dc * idct_matrix[0][0] + (1 << (IDCT_SHIFT_2 - 1))) >> IDCT_SHIFT_2;
+
+   for (i = 0; i < 64; ++i)
+      block[i] = dc;
+}
+
+/**
+ * bring the coefficients into raster order and apply the quantiser matrix,
+ * see section 7.4 of the spec. Returns false if only the DC is set.
+ */
+static INLINE bool
+dequant_block(const struct vl_mpeg12_cpu_decoder *dec, const short *src,
+              const short *matrix, short dst[64])
+{
+   bool ac = false;
+   unsigned i;
+
+   memset(dst, 0, 64 * sizeof(short));
+
+   for (i = 0; i < 64; ++i) {
+      unsigned pos;
+      int value;
+
+      if (!src[i])
+         continue;
+
+      pos = dec->scan[i];
+      value = src[i] * matrix[pos] / 16;
+      dst[pos] = CLAMP(value, -2048, 2047);
+      ac |= pos != 0;
+   }
+
+   return ac;
+}
+
+/**
+ * add a residual block to the prediction
+ */
+static INLINE void
+add_block(uint8_t *dst, unsigned stride, const short block[64])
+{
+#if defined(PIPE_ARCH_SSE)
+   const __m128i zero = _mm_setzero_si128();
+   unsigned y;
+
+   for (y = 0; y < 8; ++y, dst += stride) {
+      __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)dst), zero);
+      p = _mm_adds_epi16(p, _mm_load_si128((const __m128i *)(block + y * 8)));
+      _mm_storel_epi64((__m128i *)dst, _mm_packus_epi16(p, p));
+   }
+#else
+   unsigned x, y;
+
+   for (y = 0; y < 8; ++y, dst += stride)
+      for (x = 0; x < 8; ++x)
+         dst[x] = CLAMP(dst[x] + block[y * 8 + x], 0, 255);
+#endif
+}
+
+/**
+ * average the forward and backward prediction
+ */
+static INLINE void
+average_block(uint8_t *dst, const uint8_t *src, unsigned size)
+{
+#if defined(PIPE_ARCH_SSE)
+   unsigned i;
+
+   for (i = 0; i < size; i += 16) {
+      __m128i a = _mm_load_si128((const __m128i *)(dst + i));
+      __m128i b = _mm_load_si128((const __m128i *)(src + i));
+      _mm_store_si128((__m128i *)(dst + i), _mm_avg_epu8(a, b));
+   }
+#else
+   unsigned i;
+
+   for (i = 0; i < size; ++i)
+      dst[i] = (dst[i] + src[i] + 1) >> 1;
+#endif
+}
+
+/**
+ * fetch the (w + 1) x (h + 1) reference samples needed for a half-pel
+ * prediction into a linear buffer, clamping at the edges of the plane
+ */
+static INLINE void
+fetch_reference(const struct vl_mpeg12_cpu_plane *plane,
+                unsigned field, unsigned field_step,
+                int x, int y, unsigned w, unsigned h, uint8_t *dst)
+{
+   const uint8_t *src = plane->map + field * plane->stride;
+   unsigned stride = plane->stride * field_step;
+   int width = plane->width, height = plane->height / field_step;
+   unsigned i, j;
+
+   if (plane->step == 1 && x >= 0 && y >= 0 &&
+       x + (int)w < width && y + (int)h < height) {
+      src += y * stride + x;
+      for (j = 0; j <= h; ++j, src += stride, dst += FETCH_STRIDE)
+         memcpy(dst, src, w + 1);
+      return;
+   }
+
+   for (j = 0; j <= h; ++j, dst += FETCH_STRIDE) {
+      const uint8_t *row = src + CLAMP(y + (int)j, 0, height - 1) * stride;
+      for (i = 0; i <= w; ++i)
+         dst[i] = row[CLAMP(x + (int)i, 0, width - 1) * plane->step];
+   }
+}
+
+/**
+ * half-pel interpolation of a w x h block, see section 7.6.4 of the spec
+ */
+static INLINE void
+interpolate_block(const uint8_t *src, unsigned hx, unsigned hy,
+                  unsigned w, unsigned h, uint8_t *dst, unsigned dst_stride)
+{
+#if defined(PIPE_ARCH_SSE)
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i two = _mm_set1_epi16(2);
+   unsigned y;
+
+   for (y = 0; y < h; ++y, src += FETCH_STRIDE, dst += dst_stride) {
+      __m128i a = _mm_loadu_si128((const __m128i *)src);
+      __m128i r;
+
+      if (hx && hy) {
+         __m128i b = _mm_loadu_si128((const __m128i *)(src + 1));
+         __m128i c = _mm_loadu_si128((const __m128i *)(src + FETCH_STRIDE));
+         __m128i d = _mm_loadu_si128((const __m128i *)(src + FETCH_STRIDE + 1));
+         __m128i lo, hi;
+
+         lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                            _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+         hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+                            _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+         lo = _mm_srli_epi16(_mm_add_epi16(lo, two), 2);
+         hi = _mm_srli_epi16(_mm_add_epi16(hi, two), 2);
+         r = _mm_packus_epi16(lo, hi);
+      } else if (hx)
+         r = _mm_avg_epu8(a, _mm_loadu_si128((const __m128i *)(src + 1)));
+      else if (hy)
+         r = _mm_avg_epu8(a, _mm_loadu_si128((const __m128i *)(src + FETCH_STRIDE)));
+      else
+         r = a;
+
+      if (w == 16)
+         _mm_storeu_si128((__m128i *)dst, r);
+      else
+         _mm_storel_epi64((__m128i *)dst, r);
+   }
+#else
+   unsigned x, y;
+
+   for (y = 0; y < h; ++y, src += FETCH_STRIDE, dst += dst_stride) {
+      for (x = 0; x < w; ++x) {
+         const uint8_t *s = src + x;
+
+         if (hx && hy)
+            dst[x] = (s[0] + s[1] + s[FETCH_STRIDE] + s[FETCH_STRIDE + 1] + 2) >> 2;
+         else if (hx)
+            dst[x] = (s[0] + s[1] + 1) >> 1;
+         else if (hy)
+            dst[x] = (s[0] + s[FETCH_STRIDE] + 1) >> 1;
+         else
+            dst[x] = s[0];
+      }
+   }
+#endif
+}
+
+/**
+ * predict a w x h block at x, y from one reference plane or field,
+ * mv is in half samples of the plane or field
+ */
+static void
+predict_block(const struct vl_mpeg12_cpu_plane *plane,
+              unsigned field, unsigned field_step,
+              int x, int y, int mv_x, int mv_y, unsigned w, unsigned h,
+              uint8_t *dst, unsigned dst_stride)
+{
+   PIPE_ALIGN_VAR(16) uint8_t samples[FETCH_STRIDE * (VL_MACROBLOCK_HEIGHT + 1)];
+
+   fetch_reference(plane, field, field_step, x + (mv_x >> 1), y + (mv_y >> 1),
+                   w, h, samples);
+   interpolate_block(samples, mv_x & 1, mv_y & 1, w, h, dst, dst_stride);
+}
+
+/**
+ * predict field r of a macroblock from one field of the reference frame,
+ * mv is in half samples of the field
+ */
+static void
+predict_field(const struct vl_mpeg12_cpu_frame *ref, unsigned field, unsigned r,
+              unsigned mb_x, unsigned mb_y, int mv_x, int mv_y,
+              uint8_t pred[VL_NUM_COMPONENTS][256])
+{
+   unsigned c;
+
+   predict_block(&ref->components[0], field, 2, mb_x * 16, mb_y * 8,
+                 mv_x, mv_y, 16, 8, pred[0] + r * 16, 32);
+
+   for (c = 1; c < VL_NUM_COMPONENTS; ++c)
+      predict_block(&ref->components[c], field, 2, mb_x * 8, mb_y * 4,
+                    mv_x / 2, mv_y / 2, 8, 4, pred[c] + r * 8, 16);
+}
+
+/**
+ * prediction of a macroblock from one direction, see section 7.6.3 of the spec
+ */
+static void
+predict_direction(const struct vl_mpeg12_cpu_decoder *dec, unsigned s,
+                  unsigned mb_x, unsigned mb_y, unsigned motion_type,
+                  unsigned field_select, const short PMV[2][2][2],
+                  const short dmvector[2],
+                  uint8_t pred[VL_NUM_COMPONENTS][256])
+{
+   const struct vl_mpeg12_cpu_frame *ref = dec->ref_frames[s];
+   unsigned c, r;
+
+   if (!ref) {
+      memset(pred, 0x80, VL_NUM_COMPONENTS * 256);
+      return;
+   }
+
+   if (motion_type == PIPE_MPEG12_MO_TYPE_FIELD) {
+      /* one vector for each field of the macroblock, vertical in frame units */
+      for (r = 0; r < 2; ++r) {
+         unsigned field = field_select & (PIPE_MPEG12_FS_FIRST_FORWARD << (s + 2 * r)) ? 1 : 0;
+
+         predict_field(ref, field, r, mb_x, mb_y, PMV[r][s][0], PMV[r][s][1] >> 1, pred);
+      }
+   } else if (motion_type == PIPE_MPEG12_MO_TYPE_DUAL_PRIME) {
+      /*
+       * each field is the average of the reference field with the same parity
+       * and the one with the opposite parity, the vector of the latter derived
+       * from the first, see section 7.6.3.6 of the spec
+       */
+      PIPE_ALIGN_VAR(16) uint8_t opposite[VL_NUM_COMPONENTS][256];
+      int mv_x = PMV[0][s][0], mv_y = PMV[0][s][1] >> 1;
+
+      for (r = 0; r < 2; ++r) {
+         /* distance between the two fields in field periods */
+         int m = (r == 0) == (dec->top_field_first != 0) ? 1 : 3;
+         int dmv_x = ((mv_x * m + (mv_x > 0)) >> 1) + dmvector[0];
+         int dmv_y = ((mv_y * m + (mv_y > 0)) >> 1) + dmvector[1] + (r ? 1 : -1);
+
+         predict_field(ref, r, r, mb_x, mb_y, mv_x, mv_y, pred);
+         predict_field(ref, !r, r, mb_x, mb_y, dmv_x, dmv_y, opposite);
+      }
+
+      for (c = 0; c < VL_NUM_COMPONENTS; ++c)
+         average_block(pred[c], opposite[c], c ? 64 : 256);
+   } else {
+      int mv_x = PMV[0][s][0], mv_y = PMV[0][s][1];
+
+      predict_block(&ref->components[0], 0, 1, mb_x * 16, mb_y * 16,
+                    mv_x, mv_y, 16, 16, pred[0], 16);
+
+      for (c = 1; c < VL_NUM_COMPONENTS; ++c)
+         predict_block(&ref->components[c], 0, 1, mb_x * 8, mb_y * 8,
+                       mv_x / 2, mv_y / 2, 8, 8, pred[c], 8);
+   }
+}
+
+static void
+predict_macroblock(const struct vl_mpeg12_cpu_decoder *dec,
+                   unsigned mb_x, unsigned mb_y, unsigned motion,
+                   unsigned motion_type, unsigned field_select,
+                   const short PMV[2][2][2], const short dmvector[2],
+                   uint8_t pred[VL_NUM_COMPONENTS][256])
+{
+   PIPE_ALIGN_VAR(16) uint8_t backward[VL_NUM_COMPONENTS][256];
+   unsigned c;
+
+   switch (motion) {
+   case PIPE_MPEG12_MB_TYPE_MOTION_FORWARD:
+      predict_direction(dec, 0, mb_x, mb_y, motion_type, field_select, PMV, dmvector, pred);
+      break;
+
+   case PIPE_MPEG12_MB_TYPE_MOTION_BACKWARD:
+      predict_direction(dec, 1, mb_x, mb_y, motion_type, field_select, PMV, dmvector, pred);
+      break;
+
+   default:
+      predict_direction(dec, 0, mb_x, mb_y, motion_type, field_select, PMV, dmvector, pred);
+      predict_direction(dec, 1, mb_x, mb_y, motion_type, field_select, PMV, dmvector, backward);
+      for (c = 0; c < VL_NUM_COMPONENTS; ++c)
+         average_block(pred[c], backward[c], c ? 64 : 256);
+      break;
+   }
+}
+
+/**
+ * add the coded blocks of a macroblock to its prediction
+ */
+static void
+add_residuals(const struct vl_mpeg12_cpu_decoder *dec,
+              const struct pipe_mpeg12_macroblock *mb,
+              uint8_t pred[VL_NUM_COMPONENTS][256])
+{
+   PIPE_ALIGN_VAR(16) short block[64];
+   const short *matrix, *src = mb->blocks;
+   unsigned b;
+
+   matrix = mb->macroblock_type & PIPE_MPEG12_MB_TYPE_INTRA ?
+      dec->intra_matrix : dec->non_intra_matrix;
+
+   for (b = 0; b < 6; ++b) {
+      uint8_t *dst;
+      unsigned stride;
+
+      if (!(mb->coded_block_pattern & (0x20 >> b)))
+         continue;
+
+      if (b >= 4) {
+         dst = pred[b - 3];
+         stride = 8;
+      } else if (mb->macroblock_modes.bits.dct_type) {
+         /* field DCT, see section 6.1.3 of the spec */
+         dst = pred[0] + (b >> 1) * 16 + (b & 1) * 8;
+         stride = 32;
+      } else {
+         dst = pred[0] + (b >> 1) * 128 + (b & 1) * 8;
+         stride = 16;
+      }
+
+      if (dec->base.entrypoint <= PIPE_VIDEO_ENTRYPOINT_IDCT) {
+         if (dequant_block(dec, src, matrix, block))
+            idct_8x8(block);
+         else
+            idct_dc(block);
+      } else
+         memcpy(block, src, sizeof(block));
+
+      add_block(dst, stride, block);
+      src += 64;
+   }
+}
+
+static void
+store_macroblock(const struct vl_mpeg12_cpu_decoder *dec,
+                 unsigned mb_x, unsigned mb_y,
+                 uint8_t pred[VL_NUM_COMPONENTS][256])
+{
+   unsigned c, i, j;
+
+   for (c = 0; c < VL_NUM_COMPONENTS; ++c) {
+      const struct vl_mpeg12_cpu_plane *plane = &dec->target.components[c];
+      unsigned size = c ? VL_BLOCK_WIDTH : VL_MACROBLOCK_WIDTH;
+      unsigned x = mb_x * size, y = mb_y * size, w, h;
+      const uint8_t *src = pred[c];
+      uint8_t *dst;
+
+      if (x >= plane->width || y >= plane->height)
+         continue;
+
+      w = MIN2(size, plane->width - x);
+      h = MIN2(size, plane->height - y);
+      dst = plane->map + y * plane->stride + x * plane->step;
+
+      for (j = 0; j < h; ++j, src += size, dst += plane->stride) {
+         if (plane->step == 1)
+            memcpy(dst, src, w);
+         else
+            for (i = 0; i < w; ++i)
+               dst[i * plane->step] = src[i];
+      }
+   }
+}
+
+static void
+decode_macroblock(const struct vl_mpeg12_cpu_decoder *dec,
+                  const struct pipe_mpeg12_macroblock *mb)
+{
+   PIPE_ALIGN_VAR(16) uint8_t pred[VL_NUM_COMPONENTS][256];
+
+   if (mb->x >= dec->width_in_macroblocks || mb->y >= dec->height_in_macroblocks)
+      return;
+
+   if (mb->macroblock_type & PIPE_MPEG12_MB_TYPE_INTRA) {
+      /* the intra DC is predicted from zero instead of 128 by the parser */
+      memset(pred, 0x80, sizeof(pred));
+   } else {
+      unsigned motion = mb->macroblock_type & (PIPE_MPEG12_MB_TYPE_MOTION_FORWARD |
+                                               PIPE_MPEG12_MB_TYPE_MOTION_BACKWARD);
+
+      /* no motion vector, but also not intra -> copy the old frame content */
+      if (!motion)
+         motion = PIPE_MPEG12_MB_TYPE_MOTION_FORWARD;
+
+      predict_macroblock(dec, mb->x, mb->y, motion,
+                         mb->macroblock_modes.bits.frame_motion_type,
+                         mb->motion_vertical_field_select, mb->PMV, mb->dmvector,
+                         pred);
+   }
+
+   if (mb->macroblock_type & (PIPE_MPEG12_MB_TYPE_PATTERN | PIPE_MPEG12_MB_TYPE_INTRA))
+      add_residuals(dec, mb, pred);
+
+   store_macroblock(dec, mb->x, mb->y, pred);
+}
+
+/**
+ * skipped macroblocks following mb, see section 7.6.6 of the spec
+ */
+static void
+skip_macroblocks(const struct vl_mpeg12_cpu_decoder *dec,
+                 const struct pipe_mpeg12_picture_desc *desc,
+                 const struct pipe_mpeg12_macroblock *mb)
+{
+   static const short zero_mv[2][2][2];
+
+   PIPE_ALIGN_VAR(16) uint8_t pred[VL_NUM_COMPONENTS][256];
+   unsigned addr, i, motion;
+   const short (*PMV)[2][2];
+
+   if (desc->picture_coding_type == PIPE_MPEG12_PICTURE_CODING_TYPE_B) {
+      /* same vectors and prediction type as the previous macroblock */
+      motion = mb->macroblock_type & (PIPE_MPEG12_MB_TYPE_MOTION_FORWARD |
+                                      PIPE_MPEG12_MB_TYPE_MOTION_BACKWARD);
+      PMV = mb->PMV;
+   } else {
+      motion = 0;
+      PMV = zero_mv;
+   }
+
+   if (!motion) {
+      motion = PIPE_MPEG12_MB_TYPE_MOTION_FORWARD;
+      PMV = zero_mv;
+   }
+
+   addr = mb->y * dec->width_in_macroblocks + mb->x;
+   for (i = 0; i < mb->num_skipped_macroblocks; ++i) {
+      unsigned mb_x, mb_y;
+
+      ++addr;
+      mb_x = addr % dec->width_in_macroblocks;
+      mb_y = addr / dec->width_in_macroblocks;
+      if (mb_y >= dec->height_in_macroblocks)
+         break;
+
+      predict_macroblock(dec, mb_x, mb_y, motion, PIPE_MPEG12_MO_TYPE_FRAME, 0,
+                         PMV, NULL, pred);
+      store_macroblock(dec, mb_x, mb_y, pred);
+   }
+}
+
+static void
+unmap_frame(struct vl_mpeg12_cpu_decoder *dec, struct vl_mpeg12_cpu_frame *frame)
+{
+   struct pipe_context *pipe = dec->base.context;
+   unsigned i;
+
+   for (i = 0; i < VL_NUM_COMPONENTS; ++i)
+      if (frame->transfers[i])
+         pipe->transfer_unmap(pipe, frame->transfers[i]);
+
+   memset(frame, 0, sizeof(*frame));
+}
+
+/**
+ * map the planes of a video buffer and sort them into Y, Cb and Cr
+ */
+static bool
+map_frame(struct vl_mpeg12_cpu_decoder *dec, struct pipe_video_buffer *buf,
+          struct vl_mpeg12_cpu_frame *frame, unsigned usage)
+{
+   struct pipe_context *pipe = dec->base.context;
+   struct pipe_sampler_view **views;
+   const unsigned *plane_order;
+   unsigned i, j, component;
+
+   memset(frame, 0, sizeof(*frame));
+
+   if (buf->interlaced || buf->chroma_format != PIPE_VIDEO_CHROMA_FORMAT_420)
+      return false;
+
+   plane_order = vl_video_buffer_plane_order(buf->buffer_format);
+   views = buf->get_sampler_view_planes(buf);
+   if (!plane_order || !views)
+      return false;
+
+   for (i = 0, component = 0; i < VL_NUM_COMPONENTS && component < VL_NUM_COMPONENTS; ++i) {
+      struct pipe_resource *res;
+      struct pipe_box box;
+      unsigned nr_components;
+      uint8_t *map;
+
+      if (!views[i])
+         break;
+
+      res = views[i]->texture;
+      switch (res->format) {
+      case PIPE_FORMAT_R8_UNORM:
+         nr_components = 1;
+         break;
+      case PIPE_FORMAT_R8G8_UNORM:
+         nr_components = 2;
+         break;
+      default:
+         goto error;
+      }
+
+      u_box_2d(0, 0, res->width0, res->height0, &box);
+      map = pipe->transfer_map(pipe, res, 0, usage, &box, &frame->transfers[i]);
+      if (!map)
+         goto error;
+
+      for (j = 0; j < nr_components && component < VL_NUM_COMPONENTS; ++j, ++component) {
+         struct vl_mpeg12_cpu_plane *plane = &frame->components[plane_order[component]];
+
+         plane->map = map + j;
+         plane->stride = frame->transfers[i]->stride;
+         plane->step = nr_components;
+         plane->width = res->width0;
+         plane->height = res->height0;
+      }
+   }
+
+   if (component < VL_NUM_COMPONENTS)
+      goto error;
+
+   return true;
+
+error:
+   unmap_frame(dec, frame);
+   return false;
+}
+
+static PIPE_THREAD_ROUTINE(thread_function, init_data)
+{
+   struct vl_mpeg12_cpu_task *task = (struct vl_mpeg12_cpu_task *)init_data;
+   struct vl_mpeg12_cpu_decoder *dec = task->dec;
+
+   while (1) {
+      pipe_semaphore_wait(&task->work_ready);
+
+      if (dec->exit_flag)
+         break;
+
+      vl_mpg12_bs_decode(&task->bs, dec->job_target, dec->job_picture,
+                         1, &task->data, &task->size);
+
+      pipe_semaphore_signal(&task->work_done);
+   }
+
+   return 0;
+}
+
+static void
+vl_mpeg12_cpu_destroy(struct pipe_video_codec *decoder)
+{
+   struct vl_mpeg12_cpu_decoder *dec = (struct vl_mpeg12_cpu_decoder *)decoder;
+   unsigned i;
+
+   assert(decoder);
+
+   dec->exit_flag = TRUE;
+   for (i = 1; i < dec->num_threads; ++i)
+      pipe_semaphore_signal(&dec->tasks[i].work_ready);
+
+   for (i = 1; i < dec->num_threads; ++i) {
+      pipe_thread_wait(dec->threads[i]);
+      pipe_semaphore_destroy(&dec->tasks[i].work_ready);
+      pipe_semaphore_destroy(&dec->tasks[i].work_done);
+   }
+
+   FREE(dec->bitstream);
+   FREE(dec);
+}
+
+static void
+vl_mpeg12_cpu_begin_frame(struct pipe_video_codec *decoder,
+                          struct pipe_video_buffer *target,
+                          struct pipe_picture_desc *picture)
+{
+   struct vl_mpeg12_cpu_decoder *dec = (struct vl_mpeg12_cpu_decoder *)decoder;
+   struct pipe_mpeg12_picture_desc *desc = (struct pipe_mpeg12_picture_desc *)picture;
+   unsigned i;
+
+   assert(dec && target && picture);
+   assert(!target->interlaced);
+
+   /* this also rules out 16x8 motion, which only field pictures use */
+   if (desc->picture_structure != PIPE_MPEG12_PICTURE_STRUCTURE_FRAME) {
+      debug_printf("[vl] field pictures are unsupported by the CPU decoder\n");
+      return;
+   }
+   dec->top_field_first = desc->top_field_first;
+
+   if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM) {
+      for (i = 0; i < 64; ++i) {
+         dec->intra_matrix[i] = desc->intra_matrix[i];
+         dec->non_intra_matrix[i] = desc->non_intra_matrix[i];
+      }
+      dec->intra_matrix[0] = 1 << (7 - desc->intra_dc_precision);
+      dec->scan = desc->alternate_scan ? vl_zscan_alternate : vl_zscan_normal;
+   } else {
+      for (i = 0; i < 64; ++i)
+         dec->intra_matrix[i] = dec->non_intra_matrix[i] = 0x10;
+      dec->scan = vl_zscan_linear;
+   }
+
+   dec->mapped = map_frame(dec, target, &dec->target, PIPE_TRANSFER_WRITE);
+   if (!dec->mapped) {
+      debug_printf("[vl] unsupported video buffer for CPU decoding\n");
+      return;
+   }
+
+   for (i = 0; i < VL_MAX_REF_FRAMES; ++i) {
+      dec->ref_frames[i] = NULL;
+      if (desc->ref[i] && map_frame(dec, desc->ref[i], &dec->refs[i], PIPE_TRANSFER_READ))
+         dec->ref_frames[i] = &dec->refs[i];
+   }
+}
+
+static void
+vl_mpeg12_cpu_decode_macroblock(struct pipe_video_codec *decoder,
+                                struct pipe_video_buffer *target,
+                                struct pipe_picture_desc *picture,
+                                const struct pipe_macroblock *macroblocks,
+                                unsigned num_macroblocks)
+{
+   struct vl_mpeg12_cpu_decoder *dec = (struct vl_mpeg12_cpu_decoder *)decoder;
+   const struct pipe_mpeg12_macroblock *mb = (const struct pipe_mpeg12_macroblock *)macroblocks;
+   struct pipe_mpeg12_picture_desc *desc = (struct pipe_mpeg12_picture_desc *)picture;
+
+   assert(dec && target && picture);
+   assert(macroblocks && macroblocks->codec == PIPE_VIDEO_FORMAT_MPEG12);
+
+   /* called from the slice threads as well, so only read the decoder state */
+   if (!dec->mapped)
+      return;
+
+   for (; num_macroblocks > 0; --num_macroblocks, ++mb) {
+      decode_macroblock(dec, mb);
+
+      if (mb->num_skipped_macroblocks > 0)
+         skip_macroblocks(dec, desc, mb);
+   }
+}
+
+static void
+vl_mpeg12_cpu_decode_bitstream(struct pipe_video_codec *decoder,
+                               struct pipe_video_buffer *target,
+                               struct pipe_picture_desc *picture,
+                               unsigned num_buffers,
+                               const void * const *buffers,
+                               const unsigned *sizes)
+{
+   struct vl_mpeg12_cpu_decoder *dec = (struct vl_mpeg12_cpu_decoder *)decoder;
+   struct pipe_mpeg12_picture_desc *desc = (struct pipe_mpeg12_picture_desc *)picture;
+   unsigned start[VL_MPEG12_CPU_MAX_THREADS + 1];
+   unsigned i, size, num_tasks;
+   uint8_t *data;
+
+   assert(dec && target && picture);
+
+   if (!dec->mapped)
+      return;
+
+   if (dec->num_threads == 1) {
+      vl_mpg12_bs_decode(&dec->tasks[0].bs, target, desc, num_buffers, buffers, sizes);
+      return;
+   }
+
+   for (i = 0, size = 0; i < num_buffers; ++i)
+      size += sizes[i];
+
+   if (size > dec->bitstream_size) {
+      FREE(dec->bitstream);
+      dec->bitstream = MALLOC(size);
+      dec->bitstream_size = dec->bitstream ? size : 0;
+      if (!dec->bitstream) {
+         vl_mpg12_bs_decode(&dec->tasks[0].bs, target, desc, num_buffers, buffers, sizes);
+         return;
+      }
+   }
+
+   for (i = 0, data = dec->bitstream; i < num_buffers; data += sizes[i], ++i)
+      memcpy(data, buffers[i], sizes[i]);
+   data = dec->bitstream;
+
+   /*
+    * Slices are independent of each other, so split the picture at the slice
+    * start codes into runs of about the same size, one for each thread.
+    */
+   num_tasks = 0;
+   for (i = 0; i + 3 < size; ++i) {
+      if (data[i] || data[i + 1] || data[i + 2] != 0x01 ||
+          data[i + 3] < 0x01 || data[i + 3] > 0xAF)
+         continue;
+
+      if (num_tasks == 0 || (num_tasks < dec->num_threads &&
+                             (uint64_t)i * dec->num_threads >= (uint64_t)size * num_tasks))
+         start[num_tasks++] = i;
+
+      i += 3;
+   }
+   start[num_tasks] = size;
+
+   dec->job_target = target;
+   dec->job_picture = desc;
+
+   for (i = 0; i < num_tasks; ++i) {
+      dec->tasks[i].data = data + start[i];
+      dec->tasks[i].size = start[i + 1] - start[i];
+   }
+
+   for (i = 1; i < num_tasks; ++i)
+      pipe_semaphore_signal(&dec->tasks[i].work_ready);
+
+   if (num_tasks)
+      vl_mpg12_bs_decode(&dec->tasks[0].bs, target, desc,
+                         1, &dec->tasks[0].data, &dec->tasks[0].size);
+
+   for (i = 1; i < num_tasks; ++i)
+      pipe_semaphore_wait(&dec->tasks[i].work_done);
+}
+
+static void
+vl_mpeg12_cpu_end_frame(struct pipe_video_codec *decoder,
+                        struct pipe_video_buffer *target,
+                        struct pipe_picture_desc *picture)
+{
+   struct vl_mpeg12_cpu_decoder *dec = (struct vl_mpeg12_cpu_decoder *)decoder;
+   unsigned i;
+
+   assert(dec && target && picture);
+
+   if (!dec->mapped)
+      return;
+
+   for (i = 0; i < VL_MAX_REF_FRAMES; ++i) {
+      if (dec->ref_frames[i])
+         unmap_frame(dec, dec->ref_frames[i]);
+      dec->ref_frames[i] = NULL;
+   }
+
+   unmap_frame(dec, &dec->target);
+   dec->mapped = false;
+}
+
+static void
+vl_mpeg12_cpu_flush(struct pipe_video_codec *decoder)
+{
+   assert(decoder);
+
+   //Noop, the picture is complete when end_frame returns
+}
+
+struct pipe_video_codec *
+vl_create_mpeg12_cpu_decoder(struct pipe_context *context,
+                             const struct pipe_video_codec *templat)
+{
+   struct vl_mpeg12_cpu_decoder *dec;
+   long num_threads = 1;
+   unsigned i;
+
+   assert(u_reduce_video_profile(templat->profile) == PIPE_VIDEO_FORMAT_MPEG12);
+
+   if (templat->chroma_format != PIPE_VIDEO_CHROMA_FORMAT_420)
+      return NULL;
+
+   dec = CALLOC_STRUCT(vl_mpeg12_cpu_decoder);
+   if (!dec)
+      return NULL;
+
+   dec->base = *templat;
+   dec->base.context = context;
+   dec->base.width = align(templat->width, VL_MACROBLOCK_WIDTH);
+   dec->base.height = align(templat->height, VL_MACROBLOCK_HEIGHT);
+
+   dec->base.destroy = vl_mpeg12_cpu_destroy;
+   dec->base.begin_frame = vl_mpeg12_cpu_begin_frame;
+   dec->base.decode_macroblock = vl_mpeg12_cpu_decode_macroblock;
+   dec->base.decode_bitstream = vl_mpeg12_cpu_decode_bitstream;
+   dec->base.end_frame = vl_mpeg12_cpu_end_frame;
+   dec->base.flush = vl_mpeg12_cpu_flush;
+
+   dec->width_in_macroblocks = dec->base.width / VL_MACROBLOCK_WIDTH;
+   dec->height_in_macroblocks = dec->base.height / VL_MACROBLOCK_HEIGHT;
+
+   /* with the macroblock entrypoints the state tracker feeds us serially */
+   if (templat->entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM) {
+      util_cpu_detect();
+      num_threads = debug_get_num_option("VL_MPEG12_CPU_THREADS",
+                                         util_cpu_caps.nr_cpus);
+   }
+   dec->num_threads = CLAMP(num_threads, 1, VL_MPEG12_CPU_MAX_THREADS);
+
+   for (i = 0; i < dec->num_threads; ++i) {
+      struct vl_mpeg12_cpu_task *task = &dec->tasks[i];
+
+      task->dec = dec;
+      vl_mpg12_bs_init(&task->bs, &dec->base);
+
+      /* the first run of slices is decoded by the calling thread */
+      if (i > 0) {
+         pipe_semaphore_init(&task->work_ready, 0);
+         pipe_semaphore_init(&task->work_done, 0);
+         dec->threads[i] = pipe_thread_create(thread_function, task);
+         if (!dec->threads[i]) {
+            /* go on with the threads already running */
+            pipe_semaphore_destroy(&task->work_ready);
+            pipe_semaphore_destroy(&task->work_done);
+            dec->num_threads = i;
+            break;
+         }
+      }
+   }
+
+   return &dec->base;
+}
@@ -0,0 +1,110 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef vl_mpeg12_cpu_decoder_h
+#define vl_mpeg12_cpu_decoder_h
+
+#include "pipe/p_video_codec.h"
+#include "os/os_thread.h"
+
+#include "vl_defines.h"
+#include "vl_mpeg12_bitstream.h"
+
+#define VL_MPEG12_CPU_MAX_THREADS 8
+
+struct pipe_context;
+struct pipe_transfer;
+
+struct vl_mpeg12_cpu_decoder;
+
+/* a single Y, Cb or Cr component of a mapped video buffer */
+struct vl_mpeg12_cpu_plane
+{
+   uint8_t *map;
+   unsigned stride;
+   unsigned step;  /* bytes between two samples, 2 for interleaved chroma */
+   unsigned width, height;
+};
+
+struct vl_mpeg12_cpu_frame
+{
+   struct vl_mpeg12_cpu_plane components[VL_NUM_COMPONENTS];
+   struct pipe_transfer *transfers[VL_NUM_COMPONENTS];
+};
+
+/* a run of consecutive slices decoded by one thread */
+struct vl_mpeg12_cpu_task
+{
+   struct vl_mpeg12_cpu_decoder *dec;
+   struct vl_mpg12_bs bs;
+
+   const void *data;
+   unsigned size;
+
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+/**
+ * MPEG-1/2 decoder doing the IDCT and motion compensation on the CPU,
+ * for drivers where the shader based decoder would be emulated anyway
+ */
+struct vl_mpeg12_cpu_decoder
+{
+   struct pipe_video_codec base;
+
+   unsigned width_in_macroblocks;
+   unsigned height_in_macroblocks;
+
+   /* dequantisation matrices in raster order and the scan of the coefficients */
+   short intra_matrix[64];
+   short non_intra_matrix[64];
+   const int *scan;
+   unsigned top_field_first;
+
+   bool mapped;
+   struct vl_mpeg12_cpu_frame target;
+   struct vl_mpeg12_cpu_frame refs[VL_MAX_REF_FRAMES];
+   struct vl_mpeg12_cpu_frame *ref_frames[VL_MAX_REF_FRAMES];
+
+   /* the picture currently split across the threads */
+   struct pipe_video_buffer *job_target;
+   struct pipe_mpeg12_picture_desc *job_picture;
+   uint8_t *bitstream;
+   unsigned bitstream_size;
+
+   boolean exit_flag;
+   unsigned num_threads;
+   struct vl_mpeg12_cpu_task tasks[VL_MPEG12_CPU_MAX_THREADS];
+   pipe_thread threads[VL_MPEG12_CPU_MAX_THREADS];
+};
+
+/**
+ * creates a CPU based MPEG-1/2 decoder
+ */
+struct pipe_video_codec *
+vl_create_mpeg12_cpu_decoder(struct pipe_context *pipe,
+                             const struct pipe_video_codec *templat);
+
+#endif /* vl_mpeg12_cpu_decoder_h */
@@ -267,6 +267,7 @@ i915_get_param(struct pipe_screen *screen, enum pipe_cap cap)
    /* Geometry shader output, unsupported. */
    case PIPE_CAP_MAX_GEOMETRY_OUTPUT_VERTICES:
    case PIPE_CAP_MAX_GEOMETRY_TOTAL_OUTPUT_COMPONENTS:
+   case PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT:
       return 0;
 
    /* Fragment coordinate conventions. */
@@ -38,6 +38,7 @@
 #include "lp_setup.h"
 #include "lp_query.h"
 #include "lp_debug.h"
+#include "lp_texture.h"
 
 
 /**
@@ -59,5 +60,17 @@ llvmpipe_clear(struct pipe_context *pipe,
    if (LP_PERF & PERF_NO_DEPTH)
       buffers &= ~PIPE_CLEAR_DEPTHSTENCIL;
 
+   if (buffers & PIPE_CLEAR_COLOR) {
+      const struct pipe_framebuffer_state *fb = &llvmpipe->framebuffer;
+      unsigned i;
+
+      for (i = 0; i < fb->nr_cbufs; i++) {
+         if (fb->cbufs[i] && (buffers & (PIPE_CLEAR_COLOR0 << i)))
+            llvmpipe_resource_add_damage_region(
+                  llvmpipe_resource(fb->cbufs[i]->texture),
+                  0, 0, fb->width, fb->height);
+      }
+   }
+
    lp_setup_clear( llvmpipe->setup, color, depth, stencil, buffers );
 }
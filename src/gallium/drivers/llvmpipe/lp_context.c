@@ -37,11 +37,14 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
+#include "vl/vl_decoder.h"
+#include "vl/vl_video_buffer.h"
 #include "lp_clear.h"
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_perf.h"
 #include "lp_state.h"
+#include "lp_state_cs.h"
 #include "lp_surface.h"
 #include "lp_query.h"
 #include "lp_setup.h"
@@ -95,6 +98,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_resource_reference(&llvmpipe->vertex_buffer[i].buffer, NULL);
    }
 
+   llvmpipe_cleanup_compute(llvmpipe);
+
    lp_delete_setup_variants(llvmpipe);
 
    align_free( llvmpipe );
@@ -151,6 +156,9 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
 
    llvmpipe->pipe.render_condition = llvmpipe_render_condition;
 
+   llvmpipe->pipe.create_video_codec = vl_create_cpu_decoder;
+   llvmpipe->pipe.create_video_buffer = vl_video_buffer_create;
+
    llvmpipe_init_blend_funcs(llvmpipe);
    llvmpipe_init_clip_funcs(llvmpipe);
    llvmpipe_init_draw_funcs(llvmpipe);
@@ -161,6 +169,7 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    llvmpipe_init_fs_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
@@ -48,6 +48,7 @@ struct draw_context;
 struct draw_stage;
 struct lp_fragment_shader;
 struct lp_vertex_shader;
+struct lp_compute_shader;
 struct lp_blend_state;
 struct lp_setup_context;
 struct lp_setup_variant;
@@ -67,6 +68,7 @@ struct llvmpipe_context {
    const struct lp_geometry_shader *gs;
    const struct lp_velems_state *velems;
    const struct lp_so_state *so;
+   struct lp_compute_shader *cs;
 
    /** Other rendering state */
    unsigned sample_mask;
@@ -85,6 +87,11 @@ struct llvmpipe_context {
    struct pipe_resource *mapped_vs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    struct pipe_resource *mapped_gs_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
+   /** Compute state */
+   struct pipe_surface *compute_resources[PIPE_MAX_SHADER_RESOURCES];
+   struct pipe_resource *global_buffers[LP_MAX_GLOBAL_BUFFERS];
+   unsigned global_shift;  /**< see struct lp_jit_cs_context */
+
    unsigned num_samplers[PIPE_SHADER_TYPES];
    unsigned num_sampler_views[PIPE_SHADER_TYPES];
 
@@ -99,6 +106,11 @@ struct llvmpipe_context {
 
    unsigned active_occlusion_queries;
 
+   /** performance / info queries */
+   uint64_t num_resource_stalls;          /**< LP_QUERY_RESOURCE_STALLS */
+   uint64_t num_resource_stalls_avoided;  /**< LP_QUERY_RESOURCE_STALLS_AVOIDED */
+   uint64_t num_resource_copies;          /**< LP_QUERY_RESOURCE_COPIES */
+
    unsigned dirty; /**< Mask of LP_NEW_x flags */
 
    /** Mapped vertex buffers */
@@ -86,6 +86,14 @@ llvmpipe_finish( struct pipe_context *pipe,
    }
 }
 
+static INLINE boolean
+must_flush(unsigned referenced, boolean read_only)
+{
+   return (referenced & LP_REFERENCED_FOR_WRITE) ||
+          ((referenced & LP_REFERENCED_FOR_READ) && !read_only);
+}
+
+
 /**
  * Flush context if necessary.
  *
@@ -98,6 +106,7 @@ boolean
 llvmpipe_flush_resource(struct pipe_context *pipe,
                         struct pipe_resource *resource,
                         unsigned level,
+                        int layer,
                         boolean read_only,
                         boolean cpu_access,
                         boolean do_not_block,
@@ -105,10 +114,9 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
 {
    unsigned referenced;
 
-   referenced = llvmpipe_is_resource_referenced(pipe, resource, level);
+   referenced = llvmpipe_is_resource_referenced(pipe, resource, level, layer);
 
-   if ((referenced & LP_REFERENCED_FOR_WRITE) ||
-       ((referenced & LP_REFERENCED_FOR_READ) && !read_only)) {
+   if (must_flush(referenced, read_only)) {
 
       if (cpu_access) {
          /*
@@ -117,6 +125,7 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
          if (do_not_block)
             return FALSE;
 
+         llvmpipe_context(pipe)->num_resource_stalls++;
          llvmpipe_finish(pipe, reason);
       } else {
          /*
@@ -129,3 +138,40 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
 
    return TRUE;
 }
+
+
+/**
+ * Like llvmpipe_flush_resource() for CPU access to the bytes
+ * [offset, offset + size) of a buffer.  Only waits for the scenes if they
+ * use that range, so writes to other parts of a buffer which is being
+ * drawn from (e.g. through a persistent mapping) don't stall.
+ */
+boolean
+llvmpipe_flush_buffer_range(struct pipe_context *pipe,
+                            struct pipe_resource *buffer,
+                            unsigned offset,
+                            unsigned size,
+                            boolean read_only,
+                            boolean do_not_block,
+                            const char *reason)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned referenced;
+
+   referenced = lp_setup_is_range_referenced(llvmpipe->setup, buffer, 0,
+                                             offset, offset + size);
+
+   if (must_flush(referenced, read_only)) {
+      if (do_not_block)
+         return FALSE;
+
+      llvmpipe->num_resource_stalls++;
+      llvmpipe_finish(pipe, reason);
+   }
+   else if (!read_only &&
+            lp_setup_is_resource_referenced(llvmpipe->setup, buffer)) {
+      llvmpipe->num_resource_stalls_avoided++;
+   }
+
+   return TRUE;
+}
@@ -47,9 +47,19 @@ boolean
 llvmpipe_flush_resource(struct pipe_context *pipe,
                         struct pipe_resource *resource,
                         unsigned level,
+                        int layer,
                         boolean read_only,
                         boolean cpu_access,
                         boolean do_not_block,
                         const char *reason);
 
+boolean
+llvmpipe_flush_buffer_range(struct pipe_context *pipe,
+                            struct pipe_resource *buffer,
+                            unsigned offset,
+                            unsigned size,
+                            boolean read_only,
+                            boolean do_not_block,
+                            const char *reason);
+
 #endif
@@ -38,6 +38,7 @@
 #include "gallivm/lp_bld_debug.h"
 #include "lp_context.h"
 #include "lp_jit.h"
+#include "lp_state_cs.h"
 
 
 static void
@@ -272,3 +273,146 @@ lp_jit_init_types(struct lp_fragment_shader_variant *lp)
    if (!lp->jit_context_ptr_type)
       lp_jit_create_types(lp);
 }
+
+
+static void
+lp_jit_create_cs_types(struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int8_ptr_type = LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+   LLVMTypeRef resource_type;
+
+   /* struct lp_jit_cs_resource */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_RESOURCE_NUM_FIELDS];
+
+      elem_types[LP_JIT_CS_RESOURCE_BASE] = int8_ptr_type;
+      elem_types[LP_JIT_CS_RESOURCE_ROW_STRIDE] =
+      elem_types[LP_JIT_CS_RESOURCE_IMG_STRIDE] = LLVMInt32TypeInContext(lc);
+
+      resource_type = LLVMStructTypeInContext(lc, elem_types,
+                                              Elements(elem_types), 0);
+#if HAVE_LLVM < 0x0300
+      LLVMAddTypeName(gallivm->module, "cs_resource", resource_type);
+
+      LLVMInvalidateStructLayout(gallivm->target, resource_type);
+#endif
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, base,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_BASE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, row_stride,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_ROW_STRIDE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, img_stride,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_IMG_STRIDE);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_resource,
+                           gallivm->target, resource_type);
+   }
+
+   /* struct lp_jit_cs_context */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_CTX_COUNT];
+      LLVMTypeRef context_type;
+
+      elem_types[LP_JIT_CS_CTX_BLOCK_SIZE] =
+      elem_types[LP_JIT_CS_CTX_GRID_SIZE] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), 3);
+      elem_types[LP_JIT_CS_CTX_INPUT] = int8_ptr_type;
+      elem_types[LP_JIT_CS_CTX_GLOBAL] = LLVMPointerType(int8_ptr_type, 0);
+      elem_types[LP_JIT_CS_CTX_NUM_GLOBAL] =
+      elem_types[LP_JIT_CS_CTX_GLOBAL_SHIFT] = LLVMInt32TypeInContext(lc);
+      elem_types[LP_JIT_CS_CTX_RESOURCES] =
+         LLVMArrayType(resource_type, PIPE_MAX_SHADER_RESOURCES);
+
+      context_type = LLVMStructTypeInContext(lc, elem_types,
+                                             Elements(elem_types), 0);
+#if HAVE_LLVM < 0x0300
+      LLVMInvalidateStructLayout(gallivm->target, context_type);
+
+      LLVMAddTypeName(gallivm->module, "cs_context", context_type);
+#endif
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, block_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_BLOCK_SIZE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, grid_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_GRID_SIZE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, input,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_INPUT);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, global,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_GLOBAL);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, num_global,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_NUM_GLOBAL);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, global_shift,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_GLOBAL_SHIFT);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, resources,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_RESOURCES);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_context,
+                           gallivm->target, context_type);
+
+      variant->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+   }
+
+   /* struct lp_jit_cs_thread_data */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_THREAD_DATA_COUNT];
+      LLVMTypeRef thread_data_type;
+
+      elem_types[LP_JIT_CS_THREAD_DATA_BLOCK_ID] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), 3);
+      elem_types[LP_JIT_CS_THREAD_DATA_FIRST_THREAD] =
+         LLVMInt32TypeInContext(lc);
+      elem_types[LP_JIT_CS_THREAD_DATA_LOCAL_MEM] =
+      elem_types[LP_JIT_CS_THREAD_DATA_PRIVATE_MEM] =
+      elem_types[LP_JIT_CS_THREAD_DATA_FIBER] = int8_ptr_type;
+
+      thread_data_type = LLVMStructTypeInContext(lc, elem_types,
+                                                 Elements(elem_types), 0);
+#if HAVE_LLVM < 0x0300
+      LLVMInvalidateStructLayout(gallivm->target, thread_data_type);
+
+      LLVMAddTypeName(gallivm->module, "cs_thread_data", thread_data_type);
+#endif
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_thread_data, block_id,
+                             gallivm->target, thread_data_type,
+                             LP_JIT_CS_THREAD_DATA_BLOCK_ID);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_thread_data, first_thread,
+                             gallivm->target, thread_data_type,
+                             LP_JIT_CS_THREAD_DATA_FIRST_THREAD);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_thread_data, local_mem,
+                             gallivm->target, thread_data_type,
+                             LP_JIT_CS_THREAD_DATA_LOCAL_MEM);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_thread_data, private_mem,
+                             gallivm->target, thread_data_type,
+                             LP_JIT_CS_THREAD_DATA_PRIVATE_MEM);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_thread_data, fiber,
+                             gallivm->target, thread_data_type,
+                             LP_JIT_CS_THREAD_DATA_FIBER);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_thread_data,
+                           gallivm->target, thread_data_type);
+
+      variant->jit_thread_data_ptr_type = LLVMPointerType(thread_data_type, 0);
+   }
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMDumpModule(gallivm->module);
+   }
+}
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *variant)
+{
+   if (!variant->jit_context_ptr_type)
+      lp_jit_create_cs_types(variant);
+}
@@ -44,6 +44,7 @@
 
 
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
 struct llvmpipe_screen;
 
 
@@ -248,6 +249,123 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * A RAW-addressed compute resource, RES[n].
+ */
+struct lp_jit_cs_resource
+{
+   uint8_t *base;
+   uint32_t row_stride;
+   uint32_t img_stride;
+};
+
+
+enum {
+   LP_JIT_CS_RESOURCE_BASE = 0,
+   LP_JIT_CS_RESOURCE_ROW_STRIDE,
+   LP_JIT_CS_RESOURCE_IMG_STRIDE,
+   LP_JIT_CS_RESOURCE_NUM_FIELDS  /* number of fields above */
+};
+
+
+/**
+ * State of a grid launch, shared by all its blocks.
+ *
+ * GLOBAL addresses are handles made by set_global_binding: the bits above
+ * global_shift select an entry of the global[] table, where entry zero is
+ * a scratch area NULL pointers land in, the bits below are the offset.
+ */
+struct lp_jit_cs_context
+{
+   uint32_t block_size[3];
+   uint32_t grid_size[3];
+
+   uint8_t *input;
+
+   uint8_t **global;
+   uint32_t num_global;     /**< last valid index of global[] */
+   uint32_t global_shift;
+
+   struct lp_jit_cs_resource resources[PIPE_MAX_SHADER_RESOURCES];
+};
+
+
+enum {
+   LP_JIT_CS_CTX_BLOCK_SIZE = 0,
+   LP_JIT_CS_CTX_GRID_SIZE,
+   LP_JIT_CS_CTX_INPUT,
+   LP_JIT_CS_CTX_GLOBAL,
+   LP_JIT_CS_CTX_NUM_GLOBAL,
+   LP_JIT_CS_CTX_GLOBAL_SHIFT,
+   LP_JIT_CS_CTX_RESOURCES,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_block_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_BLOCK_SIZE, "block_size")
+
+#define lp_jit_cs_context_grid_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_GRID_SIZE, "grid_size")
+
+#define lp_jit_cs_context_input(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_INPUT, "input")
+
+#define lp_jit_cs_context_global(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_GLOBAL, "global")
+
+#define lp_jit_cs_context_num_global(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_GLOBAL, "num_global")
+
+#define lp_jit_cs_context_global_shift(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_GLOBAL_SHIFT, "global_shift")
+
+#define lp_jit_cs_context_resources(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_RESOURCES, "resources")
+
+
+/**
+ * State of one call of the compute function, which runs as many threads
+ * of a block as there are lanes in a vector.
+ */
+struct lp_jit_cs_thread_data
+{
+   uint32_t block_id[3];
+   uint32_t first_thread;   /**< linear index in the block of lane 0 */
+   uint8_t *local_mem;
+   uint8_t *private_mem;    /**< private memory of lane 0 */
+   void *fiber;             /**< passed to the barrier function */
+};
+
+
+enum {
+   LP_JIT_CS_THREAD_DATA_BLOCK_ID = 0,
+   LP_JIT_CS_THREAD_DATA_FIRST_THREAD,
+   LP_JIT_CS_THREAD_DATA_LOCAL_MEM,
+   LP_JIT_CS_THREAD_DATA_PRIVATE_MEM,
+   LP_JIT_CS_THREAD_DATA_FIBER,
+   LP_JIT_CS_THREAD_DATA_COUNT
+};
+
+
+#define lp_jit_cs_thread_data_block_id(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_THREAD_DATA_BLOCK_ID, "block_id")
+
+#define lp_jit_cs_thread_data_first_thread(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_THREAD_DATA_FIRST_THREAD, "first_thread")
+
+#define lp_jit_cs_thread_data_local_mem(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_THREAD_DATA_LOCAL_MEM, "local_mem")
+
+#define lp_jit_cs_thread_data_private_mem(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_THREAD_DATA_PRIVATE_MEM, "private_mem")
+
+
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  struct lp_jit_cs_thread_data *thread_data);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -260,4 +378,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *variant);
+
+
 #endif /* LP_JIT_H */
@@ -91,4 +91,21 @@
  */
 #define LP_MAX_SETUP_VARIANTS 64
 
+
+/**
+ * Compute limits.  A block runs as a few calls of the compute function,
+ * and with barriers every call needs a fiber stack of LP_CS_STACK_SIZE.
+ *
+ * GLOBAL handles are 32 bits: the buffer index plus one, which takes 6 bits
+ * for 32 buffers, above an offset of up to 26 bits.  That bounds the size
+ * of a global buffer.
+ */
+#define LP_MAX_GLOBAL_BUFFERS 32
+#define LP_MAX_CS_THREADS_PER_BLOCK 1024
+#define LP_MAX_CS_LOCAL_SIZE (32 * 1024)
+#define LP_MAX_CS_PRIVATE_SIZE (8 * 1024)
+#define LP_MAX_CS_INPUT_SIZE 4096
+#define LP_MAX_CS_MEM_ALLOC_SIZE (64 * 1024 * 1024)
+#define LP_CS_STACK_SIZE (128 * 1024)
+
 #endif /* LP_LIMITS_H */
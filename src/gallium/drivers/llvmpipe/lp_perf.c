@@ -102,6 +102,14 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
+      if (lp_count.nr_presents) {
+         debug_printf("llvmpipe: nr_presents:                  %9u\n", lp_count.nr_presents);
+         debug_printf("llvmpipe:   bytes per present:          %9.0f (%3.0f%% of full surface)\n",
+                      (double) lp_count.nr_present_bytes / lp_count.nr_presents,
+                      100.0 * (double) lp_count.nr_present_bytes /
+                      (double) lp_count.nr_full_present_bytes);
+      }
+
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
@@ -62,6 +62,10 @@ struct lp_counters
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   unsigned nr_presents;
+   uint64_t nr_present_bytes;       /**< copied to the window system */
+   uint64_t nr_full_present_bytes;  /**< had whole surfaces been copied */
 };
 
 
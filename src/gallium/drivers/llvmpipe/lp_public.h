@@ -7,4 +7,7 @@ struct sw_winsys;
 struct pipe_screen *
 llvmpipe_create_screen(struct sw_winsys *winsys);
 
+struct pipe_screen *
+llvmpipe_create_screen_threads(struct sw_winsys *winsys, int num_threads);
+
 #endif
@@ -54,7 +54,10 @@ llvmpipe_create_query(struct pipe_context *pipe,
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          type == LP_QUERY_RESOURCE_STALLS ||
+          type == LP_QUERY_RESOURCE_STALLS_AVOIDED ||
+          type == LP_QUERY_RESOURCE_COPIES);
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -174,6 +177,11 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       *stats = pq->stats;
    }
       break;
+   case LP_QUERY_RESOURCE_STALLS:
+   case LP_QUERY_RESOURCE_STALLS_AVOIDED:
+   case LP_QUERY_RESOURCE_COPIES:
+      *result = pq->count;
+      break;
    default:
       assert(0);
       break;
@@ -189,6 +197,21 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   /* The driver queries are counted on the CPU, they don't need a scene */
+   switch (pq->type) {
+   case LP_QUERY_RESOURCE_STALLS:
+      pq->count = llvmpipe->num_resource_stalls;
+      return;
+   case LP_QUERY_RESOURCE_STALLS_AVOIDED:
+      pq->count = llvmpipe->num_resource_stalls_avoided;
+      return;
+   case LP_QUERY_RESOURCE_COPIES:
+      pq->count = llvmpipe->num_resource_copies;
+      return;
+   default:
+      break;
+   }
+
    /* Check if the query is already in the scene.  If so, we need to
     * flush the scene now.  Real apps shouldn't re-use a query in a
     * frame of rendering.
@@ -243,6 +266,20 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   switch (pq->type) {
+   case LP_QUERY_RESOURCE_STALLS:
+      pq->count = llvmpipe->num_resource_stalls - pq->count;
+      return;
+   case LP_QUERY_RESOURCE_STALLS_AVOIDED:
+      pq->count = llvmpipe->num_resource_stalls_avoided - pq->count;
+      return;
+   case LP_QUERY_RESOURCE_COPIES:
+      pq->count = llvmpipe->num_resource_copies - pq->count;
+      return;
+   default:
+      break;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
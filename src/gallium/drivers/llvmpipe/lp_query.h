@@ -41,6 +41,12 @@
 struct llvmpipe_context;
 
 
+/** Driver queries for the gallium HUD */
+#define LP_QUERY_RESOURCE_STALLS          (PIPE_QUERY_DRIVER_SPECIFIC + 0)
+#define LP_QUERY_RESOURCE_STALLS_AVOIDED  (PIPE_QUERY_DRIVER_SPECIFIC + 1)
+#define LP_QUERY_RESOURCE_COPIES          (PIPE_QUERY_DRIVER_SPECIFIC + 2)
+
+
 struct llvmpipe_query {
    uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
    uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
@@ -48,6 +54,7 @@ struct llvmpipe_query {
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
    unsigned num_primitives_written;
+   uint64_t count;                  /* LP_QUERY_x count */
 
    struct pipe_query_data_pipeline_statistics stats;
 };
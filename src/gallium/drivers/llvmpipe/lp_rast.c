@@ -799,6 +799,43 @@ lp_rast_finish( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Run func on every rasterizer thread, or on the calling thread if there
+ * are none, and wait for all of them to return.
+ * The caller must hold the screen's rast_mutex, like for scenes.
+ */
+void
+lp_rast_run_compute( struct lp_rasterizer *rast,
+                     lp_rast_compute_func func,
+                     void *data )
+{
+   if (rast->num_threads == 0) {
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+      func(data, 0, 1);
+      util_fpstate_set(fpstate);
+   }
+   else {
+      unsigned i;
+
+      rast->compute_func = func;
+      rast->compute_data = data;
+
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_signal(&rast->tasks[i].work_ready);
+      }
+
+      for (i = 0; i < rast->num_threads; i++) {
+         pipe_semaphore_wait(&rast->tasks[i].work_done);
+      }
+
+      rast->compute_func = NULL;
+      rast->compute_data = NULL;
+   }
+}
+
+
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
@@ -827,6 +864,14 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       if (rast->exit_flag)
          break;
 
+      if (rast->compute_func) {
+         /* compute work, no scene involved */
+         rast->compute_func(rast->compute_data,
+                            task->thread_index, rast->num_threads);
+         pipe_semaphore_signal(&task->work_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -157,6 +157,20 @@ void
 lp_rast_finish( struct lp_rasterizer *rast );
 
 
+/**
+ * Function run by every rasterizer thread for lp_rast_run_compute(),
+ * with the index of the thread and the number of threads.
+ */
+typedef void (*lp_rast_compute_func)(void *data,
+                                     unsigned thread_index,
+                                     unsigned num_threads);
+
+void
+lp_rast_run_compute( struct lp_rasterizer *rast,
+                     lp_rast_compute_func func,
+                     void *data );
+
+
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
    struct {
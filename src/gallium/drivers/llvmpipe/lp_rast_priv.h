@@ -131,6 +131,10 @@ struct lp_rasterizer
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
+
+   /** Compute work the threads run instead of a scene, if set */
+   lp_rast_compute_func compute_func;
+   void *compute_data;
 };
 
 
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 #include "util/u_framebuffer.h"
+#include "util/u_atomic.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
@@ -34,6 +35,7 @@
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -41,10 +43,19 @@
 /** List of resource references */
 struct resource_ref {
    struct pipe_resource *resource[RESOURCE_REF_SZ];
+   unsigned levels[RESOURCE_REF_SZ];  /**< bitmask of referenced levels */
+   unsigned begin[RESOURCE_REF_SZ];   /**< first referenced layer or byte */
+   unsigned end[RESOURCE_REF_SZ];     /**< past the last one */
    int count;
    struct resource_ref *next;
 };
 
+/** Texture storage which was replaced while the scene still read it */
+struct retired_storage {
+   void *data;
+   struct retired_storage *next;
+};
+
 
 /**
  * Create a new scene object.
@@ -262,6 +273,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                             ref->resource[i]->height0,
                             llvmpipe_resource_size(ref->resource[i]));
             j++;
+            p_atomic_dec(&llvmpipe_resource(ref->resource[i])->scene_refs);
             pipe_resource_reference(&ref->resource[i], NULL);
          }
       }
@@ -271,6 +283,16 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
+   /* Free the texture storage that was only kept for this scene, before
+    * the list itself goes away with the data blocks.
+    */
+   {
+      struct retired_storage *retired;
+
+      for (retired = scene->retired; retired; retired = retired->next)
+         align_free(retired->data);
+   }
+
    /* Free all scene data blocks:
     */
    {
@@ -289,6 +311,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
    lp_fence_reference(&scene->fence, NULL);
 
    scene->resources = NULL;
+   scene->retired = NULL;
    scene->scene_size = 0;
    scene->resource_reference_size = 0;
 
@@ -368,10 +391,15 @@ lp_scene_data_size( const struct lp_scene *scene )
 
 /**
  * Add a reference to a resource by the scene.
+ * For textures, \p levels is the bitmask of referenced mipmap levels and
+ * [begin, end) the referenced layers, or 0 and ~0 for all of them.
+ * For buffers, \p levels is 1 and [begin, end) the referenced bytes.
  */
 boolean
 lp_scene_add_resource_reference(struct lp_scene *scene,
                                 struct pipe_resource *resource,
+                                unsigned levels,
+                                unsigned begin, unsigned end,
                                 boolean initializing_scene)
 {
    struct resource_ref *ref, **last = &scene->resources;
@@ -384,9 +412,14 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
       /* Search for this resource:
        */
-      for (i = 0; i < ref->count; i++)
-         if (ref->resource[i] == resource)
+      for (i = 0; i < ref->count; i++) {
+         if (ref->resource[i] == resource) {
+            ref->levels[i] |= levels;
+            ref->begin[i] = MIN2(ref->begin[i], begin);
+            ref->end[i] = MAX2(ref->end[i], end);
             return TRUE;
+         }
+      }
 
       if (ref->count < RESOURCE_REF_SZ) {
          /* If the block is half-empty, then append the reference here.
@@ -409,7 +442,11 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
    /* Append the reference to the reference block.
     */
+   ref->levels[ref->count] = levels;
+   ref->begin[ref->count] = begin;
+   ref->end[ref->count] = end;
    pipe_resource_reference(&ref->resource[ref->count++], resource);
+   p_atomic_inc(&llvmpipe_resource(resource)->scene_refs);
    scene->resource_reference_size += llvmpipe_resource_size(resource);
 
    /* Heuristic to advise scene flushes.  This isn't helpful in the
@@ -445,6 +482,53 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 }
 
 
+/**
+ * Does this scene reference any of the layers [begin, end) of the given
+ * level of a texture, or any of the bytes [begin, end) of a buffer (with
+ * level 0)?
+ */
+boolean
+lp_scene_is_range_referenced(const struct lp_scene *scene,
+                             const struct pipe_resource *resource,
+                             unsigned level,
+                             unsigned begin, unsigned end)
+{
+   const struct resource_ref *ref;
+   int i;
+
+   for (ref = scene->resources; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++)
+         if (ref->resource[i] == resource)
+            return (ref->levels[i] & (1u << level)) &&
+                   begin < ref->end[i] && ref->begin[i] < end;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Keep the given texture storage, which the scene's commands may still
+ * read, until the scene has been rasterized, then free it with
+ * align_free().
+ */
+boolean
+lp_scene_retire_storage(struct lp_scene *scene, void *data)
+{
+   struct retired_storage *retired;
+
+   retired = lp_scene_alloc(scene, sizeof *retired);
+   if (!retired)
+      return FALSE;
+
+   retired->data = data;
+   retired->next = scene->retired;
+   scene->retired = retired;
+
+   return TRUE;
+}
+
+
 
 
 /** advance curr_x,y to the next bin */
@@ -547,8 +631,70 @@ void lp_scene_begin_binning( struct lp_scene *scene,
 }
 
 
+/**
+ * Add the tiles the scene draws to to the damage of the display targets it
+ * renders into.
+ */
+static void
+lp_scene_update_damage(struct lp_scene *scene)
+{
+   struct u_rect bins;
+   boolean any_dt = FALSE;
+   unsigned i, x, y;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      if (cbuf && llvmpipe_resource(cbuf->texture)->dt)
+         any_dt = TRUE;
+   }
+
+   if (!any_dt)
+      return;
+
+   bins.x0 = scene->tiles_x;
+   bins.y0 = scene->tiles_y;
+   bins.x1 = bins.y1 = -1;
+
+   for (y = 0; y < scene->tiles_y; y++) {
+      for (x = 0; x < scene->tiles_x; x++) {
+         const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+
+         /* lp_scene_bin_reset() leaves an empty block behind. */
+         if (bin->head && (bin->head != bin->tail || bin->head->count)) {
+            bins.x0 = MIN2(bins.x0, (int) x);
+            bins.y0 = MIN2(bins.y0, (int) y);
+            bins.x1 = MAX2(bins.x1, (int) x);
+            bins.y1 = MAX2(bins.y1, (int) y);
+         }
+      }
+   }
+
+   if (bins.x0 > bins.x1)
+      return;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      struct llvmpipe_resource *lpr;
+
+      if (!cbuf)
+         continue;
+
+      lpr = llvmpipe_resource(cbuf->texture);
+      if (lpr->dt) {
+         llvmpipe_resource_add_damage(lpr,
+               bins.x0 * TILE_SIZE,
+               bins.y0 * TILE_SIZE,
+               MIN2((bins.x1 + 1) * TILE_SIZE, (int) scene->fb.width) - 1,
+               MIN2((bins.y1 + 1) * TILE_SIZE, (int) scene->fb.height) - 1);
+      }
+   }
+}
+
+
 void lp_scene_end_binning( struct lp_scene *scene )
 {
+   lp_scene_update_damage(scene);
+
    if (LP_DEBUG & DEBUG_SCENE) {
       debug_printf("rasterize scene:\n");
       debug_printf("  scene_size: %u\n",
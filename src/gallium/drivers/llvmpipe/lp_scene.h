@@ -116,6 +116,7 @@ struct data_block_list {
 };
 
 struct resource_ref;
+struct retired_storage;
 
 /**
  * All bins and bin data are contained here.
@@ -153,6 +154,9 @@ struct lp_scene {
    /** list of resources referenced by the scene commands */
    struct resource_ref *resources;
 
+   /** texture storage replaced by copy-on-write, freed with the scene */
+   struct retired_storage *retired;
+
    /** Total memory used by the scene (in bytes).  This sums all the
     * data blocks and counts all bins, state, resource references and
     * other random allocations within the scene.
@@ -197,11 +201,20 @@ struct cmd_block *lp_scene_new_cmd_block( struct lp_scene *scene,
 
 boolean lp_scene_add_resource_reference(struct lp_scene *scene,
                                         struct pipe_resource *resource,
+                                        unsigned levels,
+                                        unsigned begin, unsigned end,
                                         boolean initializing_scene);
 
 boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                         const struct pipe_resource *resource );
 
+boolean lp_scene_is_range_referenced(const struct lp_scene *scene,
+                                     const struct pipe_resource *resource,
+                                     unsigned level,
+                                     unsigned begin, unsigned end);
+
+boolean lp_scene_retire_storage(struct lp_scene *scene, void *data);
+
 
 /**
  * Allocate space for a command/data in the bin's data buffer.
@@ -26,6 +26,7 @@
  **************************************************************************/
 
 
+#include "util/u_box.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_cpu_detect.h"
@@ -36,6 +37,8 @@
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
+#include "vl/vl_decoder.h"
+#include "vl/vl_video_buffer.h"
 
 #include "os/os_time.h"
 #include "lp_texture.h"
@@ -44,7 +47,9 @@
 #include "lp_screen.h"
 #include "lp_context.h"
 #include "lp_debug.h"
+#include "lp_perf.h"
 #include "lp_public.h"
+#include "lp_query.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
 
@@ -80,6 +85,7 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_damage",      PERF_NO_DAMAGE, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -192,6 +198,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_MAX_GEOMETRY_OUTPUT_VERTICES:
    case PIPE_CAP_MAX_GEOMETRY_TOTAL_OUTPUT_COMPONENTS:
       return 1024;
+   case PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT:
+      return 1;
    case PIPE_CAP_STREAM_OUTPUT_PAUSE_RESUME:
       return 1;
    case PIPE_CAP_TGSI_CAN_COMPACT_CONSTANTS:
@@ -204,7 +212,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
    case PIPE_CAP_USER_INDEX_BUFFERS:
       return 1;
@@ -274,6 +282,73 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      case PIPE_SHADER_CAP_PREFERRED_IR:
+         return PIPE_SHADER_IR_TGSI;
+      default:
+         return gallivm_get_shader_param(param);
+      }
+   default:
+      return 0;
+   }
+}
+
+static int
+llvmpipe_get_compute_param(struct pipe_screen *screen,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   static const char ir_target[] = "llvmpipe";
+   uint64_t *ret64 = (uint64_t *) ret;
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      if (ret)
+         memcpy(ret, ir_target, sizeof ir_target);
+      return sizeof ir_target;
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      if (ret)
+         ret64[0] = 3;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         ret64[0] = 65535;
+         ret64[1] = 65535;
+         ret64[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         ret64[0] = LP_MAX_CS_THREADS_PER_BLOCK;
+         ret64[1] = LP_MAX_CS_THREADS_PER_BLOCK;
+         ret64[2] = 64;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret)
+         ret64[0] = LP_MAX_CS_THREADS_PER_BLOCK;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      if (ret)
+         ret64[0] = (uint64_t) LP_MAX_GLOBAL_BUFFERS * LP_MAX_CS_MEM_ALLOC_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_LOCAL_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_PRIVATE_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_INPUT_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_MEM_ALLOC_SIZE;
+      return sizeof(uint64_t);
    default:
       return 0;
    }
@@ -307,6 +382,34 @@ llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 }
 
 
+static int
+llvmpipe_get_video_param(struct pipe_screen *screen,
+                         enum pipe_video_profile profile,
+                         enum pipe_video_entrypoint entrypoint,
+                         enum pipe_video_cap param)
+{
+   switch (param) {
+   case PIPE_VIDEO_CAP_SUPPORTED:
+      return vl_profile_supported(screen, profile, entrypoint);
+   case PIPE_VIDEO_CAP_NPOT_TEXTURES:
+      return 1;
+   case PIPE_VIDEO_CAP_MAX_WIDTH:
+   case PIPE_VIDEO_CAP_MAX_HEIGHT:
+      return vl_video_buffer_max_size(screen);
+   case PIPE_VIDEO_CAP_PREFERED_FORMAT:
+      return PIPE_FORMAT_NV12;
+   case PIPE_VIDEO_CAP_PREFERS_INTERLACED:
+      return false;
+   case PIPE_VIDEO_CAP_SUPPORTS_INTERLACED:
+      return false;
+   case PIPE_VIDEO_CAP_SUPPORTS_PROGRESSIVE:
+      return true;
+   default:
+      return 0;
+   }
+}
+
+
 /**
  * Query format support for creating a texture, drawing surface, etc.
  * \param format  the format to test
@@ -419,10 +522,57 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
    struct llvmpipe_resource *texture = llvmpipe_resource(resource);
+   const struct u_rect *damage = &texture->damage;
+   const boolean whole_damage = sub_box == NULL;
+   unsigned cpp = util_format_get_blocksize(resource->format);
+   struct pipe_box box;
 
    assert(texture->dt);
-   if (texture->dt)
-      winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
+   if (!texture->dt)
+      return;
+
+   /* Without an explicit region, only present what was drawn since the
+    * last present.  New display targets, which is what a resize or a new
+    * loader gives us, start out wholly damaged; an expose is reported by
+    * the winsys.
+    */
+   if (whole_damage && !(LP_PERF & PERF_NO_DAMAGE)) {
+      if (winsys->displaytarget_contents_lost &&
+          winsys->displaytarget_contents_lost(winsys, texture->dt)) {
+         llvmpipe_resource_add_damage(texture, 0, 0,
+                                      resource->width0 - 1,
+                                      resource->height0 - 1);
+      }
+
+      if (damage->x0 > damage->x1)
+         return;
+
+      if (damage->x0 > 0 || damage->y0 > 0 ||
+          damage->x1 < (int) resource->width0 - 1 ||
+          damage->y1 < (int) resource->height0 - 1) {
+         u_box_2d(damage->x0, damage->y0,
+                  damage->x1 - damage->x0 + 1,
+                  damage->y1 - damage->y0 + 1, &box);
+         sub_box = &box;
+      }
+   }
+
+   LP_COUNT(nr_presents);
+   LP_COUNT_ADD(nr_full_present_bytes,
+                (uint64_t) resource->width0 * resource->height0 * cpp);
+   if (sub_box) {
+      LP_COUNT_ADD(nr_present_bytes,
+                   (uint64_t) sub_box->width * sub_box->height * cpp);
+   }
+   else {
+      LP_COUNT_ADD(nr_present_bytes,
+                   (uint64_t) resource->width0 * resource->height0 * cpp);
+   }
+
+   if (whole_damage)
+      llvmpipe_resource_clear_damage(texture);
+
+   winsys->displaytarget_display(winsys, texture->dt, context_private, sub_box);
 }
 
 static void
@@ -494,12 +644,36 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   static const struct pipe_driver_query_info queries[] = {
+      {"resource-stalls", LP_QUERY_RESOURCE_STALLS, 0, FALSE},
+      {"resource-stalls-avoided", LP_QUERY_RESOURCE_STALLS_AVOIDED, 0, FALSE},
+      {"resource-copies", LP_QUERY_RESOURCE_COPIES, 0, FALSE}
+   };
+
+   if (!info)
+      return Elements(queries);
+
+   if (index >= Elements(queries))
+      return 0;
+
+   *info = queries[index];
+   return 1;
+}
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
+ *
+ * \param num_threads  number of rasterizer threads, or -1 for one per CPU.
+ *                     LP_NUM_THREADS overrides either.
  */
 struct pipe_screen *
-llvmpipe_create_screen(struct sw_winsys *winsys)
+llvmpipe_create_screen_threads(struct sw_winsys *winsys, int num_threads)
 {
    struct llvmpipe_screen *screen;
 
@@ -529,8 +703,11 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_vendor = llvmpipe_get_vendor;
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_video_param = llvmpipe_get_video_param;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
+   screen->base.is_video_format_supported = vl_video_buffer_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
    screen->base.flush_frontbuffer = llvmpipe_flush_frontbuffer;
@@ -539,6 +716,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -548,6 +726,8 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 #ifdef PIPE_SUBSYSTEM_EMBEDDED
    screen->num_threads = 0;
 #endif
+   if (num_threads >= 0)
+      screen->num_threads = num_threads;
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
@@ -563,3 +743,10 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    return &screen->base;
 }
+
+
+struct pipe_screen *
+llvmpipe_create_screen(struct sw_winsys *winsys)
+{
+   return llvmpipe_create_screen_threads(winsys, -1);
+}
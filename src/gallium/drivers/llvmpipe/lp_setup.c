@@ -35,6 +35,7 @@
 #include <limits.h>
 
 #include "pipe/p_defines.h"
+#include "util/u_atomic.h"
 #include "util/u_framebuffer.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
@@ -714,6 +715,9 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
           * reference to it.
           */
          pipe_resource_reference(&setup->fs.current_tex[i], res);
+         setup->fs.current_tex_levels[i] = 1;
+         setup->fs.current_tex_begin[i] = 0;
+         setup->fs.current_tex_end[i] = ~0u;
 
          if (!lp_tex->dt) {
             /* regular texture - setup array of mipmap level offsets */
@@ -789,7 +793,13 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
                      }
                      assert(view->u.tex.first_layer <= view->u.tex.last_layer);
                      assert(view->u.tex.last_layer < res->array_size);
+
+                     setup->fs.current_tex_begin[i] = view->u.tex.first_layer;
+                     setup->fs.current_tex_end[i] = view->u.tex.last_layer + 1;
                   }
+
+                  setup->fs.current_tex_levels[i] =
+                     ((2u << last_level) - 1) & ~((1u << first_level) - 1);
                }
                else {
                   /*
@@ -809,6 +819,11 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
                   /* XXX Unsure if we need to sanitize parameters? */
                   assert(view->u.buf.first_element <= view->u.buf.last_element);
                   assert(view->u.buf.last_element * view_blocksize < res->width0);
+
+                  setup->fs.current_tex_begin[i] =
+                     view->u.buf.first_element * view_blocksize;
+                  setup->fs.current_tex_end[i] =
+                     (view->u.buf.last_element + 1) * view_blocksize;
                }
             }
          }
@@ -900,6 +915,98 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
 }
 
 
+/**
+ * Does the surface render to the layers [begin, end) of the given level?
+ */
+static boolean
+surface_overlaps(const struct pipe_surface *surf,
+                 const struct pipe_resource *resource,
+                 unsigned level,
+                 unsigned begin, unsigned end)
+{
+   if (!surf || surf->texture != resource)
+      return FALSE;
+
+   if (resource->target == PIPE_BUFFER)
+      return TRUE;
+
+   return surf->u.tex.level == level &&
+          begin <= surf->u.tex.last_layer && surf->u.tex.first_layer < end;
+}
+
+
+/**
+ * Like lp_setup_is_resource_referenced(), but only considers the layers
+ * [begin, end) of one level of a texture, or the bytes [begin, end) of a
+ * buffer with level 0, so that the CPU can access the parts which the
+ * scenes don't use without waiting for them.
+ */
+unsigned
+lp_setup_is_range_referenced( const struct lp_setup_context *setup,
+                              const struct pipe_resource *resource,
+                              unsigned level,
+                              unsigned begin, unsigned end )
+{
+   unsigned i;
+
+   for (i = 0; i < setup->fb.nr_cbufs; i++) {
+      if (surface_overlaps(setup->fb.cbufs[i], resource, level, begin, end))
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+   if (surface_overlaps(setup->fb.zsbuf, resource, level, begin, end))
+      return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+
+   for (i = 0; i < Elements(setup->scenes); i++) {
+      if (lp_scene_is_range_referenced(setup->scenes[i], resource,
+                                       level, begin, end)) {
+         return LP_REFERENCED_FOR_READ;
+      }
+   }
+
+   return LP_UNREFERENCED;
+}
+
+
+/**
+ * The CPU is about to write to a texture which only the scene being
+ * built reads from, and gave it new storage.  Have the scene free the
+ * old storage, which its commands still point to, once it's done.
+ *
+ * Returns FALSE if any other scene, in this context or another one, may
+ * still use the texture, or if the scene renders to it, in which case
+ * the caller has to wait for the scenes instead.
+ */
+boolean
+lp_setup_retire_texture_storage( struct lp_setup_context *setup,
+                                 struct pipe_resource *texture,
+                                 void *data )
+{
+   struct lp_scene *scene = setup->scene;
+   unsigned i, j;
+
+   if (!scene ||
+       p_atomic_read(&llvmpipe_resource(texture)->scene_refs) != 1 ||
+       !lp_scene_is_resource_referenced(scene, texture))
+      return FALSE;
+
+   /* Scenes map their render targets when they are rasterized, not when
+    * they are binned, so the framebuffers of all of them matter.
+    */
+   for (i = 0; i < Elements(setup->scenes); i++) {
+      const struct pipe_framebuffer_state *fb = &setup->scenes[i]->fb;
+
+      for (j = 0; j < fb->nr_cbufs; j++) {
+         if (fb->cbufs[j] && fb->cbufs[j]->texture == texture)
+            return FALSE;
+      }
+      if (fb->zsbuf && fb->zsbuf->texture == texture)
+         return FALSE;
+   }
+
+   return lp_scene_retire_storage(scene, data);
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
@@ -1065,6 +1172,9 @@ try_update_scene_state( struct lp_setup_context *setup )
             if (setup->fs.current_tex[i]) {
                if (!lp_scene_add_resource_reference(scene,
                                                     setup->fs.current_tex[i],
+                                                    setup->fs.current_tex_levels[i],
+                                                    setup->fs.current_tex_begin[i],
+                                                    setup->fs.current_tex_end[i],
                                                     new_scene)) {
                   assert(!new_scene);
                   return FALSE;
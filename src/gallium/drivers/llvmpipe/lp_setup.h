@@ -139,6 +139,17 @@ unsigned
 lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture );
 
+unsigned
+lp_setup_is_range_referenced( const struct lp_setup_context *setup,
+                              const struct pipe_resource *resource,
+                              unsigned level,
+                              unsigned begin, unsigned end );
+
+boolean
+lp_setup_retire_texture_storage( struct lp_setup_context *setup,
+                                 struct pipe_resource *texture,
+                                 void *data );
+
 void
 lp_setup_set_flatshade_first( struct lp_setup_context *setup, 
                               boolean flatshade_first );
@@ -131,6 +131,10 @@ struct lp_setup_context
       const struct lp_rast_state *stored; /**< what's in the scene */
       struct lp_rast_state current;  /**< currently set state */
       struct pipe_resource *current_tex[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+      /** levels, and layers or bytes of buffers, the views refer to */
+      unsigned current_tex_levels[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+      unsigned current_tex_begin[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+      unsigned current_tex_end[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    } fs;
 
    /** fragment shader constants */
@@ -0,0 +1,910 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file
+ * Compute shaders: launch_grid.
+ *
+ * A compute shader variant is a function running as many threads of a
+ * block as there are lanes in a native vector, so a block takes a few
+ * calls.  The blocks of a grid are handed out to the rasterizer threads
+ * one at a time.
+ *
+ * When the shader has barriers, every call of a block runs on its own
+ * fiber, and a barrier switches to the next fiber of the block; once the
+ * last fiber gets to the barrier every thread of the block has, and the
+ * first fiber carries on.
+ */
+
+#include "pipe/p_config.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_atomic.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "util/u_string.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_scan.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_type.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+#if defined(PIPE_OS_UNIX)
+#include <ucontext.h>
+#define LP_CS_HAVE_FIBERS 1
+#endif
+
+
+static unsigned cs_no = 0;
+
+/** Where unbound resources, NULL pointers and inactive lanes point to */
+static PIPE_ALIGN_VAR(16) uint8_t lp_cs_scratch[64];
+
+
+/**
+ * State of a launch_grid, shared by all the threads running it.
+ */
+struct lp_cs_job
+{
+   struct lp_jit_cs_context jit_context;
+   lp_jit_cs_func func;
+   uint8_t *global[LP_MAX_GLOBAL_BUFFERS + 1];
+
+   unsigned local_size;
+   unsigned private_size;   /**< per thread */
+   unsigned num_calls;      /**< calls of func per block */
+   unsigned vector_length;
+   boolean uses_barrier;
+
+   int32_t num_blocks;
+   int32_t next_block;
+};
+
+
+#ifdef LP_CS_HAVE_FIBERS
+
+struct lp_cs_fibers;
+
+struct lp_cs_fiber
+{
+   struct lp_jit_cs_thread_data thread_data;
+   ucontext_t context;
+   struct lp_cs_fibers *group;
+   unsigned index;
+};
+
+/**
+ * The fibers of a block, reused for every block a thread runs.
+ */
+struct lp_cs_fibers
+{
+   const struct lp_cs_job *job;
+   ucontext_t main;
+   unsigned num_fibers;
+   struct lp_cs_fiber *fibers;
+   uint8_t *stacks;
+};
+
+
+/**
+ * Called by the compute function at a barrier.
+ */
+static void
+lp_cs_barrier(struct lp_jit_cs_thread_data *thread_data)
+{
+   struct lp_cs_fiber *fiber = (struct lp_cs_fiber *) thread_data->fiber;
+   struct lp_cs_fibers *group = fiber->group;
+   unsigned next = fiber->index + 1;
+
+   if (next == group->num_fibers)
+      next = 0;
+
+   if (next != fiber->index)
+      swapcontext(&fiber->context, &group->fibers[next].context);
+}
+
+
+/**
+ * makecontext() only passes ints, so the fiber pointer comes in halves.
+ */
+static void
+lp_cs_fiber_main(unsigned lo, unsigned hi)
+{
+   struct lp_cs_fiber *fiber = (struct lp_cs_fiber *)
+      (uintptr_t) (((uint64_t) hi << 32) | lo);
+   const struct lp_cs_job *job = fiber->group->job;
+
+   job->func(&job->jit_context, &fiber->thread_data);
+
+   /* uc_link resumes the next fiber, waiting at the last barrier */
+}
+
+
+static boolean
+lp_cs_fibers_init(struct lp_cs_fibers *group, const struct lp_cs_job *job)
+{
+   unsigned i;
+
+   group->job = job;
+   group->num_fibers = job->num_calls;
+   group->fibers = CALLOC(job->num_calls, sizeof *group->fibers);
+   group->stacks = MALLOC(job->num_calls * LP_CS_STACK_SIZE);
+   if (!group->fibers || !group->stacks) {
+      FREE(group->fibers);
+      FREE(group->stacks);
+      return FALSE;
+   }
+
+   for (i = 0; i < group->num_fibers; i++) {
+      struct lp_cs_fiber *fiber = &group->fibers[i];
+
+      fiber->group = group;
+      fiber->index = i;
+      fiber->thread_data.fiber = fiber;
+      getcontext(&fiber->context);
+   }
+
+   return TRUE;
+}
+
+
+static void
+lp_cs_fibers_cleanup(struct lp_cs_fibers *group)
+{
+   FREE(group->fibers);
+   FREE(group->stacks);
+}
+
+
+static void
+lp_cs_run_block_fibers(struct lp_cs_fibers *group,
+                       const struct lp_jit_cs_thread_data *block)
+{
+   const struct lp_cs_job *job = group->job;
+   unsigned i;
+
+   for (i = 0; i < group->num_fibers; i++) {
+      struct lp_cs_fiber *fiber = &group->fibers[i];
+      uintptr_t ptr = (uintptr_t) fiber;
+
+      fiber->thread_data.block_id[0] = block->block_id[0];
+      fiber->thread_data.block_id[1] = block->block_id[1];
+      fiber->thread_data.block_id[2] = block->block_id[2];
+      fiber->thread_data.first_thread = i * job->vector_length;
+      fiber->thread_data.local_mem = block->local_mem;
+      fiber->thread_data.private_mem = block->private_mem +
+         fiber->thread_data.first_thread * job->private_size;
+
+      /* the context was last saved by getcontext() or a barrier */
+      fiber->context.uc_stack.ss_sp = group->stacks + i * LP_CS_STACK_SIZE;
+      fiber->context.uc_stack.ss_size = LP_CS_STACK_SIZE;
+      fiber->context.uc_link = i + 1 < group->num_fibers ?
+         &group->fibers[i + 1].context : &group->main;
+      makecontext(&fiber->context, (void (*)(void)) lp_cs_fiber_main, 2,
+                  (unsigned) (ptr & 0xffffffff),
+                  (unsigned) ((uint64_t) ptr >> 32));
+   }
+
+   swapcontext(&group->main, &group->fibers[0].context);
+}
+
+#endif /* LP_CS_HAVE_FIBERS */
+
+
+static int
+lp_cs_next_block(struct lp_cs_job *job)
+{
+   int32_t block;
+
+   do {
+      block = p_atomic_read(&job->next_block);
+      if (block >= job->num_blocks)
+         return -1;
+   } while (p_atomic_cmpxchg(&job->next_block, block, block + 1) != block);
+
+   return block;
+}
+
+
+/**
+ * Run blocks until there are none left.  Called on every rasterizer
+ * thread.
+ */
+static void
+lp_cs_run_blocks(void *data, unsigned thread_index, unsigned num_threads)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *) data;
+   const uint32_t *grid_size = job->jit_context.grid_size;
+   struct lp_jit_cs_thread_data thread_data;
+   uint8_t *local_mem, *private_mem;
+#ifdef LP_CS_HAVE_FIBERS
+   struct lp_cs_fibers fibers;
+#endif
+   int block;
+
+   /* Some room past the end for the zero addresses of inactive lanes */
+   local_mem = align_malloc(job->local_size + 16, 16);
+   private_mem = align_malloc(job->num_calls * job->vector_length *
+                              job->private_size + 16, 16);
+   if (!local_mem || !private_mem)
+      goto out;
+
+#ifdef LP_CS_HAVE_FIBERS
+   if (job->uses_barrier && !lp_cs_fibers_init(&fibers, job))
+      goto out;
+#endif
+
+   memset(&thread_data, 0, sizeof thread_data);
+   thread_data.local_mem = local_mem;
+
+   while ((block = lp_cs_next_block(job)) >= 0) {
+      unsigned call;
+
+      thread_data.block_id[0] = block % grid_size[0];
+      thread_data.block_id[1] = (block / grid_size[0]) % grid_size[1];
+      thread_data.block_id[2] = block / (grid_size[0] * grid_size[1]);
+
+#ifdef LP_CS_HAVE_FIBERS
+      if (job->uses_barrier) {
+         thread_data.private_mem = private_mem;
+         lp_cs_run_block_fibers(&fibers, &thread_data);
+         continue;
+      }
+#endif
+
+      for (call = 0; call < job->num_calls; call++) {
+         thread_data.first_thread = call * job->vector_length;
+         thread_data.private_mem = private_mem +
+            thread_data.first_thread * job->private_size;
+         job->func(&job->jit_context, &thread_data);
+      }
+   }
+
+#ifdef LP_CS_HAVE_FIBERS
+   if (job->uses_barrier)
+      lp_cs_fibers_cleanup(&fibers);
+#endif
+
+out:
+   align_free(local_mem);
+   align_free(private_mem);
+}
+
+
+/**
+ * The compute shader interface of lp_build_tgsi_soa().
+ */
+struct lp_cs_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef context_ptr;
+   LLVMValueRef thread_data_ptr;
+   unsigned private_size;
+};
+
+
+static INLINE const struct lp_cs_iface *
+lp_cs_iface(const struct lp_build_tgsi_cs_iface *iface)
+{
+   return (const struct lp_cs_iface *) iface;
+}
+
+
+static LLVMValueRef
+cs_resource_ptr(const struct lp_build_tgsi_cs_iface *cs_iface,
+                struct lp_build_tgsi_context *bld_base,
+                unsigned resource,
+                unsigned lane,
+                LLVMValueRef x,
+                LLVMValueRef y,
+                LLVMValueRef z)
+{
+   const struct lp_cs_iface *iface = lp_cs_iface(cs_iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef base, offset;
+
+   switch (resource) {
+   case TGSI_RESOURCE_GLOBAL:
+   {
+      LLVMValueRef shift, num_global, index, valid, zero;
+
+      shift = lp_jit_cs_context_global_shift(gallivm, iface->context_ptr);
+      num_global = lp_jit_cs_context_num_global(gallivm, iface->context_ptr);
+      zero = lp_build_const_int32(gallivm, 0);
+
+      index = LLVMBuildLShr(builder, x, shift, "");
+      offset = LLVMBuildSub(builder, x,
+                            LLVMBuildShl(builder, index, shift, ""), "");
+
+      /* stray handles land in the scratch area */
+      valid = LLVMBuildICmp(builder, LLVMIntULE, index, num_global, "");
+      index = LLVMBuildSelect(builder, valid, index, zero, "");
+      offset = LLVMBuildSelect(builder, valid, offset, zero, "");
+
+      base = lp_jit_cs_context_global(gallivm, iface->context_ptr);
+      base = LLVMBuildLoad(builder,
+                           LLVMBuildGEP(builder, base, &index, 1, ""), "");
+      break;
+   }
+
+   case TGSI_RESOURCE_LOCAL:
+      base = lp_jit_cs_thread_data_local_mem(gallivm, iface->thread_data_ptr);
+      offset = x;
+      break;
+
+   case TGSI_RESOURCE_PRIVATE:
+      base = lp_jit_cs_thread_data_private_mem(gallivm,
+                                               iface->thread_data_ptr);
+      offset = LLVMBuildAdd(builder, x,
+                            lp_build_const_int32(gallivm,
+                                                 lane * iface->private_size),
+                            "");
+      break;
+
+   case TGSI_RESOURCE_INPUT:
+      base = lp_jit_cs_context_input(gallivm, iface->context_ptr);
+      offset = x;
+      break;
+
+   default:
+   {
+      LLVMValueRef res_ptr, row_stride, img_stride;
+
+      assert(resource < PIPE_MAX_SHADER_RESOURCES);
+      if (resource >= PIPE_MAX_SHADER_RESOURCES)
+         resource = 0;
+
+      res_ptr = lp_jit_cs_context_resources(gallivm, iface->context_ptr);
+      res_ptr = lp_build_array_get_ptr(gallivm, res_ptr,
+                                       lp_build_const_int32(gallivm, resource));
+
+      base = lp_build_struct_get(gallivm, res_ptr,
+                                 LP_JIT_CS_RESOURCE_BASE, "base");
+      row_stride = lp_build_struct_get(gallivm, res_ptr,
+                                       LP_JIT_CS_RESOURCE_ROW_STRIDE,
+                                       "row_stride");
+      img_stride = lp_build_struct_get(gallivm, res_ptr,
+                                       LP_JIT_CS_RESOURCE_IMG_STRIDE,
+                                       "img_stride");
+
+      offset = LLVMBuildAdd(builder, x,
+                            LLVMBuildMul(builder, y, row_stride, ""), "");
+      offset = LLVMBuildAdd(builder, offset,
+                            LLVMBuildMul(builder, z, img_stride, ""), "");
+      break;
+   }
+   }
+
+   return LLVMBuildGEP(builder, base, &offset, 1, "");
+}
+
+
+static void
+cs_barrier(const struct lp_build_tgsi_cs_iface *cs_iface,
+           struct lp_build_tgsi_context *bld_base)
+{
+#ifdef LP_CS_HAVE_FIBERS
+   const struct lp_cs_iface *iface = lp_cs_iface(cs_iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMTypeRef arg_type = LLVMTypeOf(iface->thread_data_ptr);
+   LLVMValueRef function;
+   LLVMValueRef arg = iface->thread_data_ptr;
+
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer)lp_cs_barrier),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          &arg_type, 1, "barrier");
+
+   LLVMBuildCall(gallivm->builder, function, &arg, 1, "");
+#endif
+}
+
+
+static void
+generate_compute(struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type;
+   struct lp_build_context uint_bld;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_build_mask_context mask;
+   struct lp_cs_iface iface;
+   LLVMTypeRef arg_types[2];
+   LLVMTypeRef func_type;
+   LLVMValueRef function, context_ptr, thread_data_ptr;
+   LLVMValueRef block_size_ptr, grid_size_ptr, block_id_ptr;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef linear, num_threads, tmp, mask_val;
+   LLVMBasicBlockRef block;
+   char func_name[64];
+   unsigned i;
+
+   memset(&type, 0, sizeof type);
+   type.floating = TRUE;
+   type.sign = TRUE;
+   type.norm = FALSE;
+   type.width = 32;
+   type.length = MIN2(lp_native_vector_width / 32, 16);
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u_pc%u",
+                 shader->no, variant->entry_pc);
+
+   arg_types[0] = variant->jit_context_ptr_type;       /* context */
+   arg_types[1] = variant->jit_thread_data_ptr_type;   /* thread data */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, Elements(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   /* no noalias here: other fibers write the local memory at barriers */
+   context_ptr = LLVMGetParam(function, 0);
+   thread_data_ptr = LLVMGetParam(function, 1);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(thread_data_ptr, "thread_data");
+
+   /*
+    * Function body
+    */
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(type));
+
+   memset(&system_values, 0, sizeof system_values);
+
+   block_size_ptr = lp_jit_cs_context_block_size(gallivm, context_ptr);
+   grid_size_ptr = lp_jit_cs_context_grid_size(gallivm, context_ptr);
+   block_id_ptr = lp_jit_cs_thread_data_block_id(gallivm, thread_data_ptr);
+
+   for (i = 0; i < 3; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+
+      system_values.block_size[i] =
+         lp_build_array_get(gallivm, block_size_ptr, index);
+      system_values.grid_size[i] =
+         lp_build_array_get(gallivm, grid_size_ptr, index);
+      system_values.block_id[i] =
+         lp_build_array_get(gallivm, block_id_ptr, index);
+   }
+
+   /* The lanes run consecutive threads of the block, x varying fastest */
+   for (i = 0; i < type.length; i++)
+      lanes[i] = lp_build_const_int32(gallivm, i);
+
+   linear = lp_build_broadcast_scalar(&uint_bld,
+               lp_jit_cs_thread_data_first_thread(gallivm, thread_data_ptr));
+   linear = LLVMBuildAdd(builder, linear,
+                         LLVMConstVector(lanes, type.length), "");
+
+   /* the last call of a block may have lanes past its last thread */
+   num_threads = LLVMBuildMul(builder, system_values.block_size[0],
+                              system_values.block_size[1], "");
+   num_threads = LLVMBuildMul(builder, num_threads,
+                              system_values.block_size[2], "");
+   mask_val = lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, linear,
+                           lp_build_broadcast_scalar(&uint_bld, num_threads));
+
+   tmp = lp_build_broadcast_scalar(&uint_bld, system_values.block_size[0]);
+   system_values.thread_id[0] = LLVMBuildURem(builder, linear, tmp, "");
+   linear = LLVMBuildUDiv(builder, linear, tmp, "");
+   tmp = lp_build_broadcast_scalar(&uint_bld, system_values.block_size[1]);
+   system_values.thread_id[1] = LLVMBuildURem(builder, linear, tmp, "");
+   system_values.thread_id[2] = LLVMBuildUDiv(builder, linear, tmp, "");
+
+   lp_build_mask_begin(&mask, gallivm, type, mask_val);
+
+   memset(&iface, 0, sizeof iface);
+   iface.base.entry_pc = variant->entry_pc;
+   iface.base.resource_ptr = cs_resource_ptr;
+   iface.base.barrier = cs_barrier;
+   iface.context_ptr = context_ptr;
+   iface.thread_data_ptr = thread_data_ptr;
+   iface.private_size = shader->base.req_private_mem;
+
+   lp_build_tgsi_soa(gallivm, shader->tokens, type, &mask,
+                     NULL, NULL, &system_values,
+                     NULL, NULL, NULL, &shader->info, NULL, &iface.base);
+
+   lp_build_mask_end(&mask);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static struct lp_compute_shader_variant *
+generate_variant(struct lp_compute_shader *shader, unsigned entry_pc)
+{
+   struct lp_compute_shader_variant *variant;
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->gallivm = gallivm_create();
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->entry_pc = entry_pc;
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->jit_function = (lp_jit_cs_func)
+      gallivm_jit_function(variant->gallivm, variant->function);
+
+   return variant;
+}
+
+
+static void
+delete_variant(struct lp_compute_shader_variant *variant)
+{
+   gallivm_free_function(variant->gallivm, variant->function,
+                         variant->jit_function);
+   gallivm_destroy(variant->gallivm);
+   FREE(variant);
+}
+
+
+static struct lp_compute_shader_variant *
+lookup_variant(struct lp_compute_shader *shader, unsigned entry_pc)
+{
+   struct lp_compute_shader_variant *variant;
+
+   for (variant = shader->variants; variant; variant = variant->next) {
+      if (variant->entry_pc == entry_pc)
+         return variant;
+   }
+
+   variant = generate_variant(shader, entry_pc);
+   if (variant) {
+      variant->next = shader->variants;
+      shader->variants = variant;
+   }
+
+   return variant;
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->base = *templ;
+   shader->no = cs_no++;
+
+   /* copy shader tokens, the ones passed in will go away. */
+   shader->tokens = tgsi_dup_tokens((const struct tgsi_token *) templ->prog);
+   if (!shader->tokens) {
+      FREE(shader);
+      return NULL;
+   }
+   shader->base.prog = shader->tokens;
+
+   tgsi_scan_shader(shader->tokens, &shader->info);
+
+   shader->uses_barrier =
+      shader->info.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %p:\n", (void *) shader);
+      tgsi_dump(shader->tokens, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = (struct lp_compute_shader *) cs;
+   struct lp_compute_shader_variant *variant, *next;
+
+   if (!shader)
+      return;
+
+   if (llvmpipe->cs == shader)
+      llvmpipe->cs = NULL;
+
+   for (variant = shader->variants; variant; variant = next) {
+      next = variant->next;
+      delete_variant(variant);
+   }
+
+   FREE((void *) shader->tokens);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_compute_resources(struct pipe_context *pipe,
+                               unsigned start, unsigned count,
+                               struct pipe_surface **resources)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(start + count <= PIPE_MAX_SHADER_RESOURCES);
+
+   for (i = 0; i < count; i++) {
+      pipe_surface_reference(&llvmpipe->compute_resources[start + i],
+                             resources ? resources[i] : NULL);
+   }
+}
+
+
+/**
+ * GLOBAL handles are the index of the buffer, plus one, above
+ * global_shift, which is large enough for the offsets into the largest
+ * bound buffer.  Handles made before the shift changes are stale, which
+ * the interface allows: they're only valid until the next launch_grid.
+ *
+ * LP_MAX_CS_MEM_ALLOC_SIZE is chosen so that any set of buffers within the
+ * advertised limits fits in 32 bits.  Bindings that don't fit are refused,
+ * leaving the previous bindings in place and NULL handles.
+ */
+static void
+llvmpipe_set_global_binding(struct pipe_context *pipe,
+                            unsigned first, unsigned count,
+                            struct pipe_resource **resources,
+                            uint32_t **handles)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned max_size = 0, last = 0, shift;
+   unsigned i;
+
+   assert(first + count <= LP_MAX_GLOBAL_BUFFERS);
+
+   /* Work out the shift the new bindings need before making them. */
+   for (i = 0; i < LP_MAX_GLOBAL_BUFFERS; i++) {
+      struct pipe_resource *buffer = llvmpipe->global_buffers[i];
+
+      if (i >= first && i < first + count)
+         buffer = resources ? resources[i - first] : NULL;
+
+      if (buffer) {
+         max_size = MAX2(max_size, buffer->width0);
+         last = i + 1;
+      }
+   }
+
+   shift = MAX2(util_last_bit(MAX2(max_size, 1) - 1), 4);
+
+   if (shift + util_last_bit(last) > 32) {
+      debug_printf("llvmpipe: global buffers don't fit in 32-bit handles\n");
+      for (i = 0; i < count; i++) {
+         if (handles && handles[i])
+            *handles[i] = 0;
+      }
+      return;
+   }
+
+   for (i = 0; i < count; i++) {
+      pipe_resource_reference(&llvmpipe->global_buffers[first + i],
+                              resources ? resources[i] : NULL);
+   }
+
+   llvmpipe->global_shift = shift;
+
+   if (!resources)
+      return;
+
+   for (i = 0; i < count; i++) {
+      if (handles[i])
+         *handles[i] = (first + i + 1) << shift;
+   }
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const uint *block_layout, const uint *grid_layout,
+                     uint32_t pc, const void *input)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_cs_job *job;
+   unsigned num_threads;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+#ifndef LP_CS_HAVE_FIBERS
+   if (shader->uses_barrier) {
+      debug_printf("llvmpipe: compute barriers unsupported on this OS\n");
+      return;
+   }
+#endif
+
+   variant = lookup_variant(shader, pc);
+   if (!variant)
+      return;
+
+   job = align_malloc(sizeof *job, 16);
+   if (!job)
+      return;
+   memset(job, 0, sizeof *job);
+
+   num_threads = block_layout[0] * block_layout[1] * block_layout[2];
+
+   job->func = variant->jit_function;
+   job->local_size = shader->base.req_local_mem;
+   job->private_size = shader->base.req_private_mem;
+   job->vector_length = MIN2(lp_native_vector_width / 32, 16);
+   job->num_calls = (num_threads + job->vector_length - 1) / job->vector_length;
+   job->uses_barrier = shader->uses_barrier;
+   job->num_blocks = grid_layout[0] * grid_layout[1] * grid_layout[2];
+
+   for (i = 0; i < 3; i++) {
+      job->jit_context.block_size[i] = block_layout[i];
+      job->jit_context.grid_size[i] = grid_layout[i];
+   }
+
+   /* Room past the end for the zero addresses of inactive lanes */
+   job->jit_context.input = align_malloc(shader->base.req_input_mem + 16, 16);
+   if (!job->jit_context.input) {
+      align_free(job);
+      return;
+   }
+   if (input)
+      memcpy(job->jit_context.input, input, shader->base.req_input_mem);
+
+   /* Kernels access the resources directly: wait for any rendering */
+   llvmpipe_finish(pipe, __FUNCTION__);
+
+   job->global[0] = lp_cs_scratch;
+   for (i = 0; i < LP_MAX_GLOBAL_BUFFERS; i++) {
+      struct pipe_resource *buffer = llvmpipe->global_buffers[i];
+      job->global[i + 1] = buffer ? llvmpipe_resource_data(buffer) :
+                                    lp_cs_scratch;
+   }
+   job->jit_context.global = job->global;
+   job->jit_context.num_global = LP_MAX_GLOBAL_BUFFERS;
+   job->jit_context.global_shift = llvmpipe->global_shift;
+
+   for (i = 0; i < PIPE_MAX_SHADER_RESOURCES; i++) {
+      struct pipe_surface *surf = llvmpipe->compute_resources[i];
+      struct lp_jit_cs_resource *jit_res = &job->jit_context.resources[i];
+
+      if (!surf) {
+         jit_res->base = lp_cs_scratch;
+      }
+      else if (llvmpipe_resource_is_texture(surf->texture)) {
+         unsigned level = surf->u.tex.level;
+
+         jit_res->base = llvmpipe_resource_map(surf->texture, level,
+                                               surf->u.tex.first_layer,
+                                               LP_TEX_USAGE_READ_WRITE);
+         jit_res->row_stride = llvmpipe_resource_stride(surf->texture, level);
+         jit_res->img_stride = llvmpipe_layer_stride(surf->texture, level);
+      }
+      else {
+         jit_res->base = (uint8_t *) llvmpipe_resource_data(surf->texture) +
+            surf->u.buf.first_element * util_format_get_blocksize(surf->format);
+      }
+   }
+
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_rast_run_compute(screen->rast, lp_cs_run_blocks, job);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   for (i = 0; i < PIPE_MAX_SHADER_RESOURCES; i++) {
+      struct pipe_surface *surf = llvmpipe->compute_resources[i];
+
+      if (surf && llvmpipe_resource_is_texture(surf->texture)) {
+         llvmpipe_resource_unmap(surf->texture, surf->u.tex.level,
+                                 surf->u.tex.first_layer);
+      }
+   }
+
+   if (llvmpipe->active_statistics_queries) {
+      llvmpipe->pipeline_statistics.cs_invocations +=
+         (uint64_t) num_threads * job->num_blocks;
+   }
+
+   align_free(job->jit_context.input);
+   align_free(job);
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_compute_resources = llvmpipe_set_compute_resources;
+   llvmpipe->pipe.set_global_binding = llvmpipe_set_global_binding;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
+
+
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *llvmpipe)
+{
+   unsigned i;
+
+   for (i = 0; i < PIPE_MAX_SHADER_RESOURCES; i++) {
+      pipe_surface_reference(&llvmpipe->compute_resources[i], NULL);
+   }
+
+   for (i = 0; i < LP_MAX_GLOBAL_BUFFERS; i++) {
+      pipe_resource_reference(&llvmpipe->global_buffers[i], NULL);
+   }
+}
@@ -0,0 +1,86 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LP_STATE_CS_H_
+#define LP_STATE_CS_H_
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
+#include "gallivm/lp_bld.h"
+#include "lp_jit.h"
+
+
+struct llvmpipe_context;
+
+
+/**
+ * A compute shader compiled for one entry point.
+ */
+struct lp_compute_shader_variant
+{
+   /** Index of the BGNSUB the kernel starts at, the pc of launch_grid */
+   unsigned entry_pc;
+
+   struct gallivm_state *gallivm;
+
+   LLVMTypeRef jit_context_ptr_type;
+   LLVMTypeRef jit_thread_data_ptr_type;
+
+   LLVMValueRef function;
+
+   lp_jit_cs_func jit_function;
+
+   struct lp_compute_shader_variant *next;
+};
+
+
+/** Subclass of pipe_compute_state */
+struct lp_compute_shader
+{
+   struct pipe_compute_state base;
+
+   const struct tgsi_token *tokens;
+
+   struct tgsi_shader_info info;
+
+   /** Does the shader need its threads to run as fibers? */
+   boolean uses_barrier;
+
+   struct lp_compute_shader_variant *variants;
+
+   /* For debugging/profiling purposes */
+   unsigned no;
+};
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe);
+
+void
+llvmpipe_cleanup_compute(struct llvmpipe_context *llvmpipe);
+
+
+#endif /* LP_STATE_CS_H_ */
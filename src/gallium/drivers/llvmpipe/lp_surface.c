@@ -67,14 +67,14 @@ lp_resource_copy(struct pipe_context *pipe,
    unsigned z;
 
    llvmpipe_flush_resource(pipe,
-                           dst, dst_level,
+                           dst, dst_level, depth > 1 ? -1 : (int) dstz,
                            FALSE, /* read_only */
                            TRUE, /* cpu_access */
                            FALSE, /* do_not_block */
                            "blit dest");
 
    llvmpipe_flush_resource(pipe,
-                           src, src_level,
+                           src, src_level, depth > 1 ? -1 : src_box->z,
                            TRUE, /* read_only */
                            TRUE, /* cpu_access */
                            FALSE, /* do_not_block */
@@ -171,6 +171,11 @@ lp_resource_copy(struct pipe_context *pipe,
                        src_box->x, src_box->y, 0);
       }
    }
+
+   /* This write never goes through a scene, so it has to be presented
+    * explicitly, e.g. for front/back buffer copies and FBO-to-window blits.
+    */
+   llvmpipe_resource_add_damage_region(dst_tex, dstx, dsty, width, height);
 }
 
 
@@ -230,6 +235,14 @@ static void lp_blit(struct pipe_context *pipe,
    util_blitter_save_render_condition(lp->blitter, lp->render_cond_query,
                                       lp->render_cond_cond, lp->render_cond_mode);
    util_blitter_blit(lp->blitter, &info);
+
+   /* The blitter draws through a scene, which damages the tiles it bins,
+    * but be explicit about what the blit covers.
+    */
+   llvmpipe_resource_add_damage_region(llvmpipe_resource(info.dst.resource),
+                                       info.dst.box.x, info.dst.box.y,
+                                       info.dst.box.width,
+                                       info.dst.box.height);
 }
 
 
@@ -246,7 +259,8 @@ llvmpipe_create_surface(struct pipe_context *pipe,
 {
    struct pipe_surface *ps;
 
-   if (!(pt->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET)))
+   if (!(pt->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET |
+                     PIPE_BIND_COMPUTE_RESOURCE)))
       debug_printf("Illegal surface creation without bind flag\n");
 
    ps = CALLOC_STRUCT(pipe_surface);
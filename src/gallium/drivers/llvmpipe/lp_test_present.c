@@ -0,0 +1,386 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file
+ * Checks that every way of writing to a display target makes the next
+ * flush_frontbuffer present the written region, that nothing is presented
+ * when nothing was written, and that the whole surface is presented after
+ * the winsys lost its contents.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "state_tracker/sw_winsys.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define WIDTH  64
+#define HEIGHT 64
+#define FORMAT PIPE_FORMAT_B8G8R8A8_UNORM
+
+
+/**
+ * A winsys whose display targets are plain malloc'ed images, and which
+ * records what was last presented.
+ */
+struct test_winsys
+{
+   struct sw_winsys base;
+
+   unsigned presents;
+   boolean last_whole;
+   struct pipe_box last_box;
+
+   /** Whether to report the displayed contents lost, as on an expose. */
+   boolean contents_lost;
+};
+
+struct test_displaytarget
+{
+   unsigned stride;
+   void *data;
+};
+
+
+static boolean
+test_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                       unsigned tex_usage,
+                                       enum pipe_format format)
+{
+   return format == FORMAT;
+}
+
+
+static struct sw_displaytarget *
+test_displaytarget_create(struct sw_winsys *ws,
+                          unsigned tex_usage,
+                          enum pipe_format format,
+                          unsigned width, unsigned height,
+                          unsigned alignment,
+                          unsigned *stride)
+{
+   struct test_displaytarget *dt = CALLOC_STRUCT(test_displaytarget);
+
+   dt->stride = align(width * 4, alignment);
+   dt->data = align_malloc(dt->stride * height, alignment);
+   *stride = dt->stride;
+
+   return (struct sw_displaytarget *) dt;
+}
+
+
+static struct sw_displaytarget *
+test_displaytarget_from_handle(struct sw_winsys *ws,
+                               const struct pipe_resource *templat,
+                               struct winsys_handle *whandle,
+                               unsigned *stride)
+{
+   return NULL;
+}
+
+
+static boolean
+test_displaytarget_get_handle(struct sw_winsys *ws,
+                              struct sw_displaytarget *dt,
+                              struct winsys_handle *whandle)
+{
+   return FALSE;
+}
+
+
+static void *
+test_displaytarget_map(struct sw_winsys *ws,
+                       struct sw_displaytarget *dt,
+                       unsigned flags)
+{
+   return ((struct test_displaytarget *) dt)->data;
+}
+
+
+static void
+test_displaytarget_unmap(struct sw_winsys *ws,
+                         struct sw_displaytarget *dt)
+{
+}
+
+
+static void
+test_displaytarget_display(struct sw_winsys *ws,
+                           struct sw_displaytarget *dt,
+                           void *context_private,
+                           struct pipe_box *box)
+{
+   struct test_winsys *tws = (struct test_winsys *) ws;
+
+   tws->presents++;
+   tws->last_whole = box == NULL;
+   if (box)
+      tws->last_box = *box;
+}
+
+
+static void
+test_displaytarget_destroy(struct sw_winsys *ws,
+                           struct sw_displaytarget *dt)
+{
+   align_free(((struct test_displaytarget *) dt)->data);
+   FREE(dt);
+}
+
+
+static boolean
+test_displaytarget_contents_lost(struct sw_winsys *ws,
+                                 struct sw_displaytarget *dt)
+{
+   struct test_winsys *tws = (struct test_winsys *) ws;
+   boolean lost = tws->contents_lost;
+
+   tws->contents_lost = FALSE;
+
+   return lost;
+}
+
+
+static void
+test_winsys_destroy(struct sw_winsys *ws)
+{
+   FREE(ws);
+}
+
+
+static struct test_winsys *
+test_winsys_create(void)
+{
+   struct test_winsys *tws = CALLOC_STRUCT(test_winsys);
+
+   tws->base.destroy = test_winsys_destroy;
+   tws->base.is_displaytarget_format_supported =
+      test_is_displaytarget_format_supported;
+   tws->base.displaytarget_create = test_displaytarget_create;
+   tws->base.displaytarget_from_handle = test_displaytarget_from_handle;
+   tws->base.displaytarget_get_handle = test_displaytarget_get_handle;
+   tws->base.displaytarget_map = test_displaytarget_map;
+   tws->base.displaytarget_unmap = test_displaytarget_unmap;
+   tws->base.displaytarget_display = test_displaytarget_display;
+   tws->base.displaytarget_destroy = test_displaytarget_destroy;
+   tws->base.displaytarget_contents_lost = test_displaytarget_contents_lost;
+
+   return tws;
+}
+
+
+static struct pipe_resource *
+create_texture(struct pipe_screen *screen, unsigned bind)
+{
+   struct pipe_resource templat;
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = FORMAT;
+   templat.width0 = WIDTH;
+   templat.height0 = HEIGHT;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.bind = bind;
+
+   return screen->resource_create(screen, &templat);
+}
+
+
+/**
+ * Presents \p dt and checks that exactly the given region was presented,
+ * or that nothing was if \p width is zero.
+ */
+static boolean
+check_present(FILE *fp, const char *what,
+              struct pipe_screen *screen, struct test_winsys *tws,
+              struct pipe_resource *dt,
+              int x, int y, int width, int height)
+{
+   unsigned presents = tws->presents;
+   boolean success;
+
+   screen->flush_frontbuffer(screen, dt, 0, 0, NULL, NULL);
+
+   if (width == 0) {
+      success = tws->presents == presents;
+   }
+   else if (tws->presents != presents + 1) {
+      success = FALSE;
+   }
+   else if (tws->last_whole) {
+      success = x == 0 && y == 0 && width == WIDTH && height == HEIGHT;
+   }
+   else {
+      /* Damage is tracked in whole pixels, but the region may be padded. */
+      success = tws->last_box.x <= x &&
+                tws->last_box.y <= y &&
+                tws->last_box.x + tws->last_box.width >= x + width &&
+                tws->last_box.y + tws->last_box.height >= y + height;
+   }
+
+   if (fp)
+      fprintf(fp, "%s\t%s\n", success ? "pass" : "fail", what);
+   if (!success)
+      fprintf(stderr, "FAILED: present after %s\n", what);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   struct test_winsys *tws = test_winsys_create();
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource *dt, *src;
+   struct pipe_surface *surf, surf_templ;
+   struct pipe_framebuffer_state fb;
+   struct pipe_transfer *transfer;
+   struct pipe_blit_info blit;
+   struct pipe_box box;
+   union pipe_color_union color;
+   void *map;
+   boolean success = TRUE;
+
+   screen = llvmpipe_create_screen(&tws->base);
+   if (!screen) {
+      tws->base.destroy(&tws->base);
+      return FALSE;
+   }
+
+   pipe = screen->context_create(screen, NULL);
+   dt = create_texture(screen, PIPE_BIND_DISPLAY_TARGET |
+                               PIPE_BIND_RENDER_TARGET);
+   src = create_texture(screen, PIPE_BIND_SAMPLER_VIEW |
+                                PIPE_BIND_RENDER_TARGET);
+
+   /* A new display target has never been presented. */
+   success &= check_present(fp, "create", screen, tws, dt,
+                            0, 0, WIDTH, HEIGHT);
+   success &= check_present(fp, "nothing", screen, tws, dt, 0, 0, 0, 0);
+
+   /* An FBO to window blit, as glBlitFramebuffer does. */
+   memset(&blit, 0, sizeof blit);
+   blit.dst.resource = dt;
+   blit.dst.format = FORMAT;
+   u_box_2d(8, 16, 24, 8, &blit.dst.box);
+   blit.src.resource = src;
+   blit.src.format = FORMAT;
+   u_box_2d(0, 0, 24, 8, &blit.src.box);
+   blit.mask = PIPE_MASK_RGBA;
+   blit.filter = PIPE_TEX_FILTER_NEAREST;
+   pipe->blit(pipe, &blit);
+   pipe->flush(pipe, NULL, 0);
+   success &= check_present(fp, "blit", screen, tws, dt, 8, 16, 24, 8);
+   success &= check_present(fp, "nothing", screen, tws, dt, 0, 0, 0, 0);
+
+   /* An expose with nothing drawn since the last present. */
+   tws->contents_lost = TRUE;
+   success &= check_present(fp, "expose", screen, tws, dt,
+                            0, 0, WIDTH, HEIGHT);
+   success &= check_present(fp, "nothing", screen, tws, dt, 0, 0, 0, 0);
+
+   /* A back to front copy, as the xlib state tracker does on swap. */
+   u_box_2d(4, 4, 8, 12, &box);
+   pipe->resource_copy_region(pipe, dt, 0, 40, 32, 0, src, 0, &box);
+   pipe->flush(pipe, NULL, 0);
+   success &= check_present(fp, "resource_copy_region", screen, tws, dt,
+                            40, 32, 8, 12);
+
+   /* A CPU write through a transfer. */
+   u_box_2d(2, 50, 10, 6, &box);
+   map = pipe->transfer_map(pipe, dt, 0, PIPE_TRANSFER_WRITE, &box,
+                            &transfer);
+   if (map) {
+      memset(map, 0xff, transfer->stride * (box.height - 1) + box.width * 4);
+      pipe->transfer_unmap(pipe, transfer);
+   }
+   success &= check_present(fp, "transfer", screen, tws, dt, 2, 50, 10, 6);
+
+   /* A clear of the whole render target. */
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = FORMAT;
+   surf = pipe->create_surface(pipe, dt, &surf_templ);
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+   memset(&color, 0, sizeof color);
+   pipe->clear(pipe, PIPE_CLEAR_COLOR0, &color, 0.0, 0);
+   pipe->flush(pipe, NULL, 0);
+   success &= check_present(fp, "clear", screen, tws, dt,
+                            0, 0, WIDTH, HEIGHT);
+
+   memset(&fb, 0, sizeof fb);
+   pipe->set_framebuffer_state(pipe, &fb);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&src, NULL);
+   pipe_resource_reference(&dt, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);  /* destroys the winsys too */
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_all(verbose, fp);
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "operation\n");
+
+   fflush(fp);
+}
@@ -35,6 +35,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_format.h"
@@ -206,6 +207,10 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
    if (lpr->dt == NULL)
       return FALSE;
 
+   /* Nothing has been presented from it yet. */
+   llvmpipe_resource_add_damage(lpr, 0, 0,
+                                lpr->base.width0 - 1, lpr->base.height0 - 1);
+
    {
       void *map = winsys->displaytarget_map(winsys, lpr->dt,
                                             PIPE_TRANSFER_WRITE);
@@ -301,7 +306,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->linear_img.data) {
+      if (lpr->linear_img.data && !lpr->userBuffer) {
          align_free(lpr->linear_img.data);
          lpr->linear_img.data = NULL;
       }
@@ -447,6 +452,9 @@ llvmpipe_resource_from_handle(struct pipe_screen *screen,
       goto no_dt;
    }
 
+   llvmpipe_resource_add_damage(lpr, 0, 0,
+                                lpr->base.width0 - 1, lpr->base.height0 - 1);
+
    lpr->id = id_counter++;
 
 #ifdef DEBUG
@@ -462,6 +470,101 @@ no_lpr:
 }
 
 
+/**
+ * Wrap client memory in a buffer, for the compute and sampling paths,
+ * which access it in place.
+ */
+static struct pipe_resource *
+llvmpipe_buffer_from_user_memory(struct pipe_screen *screen,
+                                 const struct pipe_resource *templat,
+                                 void *user_memory)
+{
+   struct llvmpipe_resource *lpr;
+
+   /* Rendering to buffers writes past the end, see llvmpipe_resource_create */
+   if (templat->bind & PIPE_BIND_RENDER_TARGET)
+      return NULL;
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = screen;
+
+   lpr->row_stride[0] = templat->width0;
+   lpr->data = user_memory;
+   lpr->userBuffer = TRUE;
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
+/**
+ * Wrap client memory in a texture.
+ *
+ * Rendering reads and writes whole LP_RASTER_BLOCK_SIZE pixel blocks, with
+ * vector accesses aligned to 16 bytes, so the memory has to cover the
+ * size rounded up to whole blocks and be aligned accordingly.
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory,
+                                   unsigned stride)
+{
+   struct llvmpipe_resource *lpr;
+   unsigned block_size = util_format_get_blocksize(templat->format);
+
+   if (templat->target == PIPE_BUFFER)
+      return llvmpipe_buffer_from_user_memory(screen, templat, user_memory);
+
+   if ((templat->target != PIPE_TEXTURE_2D &&
+        templat->target != PIPE_TEXTURE_RECT) ||
+       templat->last_level != 0 ||
+       templat->depth0 != 1 ||
+       templat->array_size != 1 ||
+       util_format_is_compressed(templat->format))
+      return NULL;
+
+   if (templat->height0 % LP_RASTER_BLOCK_SIZE != 0 ||
+       stride < align(templat->width0, LP_RASTER_BLOCK_SIZE) * block_size ||
+       stride % 16 != 0 ||
+       (uintptr_t) user_memory % 16 != 0 ||
+       stride > LP_MAX_TEXTURE_SIZE / templat->height0)
+      return NULL;
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = screen;
+
+   lpr->row_stride[0] = stride;
+   lpr->img_stride[0] = stride * templat->height0;
+   lpr->num_slices_faces[0] = 1;
+   lpr->linear_img.data = user_memory;
+   lpr->userBuffer = TRUE;
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static boolean
 llvmpipe_resource_get_handle(struct pipe_screen *screen,
                             struct pipe_resource *pt,
@@ -478,6 +581,56 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Give a texture which only the scene being built reads from new storage,
+ * so that the CPU can write to it without waiting for the scene.  The
+ * scene goes on reading the old storage, and frees it when it's done.
+ *
+ * Returns FALSE if that isn't possible, in which case the caller has to
+ * flush instead.
+ */
+static boolean
+llvmpipe_copy_on_write(struct llvmpipe_context *llvmpipe,
+                       struct llvmpipe_resource *lpr,
+                       unsigned usage)
+{
+   const unsigned last_level = lpr->base.last_level;
+   const uint alignment = MAX2(64, util_cpu_caps.cacheline);
+   unsigned size;
+   void *data;
+
+   /* Storage others may hold pointers to can't be replaced. */
+   if (lpr->dt || lpr->userBuffer || !lpr->linear_img.data ||
+       (lpr->base.flags & PIPE_RESOURCE_FLAG_MAP_PERSISTENT) ||
+       p_atomic_read(&lpr->num_transfers) != 0)
+      return FALSE;
+
+   size = lpr->linear_mip_offsets[last_level] +
+          lpr->img_stride[last_level] * lpr->num_slices_faces[last_level];
+
+   data = align_malloc(size, alignment);
+   if (!data)
+      return FALSE;
+
+   if (!lp_setup_retire_texture_storage(llvmpipe->setup, &lpr->base,
+                                        lpr->linear_img.data)) {
+      align_free(data);
+      return FALSE;
+   }
+
+   if (!(usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))
+      memcpy(data, lpr->linear_img.data, size);
+
+   /* The timestamp bump of the write map makes all contexts pick up the
+    * new storage in their sampler views.
+    */
+   lpr->linear_img.data = data;
+   llvmpipe->num_resource_copies++;
+
+   return TRUE;
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -506,12 +659,40 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    if (!(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
       boolean read_only = !(usage & PIPE_TRANSFER_WRITE);
       boolean do_not_block = !!(usage & PIPE_TRANSFER_DONTBLOCK);
-      if (!llvmpipe_flush_resource(pipe, resource,
-                                   level,
-                                   read_only,
-                                   TRUE, /* cpu_access */
-                                   do_not_block,
-                                   __FUNCTION__)) {
+      boolean flushed;
+
+      if (resource->target == PIPE_BUFFER) {
+         /* Buffers are referenced by range, see lp_scene_add_resource_reference
+          */
+         flushed = llvmpipe_flush_buffer_range(pipe, resource,
+                                               box->x, box->width,
+                                               read_only,
+                                               do_not_block,
+                                               __FUNCTION__);
+      }
+      else {
+         int layer = box->depth > 1 ? -1 : box->z;
+
+         /* Rather than waiting for the scene to finish reading the data
+          * we're about to write, give the texture a new copy of it.
+          */
+         if (!read_only &&
+             llvmpipe_is_resource_referenced(pipe, resource, level, layer) ==
+                LP_REFERENCED_FOR_READ &&
+             llvmpipe_copy_on_write(llvmpipe, lpr, usage)) {
+            flushed = TRUE;
+         }
+         else {
+            flushed = llvmpipe_flush_resource(pipe, resource,
+                                              level, layer,
+                                              read_only,
+                                              TRUE, /* cpu_access */
+                                              do_not_block,
+                                              __FUNCTION__);
+         }
+      }
+
+      if (!flushed) {
          /*
           * It would have blocked, but state tracker requested no to.
           */
@@ -545,6 +726,8 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    pt->usage = usage;
    *transfer = pt;
 
+   p_atomic_inc(&lpr->num_transfers);
+
    assert(level < LP_MAX_TEXTURE_LEVELS);
 
    /*
@@ -599,6 +782,15 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
 {
    assert(transfer->resource);
 
+   p_atomic_dec(&llvmpipe_resource(transfer->resource)->num_transfers);
+
+   if (transfer->usage & PIPE_TRANSFER_WRITE) {
+      llvmpipe_resource_add_damage_region(llvmpipe_resource(transfer->resource),
+                                          transfer->box.x, transfer->box.y,
+                                          transfer->box.width,
+                                          transfer->box.height);
+   }
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
@@ -615,7 +807,7 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
 unsigned int
 llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                                  struct pipe_resource *presource,
-                                 unsigned level)
+                                 unsigned level, int layer)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
 
@@ -630,7 +822,12 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                             PIPE_BIND_SAMPLER_VIEW)))
       return LP_UNREFERENCED;
 
-   return lp_setup_is_resource_referenced(llvmpipe->setup, presource);
+   if (layer < 0)
+      return lp_setup_is_range_referenced(llvmpipe->setup, presource,
+                                          level, 0, ~0u);
+
+   return lp_setup_is_range_referenced(llvmpipe->setup, presource,
+                                       level, layer, layer + 1);
 }
 
 
@@ -949,6 +1146,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
    screen->resource_create = llvmpipe_resource_create;
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
    screen->can_create_resource = llvmpipe_can_create_resource;
 }
@@ -31,6 +31,8 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_rect.h"
 #include "lp_limits.h"
 
 
@@ -82,6 +84,12 @@ struct llvmpipe_resource
     */
    struct sw_displaytarget *dt;
 
+   /**
+    * Pixels of the display target written since it was last presented,
+    * inclusive.  Empty if x0 > x1.
+    */
+   struct u_rect damage;
+
    /**
     * Malloc'ed data for regular textures, or a mapping to dt above.
     */
@@ -95,6 +103,11 @@ struct llvmpipe_resource
    boolean userBuffer;  /** Is this a user-space buffer? */
    unsigned timestamp;
 
+   /** Number of scenes referencing the resource, in any context */
+   int32_t scene_refs;
+   /** Number of transfers currently mapping the resource */
+   int32_t num_transfers;
+
    unsigned id;  /**< temporary, for debugging */
 
 #ifdef DEBUG
@@ -134,6 +147,49 @@ llvmpipe_transfer(struct pipe_transfer *pt)
 }
 
 
+static INLINE void
+llvmpipe_resource_clear_damage(struct llvmpipe_resource *lpr)
+{
+   lpr->damage.x0 = lpr->damage.y0 = 0;
+   lpr->damage.x1 = lpr->damage.y1 = -1;
+}
+
+
+/**
+ * Add the given rectangle (inclusive) to a display target's damage.
+ */
+static INLINE void
+llvmpipe_resource_add_damage(struct llvmpipe_resource *lpr,
+                             int x0, int y0, int x1, int y1)
+{
+   if (lpr->damage.x0 > lpr->damage.x1) {
+      lpr->damage.x0 = x0;
+      lpr->damage.y0 = y0;
+      lpr->damage.x1 = x1;
+      lpr->damage.y1 = y1;
+   }
+   else {
+      lpr->damage.x0 = MIN2(lpr->damage.x0, x0);
+      lpr->damage.y0 = MIN2(lpr->damage.y0, y0);
+      lpr->damage.x1 = MAX2(lpr->damage.x1, x1);
+      lpr->damage.y1 = MAX2(lpr->damage.y1, y1);
+   }
+}
+
+
+/**
+ * Add a 2D region written by the CPU to the damage, if \p lpr is a display
+ * target.
+ */
+static INLINE void
+llvmpipe_resource_add_damage_region(struct llvmpipe_resource *lpr,
+                                    int x, int y, int width, int height)
+{
+   if (lpr->dt && width > 0 && height > 0)
+      llvmpipe_resource_add_damage(lpr, x, y, x + width - 1, y + height - 1);
+}
+
+
 void llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen);
 void llvmpipe_init_context_resource_funcs(struct pipe_context *pipe);
 
@@ -252,7 +308,7 @@ llvmpipe_print_resources(void);
 unsigned int
 llvmpipe_is_resource_referenced( struct pipe_context *pipe,
                                  struct pipe_resource *presource,
-                                 unsigned level);
+                                 unsigned level, int layer);
 
 unsigned
 llvmpipe_get_format_alignment(enum pipe_format format);
@@ -46,6 +46,8 @@ struct softpipe_screen {
     * this.
     */
    unsigned timestamp;
+   /** Sum of softpipe_resource::persistent_maps */
+   unsigned persistent_maps;
    boolean use_llvm;
 };
 
@@ -237,7 +237,8 @@ update_tgsi_samplers( struct softpipe_context *softpipe )
          struct softpipe_tex_tile_cache *tc = softpipe->tex_cache[sh][i];
          if (tc && tc->texture) {
             struct softpipe_resource *spt = softpipe_resource(tc->texture);
-            if (spt->timestamp != tc->timestamp) {
+            /* persistently mapped textures may have been written to */
+            if (spt->timestamp != tc->timestamp || spt->persistent_maps) {
                sp_tex_tile_cache_validate_texture( tc );
                /*
                  _debug_printf("INV %d %d\n", tc->timestamp, spt->timestamp);
@@ -354,7 +355,8 @@ softpipe_update_derived(struct softpipe_context *softpipe, unsigned prim)
 
    /* Check for updated textures.
     */
-   if (softpipe->tex_timestamp != sp_screen->timestamp) {
+   if (softpipe->tex_timestamp != sp_screen->timestamp ||
+       sp_screen->persistent_maps) {
       softpipe->tex_timestamp = sp_screen->timestamp;
       softpipe->dirty |= SP_NEW_TEXTURE;
    }
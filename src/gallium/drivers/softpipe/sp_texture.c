@@ -229,6 +229,43 @@ softpipe_resource_from_handle(struct pipe_screen *screen,
 }
 
 
+static struct pipe_resource *
+softpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory,
+                                   unsigned stride)
+{
+   struct softpipe_resource *spr;
+
+   if (templat->target == PIPE_BUFFER)
+      stride = templat->width0;
+   else if ((templat->target != PIPE_TEXTURE_2D &&
+             templat->target != PIPE_TEXTURE_RECT) ||
+            templat->last_level != 0 ||
+            templat->depth0 != 1 ||
+            templat->array_size != 1 ||
+            stride < util_format_get_stride(templat->format, templat->width0))
+      return NULL;
+
+   spr = CALLOC_STRUCT(softpipe_resource);
+   if (!spr)
+      return NULL;
+
+   spr->base = *templat;
+   pipe_reference_init(&spr->base.reference, 1);
+   spr->base.screen = screen;
+
+   spr->pot = (util_is_power_of_two(templat->width0) &&
+               util_is_power_of_two(templat->height0));
+
+   spr->stride[0] = stride;
+   spr->data = user_memory;
+   spr->userBuffer = TRUE;
+
+   return &spr->base;
+}
+
+
 static boolean
 softpipe_resource_get_handle(struct pipe_screen *screen,
                              struct pipe_resource *pt,
@@ -437,6 +474,12 @@ softpipe_transfer_map(struct pipe_context *pipe,
       return NULL;
    }
 
+   if ((usage & (PIPE_TRANSFER_WRITE | PIPE_TRANSFER_PERSISTENT)) ==
+       (PIPE_TRANSFER_WRITE | PIPE_TRANSFER_PERSISTENT)) {
+      spr->persistent_maps++;
+      softpipe_screen(pipe->screen)->persistent_maps++;
+   }
+
    *transfer = pt;
    return map + spt->offset;
 }
@@ -463,6 +506,12 @@ softpipe_transfer_unmap(struct pipe_context *pipe,
    if (transfer->usage & PIPE_TRANSFER_WRITE) {
       /* Mark the texture as dirty to expire the tile caches. */
       spr->timestamp++;
+
+      if (transfer->usage & PIPE_TRANSFER_PERSISTENT) {
+         assert(spr->persistent_maps);
+         spr->persistent_maps--;
+         softpipe_screen(pipe->screen)->persistent_maps--;
+      }
    }
 
    pipe_resource_reference(&transfer->resource, NULL);
@@ -521,6 +570,7 @@ softpipe_init_screen_texture_funcs(struct pipe_screen *screen)
    screen->resource_create = softpipe_resource_create;
    screen->resource_destroy = softpipe_resource_destroy;
    screen->resource_from_handle = softpipe_resource_from_handle;
+   screen->resource_from_user_memory = softpipe_resource_from_user_memory;
    screen->resource_get_handle = softpipe_resource_get_handle;
    screen->can_create_resource = softpipe_can_create_resource;
 }
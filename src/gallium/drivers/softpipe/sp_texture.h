@@ -65,6 +65,11 @@ struct softpipe_resource
    boolean userBuffer;
 
    unsigned timestamp;
+
+   /** Number of persistent write mappings, through which the contents may
+    * change at any time without the timestamp being bumped.
+    */
+   unsigned persistent_maps;
 };
 
 
@@ -163,6 +163,18 @@ struct pipe_screen {
 						  const struct pipe_resource *templat,
 						  struct winsys_handle *handle);
 
+   /**
+    * Create a single-level 2D texture whose storage is the caller's memory,
+    * laid out with the given row stride in bytes, or a PIPE_BUFFER of
+    * width0 bytes at the caller's memory (stride is ignored).  The memory
+    * must outlive the resource.  Optional; returns NULL if the driver can't
+    * render into or sample from memory with that layout.
+    */
+   struct pipe_resource * (*resource_from_user_memory)(struct pipe_screen *,
+                                                       const struct pipe_resource *templat,
+                                                       void *user_memory,
+                                                       unsigned stride);
+
    /**
     * Get a winsys_handle from a texture. Some platforms/winsys requires
     * that the texture is created with a special usage flag like
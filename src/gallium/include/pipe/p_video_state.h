@@ -179,6 +179,9 @@ struct pipe_mpeg12_macroblock
    /* see Table 7-7 in the spec */
    short PMV[2][2][2];
 
+   /* see section 7.6.3.6 in the spec, only valid with dual prime motion */
+   short dmvector[2];
+
    /* see figure 6.10-12 in the spec */
    unsigned short coded_block_pattern;
 
@@ -19,7 +19,11 @@ struct drisw_loader_funcs
 
 /**
  * Implemented by the drisw target.
+ *
+ * num_threads is the number of rasterizer threads for drivers that have
+ * them, or -1 for the driver's default.
  */
-struct pipe_screen * drisw_create_screen(struct drisw_loader_funcs *lf);
+struct pipe_screen * drisw_create_screen(struct drisw_loader_funcs *lf,
+                                         int num_threads);
 
 #endif
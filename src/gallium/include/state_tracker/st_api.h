@@ -245,6 +245,12 @@ struct st_config_options
    boolean force_glsl_extensions_warn;
    unsigned force_glsl_version;
    boolean force_s3tc_enable;
+
+   /** GLSL compiler threads: 0 disables, 1 picks the default count. */
+   unsigned glsl_compiler_threads;
+
+   /** Size in bytes of the streaming upload buffers, 0 for the defaults. */
+   unsigned upload_buffer_size;
 };
 
 /**
@@ -135,6 +135,15 @@ struct sw_winsys
    void 
    (*displaytarget_destroy)( struct sw_winsys *ws, 
                              struct sw_displaytarget *dt );
+
+   /**
+    * Optional.  Returns TRUE if the window system lost what was last
+    * displayed from \p dt, e.g. on an expose, and clears that condition.
+    * Drivers that only display damaged regions then display it whole.
+    */
+   boolean
+   (*displaytarget_contents_lost)( struct sw_winsys *ws,
+                                   struct sw_displaytarget *dt );
 };
 
 
@@ -182,9 +182,15 @@ clEnqueueMarker(cl_command_queue d_q, cl_event *rd_ev) try {
 
 CLOVER_API cl_int
 clEnqueueBarrier(cl_command_queue d_q) try {
-   obj(d_q);
+   auto &q = obj(d_q);
 
-   // No need to do anything, q preserves data ordering strictly.
+   // In order, no need to do anything, q preserves data ordering
+   // strictly.  Out of order, a hard event with no command type holds
+   // back the commands queued after it until the previous ones have
+   // been issued.
+   if (q.out_of_order()) {
+      ref_ptr<hard_event> hev = transfer(new hard_event(q, 0, { }));
+   }
 
    return CL_SUCCESS;
 
@@ -205,7 +211,8 @@ clEnqueueWaitForEvents(cl_command_queue d_q, cl_uint num_evs,
 
    // Create a hard event that depends on the events in the wait list:
    // subsequent commands in the same queue will be implicitly
-   // serialized with respect to it -- hard events always are.
+   // serialized with respect to it -- hard events always are, and out
+   // of order queues treat events with no command type as barriers.
    ref_ptr<hard_event> hev = transfer(new hard_event(q, 0, evs));
 
    return CL_SUCCESS;
@@ -261,7 +268,7 @@ clFinish(cl_command_queue d_q) try {
    auto &q = obj(d_q);
 
    // Create a temporary hard event -- it implicitly depends on all
-   // the previously queued hard events.
+   // the previously queued hard events, in or out of order.
    ref_ptr<hard_event> hev = transfer(new hard_event(q, 0, { }));
 
    // And wait on it.
@@ -190,29 +190,50 @@ namespace {
    /// Software copy from \a src_obj to \a dst_obj.  They can be
    /// either pointers or memory objects.
    ///
+   /// Out of order, non-blocking copies map both objects from the
+   /// action but do the memcpy on a host thread of the queue, so
+   /// independent copies overlap with each other and with the
+   /// application.
+   ///
    template<typename T, typename S>
    std::function<void (event &)>
-   soft_copy_op(command_queue &q,
+   soft_copy_op(command_queue &q, bool blocking,
                 T dst_obj, const vector_t &dst_orig, const vector_t &dst_pitch,
                 S src_obj, const vector_t &src_orig, const vector_t &src_pitch,
                 const vector_t &region) {
-      return [=, &q](event &) {
-         auto dst = _map<T>::get(q, dst_obj, CL_MAP_WRITE,
-                                 dot(dst_pitch, dst_orig),
-                                 dst_pitch[2] * region[2]);
-         auto src = _map<S>::get(q, src_obj, CL_MAP_READ,
-                                 dot(src_pitch, src_orig),
-                                 src_pitch[2] * region[2]);
-         vector_t v = {};
-
-         for (v[2] = 0; v[2] < region[2]; ++v[2]) {
-            for (v[1] = 0; v[1] < region[1]; ++v[1]) {
-               std::memcpy(
-                  static_cast<char *>(dst) + dot(dst_pitch, v),
-                  static_cast<const char *>(src) + dot(src_pitch, v),
-                  src_pitch[0] * region[0]);
+      return [=, &q](event &ev) {
+         typedef decltype(_map<T>::get(q, dst_obj, 0, 0, 0)) dst_map_t;
+         typedef decltype(_map<S>::get(q, src_obj, 0, 0, 0)) src_map_t;
+
+         // Owned by the copy below, which unmaps both when it's done.
+         auto maps = new std::pair<dst_map_t, src_map_t>(
+            _map<T>::get(q, dst_obj, CL_MAP_WRITE,
+                         dot(dst_pitch, dst_orig),
+                         dst_pitch[2] * region[2]),
+            _map<S>::get(q, src_obj, CL_MAP_READ,
+                         dot(src_pitch, src_orig),
+                         src_pitch[2] * region[2]));
+
+         auto copy = [=]() {
+            vector_t v = {};
+
+            for (v[2] = 0; v[2] < region[2]; ++v[2]) {
+               for (v[1] = 0; v[1] < region[1]; ++v[1]) {
+                  std::memcpy(
+                     static_cast<char *>(maps->first) + dot(dst_pitch, v),
+                     static_cast<const char *>(maps->second) +
+                     dot(src_pitch, v),
+                     src_pitch[0] * region[0]);
+               }
             }
-         }
+
+            delete maps;
+         };
+
+         if (!blocking && q.out_of_order())
+            static_cast<hard_event &>(ev).defer(copy);
+         else
+            copy();
       };
    }
 
@@ -248,7 +269,7 @@ clEnqueueReadBuffer(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_READ_BUFFER, deps,
-      soft_copy_op(q, ptr, {}, obj_pitch,
+      soft_copy_op(q, blocking, ptr, {}, obj_pitch,
                    &mem, obj_origin, obj_pitch,
                    region));
 
@@ -277,7 +298,7 @@ clEnqueueWriteBuffer(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_WRITE_BUFFER, deps,
-      soft_copy_op(q, &mem, obj_origin, obj_pitch,
+      soft_copy_op(q, blocking, &mem, obj_origin, obj_pitch,
                    ptr, {}, obj_pitch,
                    region));
 
@@ -313,7 +334,7 @@ clEnqueueReadBufferRect(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_READ_BUFFER_RECT, deps,
-      soft_copy_op(q, ptr, host_origin, host_pitch,
+      soft_copy_op(q, blocking, ptr, host_origin, host_pitch,
                    &mem, obj_origin, obj_pitch,
                    region));
 
@@ -349,7 +370,7 @@ clEnqueueWriteBufferRect(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_WRITE_BUFFER_RECT, deps,
-      soft_copy_op(q, &mem, obj_origin, obj_pitch,
+      soft_copy_op(q, blocking, &mem, obj_origin, obj_pitch,
                    ptr, host_origin, host_pitch,
                    region));
 
@@ -420,7 +441,7 @@ clEnqueueCopyBufferRect(cl_command_queue d_q, cl_mem d_src_mem,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_COPY_BUFFER_RECT, deps,
-      soft_copy_op(q, &dst_mem, dst_origin, dst_pitch,
+      soft_copy_op(q, false, &dst_mem, dst_origin, dst_pitch,
                    &src_mem, src_origin, src_pitch,
                    region));
 
@@ -453,7 +474,7 @@ clEnqueueReadImage(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_READ_IMAGE, deps,
-      soft_copy_op(q, ptr, {}, dst_pitch,
+      soft_copy_op(q, blocking, ptr, {}, dst_pitch,
                    &img, src_origin, src_pitch,
                    region));
 
@@ -486,7 +507,7 @@ clEnqueueWriteImage(cl_command_queue d_q, cl_mem d_mem, cl_bool blocking,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_WRITE_IMAGE, deps,
-      soft_copy_op(q, &img, dst_origin, dst_pitch,
+      soft_copy_op(q, blocking, &img, dst_origin, dst_pitch,
                    ptr, {}, src_pitch,
                    region));
 
@@ -554,7 +575,7 @@ clEnqueueCopyImageToBuffer(cl_command_queue d_q,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_COPY_IMAGE_TO_BUFFER, deps,
-      soft_copy_op(q, &dst_mem, dst_origin, dst_pitch,
+      soft_copy_op(q, false, &dst_mem, dst_origin, dst_pitch,
                    &src_img, src_origin, src_pitch,
                    region));
 
@@ -590,7 +611,7 @@ clEnqueueCopyBufferToImage(cl_command_queue d_q,
 
    hard_event *hev = new hard_event(
       q, CL_COMMAND_COPY_BUFFER_TO_IMAGE, deps,
-      soft_copy_op(q, &dst_img, dst_origin, dst_pitch,
+      soft_copy_op(q, false, &dst_img, dst_origin, dst_pitch,
                    &src_mem, src_origin, src_pitch,
                    region));
 
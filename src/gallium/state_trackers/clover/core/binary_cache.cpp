@@ -0,0 +1,318 @@
+//
+// Copyright 2014 The Mesa Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "core/binary_cache.hpp"
+#include "core/compiler.hpp"
+#include "util/u_debug.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace clover;
+
+namespace {
+   const char magic[] = "clover binary cache";
+
+   bool
+   enabled() {
+      static const bool b = debug_get_bool_option("CLOVER_CACHE", TRUE);
+      return b;
+   }
+
+   bool
+   debug() {
+      static const bool b = debug_get_bool_option("CLOVER_CACHE_DEBUG",
+                                                  FALSE);
+      return b;
+   }
+
+   /// Size the cache directory is trimmed to after a store, in bytes.
+   off_t
+   max_size() {
+      static const off_t n = debug_get_num_option("CLOVER_CACHE_SIZE",
+                                                  64) << 20;
+      return n;
+   }
+
+   std::string
+   cache_dir() {
+      if (const char *dir = getenv("CLOVER_CACHE_DIR"))
+         return dir;
+      else if (const char *dir = getenv("XDG_CACHE_HOME"))
+         return std::string(dir) + "/mesa/clover";
+      else if (const char *dir = getenv("HOME"))
+         return std::string(dir) + "/.cache/mesa/clover";
+      else
+         return "";
+   }
+
+   ///
+   /// Identify the build of the library, so that binaries from an
+   /// older compiler are never picked up.
+   ///
+   std::string
+   build_id() {
+      std::ostringstream id;
+      Dl_info info;
+      struct stat st;
+
+      id << PACKAGE_VERSION;
+
+      if (dladdr((void *)&compile_program_llvm, &info) &&
+          info.dli_fname && !stat(info.dli_fname, &st))
+         id << " " << st.st_mtime;
+
+      return id.str();
+   }
+
+   /// 64-bit FNV-1a.
+   uint64_t
+   hash(const std::string &s) {
+      uint64_t h = 0xcbf29ce484222325ull;
+
+      for (unsigned char c : s) {
+         h ^= c;
+         h *= 0x100000001b3ull;
+      }
+
+      return h;
+   }
+
+   ///
+   /// Whether the build reads files the key doesn't cover: headers
+   /// pulled in by \c #include or \c -include, looked up in \c -I
+   /// directories.  Their contents can change without the source or
+   /// the options changing.
+   ///
+   bool
+   uses_headers(const std::string &source, const std::string &opts) {
+      std::istringstream ts(opts);
+      std::string tok;
+
+      while (ts >> tok) {
+         if (tok.compare(0, 2, "-I") == 0 || tok == "-include")
+            return true;
+      }
+
+      for (size_t i = source.find('#'); i != std::string::npos;
+           i = source.find('#', i + 1)) {
+         const size_t j = source.find_first_not_of(" \t", i + 1);
+
+         if (j != std::string::npos && source.compare(j, 7, "include") == 0)
+            return true;
+      }
+
+      return false;
+   }
+
+   bool
+   is_entry_name(const char *name) {
+      return strlen(name) == 16 &&
+         strspn(name, "0123456789abcdef") == 16;
+   }
+
+   ///
+   /// Delete the least recently used entries until the directory is
+   /// within max_size().  load() refreshes the modification time of the
+   /// entries it hits.
+   ///
+   void
+   trim_dir(const std::string &dir) {
+      std::vector<std::pair<time_t, std::string>> entries;
+      off_t total = 0;
+      DIR *d = opendir(dir.c_str());
+
+      if (!d)
+         return;
+
+      while (struct dirent *e = readdir(d)) {
+         const std::string path = dir + "/" + e->d_name;
+         struct stat st;
+
+         if (is_entry_name(e->d_name) && !stat(path.c_str(), &st) &&
+             S_ISREG(st.st_mode)) {
+            entries.push_back({ st.st_mtime, path });
+            total += st.st_size;
+         }
+      }
+
+      closedir(d);
+
+      if (total <= max_size())
+         return;
+
+      std::sort(entries.begin(), entries.end());
+
+      for (auto &e : entries) {
+         struct stat st;
+
+         if (total <= max_size())
+            break;
+
+         if (!stat(e.second.c_str(), &st) && !unlink(e.second.c_str())) {
+            total -= st.st_size;
+
+            if (debug())
+               std::cerr << "clover: binary cache evict " << e.second
+                         << std::endl;
+         }
+      }
+   }
+
+   bool
+   make_dir(const std::string &dir) {
+      for (size_t i = dir.find('/', 1); ; i = dir.find('/', i + 1)) {
+         if (mkdir(dir.substr(0, i).c_str(), 0755) && errno != EEXIST)
+            return false;
+
+         if (i == std::string::npos)
+            return true;
+      }
+   }
+}
+
+binary_cache::binary_cache(const device &dev, const std::string &source,
+                           const std::string &opts) {
+   static const std::string id = build_id();
+   const std::string dir = cache_dir();
+   std::ostringstream k;
+
+   k << id << '\0' << dev.ir_format() << '\0' << dev.ir_target() << '\0'
+     << dev.device_name() << '\0' << opts << '\0' << source;
+   key = k.str();
+
+   // Hashing the preprocessed source would need a second clang run,
+   // which costs much of what the cache saves.  Builds with headers are
+   // rare, so they just aren't cached.
+   if (enabled() && !dir.empty() && !uses_headers(source, opts)) {
+      char name[17];
+
+      snprintf(name, sizeof(name), "%016llx",
+               (unsigned long long)hash(key));
+      path = dir + "/" + name;
+   }
+}
+
+bool
+binary_cache::load(module &m) const {
+   if (path.empty())
+      return false;
+
+   std::ifstream f(path.c_str(), std::ios::binary);
+   std::vector<unsigned char> data((std::istreambuf_iterator<char>(f)),
+                                   std::istreambuf_iterator<char>());
+
+   try {
+      compat::istream::buffer_t buf(data.data(), data.size());
+      compat::istream is(buf);
+      char hdr[sizeof(magic)];
+      uint32_t n;
+
+      is.read(hdr, sizeof(hdr));
+      is.read((char *)&n, sizeof(n));
+
+      // Hash collisions and stale entries show up as a different key.
+      // Check the length before allocating, the file may be corrupt.
+      if (n != key.size() || n > data.size())
+         throw compat::istream::error();
+
+      std::vector<char> k(n);
+      is.read(k.data(), n);
+
+      if (std::string(hdr, sizeof(hdr)) != std::string(magic, sizeof(magic)) ||
+          std::string(k.begin(), k.end()) != key)
+         throw compat::istream::error();
+
+      m = module::deserialize(is);
+
+   } catch (compat::istream::error &e) {
+      if (debug())
+         std::cerr << "clover: binary cache miss " << path << std::endl;
+      return false;
+
+   } catch (std::exception &e) {
+      // A corrupt entry can make deserialize() allocate absurd sizes.
+      if (debug())
+         std::cerr << "clover: binary cache miss " << path << ": "
+                   << e.what() << std::endl;
+      return false;
+   }
+
+   // Keep recently used entries from being evicted.
+   utime(path.c_str(), NULL);
+
+   if (debug())
+      std::cerr << "clover: binary cache hit " << path << std::endl;
+   return true;
+}
+
+void
+binary_cache::store(const module &m) const {
+   if (path.empty())
+      return;
+
+   const std::string dir = path.substr(0, path.rfind('/'));
+   std::string tmp = path + ".XXXXXX";
+   compat::ostream::buffer_t buf;
+   compat::ostream os(buf);
+   uint32_t n = key.size();
+   bool ok;
+   int fd;
+
+   os.write(magic, sizeof(magic));
+   os.write((const char *)&n, sizeof(n));
+   os.write(key.data(), n);
+   m.serialize(os);
+
+   if (!make_dir(dir) || (fd = mkstemp(&tmp[0])) < 0)
+      return;
+
+   ok = write(fd, buf.begin(), buf.size()) == (ssize_t)buf.size();
+   ok = !close(fd) && ok;
+
+   // rename() is atomic: readers get either the old entry or ours.
+   if (!ok || rename(tmp.c_str(), path.c_str())) {
+      unlink(tmp.c_str());
+      return;
+   }
+
+   if (debug())
+      std::cerr << "clover: binary cache store " << path << std::endl;
+
+   trim_dir(dir);
+}
@@ -0,0 +1,72 @@
+//
+// Copyright 2014 The Mesa Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#ifndef CLOVER_CORE_BINARY_CACHE_HPP
+#define CLOVER_CORE_BINARY_CACHE_HPP
+
+#include <string>
+
+#include "core/device.hpp"
+#include "core/module.hpp"
+
+namespace clover {
+   ///
+   /// On-disk cache of compiled program binaries.
+   ///
+   /// Entries are keyed by the program source, the build options, the
+   /// device and its target processor, and the build of the library
+   /// itself.  Programs that use headers aren't cached, since the key
+   /// doesn't cover them.  Entries live in \c $CLOVER_CACHE_DIR, or
+   /// \c mesa/clover under \c $XDG_CACHE_HOME or \c ~/.cache, and the
+   /// least recently used ones are deleted once the directory grows past
+   /// \c $CLOVER_CACHE_SIZE megabytes, 64 by default.  Set
+   /// \c CLOVER_CACHE=0 to disable the cache and \c CLOVER_CACHE_DEBUG=1
+   /// to log hits and misses.
+   ///
+   class binary_cache {
+   public:
+      binary_cache(const device &dev, const std::string &source,
+                   const std::string &opts);
+
+      ///
+      /// Look up the binary, returns false if there's none or the
+      /// cache is disabled.
+      ///
+      bool
+      load(module &m) const;
+
+      ///
+      /// Add the binary to the cache.  Entries are written to a
+      /// temporary file and renamed into place, so concurrent builds
+      /// never see a partial entry.  Failures are ignored.
+      ///
+      void
+      store(const module &m) const;
+
+   private:
+      std::string key;
+      std::string path;
+   };
+}
+
+#endif
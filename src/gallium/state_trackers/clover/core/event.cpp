@@ -41,10 +41,27 @@ event::trigger() {
    if (!--wait_count) {
       action_ok(*this);
 
-      while (!_chain.empty()) {
-         _chain.back()->trigger();
-         _chain.pop_back();
-      }
+      if (!wait_count)
+         signal();
+   }
+}
+
+void
+event::hold() {
+   wait_count++;
+}
+
+void
+event::unhold() {
+   if (!--wait_count)
+      signal();
+}
+
+void
+event::signal() {
+   while (!_chain.empty()) {
+      _chain.back()->trigger();
+      _chain.pop_back();
    }
 }
 
@@ -75,7 +92,7 @@ event::chain(event *ev) {
 
 hard_event::hard_event(command_queue &q, cl_command_type command,
                        const ref_vector<event> &deps, action action) :
-   event(q.ctx, deps, profile(q, action), [](event &ev){}),
+   event(q.ctx, deps, serialize(q, profile(q, action)), [](event &ev){}),
    _queue(q), _command(command), _fence(NULL) {
    if (q.profiling_enabled())
       _time_queued = timestamp::current(q);
@@ -96,6 +113,11 @@ hard_event::status() const {
    if (_status < 0)
       return _status;
 
+   else if (_host_done.valid() &&
+            _host_done.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready)
+      return CL_RUNNING;
+
    else if (!_fence)
       return CL_QUEUED;
 
@@ -119,6 +141,15 @@ hard_event::command() const {
 void
 hard_event::wait() const {
    pipe_screen *screen = queue()->dev.pipe;
+   std::shared_future<void> host_done;
+
+   {
+      std::lock_guard<std::recursive_mutex> lock(_queue.mutex);
+      host_done = _host_done;
+   }
+
+   if (host_done.valid())
+      host_done.wait();
 
    if (status() == CL_QUEUED)
       queue()->flush();
@@ -148,6 +179,23 @@ hard_event::time_end() const {
    return _time_end;
 }
 
+void
+hard_event::defer(std::function<void ()> task) {
+   auto done = std::make_shared<std::promise<void>>();
+   ref_ptr<hard_event> ev { this };
+
+   _host_done = done->get_future().share();
+   hold();
+
+   _queue.run_on_host([=] {
+         task();
+
+         std::lock_guard<std::recursive_mutex> lock(ev->_queue.mutex);
+         ev->unhold();
+         done->set_value();
+      });
+}
+
 void
 hard_event::fence(pipe_fence_handle *fence) {
    pipe_screen *screen = queue()->dev.pipe;
@@ -173,6 +221,14 @@ hard_event::profile(command_queue &q, const action &action) const {
    }
 }
 
+event::action
+hard_event::serialize(command_queue &q, const action &action) const {
+   return [&q, action] (event &ev) {
+      std::lock_guard<std::recursive_mutex> lock(q.mutex);
+      action(ev);
+   };
+}
+
 soft_event::soft_event(context &ctx, const ref_vector<event> &deps,
                        bool _trigger, action action) :
    event(ctx, deps, action, action) {
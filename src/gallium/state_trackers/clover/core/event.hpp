@@ -24,6 +24,7 @@
 #define CLOVER_CORE_EVENT_HPP
 
 #include <functional>
+#include <future>
 
 #include "core/object.hpp"
 #include "core/queue.hpp"
@@ -75,10 +76,17 @@ namespace clover {
    protected:
       void chain(event *ev);
 
+      /// Keep the event from being signalled once its action returns,
+      /// until a matching unhold().  Dependent events wait meanwhile.
+      void hold();
+      void unhold();
+
       cl_int _status;
       std::vector<ref_ptr<event>> deps;
 
    private:
+      void signal();
+
       unsigned wait_count;
       action action_ok;
       action action_fail;
@@ -114,15 +122,22 @@ namespace clover {
       const lazy<cl_ulong> &time_start() const;
       const lazy<cl_ulong> &time_end() const;
 
+      /// Run \a task on a host thread of the queue from within the
+      /// action.  The event, and the events depending on it, complete
+      /// once \a task has returned.
+      void defer(std::function<void ()> task);
+
       friend class command_queue;
 
    private:
       virtual void fence(pipe_fence_handle *fence);
       action profile(command_queue &q, const action &action) const;
+      action serialize(command_queue &q, const action &action) const;
 
       command_queue &_queue;
       cl_command_type _command;
       pipe_fence_handle *_fence;
+      std::shared_future<void> _host_done;
       lazy<cl_ulong> _time_queued, _time_submit, _time_start, _time_end;
    };
 
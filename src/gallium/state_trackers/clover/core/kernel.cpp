@@ -159,8 +159,10 @@ kernel::exec_context::exec_context(kernel &kern) :
 }
 
 kernel::exec_context::~exec_context() {
-   if (st)
+   if (st) {
+      std::lock_guard<std::recursive_mutex> lock(q->mutex);
       q->pipe->delete_compute_state(q->pipe, st);
+   }
 }
 
 void *
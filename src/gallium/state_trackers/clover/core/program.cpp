@@ -21,10 +21,32 @@
 //
 
 #include "core/program.hpp"
+#include "core/binary_cache.hpp"
 #include "core/compiler.hpp"
 
 using namespace clover;
 
+namespace {
+   module
+   compile_program(const device &dev, const std::string &source,
+                   const std::string &opts) {
+      if (dev.ir_format() == PIPE_SHADER_IR_TGSI)
+         return compile_program_tgsi(source);
+
+      // Running clang and the LLVM optimizers is what's worth caching.
+      binary_cache cache(dev, source, opts);
+      module m;
+
+      if (!cache.load(m)) {
+         m = compile_program_llvm(source, dev.ir_format(),
+                                  dev.ir_target(), opts);
+         cache.store(m);
+      }
+
+      return m;
+   }
+}
+
 program::program(context &ctx, const std::string &source) :
    has_source(true), ctx(ctx), _source(source) {
 }
@@ -50,10 +72,7 @@ program::build(const ref_vector<device> &devs, const char *opts) {
          _opts.insert({ &dev, opts });
 
          try {
-            auto module = (dev.ir_format() == PIPE_SHADER_IR_TGSI ?
-                           compile_program_tgsi(_source) :
-                           compile_program_llvm(_source, dev.ir_format(),
-                                                dev.ir_target(), build_opts(dev)));
+            auto module = compile_program(dev, _source, build_opts(dev));
             _binaries.insert({ &dev, module });
 
          } catch (build_error &e) {
@@ -20,6 +20,8 @@
 // OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#include <algorithm>
+
 #include "core/queue.hpp"
 #include "core/event.hpp"
 #include "pipe/p_screen.h"
@@ -29,13 +31,22 @@ using namespace clover;
 
 command_queue::command_queue(context &ctx, device &dev,
                              cl_command_queue_properties props) :
-   ctx(ctx), dev(dev), _props(props) {
+   ctx(ctx), dev(dev), _props(props), host_exit(false) {
    pipe = dev.pipe->context_create(dev.pipe, NULL);
    if (!pipe)
       throw error(CL_INVALID_DEVICE);
 }
 
 command_queue::~command_queue() {
+   {
+      std::lock_guard<std::mutex> lock(host_mutex);
+      host_exit = true;
+   }
+
+   host_cond.notify_all();
+   for (auto &t : host_threads)
+      t.join();
+
    pipe->destroy(pipe);
 }
 
@@ -43,16 +54,24 @@ void
 command_queue::flush() {
    pipe_screen *screen = dev.pipe;
    pipe_fence_handle *fence = NULL;
+   std::lock_guard<std::recursive_mutex> lock(mutex);
 
    if (!queued_events.empty()) {
       pipe->flush(pipe, &fence, 0);
 
-      while (!queued_events.empty() &&
-             queued_events.front()->signalled()) {
-         queued_events.front()->fence(fence);
-         queued_events.pop_front();
+      // Out of order, signalled events needn't be contiguous.
+      for (auto it = queued_events.begin(); it != queued_events.end();) {
+         if ((*it)->signalled()) {
+            (*it)->fence(fence);
+            it = queued_events.erase(it);
+         } else {
+            ++it;
+         }
       }
 
+      if (barrier_event && barrier_event->signalled())
+         barrier_event.reset();
+
       screen->fence_reference(screen, &fence, NULL);
    }
 }
@@ -67,10 +86,72 @@ command_queue::profiling_enabled() const {
    return _props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+bool
+command_queue::out_of_order() const {
+   return _props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event *ev) {
-   if (!queued_events.empty())
-      queued_events.back()->chain(ev);
+   std::lock_guard<std::recursive_mutex> lock(mutex);
+
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()->chain(ev);
+
+   } else if (ev->command() == CL_COMMAND_MARKER || !ev->command()) {
+      // Events whose action already ran are ordered by the pipe
+      // context, only the ones still waiting need an explicit edge.
+      for (auto &qev : queued_events) {
+         if (!qev->signalled())
+            qev->chain(ev);
+      }
+
+      // Barriers, clEnqueueWaitForEvents() and clFinish() hold back
+      // the commands queued after them.
+      if (!ev->command())
+         barrier_event = ev;
+
+   } else if (barrier_event && !barrier_event->signalled()) {
+      barrier_event->chain(ev);
+   }
 
    queued_events.push_back(ev);
 }
+
+void
+command_queue::run_on_host(std::function<void ()> task) {
+   std::lock_guard<std::mutex> lock(host_mutex);
+
+   if (host_threads.empty()) {
+      unsigned n = std::max(1u, std::min(4u,
+                                         std::thread::hardware_concurrency()));
+
+      for (unsigned i = 0; i < n; i++)
+         host_threads.emplace_back(&command_queue::host_thread, this);
+   }
+
+   host_tasks.push_back(std::move(task));
+   host_cond.notify_one();
+}
+
+void
+command_queue::host_thread() {
+   for (;;) {
+      std::unique_lock<std::mutex> lock(host_mutex);
+
+      host_cond.wait(lock, [&] {
+            return host_exit || !host_tasks.empty();
+         });
+
+      // Pending work is finished before exiting.
+      if (host_tasks.empty())
+         return;
+
+      auto task = std::move(host_tasks.front());
+      host_tasks.pop_front();
+      lock.unlock();
+
+      task();
+   }
+}
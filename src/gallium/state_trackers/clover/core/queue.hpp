@@ -23,7 +23,12 @@
 #ifndef CLOVER_CORE_QUEUE_HPP
 #define CLOVER_CORE_QUEUE_HPP
 
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "core/object.hpp"
 #include "core/context.hpp"
@@ -49,6 +54,7 @@ namespace clover {
 
       cl_command_queue_properties props() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       context &ctx;
       device &dev;
@@ -65,13 +71,40 @@ namespace clover {
    private:
       /// Serialize a hardware event with respect to the previous ones,
       /// and push it to the pending list.
+      ///
+      /// In order, every event depends on the previous one.  Out of
+      /// order, events only wait for their wait list and the last
+      /// barrier, so commands whose dependencies are met run right
+      /// away instead of queueing up behind unrelated ones.  Markers
+      /// and barriers depend on every pending event.
       void sequence(hard_event *ev);
 
+      /// Run \a task on one of the queue's host threads, started on
+      /// first use.
+      void run_on_host(std::function<void ()> task);
+      void host_thread();
+
       cl_command_queue_properties _props;
       pipe_context *pipe;
 
+      /// Held while using the pipe context or the pending list.  Out
+      /// of order, actions can run on whichever thread completes their
+      /// last dependency, e.g. one calling clSetUserEventStatus().
+      /// Recursive because dropping the last reference to an event in
+      /// flush() destroys its timestamp queries.
+      std::recursive_mutex mutex;
+
       typedef ref_ptr<hard_event> event_ptr;
       std::deque<event_ptr> queued_events;
+      event_ptr barrier_event;
+
+      /// Host-side work of out of order commands, e.g. the memcpy of
+      /// a non-blocking read, so independent copies overlap.
+      std::mutex host_mutex;
+      std::condition_variable host_cond;
+      std::deque<std::function<void ()>> host_tasks;
+      std::vector<std::thread> host_threads;
+      bool host_exit;
    };
 }
 
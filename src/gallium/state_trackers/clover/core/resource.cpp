@@ -65,6 +65,8 @@ resource::copy(command_queue &q, const vector &origin, const vector &region,
 void *
 resource::add_map(command_queue &q, cl_map_flags flags, bool blocking,
                   const vector &origin, const vector &region) {
+   std::lock_guard<std::recursive_mutex> lock(q.mutex);
+
    maps.emplace_back(q, *this, flags, blocking, origin, region);
    return maps.back();
 }
@@ -136,16 +138,34 @@ root_resource::root_resource(device &dev, memory_obj &obj,
                 PIPE_BIND_TRANSFER_READ |
                 PIPE_BIND_TRANSFER_WRITE);
 
+   const char *init = (data.empty() ? NULL : data.data());
+
+   if (obj.flags() & CL_MEM_USE_HOST_PTR) {
+      // CPU devices can work on the application's memory in place, so
+      // maps return host_ptr and nothing is ever copied.
+      if (info.target == PIPE_BUFFER &&
+          dev.type() == CL_DEVICE_TYPE_CPU &&
+          dev.pipe->resource_from_user_memory) {
+         pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                    obj.host_ptr(), 0);
+         if (pipe)
+            return;
+      }
+
+      init = (const char *)obj.host_ptr();
+   }
+
    pipe = dev.pipe->resource_create(dev.pipe, &info);
    if (!pipe)
       throw error(CL_OUT_OF_RESOURCES);
 
-   if (!data.empty()) {
+   if (init) {
       box rect { {{ 0, 0, 0 }}, {{ info.width0, info.height0, info.depth0 }} };
       unsigned cpp = util_format_get_blocksize(info.format);
+      std::lock_guard<std::recursive_mutex> lock(q.mutex);
 
       q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
-                                    rect, data.data(), cpp * info.width0,
+                                    rect, init, cpp * info.width0,
                                     cpp * info.width0 * info.height0);
    }
 }
@@ -170,13 +190,15 @@ mapping::mapping(command_queue &q, resource &r,
                  cl_map_flags flags, bool blocking,
                  const resource::vector &origin,
                  const resource::vector &region) :
-   pctx(q.pipe) {
+   q(&q) {
    unsigned usage = ((flags & CL_MAP_WRITE ? PIPE_TRANSFER_WRITE : 0 ) |
                      (flags & CL_MAP_READ ? PIPE_TRANSFER_READ : 0 ) |
                      (!blocking ? PIPE_TRANSFER_UNSYNCHRONIZED : 0));
 
-   p = pctx->transfer_map(pctx, r.pipe, 0, usage,
-                          box(origin + r.offset, region), &pxfer);
+   std::lock_guard<std::recursive_mutex> lock(q.mutex);
+
+   p = q.pipe->transfer_map(q.pipe, r.pipe, 0, usage,
+                            box(origin + r.offset, region), &pxfer);
    if (!p) {
       pxfer = NULL;
       throw error(CL_OUT_OF_RESOURCES);
@@ -184,21 +206,22 @@ mapping::mapping(command_queue &q, resource &r,
 }
 
 mapping::mapping(mapping &&m) :
-   pctx(m.pctx), pxfer(m.pxfer), p(m.p) {
-   m.pctx = NULL;
+   q(m.q), pxfer(m.pxfer), p(m.p) {
+   m.q = NULL;
    m.pxfer = NULL;
    m.p = NULL;
 }
 
 mapping::~mapping() {
    if (pxfer) {
-      pctx->transfer_unmap(pctx, pxfer);
+      std::lock_guard<std::recursive_mutex> lock(q->mutex);
+      q->pipe->transfer_unmap(q->pipe, pxfer);
    }
 }
 
 mapping &
 mapping::operator=(mapping m) {
-   std::swap(pctx, m.pctx);
+   std::swap(q, m.q);
    std::swap(pxfer, m.pxfer);
    std::swap(p, m.p);
    return *this;
@@ -122,7 +122,7 @@ namespace clover {
       }
 
    private:
-      pipe_context *pctx;
+      command_queue *q;
       pipe_transfer *pxfer;
       void *p;
    };
@@ -39,6 +39,8 @@ timestamp::query::query(query &&other) :
 }
 
 timestamp::query::~query() {
+   std::lock_guard<std::recursive_mutex> lock(q.mutex);
+
    if (_query)
       q.pipe->destroy_query(q.pipe, _query);
 }
@@ -46,6 +48,7 @@ timestamp::query::~query() {
 cl_ulong
 timestamp::query::operator()() const {
    pipe_query_result result;
+   std::lock_guard<std::recursive_mutex> lock(q.mutex);
 
    if (!q.pipe->get_query_result(q.pipe, _query, false, &result))
       throw error(CL_PROFILING_INFO_NOT_AVAILABLE);
@@ -55,6 +55,10 @@ dri_fill_st_options(struct st_config_options *options,
       driQueryOptioni(optionCache, "force_glsl_version");
    options->force_s3tc_enable =
       driQueryOptionb(optionCache, "force_s3tc_enable");
+   options->glsl_compiler_threads =
+      driQueryOptioni(optionCache, "multithread_glsl_compiler");
+   options->upload_buffer_size =
+      driQueryOptioni(optionCache, "upload_buffer_size") * 1024;
 }
 
 GLboolean
@@ -70,6 +70,13 @@ const __DRIconfigOptionsExtension gallium_config_options = {
          DRI_CONF_FORCE_GLSL_VERSION(0)
       DRI_CONF_SECTION_END
 
+      DRI_CONF_SECTION_PERFORMANCE
+         DRI_CONF_MULTITHREAD_GLSL_COMPILER(0)
+         DRI_CONF_UPLOAD_BUFFER_SIZE(0)
+         DRI_CONF_SW_RASTERIZER_THREADS(-1)
+         DRI_CONF_DISABLE_THROTTLING("false")
+      DRI_CONF_SECTION_END
+
       DRI_CONF_SECTION_MISCELLANEOUS
          DRI_CONF_ALWAYS_HAVE_DEPTH_BUFFER("false")
       DRI_CONF_SECTION_END
@@ -403,6 +410,23 @@ dri_postprocessing_init(struct dri_screen *screen)
    }
 }
 
+/**
+ * Parse the driconf options for the screen.
+ *
+ * Called before the pipe_screen is created, since some options affect how
+ * it is set up.
+ */
+void
+dri_init_options(struct dri_screen *screen)
+{
+   driParseOptionInfo(&screen->optionCacheDefaults, gallium_config_options.xml);
+
+   driParseConfigFiles(&screen->optionCache,
+		       &screen->optionCacheDefaults,
+                       screen->sPriv->myNum,
+                       driver_descriptor.name);
+}
+
 const __DRIconfig **
 dri_init_screen_helper(struct dri_screen *screen,
                        struct pipe_screen *pscreen)
@@ -425,13 +449,6 @@ dri_init_screen_helper(struct dri_screen *screen,
    else
       screen->target = PIPE_TEXTURE_RECT;
 
-   driParseOptionInfo(&screen->optionCacheDefaults, gallium_config_options.xml);
-
-   driParseConfigFiles(&screen->optionCache,
-		       &screen->optionCacheDefaults,
-                       screen->sPriv->myNum,
-                       driver_descriptor.name);
-
    /* Handle force_s3tc_enable. */
    if (!util_format_s3tc_enabled &&
        driQueryOptionb(&screen->optionCache, "force_s3tc_enable")) {
@@ -1041,13 +1041,16 @@ dri2_init_screen(__DRIscreen * sPriv)
 
    sPriv->driverPrivate = (void *)screen;
 
+   dri_init_options(screen);
+
    pscreen = driver_descriptor.create_screen(screen->fd);
    if (driver_descriptor.configuration) {
       throttle_ret = driver_descriptor.configuration(DRM_CONF_THROTTLE);
       dmabuf_ret = driver_descriptor.configuration(DRM_CONF_SHARE_FD);
    }
 
-   if (throttle_ret && throttle_ret->val.val_int != -1) {
+   if (throttle_ret && throttle_ret->val.val_int != -1 &&
+       !driQueryOptionb(&screen->optionCache, "disable_throttling")) {
       screen->throttling_enabled = TRUE;
       screen->default_throttle_frames = throttle_ret->val.val_int;
    }
@@ -335,6 +335,11 @@ static const __DRIextension *drisw_screen_extensions[] = {
 };
 
 static struct drisw_loader_funcs drisw_lf = {
+   .put_image = drisw_put_image
+};
+
+/* Partial presents need putImage2, new in version 2 of the loader. */
+static struct drisw_loader_funcs drisw_lf2 = {
    .put_image = drisw_put_image,
    .put_image2 = drisw_put_image2
 };
@@ -345,6 +350,8 @@ drisw_init_screen(__DRIscreen * sPriv)
    const __DRIconfig **configs;
    struct dri_screen *screen;
    struct pipe_screen *pscreen;
+   struct drisw_loader_funcs *lf = &drisw_lf;
+   int threads;
 
    screen = CALLOC_STRUCT(dri_screen);
    if (!screen)
@@ -358,7 +365,15 @@ drisw_init_screen(__DRIscreen * sPriv)
    sPriv->driverPrivate = (void *)screen;
    sPriv->extensions = drisw_screen_extensions;
 
-   pscreen = drisw_create_screen(&drisw_lf);
+   dri_init_options(screen);
+
+   if (sPriv->swrast_loader->base.version >= 2)
+      lf = &drisw_lf2;
+
+   /* LP_NUM_THREADS in the environment still overrides this. */
+   threads = driQueryOptioni(&screen->optionCache, "sw_rasterizer_threads");
+
+   pscreen = drisw_create_screen(lf, threads);
    /* dri_init_screen_helper checks pscreen for us */
 
    configs = dri_init_screen_helper(screen, pscreen);
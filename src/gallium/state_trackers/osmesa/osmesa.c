@@ -31,16 +31,16 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't suport "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * When the user's buffer stores rows top-to-bottom (OSMESA_Y_UP=FALSE) we
+ * render directly into it, through a resource wrapping the user's memory
+ * (pipe_screen::resource_from_user_memory).  The drivers don't support
+ * "upside-down" rendering, which would be needed for the OSMESA_Y_UP=TRUE
+ * case, and llvmpipe has size and alignment requirements of its own (see
+ * llvmpipe_resource_from_user_memory()).
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise we render into ordinary resources then copy the results to the
+ * user's buffer in the flush_front() function which is called when the app
+ * calls glFlush/Finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -61,6 +61,7 @@
 #include "util/u_box.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_inlines.h"
 #include "util/u_memory.h"
 
 #include "postprocess/filters.h"
@@ -86,6 +87,13 @@ struct osmesa_buffer
 
    void *map;
 
+   /**
+    * The user memory the color attachment renders into directly, or NULL if
+    * it is an ordinary resource which is copied out in flush_front().
+    */
+   void *color_map;
+   unsigned color_stride;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -298,6 +306,51 @@ stfbi_to_osbuffer(struct st_framebuffer_iface *stfbi)
 }
 
 
+/**
+ * Return the user's buffer if the color attachment can render into it
+ * directly, or NULL if the results have to be copied at flush time.
+ * The driver stores rows top-to-bottom, so this is only possible when the
+ * user's buffer does too.
+ */
+static void *
+osmesa_user_color_map(const struct osmesa_context *osmesa,
+                      const struct osmesa_buffer *osbuffer,
+                      unsigned *stride)
+{
+   struct pipe_screen *screen = get_st_manager()->screen;
+   unsigned bpp = util_format_get_blocksize(osbuffer->visual.color_format);
+
+   *stride = 0;
+
+   if (osmesa->y_up || !screen->resource_from_user_memory)
+      return NULL;
+
+   if (osmesa->user_row_length)
+      *stride = bpp * osmesa->user_row_length;
+   else
+      *stride = bpp * osbuffer->width;
+
+   return osbuffer->map;
+}
+
+
+/**
+ * Called when the user's buffer or its layout may have changed.  If the
+ * color attachment no longer matches, bump the framebuffer stamp so the
+ * state tracker validates the attachments again before the next draw.
+ */
+static void
+osmesa_update_color_map(const struct osmesa_context *osmesa,
+                        struct osmesa_buffer *osbuffer)
+{
+   unsigned stride;
+   void *map = osmesa_user_color_map(osmesa, osbuffer, &stride);
+
+   if (map != osbuffer->color_map || stride != osbuffer->color_stride)
+      p_atomic_inc(&osbuffer->stfb->stamp);
+}
+
+
 /**
  * Called via glFlush/glFinish.  This is where we copy the contents
  * of the driver's color buffer into the user-specified buffer.
@@ -340,6 +393,19 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
       pp_run(osmesa->pp, res, res, zsbuf);
    }
 
+   if (statt == ST_ATTACHMENT_FRONT_LEFT && osbuffer->color_map) {
+      /* We rendered into the user's buffer; just wait for it to land. */
+      struct pipe_screen *screen = get_st_manager()->screen;
+      struct pipe_fence_handle *fence = NULL;
+
+      pipe->flush(pipe, &fence, 0);
+      if (fence) {
+         screen->fence_finish(screen, fence, PIPE_TIMEOUT_INFINITE);
+         screen->fence_reference(screen, &fence, NULL);
+      }
+      return TRUE;
+   }
+
    u_box_2d(0, 0, res->width0, res->height0, &box);
 
    map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
@@ -387,7 +453,8 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
                                struct pipe_resource **out)
 {
    struct pipe_screen *screen = get_st_manager()->screen;
-   enum st_attachment_type i;
+   OSMesaContext osmesa = (OSMesaContext) stctx->st_manager_private;
+   unsigned i;
    struct osmesa_buffer *osbuffer = stfbi_to_osbuffer(stfbi);
    struct pipe_resource templat;
 
@@ -404,6 +471,7 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
    templat.flags = 0;
 
    for (i = 0; i < count; i++) {
+      enum st_attachment_type statt = statts[i];
       enum pipe_format format = PIPE_FORMAT_NONE;
       unsigned bind = 0;
 
@@ -412,15 +480,15 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
        * attachment, since that's all we specified for the visual in
        * osmesa_init_st_visual().
        */
-      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+      if (statt == ST_ATTACHMENT_FRONT_LEFT) {
          format = osbuffer->visual.color_format;
          bind = PIPE_BIND_RENDER_TARGET;
       }
-      else if (statts[i] == ST_ATTACHMENT_DEPTH_STENCIL) {
+      else if (statt == ST_ATTACHMENT_DEPTH_STENCIL) {
          format = osbuffer->visual.depth_stencil_format;
          bind = PIPE_BIND_DEPTH_STENCIL;
       }
-      else if (statts[i] == ST_ATTACHMENT_ACCUM) {
+      else if (statt == ST_ATTACHMENT_ACCUM) {
          format = osbuffer->visual.accum_format;
          bind = PIPE_BIND_RENDER_TARGET;
       }
@@ -431,8 +499,40 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
 
       templat.format = format;
       templat.bind = bind;
-      out[i] = osbuffer->textures[i] =
-         screen->resource_create(screen, &templat);
+
+      if (statt == ST_ATTACHMENT_FRONT_LEFT) {
+         unsigned stride;
+         void *map = osmesa_user_color_map(osmesa, osbuffer, &stride);
+
+         if (map != osbuffer->color_map || stride != osbuffer->color_stride)
+            pipe_resource_reference(&osbuffer->textures[statt], NULL);
+
+         if (!osbuffer->textures[statt] && map) {
+            osbuffer->textures[statt] =
+               screen->resource_from_user_memory(screen, &templat,
+                                                 map, stride);
+         }
+
+         if (osbuffer->textures[statt]) {
+            osbuffer->color_map = map;
+            osbuffer->color_stride = stride;
+         }
+         else {
+            osbuffer->color_map = NULL;
+            osbuffer->color_stride = 0;
+         }
+      }
+
+      /* The buffer's size never changes, so resources from an earlier
+       * validation are still good.
+       */
+      if (!osbuffer->textures[statt]) {
+         osbuffer->textures[statt] =
+            screen->resource_create(screen, &templat);
+      }
+
+      out[i] = NULL;
+      pipe_resource_reference(&out[i], osbuffer->textures[statt]);
    }
 
    return TRUE;
@@ -507,6 +607,11 @@ osmesa_find_buffer(enum pipe_format color_format,
 static void
 osmesa_destroy_buffer(struct osmesa_buffer *osbuffer)
 {
+   unsigned i;
+
+   for (i = 0; i < Elements(osbuffer->textures); i++)
+      pipe_resource_reference(&osbuffer->textures[i], NULL);
+
    FREE(osbuffer->stfb);
    FREE(osbuffer);
 }
@@ -590,6 +695,8 @@ OSMesaCreateContextExt(GLenum format, GLint depthBits, GLint stencilBits,
    attribs.options.disable_shader_bit_encoding = FALSE;
    attribs.options.force_s3tc_enable = FALSE;
    attribs.options.force_glsl_version = 0;
+   attribs.options.glsl_compiler_threads = 0;
+   attribs.options.upload_buffer_size = 0;
 
    osmesa_init_st_visual(&attribs.visual,
                          PIPE_FORMAT_R8G8B8A8_UNORM,
@@ -687,6 +794,7 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
    osbuffer->width = width;
    osbuffer->height = height;
    osbuffer->map = buffer;
+   osmesa_update_color_map(osmesa, osbuffer);
 
    /* XXX unused for now */
    (void) osmesa_destroy_buffer;
@@ -750,6 +858,9 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   if (osmesa->current_buffer)
+      osmesa_update_color_map(osmesa, osmesa->current_buffer);
 }
 
 
@@ -85,6 +85,7 @@ MacroBlocksToPipe(XvMCContextPrivate *context,
          for (j = 0; j < 2; ++j)
             for (k = 0; k < 2; ++k)
                mb->PMV[i][j][k] = xvmc_mb->PMV[i][j][k];
+      mb->dmvector[0] = mb->dmvector[1] = 0;
 
       mb->coded_block_pattern = xvmc_mb->coded_block_pattern;
       mb->blocks = xvmc_blocks->blocks + xvmc_mb->index * BLOCK_SIZE_SAMPLES;
@@ -38,7 +38,7 @@
 DRM_DRIVER_DESCRIPTOR("swrast", NULL, NULL, NULL);
 
 struct pipe_screen *
-drisw_create_screen(struct drisw_loader_funcs *lf)
+drisw_create_screen(struct drisw_loader_funcs *lf, int num_threads)
 {
    struct sw_winsys *winsys = NULL;
    struct pipe_screen *screen = NULL;
@@ -47,7 +47,7 @@ drisw_create_screen(struct drisw_loader_funcs *lf)
    if (winsys == NULL)
       return NULL;
 
-   screen = sw_screen_create(winsys);
+   screen = sw_screen_create_threads(winsys, num_threads);
    if (!screen)
       goto fail;
 
@@ -0,0 +1,564 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Times a few compute kernels for a range of thread counts.  Meant for
+ * the software drivers, which read LP_NUM_THREADS when the screen is
+ * created:
+ *
+ *   compute-bench [iterations] [max threads]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pipe/p_state.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_defines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_inlines.h"
+#include "util/u_format.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "pipe-loader/pipe_loader.h"
+
+#define RGLOBAL        "RES[32767]"
+#define RLOCAL         "RES[32766]"
+#define RINPUT         "RES[32764]"
+
+struct context {
+        struct pipe_loader_device *dev;
+        struct pipe_screen *screen;
+        struct pipe_context *pipe;
+        void *hwcs;
+        struct pipe_resource *tex[2];
+        struct pipe_surface *surf[2];
+        unsigned launches;
+};
+
+struct bench {
+        const char *name;
+        void (*init)(struct context *ctx);
+        void (*run)(struct context *ctx);
+        bool (*check)(struct context *ctx);
+        void (*destroy)(struct context *ctx);
+};
+
+/* Setup failures end the benchmark with a non-zero exit status, as do
+ * wrong results. */
+static void fail(const char *what)
+{
+        fprintf(stderr, "compute-bench: %s failed\n", what);
+        exit(1);
+}
+
+static void init_ctx(struct context *ctx, unsigned num_threads)
+{
+        char threads[16];
+        int ret;
+
+        snprintf(threads, sizeof(threads), "%u", num_threads);
+        setenv("LP_NUM_THREADS", threads, 1);
+
+        ret = pipe_loader_probe(&ctx->dev, 1);
+        if (!ret)
+                fail("pipe_loader_probe");
+
+        ctx->screen = pipe_loader_create_screen(ctx->dev, PIPE_SEARCH_DIR);
+        if (!ctx->screen)
+                fail("pipe_loader_create_screen");
+
+        ctx->pipe = ctx->screen->context_create(ctx->screen, NULL);
+        if (!ctx->pipe)
+                fail("context_create");
+}
+
+static void destroy_ctx(struct context *ctx)
+{
+        ctx->pipe->destroy(ctx->pipe);
+        ctx->screen->destroy(ctx->screen);
+        pipe_loader_release(&ctx->dev, 1);
+        memset(ctx, 0, sizeof(*ctx));
+}
+
+static void init_prog(struct context *ctx, unsigned local_sz,
+                      unsigned input_sz, const char *src)
+{
+        struct pipe_context *pipe = ctx->pipe;
+        struct tgsi_token prog[1024];
+        struct pipe_compute_state cs = {
+                .prog = prog,
+                .req_local_mem = local_sz,
+                .req_input_mem = input_sz
+        };
+        int ret;
+
+        ret = tgsi_text_translate(src, prog, Elements(prog));
+        if (!ret)
+                fail("tgsi_text_translate");
+
+        ctx->hwcs = pipe->create_compute_state(pipe, &cs);
+        if (!ctx->hwcs)
+                fail("create_compute_state");
+
+        pipe->bind_compute_state(pipe, ctx->hwcs);
+}
+
+static void destroy_prog(struct context *ctx)
+{
+        struct pipe_context *pipe = ctx->pipe;
+
+        pipe->bind_compute_state(pipe, NULL);
+        pipe->delete_compute_state(pipe, ctx->hwcs);
+        ctx->hwcs = NULL;
+}
+
+static void init_tex(struct context *ctx, int slot,
+                     enum pipe_texture_target target,
+                     int w, int h, float (*init)(int, int))
+{
+        struct pipe_context *pipe = ctx->pipe;
+        struct pipe_resource ttex = {
+                .target = target,
+                .format = PIPE_FORMAT_R32_FLOAT,
+                .width0 = w,
+                .height0 = h,
+                .depth0 = 1,
+                .array_size = 1,
+                .bind = (PIPE_BIND_COMPUTE_RESOURCE |
+                         PIPE_BIND_GLOBAL)
+        };
+        struct pipe_transfer *xfer;
+        char *map;
+        int x, y;
+
+        ctx->tex[slot] = ctx->screen->resource_create(ctx->screen, &ttex);
+        if (!ctx->tex[slot])
+                fail("resource_create");
+
+        map = pipe->transfer_map(pipe, ctx->tex[slot], 0, PIPE_TRANSFER_WRITE,
+                                 &(struct pipe_box) { .width = w,
+                                                 .height = h,
+                                                 .depth = 1 }, &xfer);
+        if (!map)
+                fail("transfer_map");
+
+        if (target == PIPE_BUFFER)
+                w /= 4;
+
+        for (y = 0; y < h; ++y) {
+                for (x = 0; x < w; ++x)
+                        ((float *)(map + y * xfer->stride))[x] = init(x, y);
+        }
+
+        pipe->transfer_unmap(pipe, xfer);
+}
+
+static float *map_tex(struct context *ctx, int slot,
+                      struct pipe_transfer **xfer)
+{
+        struct pipe_resource *tex = ctx->tex[slot];
+        float *map;
+
+        map = ctx->pipe->transfer_map(ctx->pipe, tex, 0, PIPE_TRANSFER_READ,
+                                      &(struct pipe_box) {
+                                              .width = tex->width0,
+                                              .height = tex->height0,
+                                              .depth = 1 }, xfer);
+        if (!map)
+                fail("transfer_map");
+
+        return map;
+}
+
+static void destroy_tex(struct context *ctx)
+{
+        int i;
+
+        for (i = 0; i < Elements(ctx->tex); ++i)
+                pipe_resource_reference(&ctx->tex[i], NULL);
+}
+
+static void init_compute_resources(struct context *ctx, int n)
+{
+        struct pipe_context *pipe = ctx->pipe;
+        int i;
+
+        for (i = 0; i < n; ++i) {
+                struct pipe_surface tsurf = {
+                        .format = ctx->tex[i]->format,
+                        .writable = true
+                };
+
+                if (ctx->tex[i]->target == PIPE_BUFFER)
+                        tsurf.u.buf.last_element = ctx->tex[i]->width0 / 4 - 1;
+
+                ctx->surf[i] = pipe->create_surface(pipe, ctx->tex[i], &tsurf);
+                if (!ctx->surf[i])
+                        fail("create_surface");
+        }
+
+        pipe->set_compute_resources(pipe, 0, n, ctx->surf);
+}
+
+static void destroy_compute_resources(struct context *ctx)
+{
+        struct pipe_context *pipe = ctx->pipe;
+        int i;
+
+        pipe->set_compute_resources(pipe, 0, Elements(ctx->surf), NULL);
+
+        for (i = 0; i < Elements(ctx->surf); ++i) {
+                if (ctx->surf[i])
+                        pipe_surface_reference(&ctx->surf[i], NULL);
+        }
+}
+
+/*
+ * saxpy: y = a * x + y on two global buffers.
+ */
+
+#define SAXPY_N (1 << 22)
+#define SAXPY_BLOCK 256
+
+static float saxpy_x(int x, int y) { return x & 0xff; }
+static float saxpy_y(int x, int y) { return 1.0f; }
+
+static void init_saxpy(struct context *ctx)
+{
+        const char *src = "COMP\n"
+                "DCL SV[0], BLOCK_ID[0]\n"
+                "DCL SV[1], BLOCK_SIZE[0]\n"
+                "DCL SV[2], THREAD_ID[0]\n"
+                "DCL TEMP[0..4], LOCAL\n"
+                "IMM UINT32 { 4, 0, 0, 0 }\n"
+                "\n"
+                "    BGNSUB\n"
+                "       UMUL TEMP[0].x, SV[0], SV[1]\n"
+                "       UADD TEMP[0].x, TEMP[0], SV[2]\n"
+                "       UMUL TEMP[0].x, TEMP[0], IMM[0]\n"
+                "       LOAD TEMP[1].xyz, " RINPUT ", IMM[0].yyyy\n"
+                "       UADD TEMP[2].x, TEMP[1].yyyy, TEMP[0]\n"
+                "       UADD TEMP[2].y, TEMP[1].zzzz, TEMP[0].xxxx\n"
+                "       LOAD TEMP[3].x, " RGLOBAL ", TEMP[2].xxxx\n"
+                "       LOAD TEMP[4].x, " RGLOBAL ", TEMP[2].yyyy\n"
+                "       MAD TEMP[3].x, TEMP[1].xxxx, TEMP[3], TEMP[4]\n"
+                "       STORE " RGLOBAL ".x, TEMP[2].yyyy, TEMP[3]\n"
+                "       RET\n"
+                "    ENDSUB\n";
+
+        init_prog(ctx, 0, 12, src);
+        init_tex(ctx, 0, PIPE_BUFFER, SAXPY_N * 4, 1, saxpy_x);
+        init_tex(ctx, 1, PIPE_BUFFER, SAXPY_N * 4, 1, saxpy_y);
+        ctx->launches = 0;
+}
+
+static void run_saxpy(struct context *ctx)
+{
+        struct pipe_context *pipe = ctx->pipe;
+        union { float f; uint32_t u; } input[3];
+
+        /* y grows by x every run, check_saxpy accounts for that */
+        input[0].f = 1.0f;
+        ctx->launches++;
+        pipe->set_global_binding(pipe, 0, 2, ctx->tex,
+                                 (uint32_t *[]){ &input[1].u, &input[2].u });
+        pipe->launch_grid(pipe, (uint []){ SAXPY_BLOCK, 1, 1 },
+                          (uint []){ SAXPY_N / SAXPY_BLOCK, 1, 1 }, 0, input);
+}
+
+static bool check_saxpy(struct context *ctx)
+{
+        struct pipe_transfer *xfer;
+        float *y = map_tex(ctx, 1, &xfer);
+        float runs = ctx->launches;
+        bool ok = true;
+        int i;
+
+        for (i = 0; i < SAXPY_N && ok; ++i)
+                ok = y[i] == 1.0f + runs * saxpy_x(i, 0);
+
+        ctx->pipe->transfer_unmap(ctx->pipe, xfer);
+        return ok;
+}
+
+static void destroy_saxpy(struct context *ctx)
+{
+        ctx->pipe->set_global_binding(ctx->pipe, 0, 2, NULL, NULL);
+        destroy_tex(ctx);
+        destroy_prog(ctx);
+}
+
+/*
+ * reduction: per-block sums through local memory, with barriers.
+ */
+
+#define REDUCE_N (1 << 20)
+#define REDUCE_BLOCK 64
+
+static float reduce_in(int x, int y) { return x % REDUCE_BLOCK; }
+static float reduce_out(int x, int y) { return 0.0f; }
+
+static void init_reduce(struct context *ctx)
+{
+        const char *src = "COMP\n"
+                "DCL RES[0], BUFFER, RAW\n"
+                "DCL RES[1], BUFFER, RAW, WR\n"
+                "DCL SV[0], BLOCK_ID[0]\n"
+                "DCL SV[1], BLOCK_SIZE[0]\n"
+                "DCL SV[2], THREAD_ID[0]\n"
+                "DCL TEMP[0..4], LOCAL\n"
+                "IMM UINT32 { 4, 0, 1, 0 }\n"
+                "\n"
+                "    BGNSUB\n"
+                "       UMUL TEMP[0].x, SV[0], SV[1]\n"
+                "       UADD TEMP[0].x, TEMP[0], SV[2]\n"
+                "       UMUL TEMP[0].x, TEMP[0], IMM[0]\n"
+                "       UMUL TEMP[0].y, SV[2].xxxx, IMM[0].xxxx\n"
+                "       LOAD TEMP[1].x, RES[0].xxxx, TEMP[0]\n"
+                "       STORE " RLOCAL ".x, TEMP[0].yyyy, TEMP[1]\n"
+                "       BARRIER\n"
+                "       USHR TEMP[2].x, SV[1], IMM[0].zzzz\n"
+                "       BGNLOOP\n"
+                "               USEQ TEMP[3].x, TEMP[2], IMM[0].yyyy\n"
+                "               IF TEMP[3]\n"
+                "                       BRK\n"
+                "               ENDIF\n"
+                "               USLT TEMP[3].x, SV[2], TEMP[2]\n"
+                "               IF TEMP[3]\n"
+                "                       UMUL TEMP[3].y, TEMP[2].xxxx, IMM[0].xxxx\n"
+                "                       UADD TEMP[3].y, TEMP[0], TEMP[3]\n"
+                "                       LOAD TEMP[4].x, " RLOCAL ".xxxx, TEMP[3].yyyy\n"
+                "                       LOAD TEMP[4].y, " RLOCAL ".xxxx, TEMP[0].yyyy\n"
+                "                       ADD TEMP[4].x, TEMP[4], TEMP[4].yyyy\n"
+                "                       STORE " RLOCAL ".x, TEMP[0].yyyy, TEMP[4]\n"
+                "               ENDIF\n"
+                "               BARRIER\n"
+                "               USHR TEMP[2].x, TEMP[2], IMM[0].zzzz\n"
+                "       ENDLOOP\n"
+                "       USEQ TEMP[3].x, SV[2], IMM[0].yyyy\n"
+                "       IF TEMP[3]\n"
+                "               LOAD TEMP[4].x, " RLOCAL ".xxxx, IMM[0].yyyy\n"
+                "               UMUL TEMP[3].y, SV[0].xxxx, IMM[0].xxxx\n"
+                "               STORE RES[1].x, TEMP[3].yyyy, TEMP[4]\n"
+                "       ENDIF\n"
+                "       RET\n"
+                "    ENDSUB\n";
+
+        init_prog(ctx, REDUCE_BLOCK * 4, 0, src);
+        init_tex(ctx, 0, PIPE_BUFFER, REDUCE_N * 4, 1, reduce_in);
+        init_tex(ctx, 1, PIPE_BUFFER, REDUCE_N / REDUCE_BLOCK * 4, 1,
+                 reduce_out);
+        init_compute_resources(ctx, 2);
+}
+
+static void run_reduce(struct context *ctx)
+{
+        ctx->pipe->launch_grid(ctx->pipe, (uint []){ REDUCE_BLOCK, 1, 1 },
+                               (uint []){ REDUCE_N / REDUCE_BLOCK, 1, 1 },
+                               0, NULL);
+}
+
+static bool check_reduce(struct context *ctx)
+{
+        struct pipe_transfer *xfer;
+        float *sums = map_tex(ctx, 1, &xfer);
+        bool ok = true;
+        int i;
+
+        for (i = 0; i < REDUCE_N / REDUCE_BLOCK && ok; ++i)
+                ok = sums[i] == REDUCE_BLOCK * (REDUCE_BLOCK - 1) / 2;
+
+        ctx->pipe->transfer_unmap(ctx->pipe, xfer);
+        return ok;
+}
+
+static void destroy_reduce(struct context *ctx)
+{
+        destroy_compute_resources(ctx);
+        destroy_tex(ctx);
+        destroy_prog(ctx);
+}
+
+/*
+ * convolution: 3x3 box filter over the inside of a 2D texture.
+ */
+
+#define CONV_BLOCK 16
+#define CONV_SIZE (64 * CONV_BLOCK + 2)
+
+static float conv_in(int x, int y) { return (x + y) % 9; }
+static float conv_out(int x, int y) { return -1.0f; }
+
+static void init_conv(struct context *ctx)
+{
+        const char *src = "COMP\n"
+                "DCL RES[0], 2D, RAW\n"
+                "DCL RES[1], 2D, RAW, WR\n"
+                "DCL SV[0], BLOCK_ID[0]\n"
+                "DCL SV[1], BLOCK_SIZE[0]\n"
+                "DCL SV[2], THREAD_ID[0]\n"
+                "DCL TEMP[0..3], LOCAL\n"
+                "IMM UINT32 { 0, 0, 0, 0 }\n"
+                "IMM UINT32 { 4, 0, 0, 0 }\n"
+                "IMM UINT32 { 8, 0, 0, 0 }\n"
+                "IMM UINT32 { 0, 1, 0, 0 }\n"
+                "IMM UINT32 { 4, 1, 0, 0 }\n"
+                "IMM UINT32 { 8, 1, 0, 0 }\n"
+                "IMM UINT32 { 0, 2, 0, 0 }\n"
+                "IMM UINT32 { 4, 2, 0, 0 }\n"
+                "IMM UINT32 { 8, 2, 0, 0 }\n"
+                "IMM FLT32 { 0.11111111, 0.0, 0.0, 0.0 }\n"
+                "\n"
+                "    BGNSUB\n"
+                "       UMUL TEMP[0].xy, SV[0], SV[1]\n"
+                "       UADD TEMP[0].xy, TEMP[0], SV[2]\n"
+                "       UMUL TEMP[0].x, TEMP[0], IMM[1]\n"
+                "       MOV TEMP[1].x, IMM[9].yyyy\n"
+#define TAP(i)                                                          \
+                "       UADD TEMP[3].xy, TEMP[0], IMM[" #i "]\n"        \
+                "       LOAD TEMP[2].x, RES[0].xxxx, TEMP[3]\n"         \
+                "       ADD TEMP[1].x, TEMP[1], TEMP[2]\n"
+                TAP(0) TAP(1) TAP(2) TAP(3) TAP(4)
+                TAP(5) TAP(6) TAP(7) TAP(8)
+#undef TAP
+                "       MUL TEMP[1].x, TEMP[1], IMM[9]\n"
+                "       UADD TEMP[3].xy, TEMP[0], IMM[4]\n"
+                "       STORE RES[1].x, TEMP[3], TEMP[1]\n"
+                "       RET\n"
+                "    ENDSUB\n";
+
+        init_prog(ctx, 0, 0, src);
+        init_tex(ctx, 0, PIPE_TEXTURE_2D, CONV_SIZE, CONV_SIZE, conv_in);
+        init_tex(ctx, 1, PIPE_TEXTURE_2D, CONV_SIZE, CONV_SIZE, conv_out);
+        init_compute_resources(ctx, 2);
+}
+
+static void run_conv(struct context *ctx)
+{
+        const uint n = (CONV_SIZE - 2) / CONV_BLOCK;
+
+        ctx->pipe->launch_grid(ctx->pipe,
+                               (uint []){ CONV_BLOCK, CONV_BLOCK, 1 },
+                               (uint []){ n, n, 1 }, 0, NULL);
+}
+
+static bool check_conv(struct context *ctx)
+{
+        struct pipe_transfer *xfer;
+        float *map = map_tex(ctx, 1, &xfer);
+        bool ok = true;
+        int x, y, i, j;
+
+        for (y = 1; y < CONV_SIZE - 1 && ok; ++y) {
+                float *row = (float *)((char *)map + y * xfer->stride);
+
+                for (x = 1; x < CONV_SIZE - 1 && ok; ++x) {
+                        float sum = 0.0f;
+
+                        for (j = -1; j <= 1; ++j)
+                                for (i = -1; i <= 1; ++i)
+                                        sum += conv_in(x + i, y + j);
+
+                        ok = fabsf(row[x] - sum / 9.0f) < 1e-4f;
+                }
+        }
+
+        ctx->pipe->transfer_unmap(ctx->pipe, xfer);
+        return ok;
+}
+
+static void destroy_conv(struct context *ctx)
+{
+        destroy_compute_resources(ctx);
+        destroy_tex(ctx);
+        destroy_prog(ctx);
+}
+
+static const struct bench benches[] = {
+        { "saxpy", init_saxpy, run_saxpy, check_saxpy, destroy_saxpy },
+        { "reduce", init_reduce, run_reduce, check_reduce, destroy_reduce },
+        { "conv3x3", init_conv, run_conv, check_conv, destroy_conv },
+};
+
+int main(int argc, char *argv[])
+{
+        unsigned iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10;
+        long max_threads = (argc > 2) ? strtol(argv[2], NULL, 0) :
+                           sysconf(_SC_NPROCESSORS_ONLN);
+        struct context ctx;
+        double base[Elements(benches)];
+        unsigned threads, b, i;
+        bool failed = false;
+
+        memset(&ctx, 0, sizeof(ctx));
+
+        printf("%-8s %8s %12s %8s\n", "kernel", "threads", "ms/launch",
+               "speedup");
+
+        /* 0 runs on the calling thread, without the rasterizer threads */
+        for (threads = 0; threads <= (unsigned)max_threads;
+             threads = threads ? threads * 2 : 1) {
+                init_ctx(&ctx, threads);
+
+                for (b = 0; b < Elements(benches); ++b) {
+                        const struct bench *bench = &benches[b];
+                        int64_t start, end;
+                        double ms;
+                        bool ok;
+
+                        bench->init(&ctx);
+
+                        /* the first launch compiles the kernel */
+                        bench->run(&ctx);
+                        ctx.pipe->flush(ctx.pipe, NULL, 0);
+
+                        start = os_time_get();
+                        for (i = 0; i < iterations; ++i)
+                                bench->run(&ctx);
+                        ctx.pipe->flush(ctx.pipe, NULL, 0);
+                        end = os_time_get();
+
+                        ms = (end - start) / 1000.0 / MAX2(iterations, 1);
+                        if (!threads)
+                                base[b] = ms;
+
+                        ok = bench->check(&ctx);
+                        failed |= !ok;
+
+                        printf("%-8s %8u %12.3f %7.2fx%s\n", bench->name,
+                               threads, ms, base[b] / ms,
+                               ok ? "" : "  \x1b[31mFAIL\x1b[0m");
+
+                        bench->destroy(&ctx);
+                }
+
+                destroy_ctx(&ctx);
+        }
+
+        return failed ? 1 : 0;
+}
@@ -183,7 +183,8 @@ dri_sw_displaytarget_display(struct sw_winsys *ws,
 
    height = dri_sw_dt->height;
 
-   if (box) {
+   /* Older loaders can only take whole images. */
+   if (box && dri_sw_ws->lf->put_image2) {
        void *data;
        data = dri_sw_dt->data + (dri_sw_dt->stride * box->y) + box->x * blsize;
        dri_sw_ws->lf->put_image2(dri_drawable, data,
@@ -34,10 +34,13 @@
 
 #include "pipe/p_format.h"
 #include "pipe/p_context.h"
+#include "util/u_box.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "os/os_thread.h"
+#include "os/os_time.h"
 
 #include "state_tracker/xlib_sw_winsys.h"
 
@@ -49,6 +52,8 @@
 #include <X11/extensions/XShm.h>
 
 DEBUG_GET_ONCE_BOOL_OPTION(xlib_no_shm, "XLIB_NO_SHM", FALSE)
+DEBUG_GET_ONCE_NUM_OPTION(xlib_present_queue, "XLIB_PRESENT_QUEUE", 0)
+DEBUG_GET_ONCE_BOOL_OPTION(xlib_present_stats, "XLIB_PRESENT_STATS", FALSE)
 
 /**
  * Display target for Xlib winsys.
@@ -79,6 +84,73 @@ struct xlib_displaytarget
 };
 
 
+/**
+ * A copy of a presented region, waiting in the present queue.
+ *
+ * The memory belongs to the application thread while the slot isn't
+ * queued.  Everything touching the X connection belongs to the present
+ * thread.
+ */
+struct xlib_present_slot
+{
+   char *data;
+   unsigned size;
+   unsigned stride;
+   unsigned height;
+   enum pipe_format format;
+
+   XShmSegmentInfo shminfo;
+   Bool shm;           /**< data is a shared memory segment */
+   Bool attached;      /**< shminfo is attached to the present connection */
+
+   /** A segment the slot used before it was resized, still attached. */
+   XShmSegmentInfo retired;
+   Bool has_retired;
+
+   struct xlib_drawable drawable;
+   struct pipe_box box;
+
+   int64_t queued_time;
+};
+
+
+/**
+ * Queue of presents performed by a separate thread on its own X
+ * connection, so that the application can render the next frame while the
+ * server copies the previous one.  Enabled with XLIB_PRESENT_QUEUE=n, where
+ * n is the number of frames that may be queued before presenting blocks.
+ */
+struct xlib_present_queue
+{
+   Display *display;   /**< private connection, used by the thread only */
+   GC gc;
+   Drawable gc_drawable;
+
+   pipe_thread thread;
+   pipe_mutex mutex;
+   pipe_condvar cond;
+   boolean kill;
+
+   struct xlib_present_slot *slots;
+   unsigned num_slots;
+   unsigned head;      /**< oldest queued slot */
+   unsigned count;     /**< number of queued slots */
+
+   /* Statistics, protected by the mutex */
+   unsigned num_presents;
+   unsigned num_blocked;           /**< presents that waited for a slot */
+   uint64_t occupancy_sum;         /**< queued slots, summed at each present */
+   int64_t latency_sum;            /**< queue to server completion, in usecs */
+   int64_t latency_max;
+
+   /** Whether slots get shared memory; cleared if attaching fails. */
+   boolean use_shm;
+
+   /** Set when a request on the private connection failed. */
+   boolean error;
+};
+
+
 /**
  * Subclass of sw_winsys for Xlib winsys
  */
@@ -86,6 +158,8 @@ struct xlib_sw_winsys
 {
    struct sw_winsys base;
    Display *display;
+
+   struct xlib_present_queue *present;
 };
 
 
@@ -289,17 +363,19 @@ xlib_displaytarget_destroy(struct sw_winsys *ws,
 
 /**
  * Display/copy the image in the surface into the X window specified
- * by the display target.
+ * by the display target.  If box is not NULL only that region is copied.
  */
 static void
 xlib_sw_display(struct xlib_drawable *xlib_drawable,
-                struct sw_displaytarget *dt)
+                struct sw_displaytarget *dt,
+                struct pipe_box *box)
 {
    static boolean no_swap = 0;
    static boolean firsttime = 1;
    struct xlib_displaytarget *xlib_dt = xlib_displaytarget(dt);
    Display *display = xlib_dt->display;
    XImage *ximage;
+   struct pipe_box full;
 
    if (firsttime) {
       no_swap = getenv("SP_NO_RAST") != NULL;
@@ -338,13 +414,19 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
       XSetFunction(display, xlib_dt->gc, GXcopy);
    }
 
+   if (!box) {
+      u_box_2d(0, 0, xlib_dt->width, xlib_dt->height, &full);
+      box = &full;
+   }
+
    if (xlib_dt->shm) {
       ximage = xlib_dt->tempImage;
       ximage->data = xlib_dt->data;
 
       /* _debug_printf("XSHM\n"); */
       XShmPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                   ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height, False);
+                   ximage, box->x, box->y, box->x, box->y,
+                   box->width, box->height, False);
    }
    else {
       /* display image in Window */
@@ -362,13 +444,426 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
 
       /* _debug_printf("XPUT\n"); */
       XPutImage(xlib_dt->display, xlib_drawable->drawable, xlib_dt->gc,
-                ximage, 0, 0, 0, 0, xlib_dt->width, xlib_dt->height);
+                ximage, box->x, box->y, box->x, box->y,
+                box->width, box->height);
    }
 
    XFlush(xlib_dt->display);
 }
 
 
+/*
+ * Asynchronous presents
+ */
+
+/**
+ * Errors on a present connection are noted and otherwise ignored: a window
+ * can be destroyed while a present to it is still queued.  Xlib calls the
+ * error hooks of a connection's extensions before the process-wide error
+ * handler, so a hook registered on the private connection catches its
+ * errors without touching the handler the application thread may be
+ * swapping.
+ */
+static int
+present_error_hook(Display *dpy, xError *err, XExtCodes *codes, int *ret_code)
+{
+   XExtData **list = XEHeadOfExtensionList((XEDataObject) dpy);
+   XExtData *data = XFindOnExtensionList(list, codes->extension);
+   struct xlib_present_queue *q;
+
+   if (!data)
+      return False;
+
+   q = (struct xlib_present_queue *) data->private_data;
+   q->error = TRUE;
+   *ret_code = 0;
+   return True;
+}
+
+
+/** The queue outlives its connection's extension data. */
+static int
+present_free_ext_data(XExtData *data)
+{
+   return 0;
+}
+
+
+/**
+ * Hook present_error_hook() into the queue's private connection.
+ */
+static boolean
+present_catch_errors(struct xlib_present_queue *q)
+{
+   XExtCodes *codes;
+   XExtData *data;
+
+   codes = XAddExtension(q->display);
+   if (!codes)
+      return FALSE;
+
+   data = Xcalloc(1, sizeof(*data));
+   if (!data)
+      return FALSE;
+
+   data->number = codes->extension;
+   data->free_private = present_free_ext_data;
+   data->private_data = (XPointer) q;
+   XAddToExtensionList(XEHeadOfExtensionList((XEDataObject) q->display), data);
+
+   XESetError(q->display, codes->extension, present_error_hook);
+
+   return TRUE;
+}
+
+
+/**
+ * (Re)allocate a slot's memory.  Called by the application thread, with
+ * the slot not queued.
+ */
+static boolean
+present_slot_alloc(struct xlib_present_queue *q,
+                   struct xlib_present_slot *slot,
+                   unsigned size)
+{
+   if (slot->shm) {
+      shmdt(slot->shminfo.shmaddr);
+
+      /* The present thread detaches it from the server the next time it
+       * uses the slot.
+       */
+      if (slot->attached && !slot->has_retired) {
+         slot->retired = slot->shminfo;
+         slot->has_retired = True;
+      }
+      else if (!slot->attached) {
+         shmctl(slot->shminfo.shmid, IPC_RMID, 0);
+      }
+   }
+   else {
+      FREE(slot->data);
+   }
+
+   slot->data = NULL;
+   slot->size = 0;
+   slot->shm = False;
+   slot->attached = False;
+
+   if (q->use_shm) {
+      XShmSegmentInfo *const shminfo = &slot->shminfo;
+
+      shminfo->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT|0777);
+      if (shminfo->shmid >= 0) {
+         shminfo->shmaddr = (char *) shmat(shminfo->shmid, 0, 0);
+         if (shminfo->shmaddr != (char *) -1) {
+            shminfo->readOnly = False;
+            slot->data = shminfo->shmaddr;
+            slot->shm = True;
+         }
+         else {
+            shmctl(shminfo->shmid, IPC_RMID, 0);
+         }
+      }
+   }
+
+   if (!slot->data)
+      slot->data = MALLOC(size);
+   if (!slot->data)
+      return FALSE;
+
+   slot->size = size;
+   return TRUE;
+}
+
+
+static void
+present_slot_free(struct xlib_present_queue *q,
+                  struct xlib_present_slot *slot)
+{
+   if (slot->has_retired)
+      XShmDetach(q->display, &slot->retired);
+
+   if (slot->shm) {
+      if (slot->attached)
+         XShmDetach(q->display, &slot->shminfo);
+      else
+         shmctl(slot->shminfo.shmid, IPC_RMID, 0);
+      shmdt(slot->shminfo.shmaddr);
+   }
+   else {
+      FREE(slot->data);
+   }
+}
+
+
+/**
+ * Copy a queued slot to its window.  Called by the present thread.
+ */
+static void
+present_slot_put(struct xlib_present_queue *q,
+                 struct xlib_present_slot *slot)
+{
+   Display *display = q->display;
+   const struct xlib_drawable *drawable = &slot->drawable;
+   const struct pipe_box *box = &slot->box;
+   unsigned width = slot->stride / util_format_get_blocksize(slot->format);
+   XImage *ximage;
+
+   if (slot->has_retired) {
+      XShmDetach(display, &slot->retired);
+      slot->has_retired = False;
+   }
+
+   if (slot->shm && !slot->attached) {
+      q->error = FALSE;
+      XShmAttach(display, &slot->shminfo);
+      XSync(display, False);
+
+      /* Needs to be after XShmAttach() for *BSD. */
+      shmctl(slot->shminfo.shmid, IPC_RMID, 0);
+
+      if (q->error) {
+         /* Remote display; keep using the memory for plain images. */
+         q->use_shm = FALSE;
+      }
+      else {
+         slot->attached = True;
+      }
+   }
+
+   if (q->gc_drawable != drawable->drawable) {
+      if (q->gc)
+         XFreeGC(display, q->gc);
+      q->gc = XCreateGC(display, drawable->drawable, 0, NULL);
+      XSetFunction(display, q->gc, GXcopy);
+      q->gc_drawable = drawable->drawable;
+   }
+
+   if (slot->attached) {
+      ximage = XShmCreateImage(display, drawable->visual, drawable->depth,
+                               ZPixmap, slot->data, &slot->shminfo,
+                               width, slot->height);
+      if (ximage) {
+         XShmPutImage(display, drawable->drawable, q->gc, ximage,
+                      box->x, box->y, box->x, box->y,
+                      box->width, box->height, False);
+      }
+   }
+   else {
+      ximage = XCreateImage(display, drawable->visual, drawable->depth,
+                            ZPixmap, 0, slot->data, width, slot->height,
+                            8, 0);
+      if (ximage) {
+         XPutImage(display, drawable->drawable, q->gc, ximage,
+                   box->x, box->y, box->x, box->y,
+                   box->width, box->height);
+      }
+   }
+
+   if (ximage) {
+      ximage->data = NULL;
+      XDestroyImage(ximage);
+   }
+
+   /* Wait for the server to be done with the slot's memory, and for any
+    * error the requests above caused.
+    */
+   XSync(display, False);
+}
+
+
+static PIPE_THREAD_ROUTINE(present_thread_func, init_data)
+{
+   struct xlib_present_queue *q = (struct xlib_present_queue *) init_data;
+
+   pipe_mutex_lock(q->mutex);
+
+   for (;;) {
+      struct xlib_present_slot *slot;
+      int64_t latency;
+
+      while (!q->count && !q->kill)
+         pipe_condvar_wait(q->cond, q->mutex);
+
+      /* Finish what was queued before exiting. */
+      if (!q->count)
+         break;
+
+      slot = &q->slots[q->head];
+
+      pipe_mutex_unlock(q->mutex);
+      present_slot_put(q, slot);
+      latency = os_time_get() - slot->queued_time;
+      pipe_mutex_lock(q->mutex);
+
+      q->latency_sum += latency;
+      q->latency_max = MAX2(q->latency_max, latency);
+
+      q->head = (q->head + 1) % q->num_slots;
+      q->count--;
+      pipe_condvar_broadcast(q->cond);
+   }
+
+   pipe_mutex_unlock(q->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Copy the region to present into the next free slot and queue it,
+ * blocking while the queue is full.
+ * \return FALSE if no slot memory could be allocated.
+ */
+static boolean
+present_queue_display(struct xlib_present_queue *q,
+                      struct xlib_drawable *xlib_drawable,
+                      struct xlib_displaytarget *xlib_dt,
+                      struct pipe_box *box)
+{
+   struct xlib_present_slot *slot;
+   unsigned size = xlib_dt->stride * xlib_dt->height;
+   unsigned cpp = util_format_get_blocksize(xlib_dt->format);
+   struct pipe_box full;
+   const char *src;
+   char *dst;
+   int y;
+
+   if (!box) {
+      u_box_2d(0, 0, xlib_dt->width, xlib_dt->height, &full);
+      box = &full;
+   }
+
+   pipe_mutex_lock(q->mutex);
+   if (q->count == q->num_slots) {
+      q->num_blocked++;
+      while (q->count == q->num_slots)
+         pipe_condvar_wait(q->cond, q->mutex);
+   }
+   slot = &q->slots[(q->head + q->count) % q->num_slots];
+   pipe_mutex_unlock(q->mutex);
+
+   if (slot->size < size && !present_slot_alloc(q, slot, size))
+      return FALSE;
+
+   slot->stride = xlib_dt->stride;
+   slot->height = xlib_dt->height;
+   slot->format = xlib_dt->format;
+   slot->drawable = *xlib_drawable;
+   slot->box = *box;
+
+   /* The slot keeps the display target's layout; only the region being
+    * presented is copied.
+    */
+   src = (const char *) xlib_dt->data + box->y * xlib_dt->stride + box->x * cpp;
+   dst = slot->data + box->y * slot->stride + box->x * cpp;
+   for (y = 0; y < box->height; y++) {
+      memcpy(dst, src, box->width * cpp);
+      src += xlib_dt->stride;
+      dst += slot->stride;
+   }
+
+   slot->queued_time = os_time_get();
+
+   pipe_mutex_lock(q->mutex);
+   q->count++;
+   q->num_presents++;
+   q->occupancy_sum += q->count;
+   pipe_condvar_broadcast(q->cond);
+   pipe_mutex_unlock(q->mutex);
+
+   return TRUE;
+}
+
+
+static struct xlib_present_queue *
+present_queue_create(Display *display, unsigned num_slots)
+{
+   struct xlib_present_queue *q = CALLOC_STRUCT(xlib_present_queue);
+   if (!q)
+      return NULL;
+
+   q->slots = CALLOC(num_slots, sizeof(*q->slots));
+   if (!q->slots)
+      goto no_slots;
+   q->num_slots = num_slots;
+
+   /* Xlib isn't thread-safe unless the application asked for it, so the
+    * thread gets a connection of its own.
+    */
+   q->display = XOpenDisplay(DisplayString(display));
+   if (!q->display)
+      goto no_display;
+
+   q->use_shm = !debug_get_option_xlib_no_shm() &&
+                XShmQueryExtension(q->display);
+
+   if (!present_catch_errors(q))
+      goto no_catch;
+
+   pipe_mutex_init(q->mutex);
+   pipe_condvar_init(q->cond);
+
+   q->thread = pipe_thread_create(present_thread_func, q);
+   if (!q->thread)
+      goto no_thread;
+
+   return q;
+
+no_thread:
+   pipe_condvar_destroy(q->cond);
+   pipe_mutex_destroy(q->mutex);
+no_catch:
+   XCloseDisplay(q->display);
+no_display:
+   FREE(q->slots);
+no_slots:
+   FREE(q);
+   return NULL;
+}
+
+
+static void
+present_queue_destroy(struct xlib_present_queue *q)
+{
+   unsigned i;
+
+   pipe_mutex_lock(q->mutex);
+   q->kill = TRUE;
+   pipe_condvar_broadcast(q->cond);
+   pipe_mutex_unlock(q->mutex);
+
+   pipe_thread_wait(q->thread);
+
+   if (debug_get_option_xlib_present_stats() && q->num_presents) {
+      debug_printf("xlib: %u presents, %u blocked on a full queue\n",
+                   q->num_presents, q->num_blocked);
+      debug_printf("xlib: average queue occupancy %.2f of %u\n",
+                   (double) q->occupancy_sum / q->num_presents,
+                   q->num_slots);
+      debug_printf("xlib: present latency average %.2f ms, max %.2f ms\n",
+                   q->latency_sum / 1000.0 / q->num_presents,
+                   q->latency_max / 1000.0);
+   }
+
+   for (i = 0; i < q->num_slots; i++) {
+      if (q->slots[i].data)
+         present_slot_free(q, &q->slots[i]);
+   }
+
+   if (q->gc)
+      XFreeGC(q->display, q->gc);
+
+   XSync(q->display, False);
+   XCloseDisplay(q->display);
+
+   pipe_condvar_destroy(q->cond);
+   pipe_mutex_destroy(q->mutex);
+   FREE(q->slots);
+   FREE(q);
+}
+
+
 /**
  * Display/copy the image in the surface into the X window specified
  * by the display target.
@@ -379,8 +874,15 @@ xlib_displaytarget_display(struct sw_winsys *ws,
                            void *context_private,
                            struct pipe_box *box)
 {
+   struct xlib_sw_winsys *xlib_ws = (struct xlib_sw_winsys *) ws;
    struct xlib_drawable *xlib_drawable = (struct xlib_drawable *)context_private;
-   xlib_sw_display(xlib_drawable, dt);
+
+   if (xlib_ws->present &&
+       present_queue_display(xlib_ws->present, xlib_drawable,
+                             xlib_displaytarget(dt), box))
+      return;
+
+   xlib_sw_display(xlib_drawable, dt, box);
 }
 
 
@@ -455,6 +957,11 @@ xlib_displaytarget_get_handle(struct sw_winsys *winsys,
 static void
 xlib_destroy(struct sw_winsys *ws)
 {
+   struct xlib_sw_winsys *xlib_ws = (struct xlib_sw_winsys *) ws;
+
+   if (xlib_ws->present)
+      present_queue_destroy(xlib_ws->present);
+
    FREE(ws);
 }
 
@@ -482,5 +989,10 @@ xlib_create_sw_winsys(Display *display)
 
    ws->base.displaytarget_display = xlib_displaytarget_display;
 
+   if (debug_get_option_xlib_present_queue() > 0) {
+      ws->present = present_queue_create(display,
+                                         debug_get_option_xlib_present_queue());
+   }
+
    return &ws->base;
 }
@@ -1507,6 +1507,7 @@ do_common_optimization(exec_list *ir, bool linked,
    progress = opt_flatten_nested_if_blocks(ir) || progress;
    progress = do_copy_propagation(ir) || progress;
    progress = do_copy_propagation_elements(ir) || progress;
+   progress = do_single_def_propagation(ir) || progress;
 
    if (options->OptimizeForAOS && !linked)
       progress = opt_flip_matrices(ir) || progress;
@@ -1528,6 +1529,7 @@ do_common_optimization(exec_list *ir, bool linked,
       progress = do_constant_variable_unlinked(ir) || progress;
    progress = do_constant_folding(ir) || progress;
    progress = do_cse(ir) || progress;
+   progress = do_licm(ir) || progress;
    progress = do_algebraic(ir) || progress;
    progress = do_lower_jumps(ir) || progress;
    progress = do_vec_index_to_swizzle(ir) || progress;
@@ -0,0 +1,181 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_single_def.cpp
+ *
+ * Finds the local variables with a single definition.  See ir_single_def.h.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_hierarchical_visitor.h"
+#include "ir_single_def.h"
+
+namespace {
+
+class single_def_visitor : public ir_hierarchical_visitor
+{
+public:
+   single_def_visitor(void *mem_ctx, hash_table *ht)
+      : mem_ctx(mem_ctx), ht(ht), function_depth(0)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_variable *ir);
+   virtual ir_visitor_status visit_enter(ir_function *ir);
+   virtual ir_visitor_status visit_leave(ir_function *ir);
+   virtual ir_visitor_status visit_enter(ir_assignment *ir);
+   virtual ir_visitor_status visit_enter(ir_call *ir);
+
+private:
+   void kill(ir_variable *var);
+
+   void *mem_ctx;
+   hash_table *ht;
+   int function_depth;
+};
+
+} /* unnamed namespace */
+
+void
+single_def_visitor::kill(ir_variable *var)
+{
+   ir_single_def_entry *entry = (ir_single_def_entry *) hash_table_find(ht, var);
+   if (entry)
+      entry->num_defs = ~0u;
+}
+
+ir_visitor_status
+single_def_visitor::visit(ir_variable *ir)
+{
+   /* Globals may be written by functions in other compilation units, and
+    * anything else but plain locals is written from outside the function.
+    */
+   if (function_depth > 0 &&
+       (ir->data.mode == ir_var_auto || ir->data.mode == ir_var_temporary))
+      hash_table_insert(ht, new(mem_ctx) ir_single_def_entry, ir);
+
+   return visit_continue;
+}
+
+ir_visitor_status
+single_def_visitor::visit_enter(ir_function *ir)
+{
+   function_depth++;
+   return visit_continue;
+}
+
+ir_visitor_status
+single_def_visitor::visit_leave(ir_function *ir)
+{
+   function_depth--;
+   return visit_continue;
+}
+
+ir_visitor_status
+single_def_visitor::visit_enter(ir_assignment *ir)
+{
+   ir_variable *var = ir->lhs->variable_referenced();
+   ir_single_def_entry *entry = (ir_single_def_entry *) hash_table_find(ht, var);
+
+   if (!entry)
+      return visit_continue;
+
+   if (ir->condition || ir->whole_variable_written() != var) {
+      entry->num_defs = ~0u;
+   } else if (entry->num_defs != ~0u) {
+      entry->num_defs++;
+      entry->def = ir;
+   }
+
+   return visit_continue;
+}
+
+ir_visitor_status
+single_def_visitor::visit_enter(ir_call *ir)
+{
+   if (ir->return_deref)
+      kill(ir->return_deref->var);
+
+   foreach_two_lists(formal_node, &ir->callee->parameters,
+                     actual_node, &ir->actual_parameters) {
+      ir_variable *sig_param = (ir_variable *) formal_node;
+      ir_rvalue *param = (ir_rvalue *) actual_node;
+
+      if (sig_param->data.mode == ir_var_function_out ||
+          sig_param->data.mode == ir_var_function_inout)
+         kill(param->variable_referenced());
+   }
+
+   return visit_continue_with_parent;
+}
+
+ir_single_def_state::ir_single_def_state(exec_list *instructions)
+{
+   this->mem_ctx = ralloc_context(NULL);
+   this->ht = hash_table_ctor(0, hash_table_pointer_hash,
+                              hash_table_pointer_compare);
+
+   single_def_visitor v(mem_ctx, ht);
+   v.run(instructions);
+}
+
+ir_single_def_state::~ir_single_def_state()
+{
+   hash_table_dtor(this->ht);
+   ralloc_free(this->mem_ctx);
+}
+
+ir_single_def_entry *
+ir_single_def_state::get(const ir_variable *var)
+{
+   ir_single_def_entry *entry = (ir_single_def_entry *) hash_table_find(ht, var);
+
+   return entry && entry->num_defs == 1 ? entry : NULL;
+}
+
+ir_single_def_entry *
+ir_single_def_state::assignment_visited(ir_assignment *ir)
+{
+   ir_single_def_entry *entry = get(ir->lhs->variable_referenced());
+
+   if (!entry || entry->def != ir)
+      return NULL;
+
+   entry->visible = true;
+   visible.push_tail(entry);
+
+   return entry;
+}
+
+void
+ir_single_def_state::leave_scope(exec_node *marker)
+{
+   while (visible.get_tail() != marker) {
+      ir_single_def_entry *entry = (ir_single_def_entry *) visible.get_tail();
+      entry->visible = false;
+      entry->remove();
+   }
+}
@@ -0,0 +1,117 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file ir_single_def.h
+ *
+ * Tracks the local variables that are already in SSA form: those with
+ * exactly one unconditional assignment writing the whole variable.
+ *
+ * Once that assignment has executed, the variable holds the same value
+ * everywhere the assignment dominates.  In the structured IR that is the
+ * rest of the instruction list containing it, including nested blocks.  A
+ * pass walking the IR in order calls assignment_visited() after each
+ * assignment and brackets every nested instruction list with
+ * enter_scope()/leave_scope(), and is_visible() then tells whether a
+ * variable's definition dominates the current instruction.
+ */
+
+#pragma once
+#ifndef IR_SINGLE_DEF_H
+#define IR_SINGLE_DEF_H
+
+#include "ir.h"
+#include "program/hash_table.h"
+
+class ir_single_def_entry : public exec_node
+{
+public:
+   ir_single_def_entry()
+      : def(NULL), num_defs(0), visible(false), propagatable(false)
+   {
+   }
+
+   /** The only assignment to the variable, if num_defs is 1. */
+   ir_assignment *def;
+
+   /**
+    * Number of assignments to the variable, or ~0u if it is written in a way
+    * that isn't tracked (conditionally, partially, or through a call).
+    */
+   unsigned num_defs;
+
+   /** Whether \c def dominates the instruction currently being visited. */
+   bool visible;
+
+   /**
+    * Whether copies of \c def's RHS can replace the variable wherever \c def
+    * dominates.  Set by opt_single_def_propagation when it visits \c def.
+    */
+   bool propagatable;
+};
+
+class ir_single_def_state
+{
+public:
+   ir_single_def_state(exec_list *instructions);
+   ~ir_single_def_state();
+
+   /**
+    * Returns the entry for \c var if it has a single definition, else NULL.
+    */
+   ir_single_def_entry *get(const ir_variable *var);
+
+   /** Whether \c var's single definition dominates the current point. */
+   bool is_visible(const ir_variable *var)
+   {
+      ir_single_def_entry *entry = get(var);
+      return entry && entry->visible;
+   }
+
+   /**
+    * Marks the variable written by \c ir as visible if \c ir is its single
+    * definition, and returns its entry in that case.
+    */
+   ir_single_def_entry *assignment_visited(ir_assignment *ir);
+
+   /** Starts a nested instruction list, returning the scope marker. */
+   exec_node *enter_scope()
+   {
+      return visible.get_tail();
+   }
+
+   /** Hides every definition made visible since \c marker. */
+   void leave_scope(exec_node *marker);
+
+private:
+   void *mem_ctx;
+
+   /** Map from ir_variable to ir_single_def_entry, for all locals. */
+   hash_table *ht;
+
+   /** List of ir_single_def_entry that are currently visible. */
+   exec_list visible;
+};
+
+#endif /* IR_SINGLE_DEF_H */
@@ -29,7 +29,15 @@
  * Compare to brw_fs_cse.cpp for a more complete CSE implementation.  This one
  * is generic and handles texture operations, but it's rather simple currently
  * and doesn't support modification of variables in the available expressions
- * list, so it can't do variables other than uniforms or shader inputs.
+ * list, so it can only handle variables whose value never changes once it is
+ * visible: uniforms, shader inputs, and locals with a single unconditional
+ * assignment.
+ *
+ * Since the IR is structured, an instruction dominates everything after it in
+ * its own list and everything nested inside those.  Available expressions are
+ * therefore kept in a stack of scopes following the nesting of if and loop
+ * bodies, which makes this a dominator-tree scoped global value numbering
+ * rather than a purely local CSE.
  */
 
 #include "ir.h"
@@ -39,6 +47,7 @@
 #include "ir_optimization.h"
 #include "ir_builder.h"
 #include "glsl_types.h"
+#include "ir_single_def.h"
 
 using namespace ir_builder;
 
@@ -96,9 +105,11 @@ public:
       progress = false;
       mem_ctx = ralloc_context(NULL);
       this->ae = new(mem_ctx) exec_list;
+      this->defs = new ir_single_def_state(validate_instructions);
    }
    ~cse_visitor()
    {
+      delete defs;
       ralloc_free(mem_ctx);
    }
 
@@ -106,6 +117,7 @@ public:
    virtual ir_visitor_status visit_enter(ir_loop *ir);
    virtual ir_visitor_status visit_enter(ir_if *ir);
    virtual ir_visitor_status visit_enter(ir_call *ir);
+   virtual ir_visitor_status visit_leave(ir_assignment *ir);
    virtual void handle_rvalue(ir_rvalue **rvalue);
 
    bool progress;
@@ -115,10 +127,14 @@ private:
 
    ir_rvalue *try_cse(ir_rvalue *rvalue);
    void add_to_ae(ir_rvalue **rvalue);
+   void visit_scope(exec_list *instructions);
 
    /** List of ae_entry: The available expressions to reuse */
    exec_list *ae;
 
+   /** Locals with a single definition, and which ones are visible. */
+   ir_single_def_state *defs;
+
    /**
     * The whole shader, so that we can validate_ir_tree in debug mode.
     *
@@ -136,14 +152,17 @@ class is_cse_candidate_visitor : public ir_hierarchical_visitor
 {
 public:
 
-   is_cse_candidate_visitor()
-      : ok(true)
+   is_cse_candidate_visitor(ir_single_def_state *defs)
+      : ok(true), defs(defs)
    {
    }
 
    virtual ir_visitor_status visit(ir_dereference_variable *ir);
 
    bool ok;
+
+private:
+   ir_single_def_state *defs;
 };
 
 
@@ -191,16 +210,21 @@ ir_visitor_status
 is_cse_candidate_visitor::visit(ir_dereference_variable *ir)
 {
    /* Currently, since we don't handle kills of the ae based on variables
-    * getting assigned, we can only handle constant variables.
+    * getting assigned, we can only handle variables that can't change once
+    * they are visible: constant variables, and locals whose only assignment
+    * dominates this point.
     */
-   if (ir->var->data.read_only) {
+   if (ir->var->data.read_only)
       return visit_continue;
-   } else {
-      ok = false;
-      return visit_stop;
-   }
+
+   if (defs->is_visible(ir->var))
+      return visit_continue;
+
+   ok = false;
+   return visit_stop;
 }
 
+
 void
 contains_rvalue_visitor::handle_rvalue(ir_rvalue **rvalue)
 {
@@ -217,7 +241,7 @@ contains_rvalue(ir_rvalue *haystack, ir_rvalue *needle)
 }
 
 static bool
-is_cse_candidate(ir_rvalue *ir)
+is_cse_candidate(ir_rvalue *ir, ir_single_def_state *defs)
 {
    /* Our temporary variable assignment generation isn't ready to handle
     * anything bigger than a vector.
@@ -236,7 +260,7 @@ is_cse_candidate(ir_rvalue *ir)
       return false;
    }
 
-   is_cse_candidate_visitor v;
+   is_cse_candidate_visitor v(defs);
 
    ir->accept(&v);
 
@@ -348,7 +372,7 @@ cse_visitor::handle_rvalue(ir_rvalue **rvalue)
       printf("\n");
    }
 
-   if (!is_cse_candidate(*rvalue))
+   if (!is_cse_candidate(*rvalue, defs))
       return;
 
    ir_rvalue *new_rvalue = try_cse(*rvalue);
@@ -363,18 +387,35 @@ cse_visitor::handle_rvalue(ir_rvalue **rvalue)
    }
 }
 
+/**
+ * Visits a nested list of instructions.
+ *
+ * Everything available on entry stays available inside, since it dominates
+ * the nested code.  What becomes available inside only dominates the rest of
+ * the nested list, so it is dropped on the way out.
+ */
+void
+cse_visitor::visit_scope(exec_list *instructions)
+{
+   exec_node *ae_tail = ae->get_tail();
+   exec_node *defs_scope = defs->enter_scope();
+
+   visit_list_elements(this, instructions);
+
+   while (ae->get_tail() != ae_tail)
+      ae->get_tail()->remove();
+
+   defs->leave_scope(defs_scope);
+}
+
 ir_visitor_status
 cse_visitor::visit_enter(ir_if *ir)
 {
    handle_rvalue(&ir->condition);
 
-   ae->make_empty();
-   visit_list_elements(this, &ir->then_instructions);
-
-   ae->make_empty();
-   visit_list_elements(this, &ir->else_instructions);
+   visit_scope(&ir->then_instructions);
+   visit_scope(&ir->else_instructions);
 
-   ae->make_empty();
    return visit_continue_with_parent;
 }
 
@@ -382,22 +423,31 @@ ir_visitor_status
 cse_visitor::visit_enter(ir_function_signature *ir)
 {
    ae->make_empty();
-   visit_list_elements(this, &ir->body);
+   visit_scope(&ir->body);
 
    ae->make_empty();
+
    return visit_continue_with_parent;
 }
 
 ir_visitor_status
 cse_visitor::visit_enter(ir_loop *ir)
 {
-   ae->make_empty();
-   visit_list_elements(this, &ir->body_instructions);
+   visit_scope(&ir->body_instructions);
 
-   ae->make_empty();
    return visit_continue_with_parent;
 }
 
+ir_visitor_status
+cse_visitor::visit_leave(ir_assignment *ir)
+{
+   ir_visitor_status s = ir_rvalue_visitor::visit_leave(ir);
+
+   defs->assignment_visited(ir);
+
+   return s;
+}
+
 ir_visitor_status
 cse_visitor::visit_enter(ir_call *ir)
 {
@@ -409,8 +459,8 @@ cse_visitor::visit_enter(ir_call *ir)
 }
 
 /**
- * Does a (uniform-value) constant subexpression elimination pass on the code
- * present in the instruction stream.
+ * Does a (uniform-value and single-definition) common subexpression
+ * elimination pass on the code present in the instruction stream.
  */
 bool
 do_cse(exec_list *instructions)
@@ -0,0 +1,290 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_licm.cpp
+ *
+ * Loop-invariant code motion at the GLSL IR level.
+ *
+ * Expressions inside a loop body whose operands are all loop constant are
+ * computed once into a temporary before the loop, and the temporary is used
+ * in their place.  Loop constancy comes from loop_analysis: a variable that
+ * isn't assigned anywhere in the loop (including nested loops) has the same
+ * value on every iteration as it had on entry.
+ *
+ * Only ALU expressions are moved.  They have no side effects, so evaluating
+ * them even when the loop runs zero times or when they sit under an if in
+ * the body is safe.  Texture lookups and derivatives are left alone, since
+ * their results depend on the control flow they execute in.  Loops
+ * containing calls are skipped, as the analysis doesn't know what they
+ * write.
+ *
+ * Nested loops aren't looked into while handling the outer loop; each loop
+ * hoists into its own preheader, and a later pass through the optimization
+ * loop moves things further out if they're invariant there too.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_rvalue_visitor.h"
+#include "ir_optimization.h"
+#include "ir_builder.h"
+#include "loop_analysis.h"
+#include "glsl_types.h"
+
+using namespace ir_builder;
+
+namespace {
+
+/**
+ * Collects the variables declared inside a loop body.
+ *
+ * Such a variable that is never assigned in the loop reads as loop constant
+ * to loop_analysis, but a reference to it can't be moved above its
+ * declaration.
+ */
+class loop_declaration_visitor : public ir_hierarchical_visitor {
+public:
+   loop_declaration_visitor(hash_table *declared)
+      : declared(declared)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_variable *ir)
+   {
+      hash_table_insert(declared, ir, ir);
+      return visit_continue;
+   }
+
+private:
+   hash_table *declared;
+};
+
+/**
+ * Checks that an expression tree only reads loop constants and has no
+ * operations that depend on where they execute.
+ */
+class is_invariant_visitor : public ir_hierarchical_visitor {
+public:
+   is_invariant_visitor(loop_variable_state *ls, hash_table *declared)
+      : invariant(true), reads_variables(false), ls(ls), declared(declared)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir);
+   virtual ir_visitor_status visit_enter(ir_expression *ir);
+   virtual ir_visitor_status visit_enter(ir_texture *ir);
+   virtual ir_visitor_status visit_enter(ir_call *ir);
+
+   bool invariant;
+
+   /** Whether anything but constants is read. */
+   bool reads_variables;
+
+private:
+   loop_variable_state *ls;
+   hash_table *declared;
+};
+
+/**
+ * Moves the largest invariant expressions in one loop body to before the
+ * loop.
+ */
+class licm_visitor : public ir_rvalue_enter_visitor {
+public:
+   licm_visitor(ir_loop *loop, loop_variable_state *ls, hash_table *declared)
+      : progress(false), loop(loop), ls(ls), declared(declared)
+   {
+   }
+
+   virtual ir_visitor_status visit_enter(ir_loop *ir);
+   virtual void handle_rvalue(ir_rvalue **rvalue);
+
+   bool progress;
+
+private:
+   ir_loop *loop;
+   loop_variable_state *ls;
+   hash_table *declared;
+};
+
+class loop_finder : public ir_hierarchical_visitor {
+public:
+   loop_finder(loop_state *loops)
+      : progress(false), loops(loops)
+   {
+   }
+
+   virtual ir_visitor_status visit_enter(ir_loop *ir);
+
+   bool progress;
+
+private:
+   loop_state *loops;
+};
+
+} /* unnamed namespace */
+
+ir_visitor_status
+is_invariant_visitor::visit(ir_dereference_variable *ir)
+{
+   reads_variables = true;
+
+   /* A variable declared inside the loop gets a fresh value on every
+    * iteration, even if it is read-only, so it can't be hoisted past its
+    * declaration.
+    */
+   if (hash_table_find(declared, ir->var) != NULL) {
+      invariant = false;
+      return visit_stop;
+   }
+
+   if (ir->var->data.read_only)
+      return visit_continue;
+
+   loop_variable *lv = ls->get(ir->var);
+
+   /* Every variable referenced in the loop was recorded by loop_analysis.
+    * The only ones missing are temporaries this pass created, whose
+    * references are not visited again.
+    */
+   if (lv == NULL || lv->num_assignments != 0) {
+      invariant = false;
+      return visit_stop;
+   }
+
+   return visit_continue;
+}
+
+ir_visitor_status
+is_invariant_visitor::visit_enter(ir_expression *ir)
+{
+   switch (ir->operation) {
+   case ir_unop_dFdx:
+   case ir_unop_dFdy:
+      invariant = false;
+      return visit_stop;
+   default:
+      return visit_continue;
+   }
+}
+
+ir_visitor_status
+is_invariant_visitor::visit_enter(ir_texture *ir)
+{
+   invariant = false;
+   return visit_stop;
+}
+
+ir_visitor_status
+is_invariant_visitor::visit_enter(ir_call *ir)
+{
+   invariant = false;
+   return visit_stop;
+}
+
+ir_visitor_status
+licm_visitor::visit_enter(ir_loop *ir)
+{
+   /* Nested loops hoist into their own preheader, which is part of our
+    * body and gets looked at on the next pass.
+    */
+   return visit_continue_with_parent;
+}
+
+void
+licm_visitor::handle_rvalue(ir_rvalue **rvalue)
+{
+   if (!*rvalue)
+      return;
+
+   ir_expression *expr = (*rvalue)->as_expression();
+   if (!expr)
+      return;
+
+   /* Our temporary variable assignment generation isn't ready to handle
+    * anything bigger than a vector.
+    */
+   if (!expr->type->is_vector() && !expr->type->is_scalar())
+      return;
+
+   is_invariant_visitor v(ls, declared);
+   expr->accept(&v);
+
+   /* Expressions of constants are for constant folding to deal with. */
+   if (!v.invariant || !v.reads_variables)
+      return;
+
+   ir_variable *var = new(ralloc_parent(expr)) ir_variable(expr->type,
+                                                           "licm",
+                                                           ir_var_temporary);
+   loop->insert_before(var);
+   loop->insert_before(assign(var, expr));
+
+   *rvalue = new(ralloc_parent(expr)) ir_dereference_variable(var);
+   progress = true;
+}
+
+ir_visitor_status
+loop_finder::visit_enter(ir_loop *ir)
+{
+   loop_variable_state *ls = loops->get(ir);
+
+   if (ls != NULL && !ls->contains_calls) {
+      hash_table *declared = hash_table_ctor(0, hash_table_pointer_hash,
+                                             hash_table_pointer_compare);
+      loop_declaration_visitor dv(declared);
+      dv.run(&ir->body_instructions);
+
+      licm_visitor v(ir, ls, declared);
+      visit_list_elements(&v, &ir->body_instructions);
+      progress = v.progress || progress;
+
+      hash_table_dtor(declared);
+   }
+
+   return visit_continue;
+}
+
+/**
+ * Moves loop-invariant expressions out of every loop in the instruction
+ * stream.
+ */
+bool
+do_licm(exec_list *instructions)
+{
+   loop_state *ls = analyze_loop_variables(instructions);
+
+   if (!ls->loop_found) {
+      delete ls;
+      return false;
+   }
+
+   loop_finder v(ls);
+   v.run(instructions);
+
+   delete ls;
+
+   return v.progress;
+}
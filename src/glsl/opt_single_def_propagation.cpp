@@ -0,0 +1,217 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file opt_single_def_propagation.cpp
+ *
+ * Sparse copy and constant propagation over the locals that are already in
+ * SSA form.
+ *
+ * opt_copy_propagation and opt_constant_propagation rebuild their available
+ * copy lists per basic block and kill them at every if and loop, so a copy
+ * made before a branch never reaches code inside it.  For a variable with a
+ * single unconditional definition (see ir_single_def.h) no kills are
+ * needed: wherever that definition dominates, the variable holds the same
+ * value.  If the definition's RHS is a constant, or a (swizzled) reference
+ * to a read-only variable or another such variable whose own definition
+ * dominates the first one, each dominated use is replaced with a copy of
+ * the RHS.
+ *
+ * Chains of copies collapse in the same walk, since the RHS of a definition
+ * has already been rewritten by the time the definition becomes visible.
+ * The definitions that end up unused are left for dead code elimination.
+ */
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_rvalue_visitor.h"
+#include "ir_optimization.h"
+#include "ir_single_def.h"
+#include "glsl_types.h"
+
+namespace {
+
+class single_def_propagation_visitor : public ir_rvalue_visitor {
+public:
+   single_def_propagation_visitor(exec_list *instructions)
+      : progress(false), defs(instructions)
+   {
+   }
+
+   virtual ir_visitor_status visit_enter(ir_function_signature *ir);
+   virtual ir_visitor_status visit_enter(ir_loop *ir);
+   virtual ir_visitor_status visit_enter(ir_if *ir);
+   virtual ir_visitor_status visit_enter(ir_call *ir);
+   virtual ir_visitor_status visit_leave(ir_assignment *ir);
+   virtual void handle_rvalue(ir_rvalue **rvalue);
+
+   bool progress;
+
+private:
+   void visit_scope(exec_list *instructions);
+   bool is_propagatable(ir_rvalue *rhs);
+
+   ir_single_def_state defs;
+};
+
+} /* unnamed namespace */
+
+/**
+ * Whether a definition's RHS can be copied to the places it dominates.
+ *
+ * Only constants and plain references are propagated, so that no
+ * computation is duplicated.  This has to be decided at the definition: a
+ * referenced variable whose definition doesn't dominate it may be assigned
+ * between the definition and a use, as in a loop that copies a variable
+ * before assigning it.
+ */
+bool
+single_def_propagation_visitor::is_propagatable(ir_rvalue *rhs)
+{
+   if (rhs->as_constant())
+      return true;
+
+   ir_swizzle *swiz = rhs->as_swizzle();
+   if (swiz)
+      rhs = swiz->val;
+
+   ir_dereference_variable *deref = rhs->as_dereference_variable();
+   if (!deref)
+      return false;
+
+   return deref->var->data.read_only || defs.is_visible(deref->var);
+}
+
+void
+single_def_propagation_visitor::handle_rvalue(ir_rvalue **rvalue)
+{
+   if (!*rvalue || this->in_assignee)
+      return;
+
+   ir_dereference_variable *deref = (*rvalue)->as_dereference_variable();
+   if (!deref)
+      return;
+
+   ir_single_def_entry *entry = defs.get(deref->var);
+   if (!entry || !entry->visible || !entry->propagatable)
+      return;
+
+   *rvalue = entry->def->rhs->clone(ralloc_parent(deref), NULL);
+   progress = true;
+}
+
+void
+single_def_propagation_visitor::visit_scope(exec_list *instructions)
+{
+   exec_node *scope = defs.enter_scope();
+
+   visit_list_elements(this, instructions);
+
+   defs.leave_scope(scope);
+}
+
+ir_visitor_status
+single_def_propagation_visitor::visit_enter(ir_function_signature *ir)
+{
+   visit_scope(&ir->body);
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+single_def_propagation_visitor::visit_enter(ir_loop *ir)
+{
+   visit_scope(&ir->body_instructions);
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+single_def_propagation_visitor::visit_enter(ir_if *ir)
+{
+   ir->condition->accept(this);
+   handle_rvalue(&ir->condition);
+
+   visit_scope(&ir->then_instructions);
+   visit_scope(&ir->else_instructions);
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+single_def_propagation_visitor::visit_enter(ir_call *ir)
+{
+   /* Only in parameters can be rewritten; out and inout ones are written
+    * through.
+    */
+   foreach_two_lists(formal_node, &ir->callee->parameters,
+                     actual_node, &ir->actual_parameters) {
+      ir_variable *sig_param = (ir_variable *) formal_node;
+      ir_rvalue *param = (ir_rvalue *) actual_node;
+
+      if (sig_param->data.mode != ir_var_function_in &&
+          sig_param->data.mode != ir_var_const_in)
+         continue;
+
+      param->accept(this);
+
+      ir_rvalue *new_param = param;
+      handle_rvalue(&new_param);
+      if (new_param != param)
+         param->replace_with(new_param);
+   }
+
+   return visit_continue_with_parent;
+}
+
+ir_visitor_status
+single_def_propagation_visitor::visit_leave(ir_assignment *ir)
+{
+   ir_visitor_status s = ir_rvalue_visitor::visit_leave(ir);
+
+   /* The RHS has been rewritten already, and the variable itself isn't
+    * visible yet.
+    */
+   bool propagatable = is_propagatable(ir->rhs);
+
+   ir_single_def_entry *entry = defs.assignment_visited(ir);
+   if (entry)
+      entry->propagatable = propagatable;
+
+   return s;
+}
+
+/**
+ * Propagates copies and constants held in single-definition locals to every
+ * use their definition dominates.
+ */
+bool
+do_single_def_propagation(exec_list *instructions)
+{
+   single_def_propagation_visitor v(instructions);
+
+   v.run(instructions);
+
+   return v.progress;
+}
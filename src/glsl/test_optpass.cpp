@@ -79,6 +79,8 @@ do_optimization(struct exec_list *ir, const char *optimization,
       return do_copy_propagation_elements(ir);
    } else if (strcmp(optimization, "do_constant_propagation") == 0) {
       return do_constant_propagation(ir);
+   } else if (strcmp(optimization, "do_cse") == 0) {
+      return do_cse(ir);
    } else if (strcmp(optimization, "do_dead_code") == 0) {
       return do_dead_code(ir, false);
    } else if (strcmp(optimization, "do_dead_code_local") == 0) {
@@ -94,6 +96,8 @@ do_optimization(struct exec_list *ir, const char *optimization,
                      &int_0, &int_1, &int_2, &int_3, &int_4) == 5) {
       return do_lower_jumps(ir, int_0 != 0, int_1 != 0, int_2 != 0,
                             int_3 != 0, int_4 != 0);
+   } else if (strcmp(optimization, "do_licm") == 0) {
+      return do_licm(ir);
    } else if (strcmp(optimization, "do_lower_texture_projection") == 0) {
       return do_lower_texture_projection(ir);
    } else if (strcmp(optimization, "do_if_simplification") == 0) {
@@ -105,6 +109,8 @@ do_optimization(struct exec_list *ir, const char *optimization,
       return do_mat_op_to_vec(ir);
    } else if (strcmp(optimization, "do_noop_swizzle") == 0) {
       return do_noop_swizzle(ir);
+   } else if (strcmp(optimization, "do_single_def_propagation") == 0) {
+      return do_single_def_propagation(ir);
    } else if (strcmp(optimization, "do_structure_splitting") == 0) {
       return do_structure_splitting(ir);
    } else if (strcmp(optimization, "do_swizzle_swizzle") == 0) {
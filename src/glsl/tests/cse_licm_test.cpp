@@ -0,0 +1,346 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "standalone_scaffolding.h"
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "ir.h"
+#include "ir_hierarchical_visitor.h"
+#include "ir_optimization.h"
+#include "ir_reader.h"
+#include "glsl_parser_extras.h"
+
+/**
+ * \file cse_licm_test.cpp
+ *
+ * Counts the ALU expressions left by do_cse() and do_licm(), in total and
+ * inside loops, on the same kind of IR as the tests/cse and tests/licm
+ * optimization tests.
+ */
+
+namespace {
+
+class expression_counter : public ir_hierarchical_visitor {
+public:
+   expression_counter()
+      : depth(0), total(0), muls(0)
+   {
+      memset(at_depth, 0, sizeof(at_depth));
+   }
+
+   virtual ir_visitor_status visit_enter(ir_loop *)
+   {
+      depth++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_leave(ir_loop *)
+   {
+      depth--;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_expression *ir)
+   {
+      total++;
+      if (ir->operation == ir_binop_mul)
+         muls++;
+      at_depth[MIN2(depth, 2u)]++;
+      return visit_continue;
+   }
+
+   unsigned depth;
+   unsigned total;
+   unsigned muls;
+   /** Expressions outside any loop, in one loop, and in nested loops. */
+   unsigned at_depth[3];
+};
+
+} /* anonymous namespace */
+
+class cse_licm : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void read(const char *src);
+   ir_variable *find_loop_variable(const char *name);
+   void count(expression_counter *c);
+
+   struct _mesa_glsl_parse_state *state;
+   struct gl_shader *shader;
+   void *mem_ctx;
+   gl_context ctx;
+   exec_list *ir;
+};
+
+void
+cse_licm::SetUp()
+{
+   this->mem_ctx = ralloc_context(NULL);
+
+   initialize_context_to_defaults(&this->ctx, API_OPENGL_COMPAT);
+
+   this->shader = rzalloc(this->mem_ctx, gl_shader);
+   this->shader->Type = GL_FRAGMENT_SHADER;
+   this->shader->Stage = MESA_SHADER_FRAGMENT;
+   this->ir = new(this->shader) exec_list;
+
+   this->state =
+      new(mem_ctx) _mesa_glsl_parse_state(&this->ctx, this->shader->Stage,
+                                          this->shader);
+
+   _mesa_glsl_initialize_types(this->state);
+}
+
+void
+cse_licm::TearDown()
+{
+   ralloc_free(this->mem_ctx);
+   this->mem_ctx = NULL;
+}
+
+void
+cse_licm::read(const char *src)
+{
+   _mesa_glsl_read_ir(this->state, this->ir, src, true);
+   ASSERT_FALSE(this->state->error) << this->state->info_log;
+}
+
+/**
+ * Returns the variable called \p name declared in the body of a loop at the
+ * top level of main().
+ */
+ir_variable *
+cse_licm::find_loop_variable(const char *name)
+{
+   foreach_list(node, this->ir) {
+      ir_function *const f = ((ir_instruction *) node)->as_function();
+      if (f == NULL)
+         continue;
+
+      ir_function_signature *const sig =
+         (ir_function_signature *) f->signatures.get_head();
+
+      foreach_list(inst, &sig->body) {
+         ir_loop *const loop = ((ir_instruction *) inst)->as_loop();
+         if (loop == NULL)
+            continue;
+
+         foreach_list(body_inst, &loop->body_instructions) {
+            ir_variable *const var =
+               ((ir_instruction *) body_inst)->as_variable();
+
+            if (var && strcmp(var->name, name) == 0)
+               return var;
+         }
+      }
+   }
+
+   return NULL;
+}
+
+void
+cse_licm::count(expression_counter *c)
+{
+   visit_list_elements(c, this->ir);
+}
+
+/* A local's expression computed before an if is reused in both branches. */
+TEST_F(cse_licm, cse_reuses_dominating_expression)
+{
+   read("((declare (uniform) vec4 u)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((declare () vec4 a)"
+        "    (assign (xyzw) (var_ref a) (expression vec4 + (var_ref u) (constant float (1.000000))))"
+        "    (assign (xyzw) (var_ref o) (expression vec4 * (var_ref a) (var_ref a)))"
+        "    (if (expression bool < (swiz x (var_ref u)) (constant float (0.000000)))"
+        "     ((assign (xyzw) (var_ref o) (expression vec4 + (expression vec4 * (var_ref a) (var_ref a)) (var_ref u))))"
+        "     ((assign (xyzw) (var_ref o) (expression vec4 - (expression vec4 * (var_ref a) (var_ref a)) (var_ref u))))))))))");
+
+   expression_counter before;
+   count(&before);
+   EXPECT_EQ(7u, before.total);
+   EXPECT_EQ(3u, before.muls);
+
+   EXPECT_TRUE(do_cse(this->ir));
+
+   expression_counter after;
+   count(&after);
+   EXPECT_EQ(5u, after.total);
+   EXPECT_EQ(1u, after.muls);
+}
+
+/* Neither branch of an if dominates the other, nor the code after it. */
+TEST_F(cse_licm, cse_keeps_sibling_branch_expressions)
+{
+   read("((declare (uniform) vec4 u)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((if (expression bool < (swiz x (var_ref u)) (constant float (0.000000)))"
+        "     ((assign (xyzw) (var_ref o) (expression vec4 * (var_ref u) (var_ref u))))"
+        "     ((assign (xyzw) (var_ref o) (expression vec4 * (var_ref u) (var_ref u)))))"
+        "    (assign (xyzw) (var_ref o) (expression vec4 + (var_ref o) (expression vec4 * (var_ref u) (var_ref u))))))))");
+
+   EXPECT_FALSE(do_cse(this->ir));
+
+   expression_counter after;
+   count(&after);
+   EXPECT_EQ(5u, after.total);
+   EXPECT_EQ(3u, after.muls);
+}
+
+/* An expression of uniforms and an unassigned local leaves the loop. */
+TEST_F(cse_licm, licm_hoists_invariant_expression)
+{
+   read("((declare (uniform) mat4 m)"
+        " (declare (uniform) vec4 u)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((declare () int i)"
+        "    (declare () vec4 scale)"
+        "    (assign (xyzw) (var_ref scale) (expression vec4 * (var_ref u) (constant float (2.000000))))"
+        "    (assign (x) (var_ref i) (constant int (0)))"
+        "    (loop"
+        "     ((if (expression bool >= (var_ref i) (constant int (4))) (break) ())"
+        "      (assign (xyzw) (var_ref o) (expression vec4 + (var_ref o) (expression vec4 * (var_ref m) (expression vec4 + (var_ref scale) (var_ref u)))))"
+        "      (assign (x) (var_ref i) (expression int + (var_ref i) (constant int (1))))))))))");
+
+   expression_counter before;
+   count(&before);
+   EXPECT_EQ(5u, before.at_depth[1]);
+
+   EXPECT_TRUE(do_licm(this->ir));
+
+   expression_counter after;
+   count(&after);
+   EXPECT_EQ(before.total, after.total);
+   EXPECT_EQ(3u, after.at_depth[1]);
+}
+
+/* Expressions of loop-variant values, textures and derivatives stay put. */
+TEST_F(cse_licm, licm_keeps_variant_expressions)
+{
+   read("((declare (uniform) vec4 u)"
+        " (declare (uniform) sampler2D s)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((declare () int i)"
+        "    (declare () float f)"
+        "    (assign (x) (var_ref i) (constant int (0)))"
+        "    (assign (x) (var_ref f) (constant float (0.000000)))"
+        "    (loop"
+        "     ((if (expression bool >= (var_ref i) (constant int (4))) (break) ())"
+        "      (assign (x) (var_ref f) (expression float + (var_ref f) (constant float (1.000000))))"
+        "      (assign (xyzw) (var_ref o) (expression vec4 * (var_ref u) (var_ref f)))"
+        "      (assign (xyzw) (var_ref o) (expression vec4 + (var_ref o) (tex vec4 (var_ref s) (swiz xy (var_ref u)) 0 1 ())))"
+        "      (assign (xyzw) (var_ref o) (expression vec4 + (var_ref o) (expression vec4 dFdx (var_ref u))))"
+        "      (assign (x) (var_ref i) (expression int + (var_ref i) (constant int (1))))))))))");
+
+   EXPECT_FALSE(do_licm(this->ir));
+
+   expression_counter after;
+   count(&after);
+   EXPECT_EQ(7u, after.at_depth[1]);
+}
+
+/* Each pass hoists an invariant expression out of one loop of a nest. */
+TEST_F(cse_licm, licm_hoists_out_of_nested_loops)
+{
+   read("((declare (uniform) mat4 m)"
+        " (declare (uniform) vec4 u)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((declare () int i)"
+        "    (declare () int j)"
+        "    (assign (x) (var_ref i) (constant int (0)))"
+        "    (loop"
+        "     ((if (expression bool >= (var_ref i) (constant int (4))) (break) ())"
+        "      (assign (x) (var_ref j) (constant int (0)))"
+        "      (loop"
+        "       ((if (expression bool >= (var_ref j) (var_ref i)) (break) ())"
+        "        (assign (xyzw) (var_ref o) (expression vec4 + (var_ref o) (expression vec4 * (var_ref m) (expression vec4 * (var_ref u) (constant float (3.000000))))))"
+        "        (assign (x) (var_ref j) (expression int + (var_ref j) (constant int (1))))))"
+        "      (assign (x) (var_ref i) (expression int + (var_ref i) (constant int (1))))))))))");
+
+   expression_counter before;
+   count(&before);
+   EXPECT_EQ(5u, before.at_depth[2]);
+   EXPECT_EQ(2u, before.at_depth[1]);
+   EXPECT_EQ(0u, before.at_depth[0]);
+
+   EXPECT_TRUE(do_licm(this->ir));
+
+   expression_counter once;
+   count(&once);
+   EXPECT_EQ(3u, once.at_depth[2]);
+   EXPECT_EQ(4u, once.at_depth[1]);
+
+   EXPECT_TRUE(do_licm(this->ir));
+
+   expression_counter twice;
+   count(&twice);
+   EXPECT_EQ(3u, twice.at_depth[2]);
+   EXPECT_EQ(2u, twice.at_depth[1]);
+   EXPECT_EQ(2u, twice.at_depth[0]);
+}
+
+/* A read-only variable declared in the loop is new on every iteration. */
+TEST_F(cse_licm, licm_keeps_read_only_loop_local)
+{
+   read("((declare (uniform) vec4 u)"
+        " (declare (out) vec4 o)"
+        " (function main"
+        "  (signature void (parameters)"
+        "   ((declare () int i)"
+        "    (assign (x) (var_ref i) (constant int (0)))"
+        "    (loop"
+        "     ((if (expression bool >= (var_ref i) (constant int (4))) (break) ())"
+        "      (declare () vec4 k)"
+        "      (assign (xyzw) (var_ref k) (expression vec4 * (var_ref o) (constant float (2.000000))))"
+        "      (assign (xyzw) (var_ref o) (expression vec4 + (var_ref u) (expression vec4 * (var_ref k) (var_ref u))))"
+        "      (assign (x) (var_ref i) (expression int + (var_ref i) (constant int (1))))))))))");
+
+   /* Mark k read-only, as ast_to_hir does for a const-qualified local. */
+   ir_variable *const k = find_loop_variable("k");
+   ASSERT_TRUE(k != NULL);
+   k->data.read_only = true;
+
+   expression_counter before;
+   count(&before);
+
+   EXPECT_FALSE(do_licm(this->ir));
+
+   expression_counter after;
+   count(&after);
+   EXPECT_EQ(before.at_depth[1], after.at_depth[1]);
+}
@@ -25,7 +25,7 @@
  *    Chia-I Wu <olv@lunarg.com>
  */
 
-#include "glapi/glapi.h"
+#include "glapi/glapi_priv.h"
 #include "u_current.h"
 
 /*
@@ -60,5 +60,6 @@ _glapi_set_context(void *context)
 void
 _glapi_set_dispatch(struct _glapi_table *dispatch)
 {
+   dispatch = _glapi_profile_dispatch(dispatch);
    u_current_set((const struct mapi_table *) dispatch);
 }
@@ -62,6 +62,12 @@ extern void
 _glapi_check_table(const struct _glapi_table *table);
 
 
+/* prof */
+
+extern struct _glapi_table *
+_glapi_profile_dispatch(struct _glapi_table *dispatch);
+
+
 /* entrypoint */
 
 extern void
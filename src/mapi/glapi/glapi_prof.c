@@ -0,0 +1,479 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * Profiling dispatch table.
+ *
+ * When the MESA_API_PROFILE environment variable names a file,
+ * _glapi_set_dispatch() installs this table instead of the one it's given,
+ * and remembers the real table per thread.  There are a few copies of the
+ * table, one for each real table a thread has set recently, so that code
+ * that saves the current table and sets it again later gets the real table
+ * that was current when it saved.  Every entry point of this table
+ * counts the call, reads the time stamp counter around the call into the
+ * real table, and adds the result to per-thread counters, so the threads
+ * never share a cache line on the fast path.
+ *
+ * Calls that Mesa makes through GET_DISPATCH() while handling another call
+ * are counted on their own, and their time is subtracted from the caller's
+ * self time.
+ *
+ * The self time of each entry point is written to the file in the folded
+ * stack format read by flamegraph.pl, with one stack per thread.  Call
+ * counts, total and self times go to the same file name with ".calls"
+ * appended.  Both files are written at exit, and whenever SIGUSR2 is
+ * received if the application doesn't handle that signal itself.
+ */
+
+
+#include "glapi/glapi_priv.h"
+#include "glapi/glapitable.h"
+
+
+#if defined(__GNUC__) && !defined(_WIN32)
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "u_thread.h"
+
+
+/** Nesting depth up to which nested call times are subtracted */
+#define PROF_MAX_DEPTH 8
+
+/** Number of copies of the profiling table, each standing for a real one */
+#define PROF_MAX_TABLES 8
+
+/** Number of counted entry points: the static ones, which have a slot */
+#define PROF_NUM_ENTRIES (sizeof(struct _glapi_table) / sizeof(_glapi_proc))
+
+
+struct prof_entry
+{
+   uint64_t calls;
+   uint64_t total;   /**< ticks, including nested calls */
+   uint64_t self;    /**< ticks, excluding nested calls */
+};
+
+struct prof_thread
+{
+   const struct _glapi_table *real;   /**< table the calls go to */
+
+   /** The real table each copy of the profiling table stands for */
+   const struct _glapi_table *reals[PROF_MAX_TABLES];
+   unsigned next_table;   /**< copy to rebind when a new table is set */
+
+   unsigned id;
+   unsigned depth;
+   uint64_t nested[PROF_MAX_DEPTH];   /**< ticks in calls made at each depth */
+
+   struct prof_thread *next;
+   struct prof_entry entries[];
+};
+
+
+static once_flag prof_once = ONCE_FLAG_INIT;
+static const char *prof_filename;
+u_mutex_declare_static(prof_mutex);
+static struct prof_thread *prof_threads;
+static unsigned prof_num_threads;
+static volatile sig_atomic_t prof_dump_requested;
+static GLboolean prof_signal_installed;
+
+/** The table most recently set by any thread */
+static const struct _glapi_table *volatile prof_last_real;
+
+/** Time stamp counter and clock when profiling started, for calibration */
+static uint64_t prof_start_ticks, prof_start_ns;
+
+#ifdef GLX_USE_TLS
+static __thread struct prof_thread *prof_current
+   __attribute__((tls_model("initial-exec")));
+#else
+static struct u_tsd prof_current_tsd;
+#endif
+
+
+static inline uint64_t
+prof_ticks(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+   uint32_t lo, hi;
+   __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+   return ((uint64_t) hi << 32) | lo;
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+static uint64_t
+prof_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+static inline struct prof_thread *
+prof_get_thread(void)
+{
+#ifdef GLX_USE_TLS
+   return prof_current;
+#else
+   return (struct prof_thread *) u_tsd_get(&prof_current_tsd);
+#endif
+}
+
+
+static struct prof_thread *
+prof_thread_create(void)
+{
+   struct prof_thread *t;
+
+   t = calloc(1, sizeof(*t) + PROF_NUM_ENTRIES * sizeof(t->entries[0]));
+   if (!t)
+      return NULL;
+
+   u_mutex_lock(prof_mutex);
+   t->id = prof_num_threads++;
+   t->next = prof_threads;
+   prof_threads = t;
+   u_mutex_unlock(prof_mutex);
+
+#ifdef GLX_USE_TLS
+   prof_current = t;
+#else
+   u_tsd_set(&prof_current_tsd, t);
+#endif
+
+   return t;
+}
+
+
+/**
+ * \return the calling thread's counters, or NULL if they couldn't be
+ * allocated, in which case the call goes to prof_last_real uncounted.
+ */
+static inline struct prof_thread *
+prof_enter(void)
+{
+   struct prof_thread *t = prof_get_thread();
+
+   /* Without TLS, glapi uses one global table for as long as a single
+    * thread makes current, so other threads can call through this table
+    * without ever having set it.  Their calls go to the table that was
+    * set last, which is the one they'd get without profiling.
+    */
+   if (!t) {
+      t = prof_thread_create();
+      if (!t)
+         return NULL;
+      t->real = prof_last_real;
+   }
+
+   if (t->depth < PROF_MAX_DEPTH)
+      t->nested[t->depth] = 0;
+   t->depth++;
+
+   return t;
+}
+
+
+static void prof_dump(void);
+
+static inline void
+prof_leave(struct prof_thread *t, unsigned slot, uint64_t start)
+{
+   const uint64_t elapsed = prof_ticks() - start;
+   struct prof_entry *e = &t->entries[slot];
+
+   t->depth--;
+
+   e->calls++;
+   e->total += elapsed;
+   e->self += elapsed;
+   if (t->depth < PROF_MAX_DEPTH)
+      e->self -= t->nested[t->depth];
+   if (t->depth > 0 && t->depth <= PROF_MAX_DEPTH)
+      t->nested[t->depth - 1] += elapsed;
+
+   if (prof_dump_requested) {
+      prof_dump_requested = 0;
+      prof_dump();
+   }
+}
+
+
+/*
+ * The profiling entry points, and the table of them.
+ */
+
+#define PROF_SLOT(FUNC) \
+   (offsetof(struct _glapi_table, FUNC) / sizeof(_glapi_proc))
+
+#define KEYWORD1 static
+#define KEYWORD1_ALT static
+#define KEYWORD2 GLAPIENTRY
+#define NAME(func)  Prof##func
+
+/* The locals are prefixed so that they can't shadow a parameter. */
+#define DISPATCH(FUNC, ARGS, MESSAGE)                                   \
+   struct prof_thread *prof_t = prof_enter();                           \
+   uint64_t prof_start;                                                 \
+   if (!prof_t) {                                                       \
+      prof_last_real->FUNC ARGS;                                        \
+      return;                                                           \
+   }                                                                    \
+   prof_start = prof_ticks();                                           \
+   prof_t->real->FUNC ARGS;                                             \
+   prof_leave(prof_t, PROF_SLOT(FUNC), prof_start)
+
+#define RETURN_DISPATCH(FUNC, ARGS, MESSAGE)                            \
+   struct prof_thread *prof_t = prof_enter();                           \
+   uint64_t prof_start;                                                 \
+   __typeof__(prof_t->real->FUNC ARGS) prof_ret;                        \
+   if (!prof_t)                                                         \
+      return prof_last_real->FUNC ARGS;                                 \
+   prof_start = prof_ticks();                                           \
+   prof_ret = prof_t->real->FUNC ARGS;                                  \
+   prof_leave(prof_t, PROF_SLOT(FUNC), prof_start);                     \
+   return prof_ret
+
+/**
+ * The slots past the static entry points are only filled by drivers that
+ * register their own extension functions, which Mesa's don't.  Calls
+ * through them can't be forwarded, as their offset isn't known here.
+ */
+static GLint
+ProfUnused(void)
+{
+   return 0;
+}
+
+#define TABLE_ENTRY(name) (_glapi_proc) Prof##name
+#define DISPATCH_TABLE_NAME __glapi_prof_table
+#define UNUSED_TABLE_NAME __unused_prof_functions
+
+#include "glapi/glapitemp.h"
+
+#define PROF_TABLE_SIZE \
+   (sizeof(__glapi_prof_table) / sizeof(__glapi_prof_table[0]))
+
+/** Copies 1 and up of __glapi_prof_table, filled in by prof_init() */
+static _glapi_proc prof_copies[PROF_MAX_TABLES - 1][PROF_TABLE_SIZE];
+
+
+static inline _glapi_proc *
+prof_table(unsigned i)
+{
+   return i ? prof_copies[i - 1] : __glapi_prof_table;
+}
+
+
+/**
+ * Write the folded stacks and the call counts.
+ */
+static void
+prof_dump(void)
+{
+   const uint64_t ticks = prof_ticks() - prof_start_ticks;
+   const uint64_t ns = prof_ns() - prof_start_ns;
+   const double ns_per_tick = ticks ? (double) ns / ticks : 1.0;
+   struct prof_thread *t;
+   char calls_name[4096];
+   FILE *folded, *calls;
+   unsigned i;
+
+   snprintf(calls_name, sizeof(calls_name), "%s.calls", prof_filename);
+
+   u_mutex_lock(prof_mutex);
+
+   folded = fopen(prof_filename, "w");
+   calls = fopen(calls_name, "w");
+   if (!folded || !calls) {
+      fprintf(stderr, "Mesa: couldn't write API profile to %s\n",
+              prof_filename);
+      goto out;
+   }
+
+   fprintf(calls, "# thread function calls total_ns self_ns\n");
+
+   /* The counters of other threads may be updated while they're read.
+    * Reading them is harmless, and a value may only be stale.
+    */
+   for (t = prof_threads; t; t = t->next) {
+      for (i = 0; i < PROF_NUM_ENTRIES; i++) {
+         const struct prof_entry *e = &t->entries[i];
+         const char *name;
+
+         if (!e->calls)
+            continue;
+
+         name = _glapi_get_proc_name(i);
+         if (!name)
+            name = "unknown";
+
+         fprintf(folded, "thread %u;%s %llu\n", t->id, name,
+                 (unsigned long long) (e->self * ns_per_tick));
+         fprintf(calls, "%u %s %llu %llu %llu\n", t->id, name,
+                 (unsigned long long) e->calls,
+                 (unsigned long long) (e->total * ns_per_tick),
+                 (unsigned long long) (e->self * ns_per_tick));
+      }
+   }
+
+out:
+   if (folded)
+      fclose(folded);
+   if (calls)
+      fclose(calls);
+
+   u_mutex_unlock(prof_mutex);
+}
+
+
+static void
+prof_signal(int sig)
+{
+   (void) sig;
+   prof_dump_requested = 1;
+}
+
+
+static void
+prof_init(void)
+{
+   struct sigaction sa;
+   unsigned i;
+
+   prof_filename = getenv("MESA_API_PROFILE");
+   if (!prof_filename || !prof_filename[0]) {
+      prof_filename = NULL;
+      return;
+   }
+
+   for (i = 1; i < PROF_MAX_TABLES; i++)
+      memcpy(prof_table(i), __glapi_prof_table, sizeof(__glapi_prof_table));
+
+   prof_start_ns = prof_ns();
+   prof_start_ticks = prof_ticks();
+
+   /* Only take SIGUSR2 if nobody else wants it */
+   if (sigaction(SIGUSR2, NULL, &sa) == 0 && sa.sa_handler == SIG_DFL) {
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = prof_signal;
+      sa.sa_flags = SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+      prof_signal_installed = sigaction(SIGUSR2, &sa, NULL) == 0;
+   }
+}
+
+
+/**
+ * Write the profile at exit, or when the library is unloaded: a handler
+ * registered with atexit() would be called after dlclose() unmapped it.
+ */
+static void __attribute__((destructor))
+prof_fini(void)
+{
+   if (!prof_filename)
+      return;
+
+   if (prof_signal_installed)
+      signal(SIGUSR2, SIG_DFL);
+
+   prof_dump();
+}
+
+
+/**
+ * Return the table to make current in place of \p dispatch: a copy of the
+ * profiling table if profiling is enabled, else \p dispatch itself.
+ */
+struct _glapi_table *
+_glapi_profile_dispatch(struct _glapi_table *dispatch)
+{
+   struct prof_thread *t;
+   unsigned i;
+
+   call_once(&prof_once, prof_init);
+
+   if (!prof_filename || !dispatch)
+      return dispatch;
+
+   t = prof_get_thread();
+   if (!t) {
+      t = prof_thread_create();
+      if (!t)
+         return dispatch;
+   }
+
+   for (i = 0; i < PROF_MAX_TABLES; i++) {
+      if (dispatch == (struct _glapi_table *) prof_table(i)) {
+         /* Someone saved the table that was current then, switched to
+          * another and is now switching back: go back to the real table
+          * the copy stood for.
+          */
+         if (t->reals[i])
+            t->real = t->reals[i];
+         prof_last_real = t->real;
+         return dispatch;
+      }
+   }
+
+   /* Stand in for the table with the copy already bound to it, so that
+    * switching back and forth, like at glBegin() and glEnd(), doesn't use
+    * up the copies.  Else rebind the copy that was bound longest ago.
+    */
+   for (i = 0; i < PROF_MAX_TABLES; i++) {
+      if (t->reals[i] == dispatch)
+         break;
+   }
+   if (i == PROF_MAX_TABLES) {
+      i = t->next_table;
+      t->next_table = (i + 1) % PROF_MAX_TABLES;
+      t->reals[i] = dispatch;
+   }
+
+   t->real = dispatch;
+   prof_last_real = t->real;
+
+   return (struct _glapi_table *) prof_table(i);
+}
+
+#else /* __GNUC__ && !_WIN32 */
+
+struct _glapi_table *
+_glapi_profile_dispatch(struct _glapi_table *dispatch)
+{
+   return dispatch;
+}
+
+#endif /* __GNUC__ && !_WIN32 */
@@ -0,0 +1,163 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file dispatch_bench.c
+ *
+ * Measures the cost of getting from a GL call to the function installed in
+ * the current dispatch table.
+ *
+ * A table is filled with a function that only counts its calls, and the
+ * same call is made through the public glDrawArrays entry point, through
+ * GET_DISPATCH() and through _glapi_get_dispatch().  Everything is timed
+ * twice: once while only one thread has made a table current, and once
+ * after a second thread has, which is what turns off the global-variable
+ * shortcut of non-TLS builds.
+ *
+ * Build with "make glapi-bench"; it isn't run by "make check".
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../mesa/main/glheader.h"
+#include "glapi/glapi.h"
+
+#define ITERATIONS 50000000
+
+static volatile unsigned calls;
+
+static void GLAPIENTRY
+count_draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+   calls++;
+}
+
+typedef void (GLAPIENTRYP draw_arrays_func)(GLenum, GLint, GLsizei);
+
+static int draw_arrays_offset;
+
+static double
+now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+report(const char *name, double start)
+{
+   double ns = (now() - start) * 1e9 / ITERATIONS;
+
+   if (calls != ITERATIONS)
+      printf("%-32s wrong call count %u\n", name, calls);
+   else
+      printf("%-32s %6.2f ns/call\n", name, ns);
+
+   calls = 0;
+}
+
+static void
+run(const char *mode)
+{
+   draw_arrays_func direct = count_draw_arrays;
+   double start;
+   unsigned i;
+
+   printf("%s:\n", mode);
+
+   start = now();
+   for (i = 0; i < ITERATIONS; i++)
+      direct(GL_POINTS, 0, 1);
+   report("  function pointer", start);
+
+   start = now();
+   for (i = 0; i < ITERATIONS; i++)
+      glDrawArrays(GL_POINTS, 0, 1);
+   report("  glDrawArrays entry point", start);
+
+   start = now();
+   for (i = 0; i < ITERATIONS; i++) {
+      _glapi_proc *table = (_glapi_proc *) GET_DISPATCH();
+      ((draw_arrays_func) table[draw_arrays_offset])(GL_POINTS, 0, 1);
+   }
+   report("  GET_DISPATCH()", start);
+
+   start = now();
+   for (i = 0; i < ITERATIONS; i++) {
+      _glapi_proc *table = (_glapi_proc *) _glapi_get_dispatch();
+      ((draw_arrays_func) table[draw_arrays_offset])(GL_POINTS, 0, 1);
+   }
+   report("  _glapi_get_dispatch()", start);
+}
+
+static void *
+other_thread(void *table)
+{
+   _glapi_set_dispatch((struct _glapi_table *) table);
+   return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned size = _glapi_get_dispatch_table_size();
+   _glapi_proc *table = (_glapi_proc *) calloc(size, sizeof(_glapi_proc));
+   pthread_t thread;
+
+   draw_arrays_offset = _glapi_get_proc_offset("glDrawArrays");
+   if (table == NULL || draw_arrays_offset < 0) {
+      fprintf(stderr, "couldn't set up a dispatch table\n");
+      return 1;
+   }
+
+   table[draw_arrays_offset] = (_glapi_proc) count_draw_arrays;
+
+#ifdef GLX_USE_TLS
+   printf("TLS dispatch\n");
+#else
+   printf("non-TLS dispatch\n");
+#endif
+
+   _glapi_set_dispatch((struct _glapi_table *) table);
+   run("one thread");
+
+   pthread_create(&thread, NULL, other_thread, table);
+   pthread_join(thread, NULL);
+
+   /* The table pointer of the first thread is looked up again after the
+    * switch to per-thread storage.
+    */
+   _glapi_set_dispatch((struct _glapi_table *) table);
+   run("after a second thread");
+
+   _glapi_set_dispatch(NULL);
+   free(table);
+
+   return 0;
+}
@@ -27,7 +27,7 @@
  */
 
 #include <string.h>
-#include "glapi/glapi.h"
+#include "glapi/glapi_priv.h"
 #include "u_current.h"
 #include "table.h" /* for MAPI_TABLE_NUM_SLOTS */
 #include "stub.h"
@@ -64,6 +64,7 @@ _glapi_set_context(void *context)
 void
 _glapi_set_dispatch(struct _glapi_table *dispatch)
 {
+   dispatch = _glapi_profile_dispatch(dispatch);
    u_current_set((const struct mapi_table *) dispatch);
 }
 
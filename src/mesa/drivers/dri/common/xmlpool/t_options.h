@@ -298,6 +298,16 @@ DRI_CONF_OPT_BEGIN(multithread_glsl_compiler, int, def) \
         DRI_CONF_DESC(en,gettext("Enable multithreading in the GLSL compiler")) \
 DRI_CONF_OPT_END
 
+#define DRI_CONF_UPLOAD_BUFFER_SIZE(def) \
+DRI_CONF_OPT_BEGIN_V(upload_buffer_size, int, def, "0:16384") \
+        DRI_CONF_DESC(en,gettext("Size in KiB of the buffers used to stream vertex, index and constant data (0 = driver default)")) \
+DRI_CONF_OPT_END
+
+#define DRI_CONF_SW_RASTERIZER_THREADS(def) \
+DRI_CONF_OPT_BEGIN_V(sw_rasterizer_threads, int, def, "-1:16") \
+        DRI_CONF_DESC(en,gettext("Number of rasterizer threads of software renderers (-1 = driver default)")) \
+DRI_CONF_OPT_END
+
 
 /**
  * \brief Software-fallback options.  To allow using features (like
@@ -272,7 +272,7 @@ brw_init_driver_functions(struct brw_context *brw,
       functions->GetSamplePosition = gen6_get_sample_position;
 }
 
-static void
+void
 brw_initialize_context_constants(struct brw_context *brw)
 {
    struct gl_context *ctx = &brw->ctx;
@@ -557,6 +557,8 @@ brw_process_driconf_options(struct brw_context *brw)
 
       _mesa_enable_glsl_threadpool(ctx, max_threads);
    }
+
+   brw->upload.bo_size = driQueryOptioni(options, "upload_buffer_size") * 1024;
 }
 
 GLboolean
@@ -809,6 +811,23 @@ intelDestroyContext(__DRIcontext * driContextPriv)
       brw_destroy_shader_time(brw);
    }
 
+   if (INTEL_DEBUG & DEBUG_PERF) {
+      unsigned variants = brw->wm.precompile_hits + brw->wm.precompile_misses;
+
+      if (variants) {
+         fprintf(stderr, "FS precompile: %u of %u draw-time variants were "
+                 "precompiled (%.0f%%)\n", brw->wm.precompile_hits, variants,
+                 100.0 * brw->wm.precompile_hits / variants);
+      }
+
+      if (brw->wm.simd16_compiled + brw->wm.simd16_failed +
+          brw->wm.simd16_skipped) {
+         fprintf(stderr, "FS SIMD16: %u compiled, %u failed, %u skipped "
+                 "as predicted to fail\n", brw->wm.simd16_compiled,
+                 brw->wm.simd16_failed, brw->wm.simd16_skipped);
+      }
+   }
+
    brw_destroy_state(brw);
    brw_draw_destroy(brw);
 
@@ -314,6 +314,26 @@ struct brw_geometry_program {
 struct brw_fragment_program {
    struct gl_fragment_program program;
    GLuint id;  /**< serial no. to identify frag progs, never re-used */
+
+   /**
+    * Keys compiled by brw_fs_precompile(), and a bitmask of which of them
+    * have since been needed at draw time.  The default guess comes first.
+    * A key predicted from recent draw-time misses follows it, even when it
+    * wasn't compiled, until the first draw tells whether it was right.
+    */
+   struct brw_wm_prog_key *precompile_keys;
+   unsigned num_precompile_keys;
+   unsigned precompile_keys_used;
+   bool prediction_pending;
+
+   /** @{
+    * Outcomes of SIMD16 compiles of this program's variants, as counted in
+    * brw_context::wm.  Any failure makes later variants skip SIMD16.
+    */
+   unsigned simd16_compiled;
+   unsigned simd16_failed;
+   unsigned simd16_skipped;
+   /** @} */
 };
 
 struct brw_shader {
@@ -738,8 +758,8 @@ struct brw_cache_item {
 
    uint32_t offset;
    uint32_t size;
-
-   struct brw_cache_item *next;
+   /** Hash of the uploaded data, to cheaply rule out duplicate uploads. */
+   uint32_t data_hash;
 };
 
 
@@ -749,10 +769,14 @@ typedef void (*cache_aux_free_func)(const void *aux);
 struct brw_cache {
    struct brw_context *brw;
 
+   /** Open-addressed table of items, size is a power of two. */
    struct brw_cache_item **items;
    drm_intel_bo *bo;
    GLuint size, n_items;
 
+   /** Most recently found or uploaded item for each cache_id. */
+   struct brw_cache_item *last_item[BRW_MAX_CACHE];
+
    uint32_t next_offset;
    bool bo_used_by_gpu;
 
@@ -1048,6 +1072,9 @@ struct brw_context
       uint32_t buffer_len;
       uint32_t buffer_offset;
       char buffer[4096];
+
+      /** Minimum size of a new upload BO, from driconf; 0 for the default. */
+      GLuint bo_size;
    } upload;
 
    /**
@@ -1385,6 +1412,38 @@ struct brw_context
           */
          int aligned_pairs_class;
       } reg_sets[2];
+
+      /**
+       * The GL states that most recently needed a draw-time FS compile,
+       * most recent first.  brw_fs_precompile() uses the one that missed
+       * most often to predict the key newly linked programs will be drawn
+       * with.
+       */
+      struct brw_wm_missed_state *missed_states;
+      unsigned num_missed_states;
+
+      /**
+       * Whether the predicted key matched the first draw of each of the
+       * last eight programs, most recent in bit 0.
+       */
+      unsigned prediction_history;
+
+      /** @{
+       * Number of distinct draw-time FS variants of precompiled programs
+       * that were (hits) or weren't (misses) compiled at link time.
+       */
+      unsigned precompile_hits;
+      unsigned precompile_misses;
+      /** @} */
+
+      /** @{
+       * Outcomes of SIMD16 compiles: attempted and succeeded, attempted and
+       * failed to compile, or skipped as predicted to fail.
+       */
+      unsigned simd16_compiled;
+      unsigned simd16_failed;
+      unsigned simd16_skipped;
+      /** @} */
    } wm;
 
 
@@ -1517,6 +1576,8 @@ extern const char *brw_get_renderer_string(unsigned deviceID);
 
 extern void intelFinish(struct gl_context * ctx);
 
+void brw_initialize_context_constants(struct brw_context *brw);
+
 enum {
    DRI_CONF_BO_REUSE_DISABLED,
    DRI_CONF_BO_REUSE_ALL
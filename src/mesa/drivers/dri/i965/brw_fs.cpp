@@ -3280,6 +3280,80 @@ fs_visitor::calculate_register_pressure()
    }
 }
 
+/**
+ * Returns the most GRFs live at any instruction.
+ *
+ * This is the maximum of what calculate_register_pressure() computes per
+ * instruction, but using a sweep over the interval endpoints rather than
+ * walking every interval.
+ */
+int
+fs_visitor::calculate_max_register_pressure()
+{
+   calculate_live_intervals();
+
+   int num_instructions = 0;
+   foreach_list(node, &this->instructions) {
+      ++num_instructions;
+   }
+
+   /* SIMD16 reads may extend an interval one past the last instruction. */
+   int *delta = rzalloc_array(mem_ctx, int, num_instructions + 2);
+
+   for (int reg = 0; reg < virtual_grf_count; reg++) {
+      if (virtual_grf_start[reg] > virtual_grf_end[reg])
+         continue;
+
+      delta[virtual_grf_start[reg]] += virtual_grf_sizes[reg];
+      delta[virtual_grf_end[reg] + 1] -= virtual_grf_sizes[reg];
+   }
+
+   int live = 0, max_live = 0;
+   for (int ip = 0; ip < num_instructions + 2; ip++) {
+      live += delta[ip];
+      max_live = MAX2(max_live, live);
+   }
+
+   ralloc_free(delta);
+
+   return max_live;
+}
+
+/**
+ * Accumulated cost of one optimization pass, for INTEL_DEBUG=optimizer.
+ */
+struct fs_pass_time {
+   const char *name;
+   double time;
+   int runs;
+   int progress;
+};
+
+static void
+record_pass_time(struct fs_pass_time *times, int *num_times,
+                 const char *name, double time, bool progress)
+{
+   int i;
+
+   for (i = 0; i < *num_times; i++) {
+      if (times[i].name == name)
+         break;
+   }
+
+   if (i == *num_times) {
+      times[i].name = name;
+      times[i].time = 0.0;
+      times[i].runs = 0;
+      times[i].progress = 0;
+      (*num_times)++;
+   }
+
+   times[i].time += time;
+   times[i].runs++;
+   if (progress)
+      times[i].progress++;
+}
+
 bool
 fs_visitor::run()
 {
@@ -3346,27 +3420,66 @@ fs_visitor::run()
       remove_dead_constants();
       setup_pull_constants();
 
+      const bool timing = unlikely(INTEL_DEBUG & DEBUG_OPTIMIZER);
+      struct fs_pass_time pass_times[16];
+      int num_pass_times = 0;
+      double loop_start_time = timing ? get_time() : 0.0;
+
+#define OPT(pass, args...)                                              \
+      ({                                                                \
+         double pass_start_time = timing ? get_time() : 0.0;            \
+         bool this_progress = pass(args);                               \
+         if (timing) {                                                  \
+            record_pass_time(pass_times, &num_pass_times, #pass,        \
+                             get_time() - pass_start_time,              \
+                             this_progress);                            \
+         }                                                              \
+         this_progress;                                                 \
+      })
+
       bool progress;
       do {
 	 progress = false;
 
          compact_virtual_grfs();
 
-	 progress = remove_duplicate_mrf_writes() || progress;
-
-	 progress = opt_algebraic() || progress;
-	 progress = opt_cse() || progress;
-	 progress = opt_copy_propagate() || progress;
-         progress = opt_peephole_predicated_break() || progress;
-	 progress = dead_code_eliminate() || progress;
-	 progress = dead_code_eliminate_local() || progress;
-         progress = opt_peephole_sel() || progress;
-         progress = dead_control_flow_eliminate(this) || progress;
-         progress = opt_saturate_propagation() || progress;
-         progress = register_coalesce() || progress;
-	 progress = compute_to_mrf() || progress;
+	 progress = OPT(remove_duplicate_mrf_writes) || progress;
+
+	 progress = OPT(opt_algebraic) || progress;
+	 progress = OPT(opt_cse) || progress;
+	 progress = OPT(opt_copy_propagate) || progress;
+         progress = OPT(opt_peephole_predicated_break) || progress;
+	 progress = OPT(dead_code_eliminate) || progress;
+	 progress = OPT(dead_code_eliminate_local) || progress;
+         progress = OPT(opt_peephole_sel) || progress;
+         progress = OPT(dead_control_flow_eliminate, this) || progress;
+         progress = OPT(opt_saturate_propagation) || progress;
+         progress = OPT(register_coalesce) || progress;
+	 progress = OPT(compute_to_mrf) || progress;
       } while (progress);
 
+#undef OPT
+
+      if (timing) {
+         if (shader) {
+            fprintf(stderr, "Optimizer for fragment shader %d (SIMD%d): "
+                    "%.3f ms\n", shader_prog->Name, dispatch_width,
+                    (get_time() - loop_start_time) * 1000.0);
+         } else {
+            fprintf(stderr, "Optimizer for fragment program %d (SIMD%d): "
+                    "%.3f ms\n", fp->Base.Id, dispatch_width,
+                    (get_time() - loop_start_time) * 1000.0);
+         }
+         for (int i = 0; i < num_pass_times; i++) {
+            fprintf(stderr, "  %-32s %8.3f ms, %d runs, %d with progress\n",
+                    pass_times[i].name, pass_times[i].time * 1000.0,
+                    pass_times[i].runs, pass_times[i].progress);
+         }
+         fprintf(stderr, "  %-32s %8.3f ms, %d runs\n",
+                 "(live intervals, included above)",
+                 live_intervals_time * 1000.0, live_intervals_calculations);
+      }
+
       lower_uniform_pull_constant_loads();
 
       assign_curb_setup();
@@ -3385,6 +3498,9 @@ fs_visitor::run()
       for (unsigned i = 0; i < ARRAY_SIZE(pre_modes); i++) {
          schedule_instructions(pre_modes[i]);
 
+         if (dispatch_width == 8 && brw->gen >= 5)
+            max_register_pressure = calculate_max_register_pressure();
+
          if (0) {
             assign_regs_trivial();
             allocated_without_spills = true;
@@ -3428,6 +3544,13 @@ fs_visitor::run()
    if (!allocated_without_spills)
       schedule_instructions(SCHEDULE_POST);
 
+   if (unlikely(c->estimate_cycles)) {
+      if (dispatch_width == 8)
+         c->estimated_cycles_8 = estimate_cycles();
+      else
+         c->estimated_cycles_16 = estimate_cycles();
+   }
+
    if (dispatch_width == 8) {
       c->prog_data.reg_blocks = brw_register_blocks(grf_used);
    } else {
@@ -3497,17 +3620,56 @@ brw_wm_fs_emit(struct brw_context *brw, struct brw_wm_compile *c,
    exec_list *simd16_instructions = NULL;
    fs_visitor v2(brw, c, prog, fp, 16);
    if (brw->gen >= 5 && likely(!(INTEL_DEBUG & DEBUG_NO16))) {
-      if (c->prog_data.nr_pull_params == 0) {
+      struct brw_fragment_program *bfp = brw_fragment_program(fp);
+
+      /* SIMD16 can't spill, so predict its failure from the SIMD8 compile
+       * and skip the second backend compile when failure is near certain.
+       * Doubling the SIMD8 pressure overestimates SIMD16's, since some
+       * virtual GRFs don't grow with the dispatch width, so only skip when
+       * the doubled pressure overshoots the registers left after the
+       * payload by half.
+       */
+      int simd16_grfs = BRW_MAX_GRF - v.first_non_payload_grf;
+
+      if (c->prog_data.nr_pull_params != 0) {
+         perf_debug("Skipping SIMD16 due to pull parameters.\n");
+      } else if (bfp->simd16_failed) {
+         /* Variants of a program register allocate about as well as each
+          * other, so don't pay for a second compile that failed before.
+          */
+         perf_debug("Skipping SIMD16, another variant of this program "
+                    "failed to compile.\n");
+         bfp->simd16_skipped++;
+         brw->wm.simd16_skipped++;
+      } else if (v.spilled_any_registers) {
+         perf_debug("Skipping SIMD16 because SIMD8 spilled.\n");
+         bfp->simd16_skipped++;
+         brw->wm.simd16_skipped++;
+      } else if (v.max_register_pressure * 2 > simd16_grfs * 3 / 2) {
+         perf_debug("Skipping SIMD16: %d registers live at once in SIMD8.\n",
+                    v.max_register_pressure);
+         bfp->simd16_skipped++;
+         brw->wm.simd16_skipped++;
+      } else {
          /* Try a SIMD16 compile */
          v2.import_uniforms(&v);
          if (!v2.run()) {
             perf_debug("SIMD16 shader failed to compile, falling back to "
                        "SIMD8 at a 10-20%% performance cost: %s", v2.fail_msg);
+            bfp->simd16_failed++;
+            brw->wm.simd16_failed++;
          } else {
             simd16_instructions = &v2.instructions;
+            bfp->simd16_compiled++;
+            brw->wm.simd16_compiled++;
          }
-      } else {
-         perf_debug("Skipping SIMD16 due to pull parameters.\n");
+      }
+
+      /* Only worth reporting when the predictor or the compile said no. */
+      if (!simd16_instructions && c->prog_data.nr_pull_params == 0) {
+         perf_debug("FS program %d SIMD16: %u compiled, %u failed, "
+                    "%u skipped\n", fp->Base.Id, bfp->simd16_compiled,
+                    bfp->simd16_failed, bfp->simd16_skipped);
       }
    }
 
@@ -3536,74 +3698,117 @@ brw_wm_fs_emit(struct brw_context *brw, struct brw_wm_compile *c,
    return assembly;
 }
 
-bool
-brw_fs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
+/**
+ * Guess the program key that will be used at draw time for \p fp, for
+ * compiling the program before the non-orthogonal state is known.
+ */
+void
+brw_wm_setup_prog_key_for_precompile(struct gl_context *ctx,
+                                     struct brw_wm_prog_key *key,
+                                     struct gl_fragment_program *fp)
 {
    struct brw_context *brw = brw_context(ctx);
-   struct brw_wm_prog_key key;
-
-   if (!prog->_LinkedShaders[MESA_SHADER_FRAGMENT])
-      return true;
-
-   struct gl_fragment_program *fp = (struct gl_fragment_program *)
-      prog->_LinkedShaders[MESA_SHADER_FRAGMENT]->Program;
    struct brw_fragment_program *bfp = brw_fragment_program(fp);
    bool program_uses_dfdy = fp->UsesDFdy;
 
-   memset(&key, 0, sizeof(key));
+   memset(key, 0, sizeof(*key));
 
    if (brw->gen < 6) {
       if (fp->UsesKill)
-         key.iz_lookup |= IZ_PS_KILL_ALPHATEST_BIT;
+         key->iz_lookup |= IZ_PS_KILL_ALPHATEST_BIT;
 
       if (fp->Base.OutputsWritten & BITFIELD64_BIT(FRAG_RESULT_DEPTH))
-         key.iz_lookup |= IZ_PS_COMPUTES_DEPTH_BIT;
+         key->iz_lookup |= IZ_PS_COMPUTES_DEPTH_BIT;
 
       /* Just assume depth testing. */
-      key.iz_lookup |= IZ_DEPTH_TEST_ENABLE_BIT;
-      key.iz_lookup |= IZ_DEPTH_WRITE_ENABLE_BIT;
+      key->iz_lookup |= IZ_DEPTH_TEST_ENABLE_BIT;
+      key->iz_lookup |= IZ_DEPTH_WRITE_ENABLE_BIT;
    }
 
    if (brw->gen < 6 || _mesa_bitcount_64(fp->Base.InputsRead &
                                          BRW_FS_VARYING_INPUT_MASK) > 16)
-      key.input_slots_valid = fp->Base.InputsRead | VARYING_BIT_POS;
+      key->input_slots_valid = fp->Base.InputsRead | VARYING_BIT_POS;
 
-   key.clamp_fragment_color = ctx->API == API_OPENGL_COMPAT;
+   key->clamp_fragment_color = ctx->API == API_OPENGL_COMPAT;
 
    unsigned sampler_count = _mesa_fls(fp->Base.SamplersUsed);
    for (unsigned i = 0; i < sampler_count; i++) {
       if (fp->Base.ShadowSamplers & (1 << i)) {
          /* Assume DEPTH_TEXTURE_MODE is the default: X, X, X, 1 */
-         key.tex.swizzles[i] =
+         key->tex.swizzles[i] =
             MAKE_SWIZZLE4(SWIZZLE_X, SWIZZLE_X, SWIZZLE_X, SWIZZLE_ONE);
       } else {
          /* Color sampler: assume no swizzling. */
-         key.tex.swizzles[i] = SWIZZLE_XYZW;
+         key->tex.swizzles[i] = SWIZZLE_XYZW;
       }
    }
 
    if (fp->Base.InputsRead & VARYING_BIT_POS) {
-      key.drawable_height = ctx->DrawBuffer->Height;
+      key->drawable_height = ctx->DrawBuffer->Height;
    }
 
    if ((fp->Base.InputsRead & VARYING_BIT_POS) || program_uses_dfdy) {
-      key.render_to_fbo = _mesa_is_user_fbo(ctx->DrawBuffer);
+      key->render_to_fbo = _mesa_is_user_fbo(ctx->DrawBuffer);
    }
 
-   key.nr_color_regions = 1;
+   key->nr_color_regions = 1;
 
    /* GL_FRAGMENT_SHADER_DERIVATIVE_HINT is almost always GL_DONT_CARE.  The
     * quality of the derivatives is likely to be determined by the driconf
     * option.
     */
-   key.high_quality_derivatives = brw->disable_derivative_optimization;
+   key->high_quality_derivatives = brw->disable_derivative_optimization;
+
+   key->program_string_id = bfp->id;
+}
+
+bool
+brw_fs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   struct brw_context *brw = brw_context(ctx);
+
+   if (!prog->_LinkedShaders[MESA_SHADER_FRAGMENT])
+      return true;
+
+   struct gl_fragment_program *fp = (struct gl_fragment_program *)
+      prog->_LinkedShaders[MESA_SHADER_FRAGMENT]->Program;
+   struct brw_fragment_program *bfp = brw_fragment_program(fp);
+
+   if (!bfp->precompile_keys)
+      bfp->precompile_keys = ralloc_array(NULL, struct brw_wm_prog_key, 2);
+   bfp->num_precompile_keys = 1;
+   bfp->precompile_keys_used = 0;
+   bfp->prediction_pending = false;
+
+   brw_wm_setup_prog_key_for_precompile(ctx, &bfp->precompile_keys[0], fp);
+
+   /* Apps tend to draw with only a few combinations of non-orthogonal
+    * state, so the state that most often needed a draw-time compile for
+    * earlier programs predicts this program's key too.  The first draw
+    * checks the prediction, and it's only worth a second compile at link
+    * time while such predictions have been right recently.
+    */
+   const struct brw_wm_prog_key *missed = brw_wm_likely_missed_state(brw);
+   if (missed) {
+      bfp->precompile_keys[1] = bfp->precompile_keys[0];
+      brw_wm_predict_prog_key(&bfp->precompile_keys[1], missed);
+
+      if (memcmp(&bfp->precompile_keys[0], &bfp->precompile_keys[1],
+                 sizeof(struct brw_wm_prog_key)) != 0) {
+         bfp->prediction_pending = true;
 
-   key.program_string_id = bfp->id;
+         if (_mesa_bitcount(brw->wm.prediction_history & 0xff) >=
+             BRW_WM_PREDICTION_MIN_HITS)
+            bfp->num_precompile_keys = 2;
+      }
+   }
 
    uint32_t old_prog_offset = brw->wm.base.prog_offset;
    struct brw_wm_prog_data *old_prog_data = brw->wm.prog_data;
 
-   bool success = do_wm_prog(brw, prog, bfp, &key);
+   bool success = true;
+   for (unsigned i = 0; i < bfp->num_precompile_keys && success; i++)
+      success = do_wm_prog(brw, prog, bfp, &bfp->precompile_keys[i]);
 
    brw->wm.base.prog_offset = old_prog_offset;
    brw->wm.prog_data = old_prog_data;
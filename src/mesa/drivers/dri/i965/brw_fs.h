@@ -311,6 +311,7 @@ public:
    void invalidate_live_intervals();
    void calculate_live_intervals();
    void calculate_register_pressure();
+   int calculate_max_register_pressure();
    bool opt_algebraic();
    bool opt_cse();
    bool opt_cse_local(bblock_t *block, exec_list *aeb);
@@ -327,6 +328,7 @@ public:
    bool remove_duplicate_mrf_writes();
    bool virtual_grf_interferes(int a, int b);
    void schedule_instructions(instruction_scheduler_mode mode);
+   int estimate_cycles();
    void insert_gen4_send_dependency_workarounds();
    void insert_gen4_pre_send_dependency_workarounds(fs_inst *inst);
    void insert_gen4_post_send_dependency_workarounds(fs_inst *inst);
@@ -451,6 +453,13 @@ public:
    int *virtual_grf_end;
    brw::fs_live_variables *live_intervals;
 
+   /** @{
+    * Time spent in calculate_live_intervals(), for INTEL_DEBUG=optimizer.
+    */
+   double live_intervals_time;
+   int live_intervals_calculations;
+   /** @} */
+
    int *regs_live_at_ip;
 
    /* This is the map from UNIFORM hw_reg + reg_offset as generated by
@@ -496,6 +505,13 @@ public:
    int grf_used;
    bool spilled_any_registers;
 
+   /**
+    * Most GRFs live at once in the last schedule register allocation was
+    * attempted with, in units of this dispatch width's registers.  Used to
+    * predict whether a SIMD16 compile is worth attempting after SIMD8.
+    */
+   int max_register_pressure;
+
    const unsigned dispatch_width; /**< 8 or 16 */
 
    int force_uncompressed_stack;
@@ -465,14 +465,11 @@ fs_visitor::assign_regs(bool allow_spilling)
       }
 
       ra_set_node_class(g, i, c);
-
-      for (int j = 0; j < i; j++) {
-	 if (virtual_grf_interferes(i, j)) {
-	    ra_add_node_interference(g, i, j);
-	 }
-      }
    }
 
+   ra_add_live_interval_interference(g, virtual_grf_count,
+                                     virtual_grf_start, virtual_grf_end);
+
    setup_payload_interference(g, payload_node_count, first_payload_node);
    if (brw->gen >= 7)
       setup_mrf_hack_interference(g, first_mrf_hack_node);
@@ -2937,6 +2937,8 @@ fs_visitor::fs_visitor(struct brw_context *brw,
    this->virtual_grf_start = NULL;
    this->virtual_grf_end = NULL;
    this->live_intervals = NULL;
+   this->live_intervals_time = 0.0;
+   this->live_intervals_calculations = 0;
    this->regs_live_at_ip = NULL;
 
    this->params_remap = NULL;
@@ -2945,6 +2947,7 @@ fs_visitor::fs_visitor(struct brw_context *brw,
    this->force_uncompressed_stack = 0;
 
    this->spilled_any_registers = false;
+   this->max_register_pressure = 0;
 
    memset(&this->param_size, 0, sizeof(this->param_size));
 }
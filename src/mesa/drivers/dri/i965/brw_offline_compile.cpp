@@ -0,0 +1,631 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file brw_offline_compile.cpp
+ *
+ * Standalone compiler for the i965 backend.
+ *
+ * Compiles and links a set of GLSL shaders the same way the driver does at
+ * glLinkProgram() time, and then runs the FS/VS/GS backends with the default
+ * (precompile) program key for the requested device.  No hardware, kernel
+ * driver or X server is needed, which makes this usable for measuring
+ * compile time and generated code quality in automated testing:
+ *
+ *    brw_offline_compile --device ivb_gt2 --iterations 10 a.vert a.frag
+ *
+ * The device may be given either as a chipset family name from
+ * i965_pci_ids.h (e.g. "snb_gt2", "hsw_gt3", "bdw_gt2") or as a PCI ID.
+ * INTEL_DEBUG is honored, so INTEL_DEBUG=fs,vs also dumps the assembly.
+ *
+ * The cycle counts reported are the instruction scheduler's latency model
+ * applied to the final code, summed over the basic blocks.  They are only
+ * meant for comparing the output of two versions of the compiler, e.g. by
+ * running both over a directory of shaders and diffing the results.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+extern "C" {
+#include "main/context.h"
+#include "main/framebuffer.h"
+#include "main/shaderobj.h"
+#include "main/macros.h"
+#include "main/version.h"
+#include "drivers/common/driverfuncs.h"
+#include "program/program.h"
+#include "utils.h"
+#include "xmlpool.h"
+#include "brw_context.h"
+#include "brw_device_info.h"
+#include "brw_wm.h"
+#include "intel_screen.h"
+}
+#include "brw_vs.h"
+#include "brw_vec4_gs.h"
+#include "brw_vec4_gs_visitor.h"
+#include "glsl/program.h"
+#include "glsl/ralloc.h"
+#include "program/ir_to_mesa.h"
+
+static const struct {
+   const char *family;
+   int devid;
+} chipsets[] = {
+#undef CHIPSET
+#define CHIPSET(id, family, name) { #family, id },
+#include "pci_ids/i965_pci_ids.h"
+#undef CHIPSET
+};
+
+/**
+ * Per-stage statistics gathered from one backend compile.
+ */
+struct stage_stats {
+   bool compiled;
+   unsigned instructions;
+   unsigned instructions_16;
+   int cycles;
+   int cycles_16;
+   unsigned assembly_size;
+   unsigned scratch;
+   double time;
+};
+
+struct compile_stats {
+   double compile_time;
+   double link_time;
+   struct stage_stats stage[MESA_SHADER_STAGES];
+};
+
+static int
+lookup_device(const char *name)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(chipsets); i++) {
+      if (strcmp(chipsets[i].family, name) == 0)
+         return chipsets[i].devid;
+   }
+
+   char *end;
+   errno = 0;
+   long devid = strtol(name, &end, 0);
+   if (errno == 0 && *end == '\0') {
+      for (unsigned i = 0; i < ARRAY_SIZE(chipsets); i++) {
+         if (chipsets[i].devid == devid)
+            return devid;
+      }
+   }
+
+   return -1;
+}
+
+static const char *
+device_family(int devid)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(chipsets); i++) {
+      if (chipsets[i].devid == devid)
+         return chipsets[i].family;
+   }
+   return "unknown";
+}
+
+/**
+ * Count native instructions in [start, end) of the program, taking
+ * instruction compaction into account.
+ */
+static unsigned
+count_instructions(const struct brw_context *brw, const unsigned *program,
+                   unsigned start, unsigned end)
+{
+   const char *base = (const char *) program;
+   unsigned count = 0;
+
+   for (unsigned offset = start; offset < end; count++) {
+      const uint32_t dw0 = *(const uint32_t *) (base + offset);
+
+      /* Compaction only exists on gen6+, where bit 29 of the first dword
+       * is CmptCtrl.  On earlier generations that bit means something else.
+       */
+      offset += (brw->gen >= 6 && (dw0 & (1u << 29))) ? 8 : 16;
+   }
+
+   return count;
+}
+
+/**
+ * Advertise the GLSL version and the extensions visible to the GLSL
+ * compiler.  This mirrors intelInitExtensions(), minus everything that
+ * would require talking to the kernel.
+ */
+static void
+init_glsl_extensions(struct brw_context *brw)
+{
+   struct gl_context *ctx = &brw->ctx;
+
+   ctx->Extensions.ARB_draw_instanced = true;
+   ctx->Extensions.ARB_ES2_compatibility = true;
+   ctx->Extensions.ARB_explicit_attrib_location = true;
+   ctx->Extensions.ARB_fragment_coord_conventions = true;
+   ctx->Extensions.ARB_shader_bit_encoding = true;
+   ctx->Extensions.ARB_shader_texture_lod = true;
+   ctx->Extensions.EXT_separate_shader_objects = true;
+   ctx->Extensions.EXT_texture_array = true;
+   ctx->Extensions.NV_texture_rectangle = true;
+   ctx->Extensions.OES_EGL_image_external = true;
+   ctx->Extensions.OES_standard_derivatives = true;
+
+   if (brw->gen >= 7) {
+      ctx->Const.GLSLVersion = 330;
+      ctx->Version = 33;
+   } else if (brw->gen >= 6) {
+      ctx->Const.GLSLVersion = 140;
+      ctx->Version = 31;
+   } else {
+      ctx->Const.GLSLVersion = 120;
+      ctx->Version = 21;
+   }
+   _mesa_override_glsl_version(ctx);
+
+   if (brw->gen >= 6) {
+      ctx->Extensions.ARB_ES3_compatibility = true;
+      ctx->Extensions.ARB_uniform_buffer_object = true;
+      ctx->Extensions.ARB_shading_language_420pack = true;
+      ctx->Extensions.ARB_shading_language_packing = true;
+      ctx->Extensions.ARB_texture_cube_map_array = true;
+      ctx->Extensions.ARB_texture_multisample = true;
+      ctx->Extensions.ARB_sample_shading = true;
+      ctx->Extensions.ARB_texture_buffer_object = true;
+   }
+
+   if (brw->gen >= 5) {
+      ctx->Extensions.ARB_texture_query_lod = true;
+      ctx->Extensions.EXT_shader_integer_mix = ctx->Const.GLSLVersion >= 130;
+      ctx->Extensions.ARB_texture_query_levels = ctx->Const.GLSLVersion >= 130;
+   }
+
+   if (brw->gen >= 7) {
+      ctx->Extensions.ARB_texture_gather = true;
+      ctx->Extensions.ARB_conservative_depth = true;
+      ctx->Extensions.AMD_vertex_shader_layer = true;
+      ctx->Extensions.ARB_shader_atomic_counters = true;
+   }
+}
+
+/**
+ * Set up a brw_context with just enough state for the compiler: the device
+ * info, driconf options, context constants and the register sets.  There
+ * is no DRI screen, buffer manager or hardware context.
+ */
+static struct brw_context *
+create_context(const struct brw_device_info *devinfo)
+{
+   struct intel_screen *screen = rzalloc(NULL, struct intel_screen);
+   screen->devinfo = devinfo;
+   driParseOptionInfo(&screen->optionCache, brw_config_options.xml);
+
+   struct brw_context *brw = rzalloc(NULL, struct brw_context);
+   struct gl_context *ctx = &brw->ctx;
+
+   brw->intelScreen = screen;
+   brw->gen = devinfo->gen;
+   brw->gt = devinfo->gt;
+   brw->is_g4x = devinfo->is_g4x;
+   brw->is_baytrail = devinfo->is_baytrail;
+   brw->is_haswell = devinfo->is_haswell;
+   brw->has_llc = devinfo->has_llc;
+   brw->has_pln = devinfo->has_pln;
+   brw->has_compr4 = devinfo->has_compr4;
+   brw->has_surface_tile_offset = devinfo->has_surface_tile_offset;
+   brw->has_negative_rhw_bug = devinfo->has_negative_rhw_bug;
+   brw->needs_unlit_centroid_workaround =
+      devinfo->needs_unlit_centroid_workaround;
+   brw->max_vs_threads = devinfo->max_vs_threads;
+   brw->max_gs_threads = devinfo->max_gs_threads;
+   brw->max_wm_threads = devinfo->max_wm_threads;
+
+   struct dd_function_table functions;
+   _mesa_init_driver_functions(&functions);
+   brwInitFragProgFuncs(&functions);
+
+   struct gl_config visual;
+   memset(&visual, 0, sizeof(visual));
+
+   if (!_mesa_initialize_context(ctx, API_OPENGL_CORE, &visual, NULL,
+                                 &functions)) {
+      fprintf(stderr, "failed to initialize the GL context\n");
+      exit(1);
+   }
+
+   driParseConfigFiles(&brw->optionCache, &screen->optionCache, 0, "i965");
+   brw->disable_derivative_optimization =
+      driQueryOptionb(&brw->optionCache, "disable_derivative_optimization");
+
+   /* Backend compiles are driven explicitly below, not from the linker. */
+   brw->precompile = false;
+
+   brw_process_intel_debug_variable(brw);
+   INTEL_DEBUG &= ~DEBUG_SHADER_TIME;
+
+   brw_initialize_context_constants(brw);
+   init_glsl_extensions(brw);
+
+   /* The default FS key looks at the draw buffer; give it a window-system
+    * framebuffer.
+    */
+   struct gl_framebuffer *fb = _mesa_create_framebuffer(&visual);
+   _mesa_reference_framebuffer(&ctx->DrawBuffer, fb);
+   _mesa_reference_framebuffer(&ctx->ReadBuffer, fb);
+   _mesa_reference_framebuffer(&fb, NULL);
+
+   brw_fs_alloc_reg_sets(brw);
+   brw_vec4_alloc_reg_set(brw);
+
+   return brw;
+}
+
+static char *
+load_text_file(void *mem_ctx, const char *file_name)
+{
+   FILE *fp = fopen(file_name, "rb");
+   if (!fp)
+      return NULL;
+
+   fseek(fp, 0L, SEEK_END);
+   long size = ftell(fp);
+   fseek(fp, 0L, SEEK_SET);
+
+   char *text = (char *) ralloc_size(mem_ctx, size + 1);
+   size_t total_read = fread(text, 1, size, fp);
+   text[total_read] = '\0';
+   fclose(fp);
+
+   return text;
+}
+
+static GLenum
+shader_type_for_file(const char *file_name)
+{
+   const char *ext = strrchr(file_name, '.');
+
+   if (ext == NULL)
+      return GL_NONE;
+   if (strcmp(ext, ".vert") == 0)
+      return GL_VERTEX_SHADER;
+   if (strcmp(ext, ".geom") == 0)
+      return GL_GEOMETRY_SHADER;
+   if (strcmp(ext, ".frag") == 0)
+      return GL_FRAGMENT_SHADER;
+   return GL_NONE;
+}
+
+static bool
+compile_fs(struct brw_context *brw, struct gl_shader_program *prog,
+           struct stage_stats *stats)
+{
+   struct gl_context *ctx = &brw->ctx;
+   struct gl_fragment_program *fp = (struct gl_fragment_program *)
+      prog->_LinkedShaders[MESA_SHADER_FRAGMENT]->Program;
+   struct brw_wm_prog_key key;
+   unsigned program_size;
+
+   brw_wm_setup_prog_key_for_precompile(ctx, &key, fp);
+
+   struct brw_wm_compile *c = rzalloc(NULL, struct brw_wm_compile);
+   c->estimate_cycles = true;
+   double start = get_time();
+   const unsigned *program =
+      brw_compile_wm_prog(brw, prog, brw_fragment_program(fp), &key, c,
+                          &program_size);
+   stats->time = get_time() - start;
+
+   if (program) {
+      unsigned simd8_end = c->prog_data.prog_offset_16 ?
+                           c->prog_data.prog_offset_16 : program_size;
+      stats->compiled = true;
+      stats->instructions = count_instructions(brw, program, 0, simd8_end);
+      stats->instructions_16 = c->prog_data.prog_offset_16 ?
+         count_instructions(brw, program, simd8_end, program_size) : 0;
+      stats->cycles = c->estimated_cycles_8;
+      stats->cycles_16 = c->prog_data.prog_offset_16 ?
+         c->estimated_cycles_16 : 0;
+      stats->assembly_size = program_size;
+      stats->scratch = c->prog_data.total_scratch;
+   }
+
+   brw_wm_prog_data_free(&c->prog_data);
+   ralloc_free(c);
+   return program != NULL;
+}
+
+static bool
+compile_vs(struct brw_context *brw, struct gl_shader_program *prog,
+           struct stage_stats *stats)
+{
+   struct gl_context *ctx = &brw->ctx;
+   struct gl_vertex_program *vp = (struct gl_vertex_program *)
+      prog->_LinkedShaders[MESA_SHADER_VERTEX]->Program;
+   struct brw_vertex_program *bvp = brw_vertex_program(vp);
+   struct brw_vs_prog_key key;
+   struct brw_vs_compile c;
+   struct brw_vs_prog_data prog_data;
+   unsigned program_size;
+
+   memset(&key, 0, sizeof(key));
+   brw_vec4_setup_prog_key_for_precompile(ctx, &key.base, bvp->id, &vp->Base);
+
+   void *mem_ctx = ralloc_context(NULL);
+   double start = get_time();
+   const unsigned *program =
+      brw_compile_vs_prog(brw, prog, bvp, &key, &c, &prog_data, mem_ctx,
+                          &program_size);
+   stats->time = get_time() - start;
+
+   if (program) {
+      stats->compiled = true;
+      stats->instructions = count_instructions(brw, program, 0, program_size);
+      stats->assembly_size = program_size;
+      stats->cycles = c.base.estimated_cycles;
+      stats->scratch = prog_data.base.total_scratch;
+   }
+
+   brw_vs_prog_data_free(&prog_data);
+   ralloc_free(mem_ctx);
+   return program != NULL;
+}
+
+static bool
+compile_gs(struct brw_context *brw, struct gl_shader_program *prog,
+           struct stage_stats *stats)
+{
+   struct gl_context *ctx = &brw->ctx;
+   struct gl_geometry_program *gp = (struct gl_geometry_program *)
+      prog->_LinkedShaders[MESA_SHADER_GEOMETRY]->Program;
+   struct brw_geometry_program *bgp = brw_geometry_program(gp);
+   struct brw_gs_prog_key key;
+   struct brw_gs_compile c;
+   unsigned program_size;
+
+   memset(&key, 0, sizeof(key));
+   brw_vec4_setup_prog_key_for_precompile(ctx, &key.base, bgp->id, &gp->Base);
+   key.input_varyings = gp->Base.InputsRead;
+
+   void *mem_ctx = ralloc_context(NULL);
+   double start = get_time();
+   const unsigned *program =
+      brw_compile_gs_prog(brw, prog, bgp, &key, &c, mem_ctx, &program_size);
+   stats->time = get_time() - start;
+
+   if (program) {
+      stats->compiled = true;
+      stats->instructions = count_instructions(brw, program, 0, program_size);
+      stats->assembly_size = program_size;
+      stats->cycles = c.base.estimated_cycles;
+      stats->scratch = c.prog_data.base.total_scratch;
+   }
+
+   brw_gs_prog_data_free(&c.prog_data);
+   ralloc_free(mem_ctx);
+   return program != NULL;
+}
+
+/**
+ * Compile, link and run the backends once for the given set of shaders.
+ */
+static bool
+compile_program(struct brw_context *brw, int num_files, char **files,
+                char **sources, struct compile_stats *stats)
+{
+   struct gl_context *ctx = &brw->ctx;
+   struct gl_shader_program *prog = ctx->Driver.NewShaderProgram(ctx, 0);
+   bool ok = true;
+
+   memset(stats, 0, sizeof(*stats));
+
+   prog->Shaders = reralloc(prog, prog->Shaders, struct gl_shader *,
+                            num_files);
+
+   double start = get_time();
+   for (int i = 0; i < num_files; i++) {
+      struct gl_shader *shader =
+         ctx->Driver.NewShader(ctx, 0, shader_type_for_file(files[i]));
+      shader->Source = sources[i];
+
+      _mesa_glsl_compile_shader(ctx, shader, false, false);
+      prog->Shaders[prog->NumShaders++] = shader;
+
+      if (!shader->CompileStatus) {
+         fprintf(stderr, "%s: compile failed:\n%s\n", files[i],
+                 shader->InfoLog);
+         ok = false;
+      }
+   }
+   stats->compile_time = get_time() - start;
+
+   if (ok) {
+      start = get_time();
+      _mesa_glsl_link_shader(ctx, prog);
+      stats->link_time = get_time() - start;
+
+      if (!prog->LinkStatus) {
+         fprintf(stderr, "link failed:\n%s\n", prog->InfoLog);
+         ok = false;
+      }
+   }
+
+   if (ok && prog->_LinkedShaders[MESA_SHADER_VERTEX])
+      ok = compile_vs(brw, prog, &stats->stage[MESA_SHADER_VERTEX]);
+   if (ok && prog->_LinkedShaders[MESA_SHADER_GEOMETRY])
+      ok = compile_gs(brw, prog, &stats->stage[MESA_SHADER_GEOMETRY]);
+   if (ok && prog->_LinkedShaders[MESA_SHADER_FRAGMENT])
+      ok = compile_fs(brw, prog, &stats->stage[MESA_SHADER_FRAGMENT]);
+
+   for (unsigned i = 0; i < prog->NumShaders; i++) {
+      /* The source strings belong to the caller. */
+      prog->Shaders[i]->Source = NULL;
+      _mesa_reference_shader(ctx, &prog->Shaders[i], NULL);
+   }
+   prog->NumShaders = 0;
+   _mesa_reference_shader_program(ctx, &prog, NULL);
+
+   return ok;
+}
+
+static void
+print_stats(const struct compile_stats *best)
+{
+   static const char *const stage_names[MESA_SHADER_STAGES] = {
+      "VS", "GS", "FS"
+   };
+
+   printf("GLSL compile: %.3f ms\n", best->compile_time * 1000.0);
+   printf("GLSL link:    %.3f ms\n", best->link_time * 1000.0);
+
+   for (unsigned s = 0; s < MESA_SHADER_STAGES; s++) {
+      const struct stage_stats *stats = &best->stage[s];
+
+      if (!stats->compiled)
+         continue;
+
+      if (s == MESA_SHADER_FRAGMENT) {
+         printf("%s: %u SIMD8 instructions (%d cycles), "
+                "%u SIMD16 instructions (%d cycles)",
+                stage_names[s], stats->instructions, stats->cycles,
+                stats->instructions_16, stats->cycles_16);
+      } else {
+         printf("%s: %u instructions (%d cycles)", stage_names[s],
+                stats->instructions, stats->cycles);
+      }
+      printf(", %u bytes, %u bytes scratch, %.3f ms\n",
+             stats->assembly_size, stats->scratch, stats->time * 1000.0);
+   }
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [options] <file.vert | file.geom | file.frag>...\n"
+           "\n"
+           "  --device <family|pci-id>  device to compile for (default ivb_gt2)\n"
+           "  --iterations <n>          compile n times, report the fastest\n"
+           "  --list-devices            list known device families\n",
+           name);
+}
+
+static const struct option compiler_opts[] = {
+   { "device",       required_argument, NULL, 'd' },
+   { "iterations",   required_argument, NULL, 'n' },
+   { "list-devices", no_argument,       NULL, 'l' },
+   { "help",         no_argument,       NULL, 'h' },
+   { NULL, 0, NULL, 0 }
+};
+
+int
+main(int argc, char **argv)
+{
+   const char *device = "ivb_gt2";
+   int iterations = 1;
+   int c;
+
+   while ((c = getopt_long(argc, argv, "d:n:lh", compiler_opts, NULL)) != -1) {
+      switch (c) {
+      case 'd':
+         device = optarg;
+         break;
+      case 'n':
+         iterations = MAX2(atoi(optarg), 1);
+         break;
+      case 'l':
+         for (unsigned i = 0; i < ARRAY_SIZE(chipsets); i++) {
+            if (i == 0 || strcmp(chipsets[i].family, chipsets[i - 1].family))
+               printf("%s\n", chipsets[i].family);
+         }
+         return 0;
+      default:
+         usage(argv[0]);
+         return c == 'h' ? 0 : 1;
+      }
+   }
+
+   if (optind >= argc) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   int devid = lookup_device(device);
+   if (devid < 0) {
+      fprintf(stderr, "unknown device \"%s\"\n", device);
+      return 1;
+   }
+
+   const struct brw_device_info *devinfo = brw_get_device_info(devid);
+   struct brw_context *brw = create_context(devinfo);
+
+   int num_files = argc - optind;
+   char **files = argv + optind;
+   char **sources = ralloc_array(brw, char *, num_files);
+
+   for (int i = 0; i < num_files; i++) {
+      if (shader_type_for_file(files[i]) == GL_NONE) {
+         fprintf(stderr, "%s: unknown shader type\n", files[i]);
+         return 1;
+      }
+
+      sources[i] = load_text_file(sources, files[i]);
+      if (sources[i] == NULL) {
+         fprintf(stderr, "%s: %s\n", files[i], strerror(errno));
+         return 1;
+      }
+   }
+
+   printf("device: %s (0x%04x, gen%d)\n", device_family(devid), devid,
+          brw->gen);
+
+   /* Keep the fastest time seen for each phase; the code itself doesn't
+    * change from one iteration to the next.
+    */
+   struct compile_stats best, stats;
+   for (int i = 0; i < iterations; i++) {
+      if (!compile_program(brw, num_files, files, sources, &stats))
+         return 1;
+
+      if (i == 0) {
+         best = stats;
+         continue;
+      }
+
+      best.compile_time = MIN2(best.compile_time, stats.compile_time);
+      best.link_time = MIN2(best.link_time, stats.link_time);
+      for (unsigned s = 0; s < MESA_SHADER_STAGES; s++)
+         best.stage[s].time = MIN2(best.stage[s].time, stats.stage[s].time);
+   }
+
+   print_stats(&best);
+
+   return 0;
+}
@@ -122,6 +122,12 @@ static struct gl_program *brwNewProgram( struct gl_context *ctx,
 static void brwDeleteProgram( struct gl_context *ctx,
 			      struct gl_program *prog )
 {
+   if (prog->Target == GL_FRAGMENT_PROGRAM_ARB) {
+      struct brw_fragment_program *fp = (struct brw_fragment_program *) prog;
+
+      ralloc_free(fp->precompile_keys);
+   }
+
    _mesa_delete_program( ctx, prog );
 }
 
@@ -85,6 +85,15 @@ public:
     * its children, or just the issue_time if it's a leaf node.
     */
    int delay;
+
+   /**
+    * Whether this node must stay ordered against everything else in the
+    * block.  calculate_deps() sets it, add_barrier_deps() adds the edges.
+    */
+   bool is_barrier;
+
+   /** Position in the block, for add_barrier_deps(). */
+   int ip;
 };
 
 void
@@ -404,6 +413,8 @@ public:
       this->post_reg_alloc = (mode == SCHEDULE_POST);
       this->mode = mode;
       this->time = 0;
+      this->cycle_count = 0;
+      this->estimate_only = false;
       if (!post_reg_alloc) {
          this->remaining_grf_uses = rzalloc_array(mem_ctx, int, grf_count);
          this->grf_active = rzalloc_array(mem_ctx, bool, grf_count);
@@ -417,11 +428,13 @@ public:
    {
       ralloc_free(this->mem_ctx);
    }
-   void add_barrier_deps(schedule_node *n);
+   void mark_barrier(schedule_node *n);
+   void add_barrier_deps();
    void add_dep(schedule_node *before, schedule_node *after, int latency);
    void add_dep(schedule_node *before, schedule_node *after);
 
    void run(exec_list *instructions);
+   int estimate_cycles(exec_list *instructions);
    void add_inst(backend_instruction *inst);
    void compute_delay(schedule_node *node);
    virtual void calculate_deps() = 0;
@@ -441,6 +454,7 @@ public:
    virtual int get_register_pressure_benefit(backend_instruction *inst) = 0;
 
    void schedule_instructions(backend_instruction *next_block_header);
+   void simulate_instructions(backend_instruction *next_block_header);
 
    void *mem_ctx;
 
@@ -448,6 +462,15 @@ public:
    int instructions_to_schedule;
    int grf_count;
    int time;
+
+   /**
+    * Estimated cycles to execute every block once, i.e. the sum of the
+    * final clock of each block.  Loops are not taken into account.
+    */
+   int cycle_count;
+
+   /** Set by estimate_cycles() to keep the original instruction order. */
+   bool estimate_only;
    exec_list instructions;
    backend_visitor *bv;
 
@@ -611,6 +634,7 @@ schedule_node::schedule_node(backend_instruction *inst,
    this->unblocked_time = 0;
    this->cand_generation = 0;
    this->delay = 0;
+   this->is_barrier = false;
 
    /* We can't measure Gen6 timings directly but expect them to be much
     * closer to Gen7 than Gen4.
@@ -667,6 +691,16 @@ instruction_scheduler::add_dep(schedule_node *before, schedule_node *after,
 
    assert(before != after);
 
+   /* Runs of reads of the same register add the same edge repeatedly, so
+    * check the most recently added child before searching all of them.
+    */
+   if (before->child_count &&
+       before->children[before->child_count - 1] == after) {
+      int i = before->child_count - 1;
+      before->child_latency[i] = MAX2(before->child_latency[i], latency);
+      return;
+   }
+
    for (int i = 0; i < before->child_count; i++) {
       if (before->children[i] == after) {
 	 before->child_latency[i] = MAX2(before->child_latency[i], latency);
@@ -704,28 +738,85 @@ instruction_scheduler::add_dep(schedule_node *before, schedule_node *after)
 
 /**
  * Sometimes we really want this node to execute after everything that
- * was before it and before everything that followed it.  This adds
- * the deps to do so.
+ * was before it and before everything that followed it.  This marks it
+ * so that add_barrier_deps() adds the deps to do so.
  */
 void
-instruction_scheduler::add_barrier_deps(schedule_node *n)
+instruction_scheduler::mark_barrier(schedule_node *n)
 {
-   schedule_node *prev = (schedule_node *)n->prev;
-   schedule_node *next = (schedule_node *)n->next;
+   n->is_barrier = true;
+}
+
+/**
+ * Orders the nodes marked by mark_barrier() against the rest of the block,
+ * once calculate_deps() has added the register dependencies.
+ *
+ * Every dependency points forward in the block, so a node that already has
+ * a child before the next barrier is ordered before that barrier through
+ * the child, and a node that already has a parent after the previous
+ * barrier is ordered after it through the parent.  Only the remaining
+ * nodes need an edge, which is at most two per node instead of one per
+ * node for every barrier.
+ */
+void
+instruction_scheduler::add_barrier_deps()
+{
+   int ip = 0;
+   foreach_list(node, &instructions) {
+      ((schedule_node *)node)->ip = ip++;
+   }
+
+   int *last_parent_ip = ralloc_array(mem_ctx, int, ip);
+   memset(last_parent_ip, -1, ip * sizeof(int));
 
-   if (prev) {
-      while (!prev->is_head_sentinel()) {
-	 add_dep(prev, n, 0);
-	 prev = (schedule_node *)prev->prev;
+   bool any_barrier = false;
+   foreach_list(node, &instructions) {
+      schedule_node *n = (schedule_node *)node;
+
+      for (int i = 0; i < n->child_count; i++) {
+         int c = n->children[i]->ip;
+         last_parent_ip[c] = MAX2(last_parent_ip[c], n->ip);
       }
+      any_barrier |= n->is_barrier;
    }
 
-   if (next) {
-      while (!next->is_tail_sentinel()) {
-	 add_dep(n, next, 0);
-	 next = (schedule_node *)next->next;
+   if (!any_barrier) {
+      ralloc_free(last_parent_ip);
+      return;
+   }
+
+   schedule_node *barrier = NULL;
+   schedule_node *segment_start = (schedule_node *)instructions.get_head();
+
+   foreach_list(node, &instructions) {
+      schedule_node *n = (schedule_node *)node;
+
+      if (barrier && last_parent_ip[n->ip] < barrier->ip)
+         add_dep(barrier, n, 0);
+
+      if (!n->is_barrier)
+         continue;
+
+      for (schedule_node *p = segment_start; p != n;
+           p = (schedule_node *)p->next) {
+         bool ordered = false;
+
+         for (int i = 0; i < p->child_count; i++) {
+            if (p->children[i]->ip < n->ip) {
+               ordered = true;
+               break;
+            }
+         }
+
+         if (!ordered)
+            add_dep(p, n, 0);
       }
+
+      barrier = n;
+      segment_start = (schedule_node *)n->next;
    }
+
+   ralloc_free(last_parent_ip);
 }
 
 /* instruction scheduling needs to be aware of when an MRF write
@@ -765,7 +856,7 @@ fs_instruction_scheduler::calculate_deps()
     * dead code elimination anyway.
     */
    schedule_node *last = (schedule_node *)instructions.get_tail();
-   add_barrier_deps(last);
+   mark_barrier(last);
 
    memset(last_grf_write, 0, sizeof(last_grf_write));
    memset(last_mrf_write, 0, sizeof(last_mrf_write));
@@ -777,7 +868,7 @@ fs_instruction_scheduler::calculate_deps()
 
       if (inst->opcode == FS_OPCODE_PLACEHOLDER_HALT ||
          inst->has_side_effects())
-         add_barrier_deps(n);
+         mark_barrier(n);
 
       /* read-after-write deps. */
       for (int i = 0; i < 3; i++) {
@@ -804,7 +895,7 @@ fs_instruction_scheduler::calculate_deps()
 		    inst->src[i].file != IMM &&
 		    inst->src[i].file != UNIFORM) {
 	    assert(inst->src[i].file != MRF);
-	    add_barrier_deps(n);
+	    mark_barrier(n);
 	 }
       }
 
@@ -855,7 +946,7 @@ fs_instruction_scheduler::calculate_deps()
             last_fixed_grf_write = n;
          }
       } else if (inst->dst.file != BAD_FILE) {
-	 add_barrier_deps(n);
+	 mark_barrier(n);
       }
 
       if (inst->mlen > 0 && inst->base_mrf != -1) {
@@ -910,7 +1001,7 @@ fs_instruction_scheduler::calculate_deps()
 		    inst->src[i].file != IMM &&
 		    inst->src[i].file != UNIFORM) {
 	    assert(inst->src[i].file != MRF);
-	    add_barrier_deps(n);
+	    mark_barrier(n);
 	 }
       }
 
@@ -960,7 +1051,7 @@ fs_instruction_scheduler::calculate_deps()
             last_fixed_grf_write = n;
          }
       } else if (inst->dst.file != BAD_FILE) {
-	 add_barrier_deps(n);
+	 mark_barrier(n);
       }
 
       if (inst->mlen > 0 && inst->base_mrf != -1) {
@@ -995,7 +1086,7 @@ vec4_instruction_scheduler::calculate_deps()
     * anything that could have been scheduled after it.
     */
    schedule_node *last = (schedule_node *)instructions.get_tail();
-   add_barrier_deps(last);
+   mark_barrier(last);
 
    memset(last_grf_write, 0, sizeof(last_grf_write));
    memset(last_mrf_write, 0, sizeof(last_mrf_write));
@@ -1006,7 +1097,7 @@ vec4_instruction_scheduler::calculate_deps()
       vec4_instruction *inst = (vec4_instruction *)n->inst;
 
       if (inst->has_side_effects())
-         add_barrier_deps(n);
+         mark_barrier(n);
 
       /* read-after-write deps. */
       for (int i = 0; i < 3; i++) {
@@ -1022,7 +1113,7 @@ vec4_instruction_scheduler::calculate_deps()
             /* No reads from MRF, and ATTR is already translated away */
             assert(inst->src[i].file != MRF &&
                    inst->src[i].file != ATTR);
-            add_barrier_deps(n);
+            mark_barrier(n);
          }
       }
 
@@ -1050,7 +1141,7 @@ vec4_instruction_scheduler::calculate_deps()
                  inst->dst.fixed_hw_reg.file == BRW_GENERAL_REGISTER_FILE) {
          last_fixed_grf_write = n;
       } else if (inst->dst.file != BAD_FILE) {
-         add_barrier_deps(n);
+         mark_barrier(n);
       }
 
       if (inst->mlen > 0) {
@@ -1093,7 +1184,7 @@ vec4_instruction_scheduler::calculate_deps()
                     inst->src[i].file != UNIFORM) {
             assert(inst->src[i].file != MRF &&
                    inst->src[i].file != ATTR);
-            add_barrier_deps(n);
+            mark_barrier(n);
          }
       }
 
@@ -1120,7 +1211,7 @@ vec4_instruction_scheduler::calculate_deps()
                  inst->dst.fixed_hw_reg.file == BRW_GENERAL_REGISTER_FILE) {
          last_fixed_grf_write = n;
       } else if (inst->dst.file != BAD_FILE) {
-         add_barrier_deps(n);
+         mark_barrier(n);
       }
 
       if (inst->mlen > 0) {
@@ -1370,6 +1461,59 @@ instruction_scheduler::schedule_instructions(backend_instruction *next_block_hea
    assert(instructions_to_schedule == 0);
 }
 
+/**
+ * Puts the block back in its original order while running the latency
+ * model over it, as the hardware would issue it.
+ */
+void
+instruction_scheduler::simulate_instructions(backend_instruction *next_block_header)
+{
+   int math_unblocked_time = 0;
+
+   time = 0;
+
+   foreach_list_safe(node, &instructions) {
+      schedule_node *n = (schedule_node *)node;
+
+      n->remove();
+      next_block_header->insert_before(n->inst);
+      instructions_to_schedule--;
+
+      time += issue_time(n->inst);
+      time = MAX2(time, n->unblocked_time);
+      if (n->inst->is_math()) {
+         time = MAX2(time, math_unblocked_time);
+         math_unblocked_time = time + n->latency;
+      }
+
+      for (int i = 0; i < n->child_count; i++) {
+         schedule_node *child = n->children[i];
+
+         child->unblocked_time = MAX2(child->unblocked_time,
+                                      time + n->child_latency[i]);
+      }
+   }
+
+   assert(instructions_to_schedule == 0);
+}
+
+/**
+ * Returns the estimated cycle count of the program without changing it.
+ *
+ * This is the same latency model the scheduler uses, applied to the
+ * instructions in their current order.  It's meant for comparing code
+ * quality between compiler changes, not as a prediction of real timings.
+ */
+int
+instruction_scheduler::estimate_cycles(exec_list *all_instructions)
+{
+   estimate_only = true;
+   run(all_instructions);
+   estimate_only = false;
+
+   return cycle_count;
+}
+
 void
 instruction_scheduler::run(exec_list *all_instructions)
 {
@@ -1384,7 +1528,7 @@ instruction_scheduler::run(exec_list *all_instructions)
    /* Populate the remaining GRF uses array to improve the pre-regalloc
     * scheduling.
     */
-   if (remaining_grf_uses) {
+   if (remaining_grf_uses && !estimate_only) {
       foreach_list(node, all_instructions) {
          count_remaining_grf_uses((backend_instruction *)node);
       }
@@ -1401,13 +1545,20 @@ instruction_scheduler::run(exec_list *all_instructions)
 	    break;
       }
       calculate_deps();
+      add_barrier_deps();
 
-      foreach_list(node, &instructions) {
-         schedule_node *n = (schedule_node *)node;
-         compute_delay(n);
+      if (estimate_only) {
+         simulate_instructions(next_block_header);
+      } else {
+         foreach_list(node, &instructions) {
+            schedule_node *n = (schedule_node *)node;
+            compute_delay(n);
+         }
+
+         schedule_instructions(next_block_header);
       }
 
-      schedule_instructions(next_block_header);
+      cycle_count += time;
    }
 
    if (debug) {
@@ -1430,12 +1581,24 @@ fs_visitor::schedule_instructions(instruction_scheduler_mode mode)
 
    if (unlikely(INTEL_DEBUG & DEBUG_WM) && mode == SCHEDULE_POST) {
       printf("fs%d estimated execution time: %d cycles\n",
-             dispatch_width, sched.time);
+             dispatch_width, sched.cycle_count);
    }
 
    invalidate_live_intervals();
 }
 
+/**
+ * Runs the post-register-allocation latency model over the final
+ * instructions, without scheduling them.
+ */
+int
+fs_visitor::estimate_cycles()
+{
+   fs_instruction_scheduler sched(this, grf_used, SCHEDULE_POST);
+
+   return sched.estimate_cycles(&instructions);
+}
+
 void
 vec4_visitor::opt_schedule_instructions()
 {
@@ -1443,8 +1606,10 @@ vec4_visitor::opt_schedule_instructions()
    sched.run(&instructions);
 
    if (unlikely(debug_flag)) {
-      printf("vec4 estimated execution time: %d cycles\n", sched.time);
+      printf("vec4 estimated execution time: %d cycles\n", sched.cycle_count);
    }
 
+   c->estimated_cycles = sched.cycle_count;
+
    invalidate_live_intervals();
 }
@@ -37,14 +37,16 @@
  * of state (plus associated auxiliary data) in return.  Objects in
  * the cache may not have relocations (pointers to other BOs) in them.
  *
- * The inner workings are a simple hash table based on a CRC of the
- * key data.
+ * The inner workings are an open-addressed hash table (linear probing,
+ * power-of-two size) based on a CRC of the key data.  Items are never
+ * removed individually, so no tombstones are needed.
  *
  * Replacement is not implemented.  Instead, when the cache gets too
  * big we throw out all of the cache data and let it get regenerated.
  */
 
 #include "main/imports.h"
+#include "main/hash_table.h"
 #include "intel_batchbuffer.h"
 #include "brw_state.h"
 #include "brw_vs.h"
@@ -86,43 +88,43 @@ static struct brw_cache_item *
 search_cache(struct brw_cache *cache, GLuint hash,
 	     struct brw_cache_item *lookup)
 {
-   struct brw_cache_item *c;
-
-#if 0
-   int bucketcount = 0;
-
-   for (c = cache->items[hash % cache->size]; c; c = c->next)
-      bucketcount++;
-
-   fprintf(stderr, "bucket %d/%d = %d/%d items\n", hash % cache->size,
-	   cache->size, bucketcount, cache->n_items);
-#endif
+   const GLuint mask = cache->size - 1;
+   GLuint i;
 
-   for (c = cache->items[hash % cache->size]; c; c = c->next) {
-      if (brw_cache_item_equals(lookup, c))
-	 return c;
+   for (i = hash & mask; cache->items[i]; i = (i + 1) & mask) {
+      if (brw_cache_item_equals(lookup, cache->items[i]))
+	 return cache->items[i];
    }
 
    return NULL;
 }
 
+static void
+insert_item(struct brw_cache_item **items, GLuint size,
+            struct brw_cache_item *item)
+{
+   const GLuint mask = size - 1;
+   GLuint i;
+
+   for (i = item->hash & mask; items[i]; i = (i + 1) & mask)
+      ;
+
+   items[i] = item;
+}
 
 static void
 rehash(struct brw_cache *cache)
 {
    struct brw_cache_item **items;
-   struct brw_cache_item *c, *next;
    GLuint size, i;
 
-   size = cache->size * 3;
+   size = cache->size * 2;
    items = calloc(1, size * sizeof(*items));
 
-   for (i = 0; i < cache->size; i++)
-      for (c = cache->items[i]; c; c = next) {
-	 next = c->next;
-	 c->next = items[c->hash % size];
-	 items[c->hash % size] = c;
-      }
+   for (i = 0; i < cache->size; i++) {
+      if (cache->items[i])
+         insert_item(items, size, cache->items[i]);
+   }
 
    free(cache->items);
    cache->items = items;
@@ -144,6 +146,15 @@ brw_search_cache(struct brw_cache *cache,
    struct brw_cache_item lookup;
    GLuint hash;
 
+   /* State atoms are mostly re-emitted because some broad dirty flag was
+    * set, and end up asking for the same item as last time.  Checking for
+    * that first avoids hashing the key.
+    */
+   item = cache->last_item[cache_id];
+   if (item && item->key_size == key_size &&
+       memcmp(item->key, key, key_size) == 0)
+      goto found;
+
    lookup.cache_id = cache_id;
    lookup.key = key;
    lookup.key_size = key_size;
@@ -155,6 +166,9 @@ brw_search_cache(struct brw_cache *cache,
    if (item == NULL)
       return false;
 
+   cache->last_item[cache_id] = item;
+
+found:
    *(void **)out_aux = ((char *)item->key + item->key_size);
 
    if (item->offset != *inout_offset) {
@@ -204,33 +218,38 @@ brw_try_upload_using_copy(struct brw_cache *cache,
    struct brw_cache_item *item;
 
    for (i = 0; i < cache->size; i++) {
-      for (item = cache->items[i]; item; item = item->next) {
-	 const void *item_aux = item->key + item->key_size;
-	 int ret;
-
-	 if (item->cache_id != result_item->cache_id ||
-	     item->size != result_item->size ||
-	     item->aux_size != result_item->aux_size) {
-	    continue;
-	 }
-
-         if (cache->aux_compare[result_item->cache_id]) {
-            if (!cache->aux_compare[result_item->cache_id](item_aux, aux))
-               continue;
-         } else if (memcmp(item_aux, aux, item->aux_size) != 0) {
-	    continue;
-	 }
-
-	 drm_intel_bo_map(cache->bo, false);
-	 ret = memcmp(cache->bo->virtual + item->offset, data, item->size);
-	 drm_intel_bo_unmap(cache->bo);
-	 if (ret)
-	    continue;
-
-	 result_item->offset = item->offset;
-
-	 return true;
+      const void *item_aux;
+      int ret;
+
+      item = cache->items[i];
+      if (!item)
+         continue;
+
+      item_aux = item->key + item->key_size;
+
+      if (item->cache_id != result_item->cache_id ||
+          item->size != result_item->size ||
+          item->data_hash != result_item->data_hash ||
+          item->aux_size != result_item->aux_size) {
+         continue;
       }
+
+      if (cache->aux_compare[result_item->cache_id]) {
+         if (!cache->aux_compare[result_item->cache_id](item_aux, aux))
+            continue;
+      } else if (memcmp(item_aux, aux, item->aux_size) != 0) {
+         continue;
+      }
+
+      drm_intel_bo_map(cache->bo, false);
+      ret = memcmp(cache->bo->virtual + item->offset, data, item->size);
+      drm_intel_bo_unmap(cache->bo);
+      if (ret)
+         continue;
+
+      result_item->offset = item->offset;
+
+      return true;
    }
 
    return false;
@@ -251,12 +270,12 @@ brw_upload_item_data(struct brw_cache *cache,
       brw_cache_new_bo(cache, new_size);
    }
 
-   /* If we would block on writing to an in-use program BO, just
-    * recreate it.
+   /* Without LLC, the unsynchronized map brw_upload_cache() writes through
+    * is a synchronized GTT map, which would wait for the GPU to finish with
+    * any BO a batch has used.  Write to a fresh BO instead.
     */
-   if (cache->bo_used_by_gpu) {
+   if (!cache->brw->has_llc && cache->bo_used_by_gpu)
       brw_cache_new_bo(cache, cache->bo->size);
-   }
 
    item->offset = cache->next_offset;
 
@@ -285,6 +304,7 @@ brw_upload_cache(struct brw_cache *cache,
    item->key = key;
    item->key_size = key_size;
    item->aux_size = aux_size;
+   item->data_hash = _mesa_hash_data(data, data_size);
    hash = hash_key(item);
    item->hash = hash;
 
@@ -307,16 +327,24 @@ brw_upload_cache(struct brw_cache *cache,
 
    item->key = tmp;
 
-   if (cache->n_items > cache->size * 1.5)
+   /* Keep the table at most half full so that probe sequences stay short. */
+   if ((cache->n_items + 1) * 2 > cache->size)
       rehash(cache);
 
-   hash %= cache->size;
-   item->next = cache->items[hash];
-   cache->items[hash] = item;
+   insert_item(cache->items, cache->size, item);
    cache->n_items++;
-
-   /* Copy data to the buffer */
-   drm_intel_bo_subdata(cache->bo, item->offset, data_size, data);
+   cache->last_item[cache_id] = item;
+
+   /* Copy data to the buffer.  Uploads only ever append past next_offset,
+    * and brw_clear_cache() swaps in a fresh BO rather than rewinding one the
+    * GPU may still be executing from, so the range we're writing has never
+    * been referenced by a batch.  That makes it safe not to wait for the GPU
+    * to finish with the BO (which a pwrite would do).  On LLC parts, that is;
+    * elsewhere brw_upload_item_data() has made sure the BO is idle.
+    */
+   drm_intel_gem_bo_map_unsynchronized(cache->bo);
+   memcpy(cache->bo->virtual + item->offset, data, data_size);
+   drm_intel_bo_unmap(cache->bo);
 
    *out_offset = item->offset;
    *(void **)out_aux = (void *)((char *)item->key + item->key_size);
@@ -330,7 +358,7 @@ brw_init_caches(struct brw_context *brw)
 
    cache->brw = brw;
 
-   cache->size = 7;
+   cache->size = 16;
    cache->n_items = 0;
    cache->items =
       calloc(1, cache->size * sizeof(struct brw_cache_item *));
@@ -350,25 +378,27 @@ brw_init_caches(struct brw_context *brw)
 static void
 brw_clear_cache(struct brw_context *brw, struct brw_cache *cache)
 {
-   struct brw_cache_item *c, *next;
+   struct brw_cache_item *c;
    GLuint i;
 
    DBG("%s\n", __FUNCTION__);
 
    for (i = 0; i < cache->size; i++) {
-      for (c = cache->items[i]; c; c = next) {
-	 next = c->next;
-         if (cache->aux_free[c->cache_id]) {
-            const void *item_aux = c->key + c->key_size;
-            cache->aux_free[c->cache_id](item_aux);
-         }
-	 free((void *)c->key);
-	 free(c);
+      c = cache->items[i];
+      if (!c)
+         continue;
+
+      if (cache->aux_free[c->cache_id]) {
+         const void *item_aux = c->key + c->key_size;
+         cache->aux_free[c->cache_id](item_aux);
       }
+      free((void *)c->key);
+      free(c);
       cache->items[i] = NULL;
    }
 
    cache->n_items = 0;
+   memset(cache->last_item, 0, sizeof(cache->last_item));
 
    /* Start putting programs into the start of the BO again, since
     * we'll never find the old results.
@@ -382,6 +412,17 @@ brw_clear_cache(struct brw_context *brw, struct brw_cache *cache)
    brw->state.dirty.brw |= ~0;
    brw->state.dirty.cache |= ~0;
    intel_batchbuffer_flush(brw);
+
+   /* The batches just flushed may still be running programs from the start
+    * of the BO, which new uploads would now overwrite without waiting.  Use
+    * a new BO instead unless the GPU is already done with this one.
+    */
+   if (cache->bo && cache->bo_used_by_gpu) {
+      if (drm_intel_bo_busy(cache->bo))
+         brw_cache_new_bo(cache, cache->bo->size);
+      else
+         cache->bo_used_by_gpu = false;
+   }
 }
 
 void
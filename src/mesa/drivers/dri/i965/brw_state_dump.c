@@ -492,9 +492,9 @@ dump_prog_cache(struct brw_context *brw)
    drm_intel_bo_map(brw->cache.bo, false);
 
    for (b = 0; b < cache->size; b++) {
-      struct brw_cache_item *item;
+      struct brw_cache_item *item = cache->items[b];
 
-      for (item = cache->items[b]; item; item = item->next) {
+      if (item) {
 	 const char *name;
 	 uint32_t offset = item->offset;
 
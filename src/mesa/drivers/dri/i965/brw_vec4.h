@@ -47,6 +47,9 @@ extern "C" {
 
 struct brw_vec4_compile {
    GLuint last_scratch; /**< measured in 32-byte (register size) units */
+
+   /** Scheduler's estimate of the cycles to run each block once. */
+   int estimated_cycles;
 };
 
 
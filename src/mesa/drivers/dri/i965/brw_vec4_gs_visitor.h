@@ -67,6 +67,14 @@ const unsigned *brw_gs_emit(struct brw_context *brw,
                             void *mem_ctx,
                             unsigned *final_assembly_size);
 
+const unsigned *brw_compile_gs_prog(struct brw_context *brw,
+                                    struct gl_shader_program *prog,
+                                    struct brw_geometry_program *gp,
+                                    const struct brw_gs_prog_key *key,
+                                    struct brw_gs_compile *c,
+                                    void *mem_ctx,
+                                    unsigned *program_size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
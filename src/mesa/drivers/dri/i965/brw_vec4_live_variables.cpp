@@ -111,46 +111,66 @@ vec4_live_variables::setup_def_use()
 }
 
 /**
- * The algorithm incrementally sets bits in liveout and livein,
- * propagating it through control flow.  It will eventually terminate
- * because it only ever adds bits, and stops when no bits are added in
- * a pass.
+ * Computes livein and liveout for each block.
+ *
+ * Liveness flows backwards through the program, so the blocks are visited
+ * from the end of the program, and a block is only revisited when the
+ * livein of one of its successors has grown.  This converges in a couple of
+ * visits per block for structured control flow, rather than requiring whole
+ * passes over every block until no bits change.
  */
 void
 vec4_live_variables::compute_live_variables()
 {
-   bool cont = true;
-
-   while (cont) {
-      cont = false;
-
-      for (int b = 0; b < cfg->num_blocks; b++) {
-	 /* Update livein */
-	 for (int i = 0; i < bitset_words; i++) {
-            BITSET_WORD new_livein = (bd[b].use[i] |
-                                      (bd[b].liveout[i] & ~bd[b].def[i]));
-            if (new_livein & ~bd[b].livein[i]) {
-               bd[b].livein[i] |= new_livein;
-               cont = true;
-	    }
-	 }
+   bblock_t **worklist = ralloc_array(mem_ctx, bblock_t *, cfg->num_blocks);
+   bool *in_worklist = ralloc_array(mem_ctx, bool, cfg->num_blocks);
+   int worklist_count = 0;
 
-	 /* Update liveout */
-	 foreach_list(block_node, &cfg->blocks[b]->children) {
-	    bblock_link *link = (bblock_link *)block_node;
-	    bblock_t *block = link->block;
-
-	    for (int i = 0; i < bitset_words; i++) {
-               BITSET_WORD new_liveout = (bd[block->block_num].livein[i] &
-                                          ~bd[b].liveout[i]);
-               if (new_liveout) {
-                  bd[b].liveout[i] |= new_liveout;
-		  cont = true;
-	       }
-	    }
-	 }
+   for (int b = 0; b < cfg->num_blocks; b++) {
+      worklist[worklist_count++] = cfg->blocks[b];
+      in_worklist[b] = true;
+   }
+
+   while (worklist_count > 0) {
+      bblock_t *block = worklist[--worklist_count];
+      int b = block->block_num;
+      bool livein_changed = false;
+
+      in_worklist[b] = false;
+
+      /* Update liveout */
+      foreach_list(child_node, &block->children) {
+         bblock_t *child = ((bblock_link *)child_node)->block;
+
+         for (int i = 0; i < bitset_words; i++)
+            bd[b].liveout[i] |= bd[child->block_num].livein[i];
+      }
+
+      /* Update livein */
+      for (int i = 0; i < bitset_words; i++) {
+         BITSET_WORD new_livein = (bd[b].use[i] |
+                                   (bd[b].liveout[i] & ~bd[b].def[i]));
+         if (new_livein & ~bd[b].livein[i]) {
+            bd[b].livein[i] |= new_livein;
+            livein_changed = true;
+         }
+      }
+
+      if (!livein_changed)
+         continue;
+
+      foreach_list(parent_node, &block->parents) {
+         bblock_t *parent = ((bblock_link *)parent_node)->block;
+
+         if (!in_worklist[parent->block_num]) {
+            worklist[worklist_count++] = parent;
+            in_worklist[parent->block_num] = true;
+         }
       }
    }
+
+   ralloc_free(worklist);
+   ralloc_free(in_worklist);
 }
 
 vec4_live_variables::vec4_live_variables(vec4_visitor *v, cfg_t *cfg)
@@ -250,16 +270,31 @@ vec4_visitor::calculate_live_intervals()
    vec4_live_variables livevars(this, &cfg);
 
    for (int b = 0; b < cfg.num_blocks; b++) {
-      for (int i = 0; i < livevars.num_vars; i++) {
-	 if (BITSET_TEST(livevars.bd[b].livein, i)) {
-	    start[i / 4] = MIN2(start[i / 4], cfg.blocks[b]->start_ip);
-	    end[i / 4] = MAX2(end[i / 4], cfg.blocks[b]->start_ip);
-	 }
+      int block_start = cfg.blocks[b]->start_ip;
+      int block_end = cfg.blocks[b]->end_ip;
+
+      /* Only a few channels are usually live across a block boundary, so
+       * walk the set bits rather than testing every channel.
+       */
+      for (int w = 0; w < livevars.bitset_words; w++) {
+         BITSET_WORD livein = livevars.bd[b].livein[w];
+         BITSET_WORD liveout = livevars.bd[b].liveout[w];
+
+         while (livein) {
+            int i = w * BITSET_WORDBITS + ffs(livein) - 1;
+            livein &= livein - 1;
+
+            start[i / 4] = MIN2(start[i / 4], block_start);
+            end[i / 4] = MAX2(end[i / 4], block_start);
+         }
 
-	 if (BITSET_TEST(livevars.bd[b].liveout, i)) {
-	    start[i / 4] = MIN2(start[i / 4], cfg.blocks[b]->end_ip);
-	    end[i / 4] = MAX2(end[i / 4], cfg.blocks[b]->end_ip);
-	 }
+         while (liveout) {
+            int i = w * BITSET_WORDBITS + ffs(liveout) - 1;
+            liveout &= liveout - 1;
+
+            start[i / 4] = MIN2(start[i / 4], block_end);
+            end[i / 4] = MAX2(end[i / 4], block_end);
+         }
       }
    }
 
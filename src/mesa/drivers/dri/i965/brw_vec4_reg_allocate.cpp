@@ -199,14 +199,11 @@ vec4_visitor::reg_allocate()
       assert(size >= 1 && size <= 2 &&
              "Register allocation relies on split_virtual_grfs().");
       ra_set_node_class(g, i, brw->vec4.classes[size - 1]);
-
-      for (int j = 0; j < i; j++) {
-	 if (virtual_grf_interferes(i, j)) {
-	    ra_add_node_interference(g, i, j);
-	 }
-      }
    }
 
+   ra_add_live_interval_interference(g, virtual_grf_count,
+                                     virtual_grf_start, virtual_grf_end);
+
    setup_payload_interference(g, first_payload_node, node_count);
 
    if (!ra_allocate_no_spills(g)) {
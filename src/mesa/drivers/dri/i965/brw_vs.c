@@ -196,30 +196,35 @@ brw_vs_prog_data_compare(const void *in_a, const void *in_b)
    return true;
 }
 
-static bool
-do_vs_prog(struct brw_context *brw,
-	   struct gl_shader_program *prog,
-	   struct brw_vertex_program *vp,
-	   struct brw_vs_prog_key *key)
+/**
+ * Compile the vertex program for the given key, without uploading the result
+ * to the program cache.
+ *
+ * Fills in \p c and \p prog_data, and returns the final assembly (allocated
+ * out of \p mem_ctx), or NULL on failure.
+ */
+const unsigned *
+brw_compile_vs_prog(struct brw_context *brw,
+                    struct gl_shader_program *prog,
+                    struct brw_vertex_program *vp,
+                    const struct brw_vs_prog_key *key,
+                    struct brw_vs_compile *c,
+                    struct brw_vs_prog_data *prog_data,
+                    void *mem_ctx,
+                    unsigned *program_size)
 {
-   GLuint program_size;
    const GLuint *program;
-   struct brw_vs_compile c;
-   struct brw_vs_prog_data prog_data;
-   void *mem_ctx;
    int i;
    struct gl_shader *vs = NULL;
 
    if (prog)
       vs = prog->_LinkedShaders[MESA_SHADER_VERTEX];
 
-   memset(&c, 0, sizeof(c));
-   memcpy(&c.key, key, sizeof(*key));
-   memset(&prog_data, 0, sizeof(prog_data));
+   memset(c, 0, sizeof(*c));
+   memcpy(&c->key, key, sizeof(*key));
+   memset(prog_data, 0, sizeof(*prog_data));
 
-   mem_ctx = ralloc_context(NULL);
-
-   c.vp = vp;
+   c->vp = vp;
 
    /* Allocate the references to the uniforms that will end up in the
     * prog_data associated with the compiled program, and which will be freed
@@ -239,26 +244,26 @@ do_vs_prog(struct brw_context *brw,
    /* vec4_visitor::setup_uniform_clipplane_values() also uploads user clip
     * planes as uniforms.
     */
-   param_count += c.key.base.nr_userclip_plane_consts * 4;
+   param_count += c->key.base.nr_userclip_plane_consts * 4;
 
-   prog_data.base.param = rzalloc_array(NULL, const float *, param_count);
-   prog_data.base.pull_param = rzalloc_array(NULL, const float *, param_count);
+   prog_data->base.param = rzalloc_array(NULL, const float *, param_count);
+   prog_data->base.pull_param = rzalloc_array(NULL, const float *, param_count);
 
    /* Setting nr_params here NOT to the size of the param and pull_param
     * arrays, but to the number of uniform components vec4_visitor
     * needs. vec4_visitor::setup_uniforms() will set it back to a proper value.
     */
-   prog_data.base.nr_params = ALIGN(param_count, 4) / 4;
+   prog_data->base.nr_params = ALIGN(param_count, 4) / 4;
    if (vs) {
-      prog_data.base.nr_params += vs->num_samplers;
+      prog_data->base.nr_params += vs->num_samplers;
    }
 
    GLbitfield64 outputs_written = vp->program.Base.OutputsWritten;
-   prog_data.inputs_read = vp->program.Base.InputsRead;
+   prog_data->inputs_read = vp->program.Base.InputsRead;
 
-   if (c.key.copy_edgeflag) {
+   if (c->key.copy_edgeflag) {
       outputs_written |= BITFIELD64_BIT(VARYING_SLOT_EDGE);
-      prog_data.inputs_read |= VERT_BIT_EDGEFLAG;
+      prog_data->inputs_read |= VERT_BIT_EDGEFLAG;
    }
 
    if (brw->gen < 6) {
@@ -269,7 +274,7 @@ do_vs_prog(struct brw_context *brw,
        * coords, which would be a pain to handle.
        */
       for (i = 0; i < 8; i++) {
-         if (c.key.point_coord_replace & (1 << i))
+         if (c->key.point_coord_replace & (1 << i))
             outputs_written |= BITFIELD64_BIT(VARYING_SLOT_TEX0 + i);
       }
 
@@ -284,21 +289,49 @@ do_vs_prog(struct brw_context *brw,
     * distance varying slots whenever clipping is enabled, even if the vertex
     * shader doesn't write to gl_ClipDistance.
     */
-   if (c.key.base.userclip_active) {
+   if (c->key.base.userclip_active) {
       outputs_written |= BITFIELD64_BIT(VARYING_SLOT_CLIP_DIST0);
       outputs_written |= BITFIELD64_BIT(VARYING_SLOT_CLIP_DIST1);
    }
 
-   brw_compute_vue_map(brw, &prog_data.base.vue_map, outputs_written);
+   brw_compute_vue_map(brw, &prog_data->base.vue_map, outputs_written);
 
    if (0) {
-      _mesa_fprint_program_opt(stdout, &c.vp->program.Base, PROG_PRINT_DEBUG,
+      _mesa_fprint_program_opt(stdout, &c->vp->program.Base, PROG_PRINT_DEBUG,
 			       true);
    }
 
    /* Emit GEN4 code.
     */
-   program = brw_vs_emit(brw, prog, &c, &prog_data, mem_ctx, &program_size);
+   program = brw_vs_emit(brw, prog, c, prog_data, mem_ctx, program_size);
+   if (program == NULL)
+      return NULL;
+
+   /* Scratch space is used for register spilling */
+   if (c->base.last_scratch) {
+      prog_data->base.total_scratch
+         = brw_get_scratch_size(c->base.last_scratch*REG_SIZE);
+   }
+
+   return program;
+}
+
+static bool
+do_vs_prog(struct brw_context *brw,
+	   struct gl_shader_program *prog,
+	   struct brw_vertex_program *vp,
+	   struct brw_vs_prog_key *key)
+{
+   GLuint program_size;
+   const GLuint *program;
+   struct brw_vs_compile c;
+   struct brw_vs_prog_data prog_data;
+   void *mem_ctx;
+
+   mem_ctx = ralloc_context(NULL);
+
+   program = brw_compile_vs_prog(brw, prog, vp, key, &c, &prog_data,
+                                 mem_ctx, &program_size);
    if (program == NULL) {
       ralloc_free(mem_ctx);
       return false;
@@ -310,9 +343,6 @@ do_vs_prog(struct brw_context *brw,
                  "Try reducing the number of live vec4 values to "
                  "improve performance.\n");
 
-      prog_data.base.total_scratch
-         = brw_get_scratch_size(c.base.last_scratch*REG_SIZE);
-
       brw_get_scratch_bo(brw, &brw->vs.base.scratch_bo,
 			 prog_data.base.total_scratch * brw->max_vs_threads);
    }
@@ -349,16 +379,14 @@ brw_vs_debug_recompile(struct brw_context *brw,
    perf_debug("Recompiling vertex shader for program %d\n", prog->Name);
 
    for (unsigned int i = 0; i < brw->cache.size; i++) {
-      for (c = brw->cache.items[i]; c; c = c->next) {
-         if (c->cache_id == BRW_VS_PROG) {
-            old_key = c->key;
+      c = brw->cache.items[i];
+      if (c && c->cache_id == BRW_VS_PROG) {
+         old_key = c->key;
 
-            if (old_key->base.program_string_id == key->base.program_string_id)
-               break;
-         }
+         if (old_key->base.program_string_id == key->base.program_string_id)
+            break;
       }
-      if (c)
-         break;
+      c = NULL;
    }
 
    if (!c) {
@@ -145,26 +145,27 @@ brw_wm_prog_data_free(const void *in_prog_data)
 }
 
 /**
- * All Mesa program -> GPU code generation goes through this function.
- * Depending on the instructions used (i.e. flow control instructions)
- * we'll use one of two code generators.
+ * Compile the fragment program for the given key, without uploading the
+ * result to the program cache.
+ *
+ * Fills in \p c, and returns the final assembly (allocated out of \p c),
+ * or NULL on failure.
  */
-bool do_wm_prog(struct brw_context *brw,
-		struct gl_shader_program *prog,
-		struct brw_fragment_program *fp,
-		struct brw_wm_prog_key *key)
+const unsigned *
+brw_compile_wm_prog(struct brw_context *brw,
+                    struct gl_shader_program *prog,
+                    struct brw_fragment_program *fp,
+                    const struct brw_wm_prog_key *key,
+                    struct brw_wm_compile *c,
+                    unsigned *program_size)
 {
    struct gl_context *ctx = &brw->ctx;
-   struct brw_wm_compile *c;
    const GLuint *program;
    struct gl_shader *fs = NULL;
-   GLuint program_size;
 
    if (prog)
       fs = prog->_LinkedShaders[MESA_SHADER_FRAGMENT];
 
-   c = rzalloc(NULL, struct brw_wm_compile);
-
    /* Allocate the references to the uniforms that will end up in the
     * prog_data associated with the compiled program, and which will be freed
     * by the state cache.
@@ -187,9 +188,38 @@ bool do_wm_prog(struct brw_context *brw,
                                            c->key.persample_shading,
                                            &fp->program);
 
-   program = brw_wm_fs_emit(brw, c, &fp->program, prog, &program_size);
+   program = brw_wm_fs_emit(brw, c, &fp->program, prog, program_size);
    if (program == NULL)
+      return NULL;
+
+   /* Scratch space is used for register spilling */
+   if (c->last_scratch)
+      c->prog_data.total_scratch = brw_get_scratch_size(c->last_scratch);
+
+   return program;
+}
+
+/**
+ * All Mesa program -> GPU code generation goes through this function.
+ * Depending on the instructions used (i.e. flow control instructions)
+ * we'll use one of two code generators.
+ */
+bool do_wm_prog(struct brw_context *brw,
+		struct gl_shader_program *prog,
+		struct brw_fragment_program *fp,
+		struct brw_wm_prog_key *key)
+{
+   struct brw_wm_compile *c;
+   const GLuint *program;
+   GLuint program_size;
+
+   c = rzalloc(NULL, struct brw_wm_compile);
+
+   program = brw_compile_wm_prog(brw, prog, fp, key, c, &program_size);
+   if (program == NULL) {
+      ralloc_free(c);
       return false;
+   }
 
    /* Scratch space is used for register spilling */
    if (c->last_scratch) {
@@ -197,8 +227,6 @@ bool do_wm_prog(struct brw_context *brw,
                  "Try reducing the number of live scalar values to "
                  "improve performance.\n");
 
-      c->prog_data.total_scratch = brw_get_scratch_size(c->last_scratch);
-
       brw_get_scratch_bo(brw, &brw->wm.base.scratch_bo,
 			 c->prog_data.total_scratch * brw->max_wm_threads);
    }
@@ -267,16 +295,14 @@ brw_wm_debug_recompile(struct brw_context *brw,
    perf_debug("Recompiling fragment shader for program %d\n", prog->Name);
 
    for (unsigned int i = 0; i < brw->cache.size; i++) {
-      for (c = brw->cache.items[i]; c; c = c->next) {
-         if (c->cache_id == BRW_WM_PROG) {
-            old_key = c->key;
+      c = brw->cache.items[i];
+      if (c && c->cache_id == BRW_WM_PROG) {
+         old_key = c->key;
 
-            if (old_key->program_string_id == key->program_string_id)
-               break;
-         }
+         if (old_key->program_string_id == key->program_string_id)
+            break;
       }
-      if (c)
-         break;
+      c = NULL;
    }
 
    if (!c) {
@@ -552,6 +578,95 @@ static void brw_wm_populate_key( struct brw_context *brw,
 }
 
 
+/**
+ * Takes the fields of \p key that depend only on GL state from \p seen, a
+ * key recently needed at draw time by some other program.
+ *
+ * The remaining fields depend on the program itself (which inputs it reads,
+ * which samplers it uses and so on), so they are left as guessed by
+ * brw_wm_setup_prog_key_for_precompile().
+ */
+void
+brw_wm_predict_prog_key(struct brw_wm_prog_key *key,
+                        const struct brw_wm_prog_key *seen)
+{
+   const GLuint iz_state_bits = (IZ_DEPTH_WRITE_ENABLE_BIT |
+                                 IZ_DEPTH_TEST_ENABLE_BIT |
+                                 IZ_STENCIL_WRITE_ENABLE_BIT |
+                                 IZ_STENCIL_TEST_ENABLE_BIT);
+
+   key->iz_lookup = ((key->iz_lookup & ~iz_state_bits) |
+                     (seen->iz_lookup & iz_state_bits));
+   key->stats_wm = seen->stats_wm;
+   key->flat_shade = seen->flat_shade;
+   key->persample_shading = seen->persample_shading;
+   key->nr_color_regions = seen->nr_color_regions;
+   key->replicate_alpha = seen->replicate_alpha;
+   key->clamp_fragment_color = seen->clamp_fragment_color;
+   key->line_aa = seen->line_aa;
+   key->high_quality_derivatives = seen->high_quality_derivatives;
+   key->alpha_test_func = seen->alpha_test_func;
+   key->alpha_test_ref = seen->alpha_test_ref;
+}
+
+/**
+ * Remembers the GL state of a key that had to be compiled at draw time, for
+ * predicting the keys of programs linked later.  The state moves to the
+ * front of the list, and the least recently missed one drops off the end
+ * when the list is full.
+ */
+static void
+brw_wm_remember_key(struct brw_context *brw, const struct brw_wm_prog_key *key)
+{
+   struct brw_wm_missed_state state;
+   unsigned i;
+
+   if (!brw->wm.missed_states) {
+      brw->wm.missed_states = ralloc_array(brw, struct brw_wm_missed_state,
+                                           BRW_WM_MISSED_STATES);
+   }
+
+   memset(&state, 0, sizeof(state));
+   brw_wm_predict_prog_key(&state.key, key);
+   state.misses = 1;
+
+   for (i = 0; i < brw->wm.num_missed_states; i++) {
+      if (memcmp(&brw->wm.missed_states[i].key, &state.key,
+                 sizeof(state.key)) == 0) {
+         state.misses += brw->wm.missed_states[i].misses;
+         break;
+      }
+   }
+
+   if (i == brw->wm.num_missed_states) {
+      if (brw->wm.num_missed_states < BRW_WM_MISSED_STATES)
+         brw->wm.num_missed_states++;
+      else
+         i--;
+   }
+
+   memmove(&brw->wm.missed_states[1], &brw->wm.missed_states[0],
+           i * sizeof(state));
+   brw->wm.missed_states[0] = state;
+}
+
+/**
+ * Returns the remembered GL state that missed the program cache most often,
+ * the most recent one on a tie, or NULL if nothing missed yet.
+ */
+const struct brw_wm_prog_key *
+brw_wm_likely_missed_state(const struct brw_context *brw)
+{
+   const struct brw_wm_missed_state *best = NULL;
+
+   for (unsigned i = 0; i < brw->wm.num_missed_states; i++) {
+      if (!best || brw->wm.missed_states[i].misses > best->misses)
+         best = &brw->wm.missed_states[i];
+   }
+
+   return best ? &best->key : NULL;
+}
+
 static void
 brw_upload_wm_prog(struct brw_context *brw)
 {
@@ -562,13 +677,34 @@ brw_upload_wm_prog(struct brw_context *brw)
 
    brw_wm_populate_key(brw, &key);
 
+   if (fp->prediction_pending) {
+      bool hit = memcmp(&fp->precompile_keys[1], &key, sizeof(key)) == 0;
+
+      brw->wm.prediction_history = (brw->wm.prediction_history << 1) | hit;
+      fp->prediction_pending = false;
+   }
+
    if (!brw_search_cache(&brw->cache, BRW_WM_PROG,
 			 &key, sizeof(key),
 			 &brw->wm.base.prog_offset, &brw->wm.prog_data)) {
+      if (fp->num_precompile_keys)
+         brw->wm.precompile_misses++;
+      brw_wm_remember_key(brw, &key);
+
       bool success = do_wm_prog(brw, ctx->Shader._CurrentFragmentProgram, fp,
 				&key);
       (void) success;
       assert(success);
+   } else {
+      /* Count only the first draw-time use of each precompiled key. */
+      for (unsigned i = 0; i < fp->num_precompile_keys; i++) {
+         if (!(fp->precompile_keys_used & (1 << i)) &&
+             memcmp(&fp->precompile_keys[i], &key, sizeof(key)) == 0) {
+            fp->precompile_keys_used |= 1 << i;
+            brw->wm.precompile_hits++;
+            break;
+         }
+      }
    }
    brw->wm.base.prog_data = &brw->wm.prog_data->base;
 }
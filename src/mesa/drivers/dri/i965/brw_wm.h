@@ -53,6 +53,19 @@
 #define IZ_STENCIL_TEST_ENABLE_BIT  0x20
 #define IZ_BIT_MAX                  0x40
 
+/**
+ * Number of distinct GL states that recently needed a draw-time FS compile
+ * remembered for predicting precompile keys.
+ */
+#define BRW_WM_MISSED_STATES 4
+
+/**
+ * Number of the last eight predicted keys that must have matched a
+ * program's first draw for brw_fs_precompile() to also compile the
+ * prediction, at the cost of a second FS compile at link time.
+ */
+#define BRW_WM_PREDICTION_MIN_HITS 2
+
 #define AA_NEVER     0
 #define AA_SOMETIMES 1
 #define AA_ALWAYS    2
@@ -80,6 +93,15 @@ struct brw_wm_prog_key {
    struct brw_sampler_prog_key_data tex;
 };
 
+/**
+ * The GL-state fields of draw-time keys that missed the program cache, and
+ * how many misses there were with that state.
+ */
+struct brw_wm_missed_state {
+   struct brw_wm_prog_key key;
+   unsigned misses;
+};
+
 struct brw_wm_compile {
    struct brw_wm_prog_key key;
    struct brw_wm_prog_data prog_data;
@@ -96,6 +118,15 @@ struct brw_wm_compile {
    GLuint runtime_check_aads_emit:1;
 
    GLuint last_scratch;
+
+   /**
+    * If set by the caller, the scheduler's latency model is run over the
+    * final SIMD8 and SIMD16 code and the results stored in
+    * estimated_cycles_8 and estimated_cycles_16.
+    */
+   bool estimate_cycles;
+   int estimated_cycles_8;
+   int estimated_cycles_16;
 };
 
 /**
@@ -113,7 +144,20 @@ GLboolean brw_link_shader(struct gl_context *ctx, struct gl_shader_program *prog
 struct gl_shader *brw_new_shader(struct gl_context *ctx, GLuint name, GLuint type);
 struct gl_shader_program *brw_new_shader_program(struct gl_context *ctx, GLuint name);
 
+void brw_wm_setup_prog_key_for_precompile(struct gl_context *ctx,
+                                          struct brw_wm_prog_key *key,
+                                          struct gl_fragment_program *fp);
+void brw_wm_predict_prog_key(struct brw_wm_prog_key *key,
+                             const struct brw_wm_prog_key *seen);
+const struct brw_wm_prog_key *
+brw_wm_likely_missed_state(const struct brw_context *brw);
 bool brw_color_buffer_write_enabled(struct brw_context *brw);
+const unsigned *brw_compile_wm_prog(struct brw_context *brw,
+                                    struct gl_shader_program *prog,
+                                    struct brw_fragment_program *fp,
+                                    const struct brw_wm_prog_key *key,
+                                    struct brw_wm_compile *c,
+                                    unsigned *program_size);
 bool do_wm_prog(struct brw_context *brw,
 		struct gl_shader_program *prog,
 		struct brw_fragment_program *fp,
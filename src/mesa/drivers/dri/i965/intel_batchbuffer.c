@@ -257,8 +257,9 @@ brw_finish_batch(struct brw_context *brw)
    }
 
    /* Mark that the current program cache BO has been used by the GPU.
-    * It will be reallocated if we need to put new programs in for the
-    * next batch.
+    * brw_clear_cache() will reallocate it rather than overwrite programs
+    * the GPU may still be executing, and so will the next upload on
+    * non-LLC parts, where writing to it would wait for the GPU.
     */
    brw->cache.bo_used_by_gpu = true;
 }
@@ -41,13 +41,14 @@
 #include "utils.h"
 #include "xmlpool.h"
 
-static const __DRIconfigOptionsExtension brw_config_options = {
+const __DRIconfigOptionsExtension brw_config_options = {
    .base = { __DRI_CONFIG_OPTIONS, 1 },
    .xml =
 DRI_CONF_BEGIN
    DRI_CONF_SECTION_PERFORMANCE
       DRI_CONF_VBLANK_MODE(DRI_CONF_VBLANK_ALWAYS_SYNC)
       DRI_CONF_MULTITHREAD_GLSL_COMPILER(0)
+      DRI_CONF_UPLOAD_BUFFER_SIZE(0)
 
       /* Options correspond to DRI_CONF_BO_REUSE_DISABLED,
        * DRI_CONF_BO_REUSE_ALL
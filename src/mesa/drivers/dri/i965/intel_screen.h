@@ -79,6 +79,8 @@ intelMakeCurrent(__DRIcontext * driContextPriv,
                  __DRIdrawable * driDrawPriv,
                  __DRIdrawable * driReadPriv);
 
+extern const __DRIconfigOptionsExtension brw_config_options;
+
 double get_time(void);
 void aub_dump_bmp(struct gl_context *ctx);
 
@@ -68,8 +68,11 @@ wrap_buffers(struct brw_context *brw, GLuint size)
 {
    intel_upload_finish(brw);
 
-   if (size < INTEL_UPLOAD_SIZE)
-      size = INTEL_UPLOAD_SIZE;
+   const GLuint min_size = brw->upload.bo_size ? brw->upload.bo_size
+                                               : INTEL_UPLOAD_SIZE;
+
+   if (size < min_size)
+      size = min_size;
 
    brw->upload.bo = drm_intel_bo_alloc(brw->bufmgr, "upload", size, 0);
    brw->upload.offset = 0;
@@ -37,11 +37,26 @@
  */
 
 
-/** Is the given buffer object currently mapped? */
+/** Is the given buffer object currently mapped by the GL user or by Mesa? */
 static inline GLboolean
-_mesa_bufferobj_mapped(const struct gl_buffer_object *obj)
+_mesa_bufferobj_mapped(const struct gl_buffer_object *obj,
+                       gl_map_buffer_index index)
 {
-   return obj->Pointer != NULL;
+   return obj->Mappings[index].Pointer != NULL;
+}
+
+/**
+ * Check whether the given buffer object is illegally mapped prior to
+ * drawing from (or reading back to) the buffer.
+ * Note that it's legal for a buffer to be mapped at draw/readback time
+ * if it was mapped persistently (See GL_ARB_buffer_storage spec).
+ * \return true if the buffer is illegally mapped, false otherwise
+ */
+static inline bool
+_mesa_check_disallowed_mapping(const struct gl_buffer_object *obj)
+{
+   return _mesa_bufferobj_mapped(obj, MAP_USER) &&
+          !(obj->Mappings[MAP_USER].AccessFlags & GL_MAP_PERSISTENT_BIT);
 }
 
 /**
@@ -72,6 +87,10 @@ _mesa_handle_bind_buffer_gen(struct gl_context *ctx,
 extern void
 _mesa_update_default_objects_buffer_objects(struct gl_context *ctx);
 
+extern void
+_mesa_buffer_unmap_all_mappings(struct gl_context *ctx,
+                                struct gl_buffer_object *bufObj);
+
 
 extern struct gl_buffer_object *
 _mesa_lookup_bufferobj(struct gl_context *ctx, GLuint buffer);
@@ -117,6 +136,10 @@ _mesa_GenBuffers(GLsizei n, GLuint * buffer);
 GLboolean GLAPIENTRY
 _mesa_IsBuffer(GLuint buffer);
 
+void GLAPIENTRY
+_mesa_BufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data,
+                    GLbitfield flags);
+
 void GLAPIENTRY
 _mesa_BufferData(GLenum target, GLsizeiptrARB size,
                  const GLvoid * data, GLenum usage);
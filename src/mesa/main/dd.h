@@ -572,6 +572,11 @@ struct dd_function_table {
    
    void (*DeleteBuffer)( struct gl_context *ctx, struct gl_buffer_object *obj );
 
+   /**
+    * Allocate the storage of \p obj.  obj->StorageFlags holds the
+    * GL_ARB_buffer_storage flags the storage must support; glBufferData
+    * asks for GL_MAP_READ_BIT, GL_MAP_WRITE_BIT and GL_DYNAMIC_STORAGE_BIT.
+    */
    GLboolean (*BufferData)(struct gl_context *ctx, GLenum target,
                            GLsizeiptrARB size, const GLvoid *data, GLenum usage,
                            struct gl_buffer_object *obj);
@@ -597,18 +602,23 @@ struct dd_function_table {
                               GLsizeiptr size );
 
    /* Returns pointer to the start of the mapped range.
-    * May return NULL if MESA_MAP_NOWAIT_BIT is set in access:
+    * May return NULL if MESA_MAP_NOWAIT_BIT is set in access.
+    * The mapping is stored in obj->Mappings[index]; the application's and
+    * Mesa's own mappings of a buffer may exist at the same time.
     */
    void * (*MapBufferRange)( struct gl_context *ctx, GLintptr offset,
                              GLsizeiptr length, GLbitfield access,
-                             struct gl_buffer_object *obj);
+                             struct gl_buffer_object *obj,
+                             gl_map_buffer_index index);
 
    void (*FlushMappedBufferRange)(struct gl_context *ctx,
                                   GLintptr offset, GLsizeiptr length,
-                                  struct gl_buffer_object *obj);
+                                  struct gl_buffer_object *obj,
+                                  gl_map_buffer_index index);
 
    GLboolean (*UnmapBuffer)( struct gl_context *ctx,
-			     struct gl_buffer_object *obj );
+			     struct gl_buffer_object *obj,
+                             gl_map_buffer_index index);
    /*@}*/
 
    /**
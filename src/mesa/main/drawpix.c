@@ -151,7 +151,7 @@ _mesa_DrawPixels( GLsizei width, GLsizei height,
                            "glDrawPixels(invalid PBO access)");
                goto end;
             }
-            if (_mesa_bufferobj_mapped(ctx->Unpack.BufferObj)) {
+            if (_mesa_check_disallowed_mapping(ctx->Unpack.BufferObj)) {
                /* buffer is mapped - that's an error */
                _mesa_error(ctx, GL_INVALID_OPERATION,
                            "glDrawPixels(PBO is mapped)");
@@ -335,7 +335,7 @@ _mesa_Bitmap( GLsizei width, GLsizei height,
                            "glBitmap(invalid PBO access)");
                return;
             }
-            if (_mesa_bufferobj_mapped(ctx->Unpack.BufferObj)) {
+            if (_mesa_check_disallowed_mapping(ctx->Unpack.BufferObj)) {
                /* buffer is mapped - that's an error */
                _mesa_error(ctx, GL_INVALID_OPERATION,
                            "glBitmap(PBO is mapped)");
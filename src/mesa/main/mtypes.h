@@ -1447,6 +1447,33 @@ struct gl_viewport_attrib
 /**
  * GL_ARB_vertex/pixel_buffer_object buffer object
  */
+/**
+ * Which of the mappings of a buffer object.  The application's mapping
+ * (glMapBuffer and glMapBufferRange) may be persistent, with
+ * GL_ARB_buffer_storage, and stay in place while Mesa maps the buffer
+ * for its own purposes, e.g. to read the indices of a draw call.
+ */
+typedef enum
+{
+   MAP_USER,
+   MAP_INTERNAL,
+
+   MAP_COUNT
+} gl_map_buffer_index;
+
+
+/**
+ * Fields describing a mapped buffer range.
+ */
+struct gl_buffer_mapping
+{
+   GLbitfield AccessFlags; /**< Mask of GL_MAP_x_BIT flags */
+   GLvoid *Pointer;        /**< User-space address of mapping */
+   GLintptr Offset;        /**< Mapped offset */
+   GLsizeiptr Length;      /**< Mapped length */
+};
+
+
 struct gl_buffer_object
 {
    _glthread_Mutex Mutex;
@@ -1454,15 +1481,11 @@ struct gl_buffer_object
    GLuint Name;
    GLchar *Label;       /**< GL_KHR_debug */
    GLenum Usage;        /**< GL_STREAM_DRAW_ARB, GL_STREAM_READ_ARB, etc. */
+   GLbitfield StorageFlags; /**< GL_MAP_PERSISTENT_BIT, etc. */
    GLsizeiptrARB Size;  /**< Size of buffer storage in bytes */
    GLubyte *Data;       /**< Location of storage either in RAM or VRAM. */
-   /** Fields describing a mapped buffer */
-   /*@{*/
-   GLbitfield AccessFlags; /**< Mask of GL_MAP_x_BIT flags */
-   GLvoid *Pointer;     /**< User-space address of mapping */
-   GLintptr Offset;     /**< Mapped offset */
-   GLsizeiptr Length;   /**< Mapped length */
-   /*@}*/
+   struct gl_buffer_mapping Mappings[MAP_COUNT];
+   GLboolean Immutable; /**< GL_ARB_buffer_storage */
    GLboolean DeletePending;   /**< true if buffer object is removed from the hash */
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
@@ -3409,6 +3432,7 @@ struct gl_extensions
    GLboolean ARB_arrays_of_arrays;
    GLboolean ARB_base_instance;
    GLboolean ARB_blend_func_extended;
+   GLboolean ARB_buffer_storage;
    GLboolean ARB_color_buffer_float;
    GLboolean ARB_conservative_depth;
    GLboolean ARB_depth_buffer_float;
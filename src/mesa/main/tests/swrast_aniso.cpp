@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file swrast_aniso.cpp
+ *
+ * Textures spans with the anisotropic (EWA) filter of swrast/s_texfilter.c
+ * from several threads at once, the way the band threads of s_triqueue.c
+ * do, and checks that every thread gets the same colors as a later
+ * single-threaded run.  The threads are released together so that they
+ * race on the first use of the filter weight table, which must therefore
+ * be the first anisotropic sampling in the process.
+ *
+ * The texture is a 16x16 mipmapped RGBA texture whose texels don't lie on
+ * a plane, so that the result depends on the filter weights.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c11/threads.h"
+
+extern "C" {
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "swrast/s_context.h"
+#include "swrast/s_span.h"
+#include "swrast/s_texfilter.h"
+}
+
+#define SIZE 16
+#define LEVELS 5
+#define SPAN 64
+#define NR_THREADS 8
+
+namespace {
+
+GLfloat texel_value(GLint i, GLint j, GLint level, GLint c)
+{
+   return ((i * 7 + j * 13 + level * 5 + c * 3) % 16) / 15.0f;
+}
+
+void
+fetch_texel(const struct swrast_texture_image *texImage,
+            GLint col, GLint row, GLint img, GLfloat *texelOut)
+{
+   (void) img;
+   for (unsigned c = 0; c < 4; c++)
+      texelOut[c] = texel_value(col, row, texImage->Base.Level, c);
+}
+
+class aniso;
+
+struct band {
+   aniso *test;
+   SWspan *span;
+   GLfloat rgba[SPAN][4];
+};
+
+class aniso : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void sample(SWspan *span, GLfloat rgba[][4]);
+
+   struct gl_context *ctx;
+   struct gl_texture_object tObj;
+   struct gl_sampler_object samp;
+   struct swrast_texture_image images[LEVELS];
+   texture_sample_func func;
+   GLfloat texcoords[SPAN][4];
+
+   mtx_t mutex;
+   cnd_t cond;
+   bool go;
+};
+
+void
+aniso::SetUp()
+{
+   ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+   ctx->Const.MaxTextureUnits = 1;
+   ctx->Const.MaxTextureLodBias = 16.0f;
+   ctx->Texture._EnabledCoordUnits = 1;
+   ctx->Texture.Unit[0]._Current = &tObj;
+
+   memset(&tObj, 0, sizeof(tObj));
+   tObj.Target = GL_TEXTURE_2D;
+   tObj.BaseLevel = 0;
+   tObj._MaxLevel = LEVELS - 1;
+   tObj._BaseComplete = GL_TRUE;
+   tObj._MipmapComplete = GL_TRUE;
+
+   memset(images, 0, sizeof(images));
+   for (unsigned l = 0; l < LEVELS; l++) {
+      struct swrast_texture_image *img = &images[l];
+      const GLuint size = SIZE >> l;
+
+      img->Base.Level = l;
+      img->Base._BaseFormat = GL_RGBA;
+      img->Base.Width = img->Base.Width2 = size;
+      img->Base.Height = img->Base.Height2 = size;
+      img->Base.Depth = img->Base.Depth2 = 1;
+      img->Base.WidthLog2 = img->Base.HeightLog2 = LEVELS - 1 - l;
+      img->_IsPowerOfTwo = GL_TRUE;
+      img->WidthScale = img->HeightScale = (GLfloat) size;
+      img->DepthScale = 1.0f;
+      img->FetchTexel = fetch_texel;
+      tObj.Image[0][l] = &img->Base;
+   }
+
+   memset(&samp, 0, sizeof(samp));
+   samp.WrapS = samp.WrapT = samp.WrapR = GL_REPEAT;
+   samp.MinFilter = GL_LINEAR_MIPMAP_LINEAR;
+   samp.MagFilter = GL_LINEAR;
+   samp.MinLod = -1000.0f;
+   samp.MaxLod = 1000.0f;
+   samp.MaxAnisotropy = 16.0f;
+
+   func = _swrast_choose_texture_sample_func(ctx, &tObj, &samp);
+   ASSERT_TRUE(func != NULL);
+
+   /* a quad seen at a grazing angle: each pixel covers four texels in s
+    * and one in t, and q changes along the span
+    */
+   for (unsigned i = 0; i < SPAN; i++) {
+      const GLfloat q = 1.0f + i / 128.0f;
+      texcoords[i][0] = (0.1f + i * 0.25f) / q;
+      texcoords[i][1] = 0.3f / q;
+      texcoords[i][2] = 0.0f;
+      texcoords[i][3] = 1.0f;
+   }
+
+   mtx_init(&mutex, mtx_plain);
+   cnd_init(&cond);
+   go = false;
+}
+
+void
+aniso::TearDown()
+{
+   cnd_destroy(&cond);
+   mtx_destroy(&mutex);
+   free(ctx);
+}
+
+/**
+ * Texture a span the way _swrast_texture_span() does, passing the span
+ * through the lambda pointer.
+ */
+void
+aniso::sample(SWspan *span, GLfloat rgba[][4])
+{
+   const GLuint attr = VARYING_SLOT_TEX0;
+
+   span->leftClip = 0;
+   span->attrStart[attr][0] = 0.1f;
+   span->attrStart[attr][1] = 0.3f;
+   span->attrStart[attr][3] = 1.0f;
+   span->attrStepX[attr][0] = 0.25f;
+   span->attrStepX[attr][3] = 1.0f / 128.0f;
+   span->attrStepY[attr][1] = 1.0f / SIZE;
+
+   func(ctx, &samp, &tObj, SPAN, texcoords, (const GLfloat *) span, rgba);
+}
+
+int
+band_main(void *data)
+{
+   struct band *b = (struct band *) data;
+   aniso *test = b->test;
+
+   mtx_lock(&test->mutex);
+   while (!test->go)
+      cnd_wait(&test->cond, &test->mutex);
+   mtx_unlock(&test->mutex);
+
+   test->sample(b->span, b->rgba);
+   return 0;
+}
+
+} /* anonymous namespace */
+
+TEST_F(aniso, threads_match_single_thread)
+{
+   static struct band bands[NR_THREADS];
+   thrd_t threads[NR_THREADS];
+   GLfloat expected[SPAN][4];
+
+   for (unsigned t = 0; t < NR_THREADS; t++) {
+      bands[t].test = this;
+      bands[t].span = (SWspan *) calloc(1, sizeof(SWspan));
+      ASSERT_EQ(thrd_success, thrd_create(&threads[t], band_main, &bands[t]));
+   }
+
+   mtx_lock(&mutex);
+   go = true;
+   cnd_broadcast(&cond);
+   mtx_unlock(&mutex);
+
+   for (unsigned t = 0; t < NR_THREADS; t++)
+      thrd_join(threads[t], NULL);
+
+   sample(bands[0].span, expected);
+
+   for (unsigned t = 0; t < NR_THREADS; t++) {
+      for (unsigned i = 0; i < SPAN; i++) {
+         for (unsigned c = 0; c < 4; c++) {
+            EXPECT_EQ(expected[i][c], bands[t].rgba[i][c])
+               << "thread " << t << ", pixel " << i << ", component " << c;
+         }
+      }
+      free(bands[t].span);
+   }
+}
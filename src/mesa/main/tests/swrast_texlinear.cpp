@@ -0,0 +1,229 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file swrast_texlinear.cpp
+ *
+ * Checks the span bilinear filtering of swrast/s_texlinear.c against
+ * values worked out by hand, for every supported format and wrap mode.
+ *
+ * The texture is a ramp: texel (i, j) has red 16 * i, green 32 * j, blue
+ * 255 - 16 * i and alpha 255 - 32 * j, stored with _mesa_pack_*_rgba_row().
+ * Bilinear filtering reproduces a linear function exactly, so between the
+ * outermost texel centers the result only depends on the coordinate, and
+ * the expected values in the tables below follow from u = s * size - 0.5.
+ * Span lengths that aren't multiples of four exercise both the vector and
+ * the scalar code.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "main/format_pack.h"
+#include "swrast/s_texlinear.h"
+}
+
+#define WIDTH 16
+#define HEIGHT 8
+
+namespace {
+
+/**
+ * A texture coordinate and the ramp value, in 0..255 units, that filtering
+ * at it gives with each wrap mode.
+ */
+struct coord {
+   float s;
+   float clamp_to_edge;
+   float repeat;
+};
+
+/* red = 16 * i */
+const coord s_coords[] = {
+   {  0.03125f,   0.0f,   0.0f },  /* center of the first texel */
+   {  0.25f,     56.0f,  56.0f },  /* u = 3.5 */
+   {  0.5f,     120.0f, 120.0f },  /* u = 7.5 */
+   {  0.53125f, 128.0f, 128.0f },  /* center of texel 8 */
+   {  0.1f,      17.6f,  17.6f },  /* u = 1.1 */
+   {  0.96875f, 240.0f, 240.0f },  /* center of the last texel */
+   {  0.0f,       0.0f, 120.0f },  /* halfway between texels 15 and 0 */
+   {  1.0f,     240.0f, 120.0f },
+   { -0.25f,      0.0f, 184.0f },  /* u = -4.5, texels 11 and 12 */
+   {  1.25f,    240.0f,  56.0f },  /* u = 19.5, texels 3 and 4 */
+   { -1.0f,       0.0f, 120.0f },
+};
+
+/* green = 32 * j */
+const coord t_coords[] = {
+   {  0.0625f,    0.0f,   0.0f },  /* center of the first texel */
+   {  0.5f,     112.0f, 112.0f },  /* v = 3.5 */
+   {  0.8125f,  192.0f, 192.0f },  /* center of texel 6 */
+   {  0.0f,       0.0f, 112.0f },  /* halfway between texels 7 and 0 */
+   {  1.5f,     224.0f, 112.0f },
+   { -0.1875f,    0.0f, 192.0f },  /* v = -2, center of texel 6 */
+};
+
+#define SPAN (ARRAY_SIZE(s_coords) * ARRAY_SIZE(t_coords))
+
+struct format_desc {
+   mesa_format format;
+   unsigned bytes;     /* per texel */
+   bool luminance;     /* red replicated to green and blue */
+   bool alpha;         /* else alpha reads as 1.0 */
+};
+
+const format_desc formats[] = {
+   { MESA_FORMAT_A8B8G8R8_UNORM, 4,  false, true },
+   { MESA_FORMAT_R8G8B8A8_UNORM, 4,  false, true },
+   { MESA_FORMAT_B8G8R8A8_UNORM, 4,  false, true },
+   { MESA_FORMAT_BGR_UNORM8,     3,  false, false },
+   { MESA_FORMAT_RGB_UNORM8,     3,  false, false },
+   { MESA_FORMAT_L_UNORM8,       1,  true,  false },
+   { MESA_FORMAT_RGBA_FLOAT32,   16, false, true },
+};
+
+class texlinear : public ::testing::Test {
+public:
+   virtual void SetUp();
+
+   void check(const format_desc &desc, GLenum wrap);
+
+   float texcoords[SPAN][4];
+   float expected[2][SPAN][4];   /* for GL_CLAMP_TO_EDGE and GL_REPEAT */
+};
+
+void
+texlinear::SetUp()
+{
+   unsigned n = 0;
+
+   for (unsigned j = 0; j < ARRAY_SIZE(t_coords); j++) {
+      for (unsigned i = 0; i < ARRAY_SIZE(s_coords); i++) {
+         const coord &s = s_coords[i];
+         const coord &t = t_coords[j];
+
+         texcoords[n][0] = s.s;
+         texcoords[n][1] = t.s;
+         texcoords[n][2] = 0.0f;
+         texcoords[n][3] = 1.0f;
+
+         expected[0][n][0] = s.clamp_to_edge;
+         expected[0][n][1] = t.clamp_to_edge;
+         expected[0][n][2] = 255.0f - s.clamp_to_edge;
+         expected[0][n][3] = 255.0f - t.clamp_to_edge;
+
+         expected[1][n][0] = s.repeat;
+         expected[1][n][1] = t.repeat;
+         expected[1][n][2] = 255.0f - s.repeat;
+         expected[1][n][3] = 255.0f - t.repeat;
+
+         n++;
+      }
+   }
+}
+
+void
+texlinear::check(const format_desc &desc, GLenum wrap)
+{
+   struct swrast_linear_image img;
+   GLubyte ubytes[WIDTH][4];
+   GLfloat floats[WIDTH][4];
+   GLfloat map[WIDTH * HEIGHT * 4];
+   const unsigned row_stride = WIDTH * desc.bytes;
+   float rgba[SPAN][4];
+
+   for (unsigned j = 0; j < HEIGHT; j++) {
+      for (unsigned i = 0; i < WIDTH; i++) {
+         ubytes[i][0] = 16 * i;
+         ubytes[i][1] = 32 * j;
+         ubytes[i][2] = 255 - 16 * i;
+         ubytes[i][3] = 255 - 32 * j;
+         for (unsigned c = 0; c < 4; c++)
+            floats[i][c] = ubytes[i][c] / 255.0f;
+      }
+
+      GLubyte *row = (GLubyte *) map + j * row_stride;
+      if (desc.format == MESA_FORMAT_RGBA_FLOAT32)
+         _mesa_pack_float_rgba_row(desc.format, WIDTH, floats, row);
+      else
+         _mesa_pack_ubyte_rgba_row(desc.format, WIDTH, ubytes, row);
+   }
+
+   img.map = (const GLubyte *) map;
+   img.rowStride = row_stride;
+   img.width = WIDTH;
+   img.height = HEIGHT;
+   img.format = desc.format;
+   img.wrapS = wrap;
+   img.wrapT = wrap;
+
+   ASSERT_TRUE(_swrast_linear_format_supported(desc.format));
+
+   const float (*want)[4] = expected[wrap == GL_REPEAT];
+
+   /* every span length up to SPAN, so every remainder is covered */
+   for (unsigned n = 1; n <= SPAN; n++) {
+      _swrast_sample_linear_2d_span(&img, n, texcoords, rgba);
+
+      for (unsigned i = 0; i < n; i++) {
+         const float red = want[i][0] / 255.0f;
+         const float value[4] = {
+            red,
+            desc.luminance ? red : want[i][1] / 255.0f,
+            desc.luminance ? red : want[i][2] / 255.0f,
+            desc.alpha ? want[i][3] / 255.0f : 1.0f
+         };
+
+         for (int c = 0; c < 4; c++) {
+            EXPECT_NEAR(value[c], rgba[i][c], 1e-5f)
+               << "format " << desc.format << " n " << n
+               << " s " << texcoords[i][0] << " t " << texcoords[i][1]
+               << " channel " << c;
+         }
+      }
+   }
+}
+
+} /* anonymous namespace */
+
+TEST_F(texlinear, repeat)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(formats); i++)
+      check(formats[i], GL_REPEAT);
+}
+
+TEST_F(texlinear, clamp_to_edge)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(formats); i++)
+      check(formats[i], GL_CLAMP_TO_EDGE);
+}
+
+TEST_F(texlinear, unsupported_format)
+{
+   EXPECT_FALSE(_swrast_linear_format_supported(MESA_FORMAT_RGBA_FLOAT16));
+   EXPECT_FALSE(_swrast_linear_format_supported(MESA_FORMAT_B5G6R5_UNORM));
+}
@@ -0,0 +1,268 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file tnl_sse.cpp
+ *
+ * Checks the SSE lighting and texgen of tnl/t_vb_sse.c against colors and
+ * reflection vectors worked out by hand.  The lights and normals are chosen
+ * so that every dot product is a simple fraction, and the shininess
+ * exponents are 1 and 2 so that the lookup tables are exact enough.
+ * Vertex counts that aren't multiples of four exercise the partially
+ * filled last iteration.
+ */
+
+#include <gtest/gtest.h>
+#include <math.h>
+
+extern "C" {
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "tnl/t_context.h"
+#include "tnl/t_vb_sse.h"
+}
+
+#ifdef __SSE__
+
+#define NR_CASES 8
+#define COUNT 11     /* vertex i uses case i % NR_CASES */
+#define NR_LIGHTS 2
+
+namespace {
+
+const tnl_sse_light lights[NR_LIGHTS] = {
+   {
+      { 0.0f, 0.0f, 1.0f },   /* VP */
+      { 0.0f, 0.0f, 1.0f },   /* h */
+      { { 0.1f, 0.1f, 0.1f }, { 0.05f, 0.0f, 0.0f } },
+      { { 0.5f, 0.25f, 1.0f }, { 0.2f, 0.4f, 0.6f } },
+      { { 0.2f, 0.4f, 0.8f }, { 0.5f, 0.5f, 0.5f } },
+   },
+   {
+      { 1.0f, 0.0f, 0.0f },
+      { 0.6f, 0.0f, 0.8f },
+      { { 0.0f, 0.1f, 0.0f }, { 0.0f, 0.0f, 0.1f } },
+      { { 0.4f, 0.4f, 0.4f }, { 0.1f, 0.2f, 0.3f } },
+      { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+   },
+};
+
+const GLfloat base[2][4] = {
+   { 0.1f, 0.2f, 0.3f, 0.75f },
+   { 0.0f, 0.1f, 0.2f, 0.5f },
+};
+
+/**
+ * A normal and the front and back colors it lights to.  Both sides get the
+ * base color and the ambient terms of both lights; the comments list the
+ * diffuse and specular dot products that add to it.
+ */
+struct light_case {
+   GLfloat normal[4];
+   GLfloat front[3];
+   GLfloat back[3];
+};
+
+const light_case light_cases[NR_CASES] = {
+   /* front: light 0 diffuse 1, specular 1 */
+   { { 0.0f, 0.0f, 1.0f, 0.0f },
+     { 0.9f, 1.05f, 2.2f }, { 0.05f, 0.1f, 0.3f } },
+   /* back: light 0 diffuse 1, specular 1; light 1 specular 0.8^2 */
+   { { 0.0f, 0.0f, -1.0f, 0.0f },
+     { 0.2f, 0.4f, 0.4f }, { 0.75f, 1.64f, 1.4f } },
+   /* front: light 0 diffuse 0.8, specular 0.8; light 1 diffuse 0.6,
+    * specular 1
+    */
+   { { 0.6f, 0.0f, 0.8f, 0.0f },
+     { 2.0f, 1.16f, 2.08f }, { 0.05f, 0.1f, 0.3f } },
+   /* back: light 1 diffuse 1, specular 0.6^2 */
+   { { -1.0f, 0.0f, 0.0f, 0.0f },
+     { 0.2f, 0.4f, 0.4f }, { 0.15f, 0.66f, 0.6f } },
+   /* perpendicular to both lights: ambient only */
+   { { 0.0f, 1.0f, 0.0f, 0.0f },
+     { 0.2f, 0.4f, 0.4f }, { 0.05f, 0.1f, 0.3f } },
+   /* front: light 0 diffuse 2, specular 2, past the end of the table */
+   { { 0.0f, 0.0f, 2.0f, 0.0f },
+     { 1.6f, 1.7f, 4.0f }, { 0.05f, 0.1f, 0.3f } },
+   /* front: light 0 diffuse 0.5, specular 0.5 */
+   { { 0.0f, 0.0f, 0.5f, 0.0f },
+     { 0.55f, 0.725f, 1.3f }, { 0.05f, 0.1f, 0.3f } },
+   /* back: light 0 diffuse 0.5, specular 0.5^2; light 1 specular 0.4^2 */
+   { { 0.0f, 0.0f, -0.5f, 0.0f },
+     { 0.2f, 0.4f, 0.4f }, { 0.275f, 0.585f, 0.725f } },
+};
+
+/**
+ * An eye coordinate and normal, and the reflection vector and sphere map
+ * scale of build_m3() for them.
+ */
+struct reflect_case {
+   GLfloat eye[4];
+   GLfloat normal[4];
+   GLfloat f[3];
+   GLfloat m;
+};
+
+const reflect_case reflect_cases[NR_CASES] = {
+   { { 0.0f, 0.0f, -5.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 0.0f },
+     { 0.0f, 0.0f, 1.0f }, 0.25f },
+   { { 3.0f, 0.0f, -4.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 0.0f },
+     { 0.6f, 0.0f, 0.8f }, 0.26352314f },    /* 0.5 / sqrt(3.6) */
+   { { 2.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 0.0f },
+     { -1.0f, 0.0f, 0.0f }, 0.35355339f },   /* 0.5 / sqrt(2) */
+   { { 0.0f, 0.0f, 7.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 0.0f },
+     { 0.0f, 0.0f, 1.0f }, 0.25f },
+   /* f = (0, 0, -1) makes the scale's denominator zero */
+   { { 0.0f, 0.0f, 2.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 0.0f },
+     { 0.0f, 0.0f, -1.0f }, 0.0f },
+   /* a zero-length eye vector isn't normalized */
+   { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 0.0f },
+     { 0.0f, 0.0f, 0.0f }, 0.5f },
+   { { 0.0f, 0.0f, -1.0f, 1.0f }, { 0.0f, 0.6f, 0.8f, 0.0f },
+     { 0.0f, 0.96f, 0.28f }, 0.3125f },
+   { { -4.0f, 0.0f, -3.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 0.0f },
+     { -0.8f, 0.0f, 0.6f }, 0.27950850f },   /* 0.5 / sqrt(3.2) */
+};
+
+class tnl_sse : public ::testing::Test {
+public:
+   virtual void SetUp();
+
+   void check_lighting(GLuint nstride, bool twoside);
+
+   GLfloat normals[COUNT][4];
+   tnl_shine_tab shine_tabs[2];
+   tnl_shine_tab *shine[2];
+};
+
+void
+tnl_sse::SetUp()
+{
+   for (unsigned i = 0; i < COUNT; i++)
+      COPY_4V(normals[i], light_cases[i % NR_CASES].normal);
+
+   /* the table of _mesa_validate_all_lighting_tables(), shininess 1 and 2 */
+   for (unsigned side = 0; side < 2; side++) {
+      shine_tabs[side].shininess = side ? 2.0f : 1.0f;
+      for (unsigned i = 0; i <= SHINE_TABLE_SIZE; i++) {
+         shine_tabs[side].tab[i] = powf(i / (float) (SHINE_TABLE_SIZE - 1),
+                                        shine_tabs[side].shininess);
+      }
+      shine[side] = &shine_tabs[side];
+   }
+}
+
+void
+tnl_sse::check_lighting(GLuint nstride, bool twoside)
+{
+   for (GLuint count = 1; count <= COUNT; count++) {
+      GLfloat F[COUNT + 1][4], B[COUNT + 1][4];
+
+      /* the element past the end must not be written */
+      F[count][0] = B[count][0] = -1.0f;
+
+      _tnl_sse_light_infinite(count, &normals[0][0], nstride,
+                              lights, NR_LIGHTS, base, shine,
+                              twoside, F, B);
+
+      for (GLuint j = 0; j < count; j++) {
+         const light_case &expected = light_cases[nstride ? j % NR_CASES : 0];
+
+         for (unsigned c = 0; c < 3; c++) {
+            EXPECT_NEAR(expected.front[c], F[j][c], 1e-5f)
+               << "count " << count << " vertex " << j << " channel " << c;
+            if (twoside) {
+               EXPECT_NEAR(expected.back[c], B[j][c], 1e-5f)
+                  << "count " << count << " vertex " << j << " channel " << c;
+            }
+         }
+         EXPECT_EQ(base[0][3], F[j][3]);
+         if (twoside) {
+            EXPECT_EQ(base[1][3], B[j][3]);
+         }
+      }
+
+      EXPECT_EQ(-1.0f, F[count][0]);
+      EXPECT_EQ(-1.0f, B[count][0]);
+   }
+}
+
+} /* anonymous namespace */
+
+TEST_F(tnl_sse, light_one_sided)
+{
+   check_lighting(4 * sizeof(GLfloat), false);
+}
+
+TEST_F(tnl_sse, light_two_sided)
+{
+   check_lighting(4 * sizeof(GLfloat), true);
+}
+
+TEST_F(tnl_sse, light_constant_normal)
+{
+   check_lighting(0, true);
+}
+
+TEST_F(tnl_sse, reflect)
+{
+   GLfloat eye[COUNT][4], normals[COUNT][4];
+
+   for (GLuint i = 0; i < COUNT; i++) {
+      COPY_4V(eye[i], reflect_cases[i % NR_CASES].eye);
+      COPY_4V(normals[i], reflect_cases[i % NR_CASES].normal);
+   }
+
+   for (GLuint count = 1; count <= COUNT; count++) {
+      GLfloat f[COUNT + 1][3], m[COUNT + 1];
+      GLfloat f4[COUNT][4];
+
+      m[count] = f[count][0] = -1.0f;
+
+      _tnl_sse_reflect(count, &eye[0][0], sizeof(eye[0]),
+                       &normals[0][0], sizeof(normals[0]),
+                       &f[0][0], sizeof(f[0]), m);
+      /* GL_REFLECTION_MAP writes straight into 4-component texcoords */
+      _tnl_sse_reflect(count, &eye[0][0], sizeof(eye[0]),
+                       &normals[0][0], sizeof(normals[0]),
+                       &f4[0][0], sizeof(f4[0]), NULL);
+
+      for (GLuint i = 0; i < count; i++) {
+         const reflect_case &expected = reflect_cases[i % NR_CASES];
+
+         for (unsigned c = 0; c < 3; c++) {
+            EXPECT_NEAR(expected.f[c], f[i][c], 1e-5f)
+               << "count " << count << " vertex " << i << " channel " << c;
+            EXPECT_EQ(f[i][c], f4[i][c]);
+         }
+         EXPECT_NEAR(expected.m, m[i], 1e-5f)
+            << "count " << count << " vertex " << i;
+      }
+
+      EXPECT_EQ(-1.0f, f[count][0]);
+      EXPECT_EQ(-1.0f, m[count]);
+   }
+}
+
+#endif /* __SSE__ */
@@ -0,0 +1,346 @@
+/*
+ * Copyright © 2014 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file ra_replay.c
+ *
+ * Replays interference graphs written by ra_dump_graph() through
+ * ra_allocate_no_spills() and reports how long each allocation took.
+ *
+ * Graphs are captured from any driver using the allocator by pointing
+ * MESA_RA_DUMP at a file, e.g. with brw_offline_compile:
+ *
+ *    MESA_RA_DUMP=/tmp/graphs.ra brw_offline_compile a.vert a.frag
+ *    ra_replay --iterations 20 /tmp/graphs.ra
+ *
+ * The graph is rebuilt before every iteration, since allocation consumes
+ * it, and only the allocation itself is timed.  The fastest iteration is
+ * reported, as with brw_offline_compile.
+ *
+ * Interference is re-added in node order, so adjacency lists may be in a
+ * different order than the driver built them in.  The graph is the same,
+ * but ra_simplify() may visit neighbors in another order, so the colors
+ * picked can differ from the driver's.
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "register_allocate.h"
+
+/** One graph from a dump file, in a form that can be rebuilt cheaply. */
+struct replay_graph {
+   struct ra_regs *regs;
+   unsigned int node_count;
+   unsigned int *node_class;
+   int *node_reg;
+
+   /** Edges as (a, b) pairs, each listed once. */
+   unsigned int *edges;
+   unsigned int edge_count;
+};
+
+static double
+get_time(void)
+{
+   struct timespec tp;
+
+   clock_gettime(CLOCK_MONOTONIC, &tp);
+
+   return tp.tv_sec + tp.tv_nsec / 1000000000.0;
+}
+
+static bool
+expect(FILE *f, const char *keyword)
+{
+   char word[16];
+
+   return fscanf(f, "%15s", word) == 1 && strcmp(word, keyword) == 0;
+}
+
+static bool
+read_uint(FILE *f, unsigned int *value)
+{
+   return fscanf(f, "%u", value) == 1;
+}
+
+/**
+ * Reads the next graph from f.  Returns false at the end of the file or
+ * on malformed input, setting *error in the latter case.
+ */
+static bool
+read_graph(void *mem_ctx, FILE *f, struct replay_graph *graph, bool *error)
+{
+   unsigned int reg_count, class_count, round_robin;
+   unsigned int **q;
+   unsigned int i, j, n, count, value;
+   char word[16];
+   int c;
+
+   *error = false;
+
+   c = fscanf(f, "%15s", word);
+   if (c == EOF)
+      return false;
+
+   *error = true;
+   if (c != 1 || strcmp(word, "ra_graph") != 0 ||
+       fscanf(f, "%u %u %u %u", &reg_count, &class_count,
+              &graph->node_count, &round_robin) != 4)
+      return false;
+
+   graph->regs = ra_alloc_reg_set(mem_ctx, reg_count);
+   if (round_robin)
+      ra_set_allocate_round_robin(graph->regs);
+
+   /* Register conflicts, up to the first class. */
+   for (;;) {
+      if (fscanf(f, "%15s", word) != 1)
+         return false;
+      if (strcmp(word, "class") == 0)
+         break;
+      if (strcmp(word, "reg") != 0 ||
+          !read_uint(f, &i) || !read_uint(f, &count) || i >= reg_count)
+         return false;
+
+      for (j = 0; j < count; j++) {
+         if (!read_uint(f, &value) || value >= reg_count)
+            return false;
+         ra_add_reg_conflict(graph->regs, i, value);
+      }
+   }
+
+   q = ralloc_array(mem_ctx, unsigned int *, class_count);
+   for (i = 0; i < class_count; i++) {
+      /* The "class" keyword of the first class was consumed above. */
+      if ((i > 0 && !expect(f, "class")) ||
+          !read_uint(f, &n) || n != i || !read_uint(f, &count))
+         return false;
+
+      if (ra_alloc_reg_class(graph->regs) != i)
+         return false;
+
+      for (j = 0; j < count; j++) {
+         if (!read_uint(f, &value) || value >= reg_count)
+            return false;
+         ra_class_add_reg(graph->regs, i, value);
+      }
+
+      if (!expect(f, "q") || !read_uint(f, &n) || n != i)
+         return false;
+
+      q[i] = ralloc_array(q, unsigned int, class_count);
+      for (j = 0; j < class_count; j++) {
+         if (!read_uint(f, &q[i][j]))
+            return false;
+      }
+   }
+   ra_set_finalize(graph->regs, q);
+   ralloc_free(q);
+
+   graph->node_class = ralloc_array(mem_ctx, unsigned int,
+                                    graph->node_count);
+   graph->node_reg = ralloc_array(mem_ctx, int, graph->node_count);
+   graph->edges = NULL;
+   graph->edge_count = 0;
+
+   unsigned int edge_size = 0;
+   for (i = 0; i < graph->node_count; i++) {
+      if (!expect(f, "node") || !read_uint(f, &n) || n != i ||
+          !read_uint(f, &graph->node_class[i]) ||
+          fscanf(f, "%d", &graph->node_reg[i]) != 1 ||
+          !read_uint(f, &count))
+         return false;
+
+      if (graph->node_class[i] >= class_count ||
+          graph->node_reg[i] >= (int) reg_count)
+         return false;
+
+      for (j = 0; j < count; j++) {
+         if (!read_uint(f, &value) || value <= i ||
+             value >= graph->node_count)
+            return false;
+
+         if (graph->edge_count == edge_size) {
+            edge_size = MAX2(edge_size * 2, 64);
+            graph->edges = reralloc(mem_ctx, graph->edges, unsigned int,
+                                    edge_size * 2);
+         }
+         graph->edges[graph->edge_count * 2] = i;
+         graph->edges[graph->edge_count * 2 + 1] = value;
+         graph->edge_count++;
+      }
+   }
+
+   if (!expect(f, "end"))
+      return false;
+
+   *error = false;
+   return true;
+}
+
+static struct ra_graph *
+build_graph(const struct replay_graph *graph)
+{
+   struct ra_graph *g = ra_alloc_interference_graph(graph->regs,
+                                                    graph->node_count);
+   unsigned int i;
+
+   for (i = 0; i < graph->node_count; i++) {
+      ra_set_node_class(g, i, graph->node_class[i]);
+      if (graph->node_reg[i] >= 0)
+         ra_set_node_reg(g, i, graph->node_reg[i]);
+   }
+
+   for (i = 0; i < graph->edge_count; i++) {
+      ra_add_node_interference(g, graph->edges[i * 2],
+                               graph->edges[i * 2 + 1]);
+   }
+
+   return g;
+}
+
+/**
+ * Allocates the graph the given number of times and returns the fastest
+ * time, setting *colored to whether allocation succeeded.
+ */
+static double
+replay_graph(const struct replay_graph *graph, int iterations,
+             bool *colored)
+{
+   double best = 0.0;
+   int i;
+
+   *colored = false;
+   for (i = 0; i < iterations; i++) {
+      struct ra_graph *g = build_graph(graph);
+
+      double start = get_time();
+      *colored = ra_allocate_no_spills(g);
+      double time = get_time() - start;
+
+      ralloc_free(g);
+
+      best = i == 0 ? time : MIN2(best, time);
+   }
+
+   return best;
+}
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [options] <dump file>...\n"
+           "\n"
+           "Replays graphs written with MESA_RA_DUMP=<dump file>.\n"
+           "\n"
+           "  --iterations <n>  allocate each graph n times, report the "
+           "fastest\n",
+           name);
+}
+
+static const struct option options[] = {
+   { "iterations", required_argument, NULL, 'n' },
+   { "help",       no_argument,       NULL, 'h' },
+   { NULL, 0, NULL, 0 }
+};
+
+int
+main(int argc, char **argv)
+{
+   int iterations = 1;
+   unsigned int graphs = 0, failed = 0;
+   double total = 0.0;
+   int opt, i;
+
+   while ((opt = getopt_long(argc, argv, "n:h", options, NULL)) != -1) {
+      switch (opt) {
+      case 'n':
+         iterations = MAX2(atoi(optarg), 1);
+         break;
+      default:
+         usage(argv[0]);
+         return opt == 'h' ? 0 : 1;
+      }
+   }
+
+   if (optind == argc) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   for (i = optind; i < argc; i++) {
+      FILE *f = fopen(argv[i], "r");
+      unsigned int index = 0;
+      struct replay_graph graph;
+      bool error;
+
+      if (!f) {
+         perror(argv[i]);
+         return 1;
+      }
+
+      for (;;) {
+         void *mem_ctx = ralloc_context(NULL);
+         bool colored;
+
+         if (!read_graph(mem_ctx, f, &graph, &error)) {
+            ralloc_free(mem_ctx);
+            break;
+         }
+
+         double time = replay_graph(&graph, iterations, &colored);
+
+         printf("%s:%u: %u nodes, %u edges: %s, %.3f ms\n", argv[i], index,
+                graph.node_count, graph.edge_count,
+                colored ? "colored" : "failed", time * 1000.0);
+
+         graphs++;
+         if (!colored)
+            failed++;
+         total += time;
+         index++;
+
+         ralloc_free(mem_ctx);
+      }
+
+      fclose(f);
+
+      if (error) {
+         fprintf(stderr, "%s: malformed graph %u\n", argv[i], index);
+         return 1;
+      }
+   }
+
+   printf("%u graphs, %u failed to color, %.3f ms total\n", graphs, failed,
+          total * 1000.0);
+
+   return 0;
+}
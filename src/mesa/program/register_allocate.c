@@ -71,8 +71,11 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <ralloc.h>
 
+#include "c11/threads.h"
+
 #include "main/imports.h"
 #include "main/macros.h"
 #include "main/mtypes.h"
@@ -141,6 +144,19 @@ struct ra_node {
     */
    GLboolean in_stack;
 
+   /** Set while the node is waiting in the ra_simplify() worklist. */
+   GLboolean in_worklist;
+
+   /**
+    * Sum of q(B,C) over the neighbors of this node that are still in the
+    * graph, where B is this node's class and C the neighbor's.
+    *
+    * Computed at the start of ra_simplify() and kept up to date as nodes
+    * are pushed on the stack, so that the pq test is O(1) instead of a walk
+    * of the adjacency list.
+    */
+   unsigned int q_total;
+
    /* For an implementation that needs register spilling, this is the
     * approximate cost of spilling this node.
     */
@@ -155,6 +171,12 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Adjacency bitsets for all nodes, allocated as a single block so that
+    * building a large graph doesn't cost one allocation per node.
+    */
+   BITSET_WORD *adjacency;
+
    unsigned int *stack;
    unsigned int stack_count;
 
@@ -364,9 +386,11 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 
    g->stack = rzalloc_array(g, unsigned int, count);
 
+   int bitset_count = BITSET_WORDS(count);
+   g->adjacency = rzalloc_array(g, BITSET_WORD, bitset_count * count);
+
    for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+      g->nodes[i].adjacency = &g->adjacency[i * bitset_count];
 
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
@@ -397,22 +421,91 @@ ra_add_node_interference(struct ra_graph *g,
    }
 }
 
-static GLboolean pq_test(struct ra_graph *g, unsigned int n)
+struct ra_interval {
+   int start;
+   unsigned int n;
+};
+
+static int
+ra_interval_compare(const void *a, const void *b)
 {
-   unsigned int j;
-   unsigned int q = 0;
-   int n_class = g->nodes[n].class;
+   const struct ra_interval *ia = a, *ib = b;
 
-   for (j = 0; j < g->nodes[n].adjacency_count; j++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[j];
-      unsigned int n2_class = g->nodes[n2].class;
+   if (ia->start != ib->start)
+      return ia->start < ib->start ? -1 : 1;
+   return ia->n < ib->n ? -1 : ia->n > ib->n;
+}
+
+/**
+ * Adds interference between every pair of nodes in [0, count) whose live
+ * intervals overlap, where node i is live from start[i] to end[i].  Two
+ * nodes interfere unless one interval ends at or before the other starts.
+ *
+ * This sorts the intervals and sweeps over them, keeping only the ones that
+ * are still live, so it is O(n log n + edges) rather than testing all n^2
+ * pairs.
+ */
+void
+ra_add_live_interval_interference(struct ra_graph *g, unsigned int count,
+                                  const int *start, const int *end)
+{
+   struct ra_interval *order = ralloc_array(g, struct ra_interval, count);
+   unsigned int *active = ralloc_array(g, unsigned int, count);
+   unsigned int active_count = 0;
+   unsigned int i, j;
+
+   for (i = 0; i < count; i++) {
+      order[i].start = start[i];
+      order[i].n = i;
+   }
+   qsort(order, count, sizeof(*order), ra_interval_compare);
+
+   for (i = 0; i < count; i++) {
+      unsigned int n = order[i].n;
+      unsigned int live = 0;
 
-      if (n != n2 && !g->nodes[n2].in_stack) {
-	 q += g->regs->classes[n_class]->q[n2_class];
+      /* Nothing that ends by the time n starts can interfere with n or with
+       * anything after it in the sort order, so drop those from the set.
+       */
+      for (j = 0; j < active_count; j++) {
+         unsigned int a = active[j];
+
+         if (end[a] <= start[n])
+            continue;
+
+         active[live++] = a;
+
+         if (start[a] < end[n])
+            ra_add_node_interference(g, n, a);
       }
+      active_count = live;
+
+      active[active_count++] = n;
    }
 
-   return q < g->regs->classes[n_class]->p;
+   ralloc_free(order);
+   ralloc_free(active);
+}
+
+static inline unsigned int
+pq_q(struct ra_graph *g, unsigned int n, unsigned int n2)
+{
+   return g->regs->classes[g->nodes[n].class]->q[g->nodes[n2].class];
+}
+
+static GLboolean pq_test(struct ra_graph *g, unsigned int n)
+{
+   int n_class = g->nodes[n].class;
+
+   return g->nodes[n].q_total < g->regs->classes[n_class]->p;
+}
+
+static void
+ra_simplify_add_to_worklist(struct ra_graph *g, unsigned int *worklist,
+                            unsigned int *worklist_count, unsigned int n)
+{
+   worklist[(*worklist_count)++] = n;
+   g->nodes[n].in_worklist = GL_TRUE;
 }
 
 /**
@@ -420,6 +513,11 @@ static GLboolean pq_test(struct ra_graph *g, unsigned int n)
  * trivially-colorable nodes into a stack of nodes to be colored,
  * removing them from the graph, and rinsing and repeating.
  *
+ * Rather than rescanning every node until nothing changes, this keeps a
+ * worklist: removing a node from the graph only lowers the q totals of its
+ * own neighbors, so those are the only nodes that can newly pass the pq
+ * test.
+ *
  * Returns GL_TRUE if all nodes were removed from the graph.  GL_FALSE
  * means that either spilling will be required, or optimistic coloring
  * should be applied.
@@ -427,31 +525,69 @@ static GLboolean pq_test(struct ra_graph *g, unsigned int n)
 GLboolean
 ra_simplify(struct ra_graph *g)
 {
-   GLboolean progress = GL_TRUE;
-   int i;
-
-   while (progress) {
-      progress = GL_FALSE;
+   unsigned int *worklist = ralloc_array(g, unsigned int, g->count);
+   unsigned int worklist_count = 0;
+   unsigned int remaining = 0;
+   unsigned int i, j;
+   int n;
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
+   for (i = 0; i < g->count; i++) {
+      g->nodes[i].q_total = 0;
+      for (j = 0; j < g->nodes[i].adjacency_count; j++) {
+         unsigned int n2 = g->nodes[i].adjacency_list[j];
 
-	 if (pq_test(g, i)) {
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = GL_TRUE;
-	    progress = GL_TRUE;
-	 }
+         if (n2 != i && !g->nodes[n2].in_stack)
+            g->nodes[i].q_total += pq_q(g, i, n2);
       }
    }
 
-   for (i = 0; i < g->count; i++) {
-      if (!g->nodes[i].in_stack && g->nodes[i].reg == -1)
-	 return GL_FALSE;
+   /* Seed the worklist from the highest node down, the order the old
+    * rescanning loop visited the nodes in.  The stack order isn't the same
+    * as that loop's, though: a node that only passes the pq test once an
+    * earlier one is removed gets queued behind all of the seeds instead of
+    * being pushed where the scan reached it, so the registers picked by
+    * ra_select() can differ.  Any order that only pushes trivially
+    * colorable nodes is a valid simplification.
+    */
+   for (n = g->count - 1; n >= 0; n--) {
+      if (g->nodes[n].in_stack || g->nodes[n].reg != NO_REG)
+         continue;
+
+      remaining++;
+      if (pq_test(g, n))
+         ra_simplify_add_to_worklist(g, worklist, &worklist_count, n);
    }
 
-   return GL_TRUE;
+   /* The worklist is filled from the highest node down, so consume it from
+    * the front to keep pushing nodes in that order.
+    */
+   for (i = 0; i < worklist_count; i++) {
+      unsigned int w = worklist[i];
+
+      g->nodes[w].in_worklist = GL_FALSE;
+      g->stack[g->stack_count] = w;
+      g->stack_count++;
+      g->nodes[w].in_stack = GL_TRUE;
+      remaining--;
+
+      for (j = 0; j < g->nodes[w].adjacency_count; j++) {
+         unsigned int n2 = g->nodes[w].adjacency_list[j];
+
+         if (n2 == w || g->nodes[n2].in_stack)
+            continue;
+
+         g->nodes[n2].q_total -= pq_q(g, n2, w);
+
+         if (g->nodes[n2].reg == NO_REG && !g->nodes[n2].in_worklist &&
+             pq_test(g, n2)) {
+            ra_simplify_add_to_worklist(g, worklist, &worklist_count, n2);
+         }
+      }
+   }
+
+   ralloc_free(worklist);
+
+   return remaining == 0;
 }
 
 /**
@@ -464,8 +600,10 @@ ra_simplify(struct ra_graph *g)
 GLboolean
 ra_select(struct ra_graph *g)
 {
-   int i;
+   unsigned int i, j;
    int start_search_reg = 0;
+   BITSET_WORD *conflicts =
+      ralloc_array(g, BITSET_WORD, BITSET_WORDS(g->regs->count));
 
    while (g->stack_count != 0) {
       unsigned int ri;
@@ -473,28 +611,36 @@ ra_select(struct ra_graph *g)
       int n = g->stack[g->stack_count - 1];
       struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
+      /* Gather the registers used by the colored neighbors up front, so
+       * that each candidate register is a single bit test instead of a walk
+       * of the adjacency list.
+       */
+      memset(conflicts, 0,
+             BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+      for (i = 0; i < g->nodes[n].adjacency_count; i++) {
+         unsigned int n2 = g->nodes[n].adjacency_list[i];
+         struct ra_reg *reg2;
+
+         if (g->nodes[n2].in_stack || g->nodes[n2].reg == NO_REG)
+            continue;
+
+         reg2 = &g->regs->regs[g->nodes[n2].reg];
+         for (j = 0; j < reg2->num_conflicts; j++)
+            BITSET_SET(conflicts, reg2->conflict_list[j]);
+      }
+
       /* Find the lowest-numbered reg which is not used by a member
        * of the graph adjacent to us.
        */
       for (ri = 0; ri < g->regs->count; ri++) {
          r = (start_search_reg + ri) % g->regs->count;
-	 if (!c->regs[r])
-	    continue;
-
-	 /* Check if any of our neighbors conflict with this register choice. */
-	 for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-	    unsigned int n2 = g->nodes[n].adjacency_list[i];
-
-	    if (!g->nodes[n2].in_stack &&
-		g->regs->regs[r].conflicts[g->nodes[n2].reg]) {
-	       break;
-	    }
-	 }
-	 if (i == g->nodes[n].adjacency_count)
+	 if (c->regs[r] && !BITSET_TEST(conflicts, r))
 	    break;
       }
-      if (ri == g->regs->count)
+      if (ri == g->regs->count) {
+         ralloc_free(conflicts);
 	 return GL_FALSE;
+      }
 
       g->nodes[n].reg = r;
       g->nodes[n].in_stack = GL_FALSE;
@@ -504,6 +650,7 @@ ra_select(struct ra_graph *g)
          start_search_reg = r + 1;
    }
 
+   ralloc_free(conflicts);
    return GL_TRUE;
 }
 
@@ -530,9 +677,102 @@ ra_optimistic_color(struct ra_graph *g)
    }
 }
 
+/**
+ * Writes the register set and interference graph in the text format read
+ * by ra_replay, so that an allocation can be timed outside of a driver:
+ *
+ *    ra_graph <regs> <classes> <nodes> <round robin>
+ *    reg <r> <count> <registers r conflicts with, other than itself>
+ *    class <c> <p> <registers in the class>
+ *    q <c> <q(c, C) for every class C>
+ *    node <n> <class> <fixed reg or -1> <count> <neighbors above n>
+ *    end
+ *
+ * Registers without conflicts are omitted.  The q values are written out
+ * rather than recomputed, so the replay uses exactly the same pq test.
+ */
+void
+ra_dump_graph(struct ra_graph *g, FILE *f)
+{
+   struct ra_regs *regs = g->regs;
+   unsigned int i, j, count;
+
+   fprintf(f, "ra_graph %u %u %u %d\n", regs->count, regs->class_count,
+           g->count, regs->round_robin);
+
+   for (i = 0; i < regs->count; i++) {
+      if (regs->regs[i].num_conflicts <= 1)
+         continue;
+
+      fprintf(f, "reg %u %u", i, regs->regs[i].num_conflicts - 1);
+      for (j = 0; j < regs->regs[i].num_conflicts; j++) {
+         if (regs->regs[i].conflict_list[j] != i)
+            fprintf(f, " %u", regs->regs[i].conflict_list[j]);
+      }
+      fprintf(f, "\n");
+   }
+
+   for (i = 0; i < regs->class_count; i++) {
+      fprintf(f, "class %u %u", i, regs->classes[i]->p);
+      for (j = 0; j < regs->count; j++) {
+         if (regs->classes[i]->regs[j])
+            fprintf(f, " %u", j);
+      }
+      fprintf(f, "\nq %u", i);
+      for (j = 0; j < regs->class_count; j++)
+         fprintf(f, " %u", regs->classes[i]->q[j]);
+      fprintf(f, "\n");
+   }
+
+   for (i = 0; i < g->count; i++) {
+      struct ra_node *n = &g->nodes[i];
+
+      count = 0;
+      for (j = 0; j < n->adjacency_count; j++) {
+         if (n->adjacency_list[j] > i)
+            count++;
+      }
+
+      fprintf(f, "node %u %u %d %u", i, n->class,
+              n->reg == NO_REG ? -1 : (int) n->reg, count);
+      for (j = 0; j < n->adjacency_count; j++) {
+         if (n->adjacency_list[j] > i)
+            fprintf(f, " %u", n->adjacency_list[j]);
+      }
+      fprintf(f, "\n");
+   }
+
+   fprintf(f, "end\n");
+}
+
+/**
+ * Appends the graph to the file named by MESA_RA_DUMP, if set.  Drivers
+ * may compile on several threads, so whole graphs are written under a lock.
+ */
+static void
+ra_dump_graph_if_requested(struct ra_graph *g)
+{
+   static mtx_t dump_lock = _MTX_INITIALIZER_NP;
+   const char *filename = getenv("MESA_RA_DUMP");
+   FILE *f;
+
+   if (likely(filename == NULL))
+      return;
+
+   mtx_lock(&dump_lock);
+   f = fopen(filename, "a");
+   if (f) {
+      ra_dump_graph(g, f);
+      fclose(f);
+   }
+   mtx_unlock(&dump_lock);
+}
+
 GLboolean
 ra_allocate_no_spills(struct ra_graph *g)
 {
+   ra_dump_graph_if_requested(g);
+
    if (!ra_simplify(g)) {
       ra_optimistic_color(g);
    }
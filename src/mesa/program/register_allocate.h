@@ -25,6 +25,8 @@
  *
  */
 
+#include <stdio.h>
+
 struct ra_class;
 struct ra_regs;
 
@@ -61,6 +63,8 @@ struct ra_graph *ra_alloc_interference_graph(struct ra_regs *regs,
 void ra_set_node_class(struct ra_graph *g, unsigned int n, unsigned int c);
 void ra_add_node_interference(struct ra_graph *g,
 			      unsigned int n1, unsigned int n2);
+void ra_add_live_interval_interference(struct ra_graph *g, unsigned int count,
+                                       const int *start, const int *end);
 /** @} */
 
 /** @{ Graph-coloring register allocation */
@@ -75,3 +79,7 @@ void ra_set_node_spill_cost(struct ra_graph *g, unsigned int n, float cost);
 int ra_get_best_spill_node(struct ra_graph *g);
 /** @} */
 
+/** @{ Debugging */
+void ra_dump_graph(struct ra_graph *g, FILE *f);
+/** @} */
+
@@ -109,6 +109,7 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
 		const struct st_config_options *options)
 {
    struct pipe_screen *screen = pipe->screen;
+   const unsigned upload_size = options->upload_buffer_size;
    uint i;
    struct st_context *st = ST_CALLOC_STRUCT( st_context );
    
@@ -131,19 +132,22 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    /* Create upload manager for vertex data for glBitmap, glDrawPixels,
     * glClear, etc.
     */
-   st->uploader = u_upload_create(st->pipe, 65536, 4, PIPE_BIND_VERTEX_BUFFER);
+   st->uploader = u_upload_create(st->pipe, upload_size ? upload_size : 65536,
+                                  4, PIPE_BIND_VERTEX_BUFFER);
 
    if (!screen->get_param(screen, PIPE_CAP_USER_INDEX_BUFFERS)) {
-      st->indexbuf_uploader = u_upload_create(st->pipe, 128 * 1024, 4,
-                                              PIPE_BIND_INDEX_BUFFER);
+      st->indexbuf_uploader =
+         u_upload_create(st->pipe, upload_size ? upload_size : 128 * 1024, 4,
+                         PIPE_BIND_INDEX_BUFFER);
    }
 
    if (!screen->get_param(screen, PIPE_CAP_USER_CONSTANT_BUFFERS)) {
       unsigned alignment =
          screen->get_param(screen, PIPE_CAP_CONSTANT_BUFFER_OFFSET_ALIGNMENT);
 
-      st->constbuf_uploader = u_upload_create(pipe, 128 * 1024, alignment,
-                                              PIPE_BIND_CONSTANT_BUFFER);
+      st->constbuf_uploader =
+         u_upload_create(pipe, upload_size ? upload_size : 128 * 1024,
+                         alignment, PIPE_BIND_CONSTANT_BUFFER);
    }
 
    st->cso_context = cso_create_context(pipe);
@@ -204,6 +208,11 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st_init_limits(st);
    st_init_extensions(st);
 
+   if (options->glsl_compiler_threads > 0) {
+      _mesa_enable_glsl_threadpool(ctx, options->glsl_compiler_threads > 1 ?
+                                   options->glsl_compiler_threads : 2);
+   }
+
    _mesa_compute_version(ctx);
 
    _mesa_initialize_dispatch_tables(ctx);
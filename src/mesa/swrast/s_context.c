@@ -41,6 +41,7 @@
 #include "s_span.h"
 #include "s_texfetch.h"
 #include "s_triangle.h"
+#include "s_triqueue.h"
 #include "s_texfilter.h"
 
 
@@ -338,14 +339,10 @@ _swrast_update_specular_vertex_add(struct gl_context *ctx)
 
 
 /**
- * Stub for swrast->Triangle to select a true triangle function
- * after a state change.
+ * Select a true triangle function after a state change.
  */
 static void
-_swrast_validate_triangle( struct gl_context *ctx,
-			   const SWvertex *v0,
-                           const SWvertex *v1,
-                           const SWvertex *v2 )
+_swrast_choose_triangle_func( struct gl_context *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
@@ -358,8 +355,21 @@ _swrast_validate_triangle( struct gl_context *ctx,
       swrast->SpecTriangle = swrast->Triangle;
       swrast->Triangle = _swrast_add_spec_terms_triangle;
    }
+}
 
-   swrast->Triangle( ctx, v0, v1, v2 );
+/**
+ * Stub for swrast->Triangle to select a true triangle function
+ * after a state change.
+ */
+static void
+_swrast_validate_triangle( struct gl_context *ctx,
+			   const SWvertex *v0,
+                           const SWvertex *v1,
+                           const SWvertex *v2 )
+{
+   _swrast_choose_triangle_func( ctx );
+
+   SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v2 );
 }
 
 /**
@@ -421,6 +431,37 @@ _swrast_validate_blend_func(struct gl_context *ctx, GLuint n, const GLubyte mask
    swrast->BlendFunc( ctx, n, mask, src, dst, chanType );
 }
 
+
+/**
+ * Resolve swrast->BlendFunc now instead of on the first blended span.
+ * The triangle queue calls this before handing spans to band threads,
+ * which would otherwise all race through _swrast_validate_blend_func().
+ */
+void
+_swrast_update_blend_func(struct gl_context *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct gl_framebuffer *fb = ctx->DrawBuffer;
+   GLuint buf;
+
+   if (swrast->BlendFunc != _swrast_validate_blend_func ||
+       !ctx->Color.BlendEnabled || ctx->Color.ColorLogicOpEnabled)
+      return;
+
+   /* Same choice the first blended span would make: the channel type of
+    * the first color buffer that has blending enabled.
+    */
+   for (buf = 0; buf < fb->_NumColorDrawBuffers; buf++) {
+      struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[buf];
+
+      if (rb && ((ctx->Color.BlendEnabled >> buf) & 1)) {
+         _swrast_validate_derived( ctx );
+         _swrast_choose_blend_func( ctx, swrast_renderbuffer(rb)->ColorType );
+         return;
+      }
+   }
+}
+
 static void
 _swrast_sleep( struct gl_context *ctx, GLbitfield new_state )
 {
@@ -598,6 +639,30 @@ _swrast_validate_derived( struct gl_context *ctx )
 
 #define SWRAST_DEBUG 0
 
+/**
+ * Draw a triangle, or queue it for drawing by several threads.
+ */
+static void
+draw_triangle( struct gl_context *ctx, const SWvertex *v0,
+               const SWvertex *v1, const SWvertex *v2 )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (swrast->TriQueue) {
+      /* The triangle function has to be chosen here, the rendering
+       * threads only ever call it.
+       */
+      if (swrast->Triangle == _swrast_validate_triangle)
+         _swrast_choose_triangle_func( ctx );
+
+      if (_swrast_queue_triangle( ctx, v0, v1, v2 ))
+         return;
+   }
+
+   swrast->Triangle( ctx, v0, v1, v2 );
+}
+
+
 /* Public entrypoints:  See also s_bitmap.c, etc.
  */
 void
@@ -612,8 +677,8 @@ _swrast_Quad( struct gl_context *ctx,
       _swrast_print_vertex( ctx, v2 );
       _swrast_print_vertex( ctx, v3 );
    }
-   SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v3 );
-   SWRAST_CONTEXT(ctx)->Triangle( ctx, v1, v2, v3 );
+   draw_triangle( ctx, v0, v1, v3 );
+   draw_triangle( ctx, v1, v2, v3 );
 }
 
 void
@@ -626,7 +691,7 @@ _swrast_Triangle( struct gl_context *ctx, const SWvertex *v0,
       _swrast_print_vertex( ctx, v1 );
       _swrast_print_vertex( ctx, v2 );
    }
-   SWRAST_CONTEXT(ctx)->Triangle( ctx, v0, v1, v2 );
+   draw_triangle( ctx, v0, v1, v2 );
 }
 
 void
@@ -637,6 +702,7 @@ _swrast_Line( struct gl_context *ctx, const SWvertex *v0, const SWvertex *v1 )
       _swrast_print_vertex( ctx, v0 );
       _swrast_print_vertex( ctx, v1 );
    }
+   _swrast_flush_tri_queue( ctx );
    SWRAST_CONTEXT(ctx)->Line( ctx, v0, v1 );
 }
 
@@ -647,6 +713,7 @@ _swrast_Point( struct gl_context *ctx, const SWvertex *v0 )
       _mesa_debug(ctx, "_swrast_Point\n");
       _swrast_print_vertex( ctx, v0 );
    }
+   _swrast_flush_tri_queue( ctx );
    SWRAST_CONTEXT(ctx)->Point( ctx, v0 );
 }
 
@@ -718,10 +785,11 @@ _swrast_CreateContext( struct gl_context *ctx )
 {
    GLuint i;
    SWcontext *swrast = calloc(1, sizeof(SWcontext));
+   const GLuint renderThreads = _swrast_num_render_threads();
 #ifdef _OPENMP
-   const GLuint maxThreads = omp_get_max_threads();
+   const GLuint maxThreads = MAX2(omp_get_max_threads(), renderThreads);
 #else
-   const GLuint maxThreads = 1;
+   const GLuint maxThreads = renderThreads;
 #endif
 
    assert(ctx->Const.MaxViewportWidth <= SWRAST_MAX_WIDTH);
@@ -777,6 +845,7 @@ _swrast_CreateContext( struct gl_context *ctx )
       free(swrast);
       return GL_FALSE;
    }
+   swrast->NumThreads = maxThreads;
    for(i = 0; i < maxThreads; i++) {
       swrast->SpanArrays[i].ChanType = CHAN_TYPE;
 #if CHAN_TYPE == GL_UNSIGNED_BYTE
@@ -813,6 +882,10 @@ _swrast_CreateContext( struct gl_context *ctx )
       return GL_FALSE;
    }
 
+   /* Without a queue, triangles are simply drawn on the calling thread. */
+   if (renderThreads > 1)
+      _swrast_create_tri_queue(ctx, renderThreads);
+
    return GL_TRUE;
 }
 
@@ -825,6 +898,8 @@ _swrast_DestroyContext( struct gl_context *ctx )
       _mesa_debug(ctx, "_swrast_DestroyContext\n");
    }
 
+   _swrast_destroy_tri_queue(ctx);
+
    free( swrast->SpanArrays );
    free( swrast->ZoomedArrays );
    free( swrast->TexelBuffer );
@@ -851,6 +926,8 @@ void
 _swrast_flush( struct gl_context *ctx )
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   /* draw any queued triangles */
+   _swrast_flush_tri_queue(ctx);
    /* flush any pending fragments from rendering points */
    if (swrast->PointSpan.end > 0) {
       _swrast_write_rgba_span(ctx, &(swrast->PointSpan));
@@ -894,6 +971,8 @@ _swrast_render_start( struct gl_context *ctx )
    if (swrast->Driver.SpanRenderStart)
       swrast->Driver.SpanRenderStart( ctx );
    swrast->PointSpan.end = 0;
+   if (swrast->TriQueue)
+      _swrast_tri_queue_begin( ctx );
 }
  
 void
@@ -902,6 +981,8 @@ _swrast_render_finish( struct gl_context *ctx )
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
 
    _swrast_flush(ctx);
+   if (swrast->TriQueue)
+      _swrast_tri_queue_end(ctx);
 
    if (swrast->Driver.SpanRenderFinish)
       swrast->Driver.SpanRenderFinish( ctx );
@@ -113,6 +113,7 @@ typedef void (*validate_texture_image_func)(struct gl_context *ctx,
 
 
 struct swrast_texture_image;
+struct swrast_tri_queue;
 
 
 /**
@@ -304,6 +305,12 @@ typedef struct
    SWspanarrays *SpanArrays;
    SWspanarrays *ZoomedArrays;  /**< For pixel zooming */
 
+   /** Number of SpanArrays instances, and of TexelBuffer slices */
+   GLuint NumThreads;
+
+   /** Triangles waiting to be drawn by several threads, see s_triqueue.c */
+   struct swrast_tri_queue *TriQueue;
+
    /**
     * Used to buffer N GL_POINTS, instead of rendering one by one.
     */
@@ -340,6 +347,9 @@ _swrast_validate_derived( struct gl_context *ctx );
 extern void
 _swrast_update_texture_samplers(struct gl_context *ctx);
 
+extern void
+_swrast_update_blend_func(struct gl_context *ctx);
+
 
 /** Return SWcontext for the given struct gl_context */
 static inline SWcontext *
@@ -45,15 +45,19 @@ typedef float (*float4_array)[4];
 
 /**
  * Return array of texels for given unit.
+ *
+ * Each thread drawing spans has its own SpanArrays instance and its own
+ * slice of TexelBuffer, so the slice is found from the span's arrays.
  */
 static inline float4_array
-get_texel_array(SWcontext *swrast, GLuint unit)
+get_texel_array(SWcontext *swrast, const SWspan *span, GLuint unit)
 {
-#ifdef _OPENMP
-   return (float4_array) (swrast->TexelBuffer + unit * SWRAST_MAX_WIDTH * 4 * omp_get_num_threads() + (SWRAST_MAX_WIDTH * 4 * omp_get_thread_num()));
-#else
-   return (float4_array) (swrast->TexelBuffer + unit * SWRAST_MAX_WIDTH * 4);
-#endif
+   const ptrdiff_t thread = span->array - swrast->SpanArrays;
+   const GLuint slice = (thread > 0 && thread < swrast->NumThreads) ? thread : 0;
+
+   return (float4_array) (swrast->TexelBuffer +
+                          (unit * swrast->NumThreads + slice) *
+                          SWRAST_MAX_WIDTH * 4);
 }
 
 
@@ -143,7 +147,7 @@ texture_combine( struct gl_context *ctx, GLuint unit,
 
       switch (srcRGB) {
          case GL_TEXTURE:
-            argRGB[term] = get_texel_array(swrast, unit);
+            argRGB[term] = get_texel_array(swrast, span, unit);
             break;
          case GL_PRIMARY_COLOR:
             argRGB[term] = primary_rgba;
@@ -191,7 +195,7 @@ texture_combine( struct gl_context *ctx, GLuint unit,
                ASSERT(srcUnit < ctx->Const.MaxTextureUnits);
                if (!ctx->Texture.Unit[srcUnit]._ReallyEnabled)
                   goto end;
-               argRGB[term] = get_texel_array(swrast, srcUnit);
+               argRGB[term] = get_texel_array(swrast, span, srcUnit);
             }
       }
 
@@ -239,7 +243,7 @@ texture_combine( struct gl_context *ctx, GLuint unit,
 
       switch (srcA) {
          case GL_TEXTURE:
-            argA[term] = get_texel_array(swrast, unit);
+            argA[term] = get_texel_array(swrast, span, unit);
             break;
          case GL_PRIMARY_COLOR:
             argA[term] = primary_rgba;
@@ -281,7 +285,7 @@ texture_combine( struct gl_context *ctx, GLuint unit,
                ASSERT(srcUnit < ctx->Const.MaxTextureUnits);
                if (!ctx->Texture.Unit[srcUnit]._ReallyEnabled)
                   goto end;
-               argA[term] = get_texel_array(swrast, srcUnit);
+               argA[term] = get_texel_array(swrast, span, srcUnit);
             }
       }
 
@@ -590,19 +594,16 @@ swizzle_texels(GLuint swizzle, GLuint count, float4_array texels)
 
 
 /**
- * Apply texture mapping to a span of fragments.
+ * Allocate swrast->TexelBuffer, with room for every thread, if that
+ * hasn't been done yet.
  */
-void
-_swrast_texture_span( struct gl_context *ctx, SWspan *span )
+GLboolean
+_swrast_alloc_texel_buffer(struct gl_context *ctx)
 {
    SWcontext *swrast = SWRAST_CONTEXT(ctx);
-   float4_array primary_rgba;
-   GLuint unit;
 
    if (!swrast->TexelBuffer) {
 #ifdef _OPENMP
-      const GLint maxThreads = omp_get_max_threads();
-
       /* TexelBuffer memory allocation needs to be done in a critical section
        * as this code runs in a parallel loop.
        * When entering the section, first check if TexelBuffer has been
@@ -610,8 +611,6 @@ _swrast_texture_span( struct gl_context *ctx, SWspan *span )
        */
       #pragma omp critical
       if (!swrast->TexelBuffer) {
-#else
-      const GLint maxThreads = 1;
 #endif
 
       /* TexelBuffer is also global and normally shared by all SWspan
@@ -619,18 +618,35 @@ _swrast_texture_span( struct gl_context *ctx, SWspan *span )
        * thread.
        */
       swrast->TexelBuffer =
-	 malloc(ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits * maxThreads *
-			    SWRAST_MAX_WIDTH * 4 * sizeof(GLfloat));
+	 malloc(ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits *
+                swrast->NumThreads * SWRAST_MAX_WIDTH * 4 * sizeof(GLfloat));
 #ifdef _OPENMP
       } /* critical section */
 #endif
 
       if (!swrast->TexelBuffer) {
 	 _mesa_error(ctx, GL_OUT_OF_MEMORY, "texture_combine");
-	 return;
+	 return GL_FALSE;
       }
    }
 
+   return GL_TRUE;
+}
+
+
+/**
+ * Apply texture mapping to a span of fragments.
+ */
+void
+_swrast_texture_span( struct gl_context *ctx, SWspan *span )
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   float4_array primary_rgba;
+   GLuint unit;
+
+   if (!_swrast_alloc_texel_buffer(ctx))
+      return;
+
    primary_rgba = malloc(span->end * 4 * sizeof(GLfloat));
 
    if (!primary_rgba) {
@@ -667,7 +683,7 @@ _swrast_texture_span( struct gl_context *ctx, SWspan *span )
 
          const struct gl_sampler_object *samp = _mesa_get_samplerobj(ctx, unit);
          GLfloat *lambda = span->array->lambda[unit];
-         float4_array texels = get_texel_array(swrast, unit);
+         float4_array texels = get_texel_array(swrast, span, unit);
          GLuint i;
          GLfloat rotMatrix00 = ctx->Texture.Unit[unit].RotMatrix[0];
          GLfloat rotMatrix01 = ctx->Texture.Unit[unit].RotMatrix[1];
@@ -730,7 +746,7 @@ _swrast_texture_span( struct gl_context *ctx, SWspan *span )
          const struct gl_texture_object *curObj = texUnit->_Current;
          const struct gl_sampler_object *samp = _mesa_get_samplerobj(ctx, unit);
          GLfloat *lambda = span->array->lambda[unit];
-         float4_array texels = get_texel_array(swrast, unit);
+         float4_array texels = get_texel_array(swrast, span, unit);
 
          /* adjust texture lod (lambda) */
          if (span->arrayMask & SPAN_LAMBDA) {
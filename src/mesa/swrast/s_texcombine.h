@@ -31,6 +31,9 @@
 
 struct gl_context;
 
+extern GLboolean
+_swrast_alloc_texel_buffer(struct gl_context *ctx);
+
 extern void
 _swrast_texture_span( struct gl_context *ctx, SWspan *span );
 
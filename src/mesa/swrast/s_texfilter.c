@@ -23,6 +23,7 @@
  */
 
 
+#include "c11/threads.h"
 #include "main/glheader.h"
 #include "main/context.h"
 #include "main/colormac.h"
@@ -32,6 +33,7 @@
 
 #include "s_context.h"
 #include "s_texfilter.h"
+#include "s_texlinear.h"
 
 
 /*
@@ -1242,6 +1244,45 @@ sample_2d_linear_repeat(struct gl_context *ctx,
 }
 
 
+/**
+ * Bilinear sampling of a run of texcoords which all use the same image.
+ * The span functions of s_texlinear.c are used if the image and sampler
+ * state allow it.
+ */
+static void
+sample_2d_linear_span(struct gl_context *ctx,
+                      const struct gl_sampler_object *samp,
+                      const struct gl_texture_image *img,
+                      GLuint n, const GLfloat texcoord[][4],
+                      GLfloat rgba[][4])
+{
+   const struct swrast_texture_image *swImg = swrast_texture_image_const(img);
+   struct swrast_linear_image image;
+   GLuint i;
+
+   if (_swrast_init_linear_image(&image, samp, img)) {
+      _swrast_sample_linear_2d_span(&image, n, texcoord, rgba);
+   }
+   else if (samp->WrapS == GL_REPEAT &&
+            samp->WrapT == GL_REPEAT &&
+            swImg->_IsPowerOfTwo &&
+            img->Border == 0) {
+      for (i = 0; i < n; i++) {
+         sample_2d_linear_repeat(ctx, samp, img, texcoord[i], rgba[i]);
+      }
+   }
+   else {
+      for (i = 0; i < n; i++) {
+         sample_2d_linear(ctx, samp, img, texcoord[i], rgba[i]);
+      }
+   }
+}
+
+
+/** Longest run of texcoords that sample_2d_linear_mipmap_linear() lerps */
+#define MAX_LINEAR_RUN 64
+
+
 static void
 sample_2d_nearest_mipmap_nearest(struct gl_context *ctx,
                                  const struct gl_sampler_object *samp,
@@ -1264,11 +1305,15 @@ sample_2d_linear_mipmap_nearest(struct gl_context *ctx,
                                 GLuint n, const GLfloat texcoord[][4],
                                 const GLfloat lambda[], GLfloat rgba[][4])
 {
-   GLuint i;
+   GLuint i, j;
    ASSERT(lambda != NULL);
-   for (i = 0; i < n; i++) {
-      GLint level = nearest_mipmap_level(tObj, lambda[i]);
-      sample_2d_linear(ctx, samp, tObj->Image[0][level], texcoord[i], rgba[i]);
+   /* sample the runs of texcoords with the same level together */
+   for (i = 0; i < n; i = j) {
+      const GLint level = nearest_mipmap_level(tObj, lambda[i]);
+      for (j = i + 1; j < n && nearest_mipmap_level(tObj, lambda[j]) == level; j++)
+         ;
+      sample_2d_linear_span(ctx, samp, tObj->Image[0][level], j - i,
+                            texcoord + i, rgba + i);
    }
 }
 
@@ -1306,50 +1351,27 @@ sample_2d_linear_mipmap_linear( struct gl_context *ctx,
                                 GLuint n, const GLfloat texcoord[][4],
                                 const GLfloat lambda[], GLfloat rgba[][4] )
 {
-   GLuint i;
+   GLuint i, j, k;
    ASSERT(lambda != NULL);
-   for (i = 0; i < n; i++) {
-      GLint level = linear_mipmap_level(tObj, lambda[i]);
+   /* sample the runs of texcoords with the same levels together */
+   for (i = 0; i < n; i = j) {
+      const GLint level = linear_mipmap_level(tObj, lambda[i]);
+      for (j = i + 1; j < n && j - i < MAX_LINEAR_RUN &&
+                      linear_mipmap_level(tObj, lambda[j]) == level; j++)
+         ;
       if (level >= tObj->_MaxLevel) {
-         sample_2d_linear(ctx, samp, tObj->Image[0][tObj->_MaxLevel],
-                          texcoord[i], rgba[i]);
+         sample_2d_linear_span(ctx, samp, tObj->Image[0][tObj->_MaxLevel],
+                               j - i, texcoord + i, rgba + i);
       }
       else {
-         GLfloat t0[4], t1[4];  /* texels */
-         const GLfloat f = FRAC(lambda[i]);
-         sample_2d_linear(ctx, samp, tObj->Image[0][level  ], texcoord[i], t0);
-         sample_2d_linear(ctx, samp, tObj->Image[0][level+1], texcoord[i], t1);
-         lerp_rgba(rgba[i], f, t0, t1);
-      }
-   }
-}
-
-
-static void
-sample_2d_linear_mipmap_linear_repeat(struct gl_context *ctx,
-                                      const struct gl_sampler_object *samp,
-                                      const struct gl_texture_object *tObj,
-                                      GLuint n, const GLfloat texcoord[][4],
-                                      const GLfloat lambda[], GLfloat rgba[][4])
-{
-   GLuint i;
-   ASSERT(lambda != NULL);
-   ASSERT(samp->WrapS == GL_REPEAT);
-   ASSERT(samp->WrapT == GL_REPEAT);
-   for (i = 0; i < n; i++) {
-      GLint level = linear_mipmap_level(tObj, lambda[i]);
-      if (level >= tObj->_MaxLevel) {
-         sample_2d_linear_repeat(ctx, samp, tObj->Image[0][tObj->_MaxLevel],
-                                 texcoord[i], rgba[i]);
-      }
-      else {
-         GLfloat t0[4], t1[4];  /* texels */
-         const GLfloat f = FRAC(lambda[i]);
-         sample_2d_linear_repeat(ctx, samp, tObj->Image[0][level  ],
-                                 texcoord[i], t0);
-         sample_2d_linear_repeat(ctx, samp, tObj->Image[0][level+1],
-                                 texcoord[i], t1);
-         lerp_rgba(rgba[i], f, t0, t1);
+         GLfloat t1[MAX_LINEAR_RUN][4];  /* texels of the next level */
+         sample_2d_linear_span(ctx, samp, tObj->Image[0][level  ],
+                               j - i, texcoord + i, rgba + i);
+         sample_2d_linear_span(ctx, samp, tObj->Image[0][level+1],
+                               j - i, texcoord + i, t1);
+         for (k = i; k < j; k++) {
+            lerp_rgba(rgba[k], FRAC(lambda[k]), rgba[k], t1[k - i]);
+         }
       }
    }
 }
@@ -1380,23 +1402,9 @@ sample_linear_2d(struct gl_context *ctx,
                  const GLfloat texcoords[][4],
                  const GLfloat lambda[], GLfloat rgba[][4])
 {
-   GLuint i;
-   struct gl_texture_image *image = tObj->Image[0][tObj->BaseLevel];
-   const struct swrast_texture_image *swImg = swrast_texture_image_const(image);
    (void) lambda;
-   if (samp->WrapS == GL_REPEAT &&
-       samp->WrapT == GL_REPEAT &&
-       swImg->_IsPowerOfTwo &&
-       image->Border == 0) {
-      for (i = 0; i < n; i++) {
-         sample_2d_linear_repeat(ctx, samp, image, texcoords[i], rgba[i]);
-      }
-   }
-   else {
-      for (i = 0; i < n; i++) {
-         sample_2d_linear(ctx, samp, image, texcoords[i], rgba[i]);
-      }
-   }
+   sample_2d_linear_span(ctx, samp, tObj->Image[0][tObj->BaseLevel],
+                         n, texcoords, rgba);
 }
 
 
@@ -1557,11 +1565,7 @@ sample_lambda_2d(struct gl_context *ctx,
                                          lambda + minStart, rgba + minStart);
          break;
       case GL_LINEAR_MIPMAP_LINEAR:
-         if (repeatNoBorderPOT)
-            sample_2d_linear_mipmap_linear_repeat(ctx, samp, tObj, m,
-                  texcoords + minStart, lambda + minStart, rgba + minStart);
-         else
-            sample_2d_linear_mipmap_linear(ctx, samp, tObj, m, texcoords + minStart,
+         sample_2d_linear_mipmap_linear(ctx, samp, tObj, m, texcoords + minStart,
                                         lambda + minStart, rgba + minStart);
          break;
       default:
@@ -1611,24 +1615,23 @@ sample_lambda_2d(struct gl_context *ctx,
 /* For anisotropic filtering */
 #define WEIGHT_LUT_SIZE 1024
 
-static GLfloat *weightLut = NULL;
+static GLfloat weightLut[WEIGHT_LUT_SIZE];
+static once_flag weightLutOnce = ONCE_FLAG_INIT;
 
 /**
- * Creates the look-up table used to speed-up EWA sampling
+ * Creates the look-up table used to speed-up EWA sampling.  Called through
+ * call_once, since spans can be textured from several threads.
  */
 static void
 create_filter_table(void)
 {
    GLuint i;
-   if (!weightLut) {
-      weightLut = malloc(WEIGHT_LUT_SIZE * sizeof(GLfloat));
 
-      for (i = 0; i < WEIGHT_LUT_SIZE; ++i) {
-         GLfloat alpha = 2;
-         GLfloat r2 = (GLfloat) i / (GLfloat) (WEIGHT_LUT_SIZE - 1);
-         GLfloat weight = (GLfloat) exp(-alpha * r2);
-         weightLut[i] = weight;
-      }
+   for (i = 0; i < WEIGHT_LUT_SIZE; ++i) {
+      GLfloat alpha = 2;
+      GLfloat r2 = (GLfloat) i / (GLfloat) (WEIGHT_LUT_SIZE - 1);
+      GLfloat weight = (GLfloat) exp(-alpha * r2);
+      weightLut[i] = weight;
    }
 }
 
@@ -1905,9 +1908,7 @@ sample_lambda_2d_aniso(struct gl_context *ctx,
    GLuint i;
    
    /* on first access create the lookup table containing the filter weights. */
-   if (!weightLut) {
-      create_filter_table();
-   }
+   call_once(&weightLutOnce, create_filter_table);
 
    texW = swImg->WidthScale;
    texH = swImg->HeightScale;
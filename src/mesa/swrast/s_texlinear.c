@@ -0,0 +1,462 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file s_texlinear.c
+ * Bilinear filtering of whole spans of 2D texture coordinates.
+ *
+ * The generic sampling code in s_texfilter.c handles one fragment at a
+ * time, and makes four indirect FetchTexel() calls per bilinear sample.
+ * For the most common formats, with no border and GL_REPEAT or
+ * GL_CLAMP_TO_EDGE wrapping, the functions here read the texels straight
+ * from the mapped image instead.  With SSE2, four fragments at a time
+ * have their texel locations and weights computed, and their channels
+ * interpolated, in vector registers.
+ *
+ * The results match FetchTexel() followed by lerp_rgba_2d(), apart from
+ * the rounding of the final division by 255.
+ */
+
+
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+
+#include "s_context.h"
+#include "s_texlinear.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * Where the 8-bit channels of a texel are, once its bytes are loaded into
+ * a GLuint by load_texel().
+ */
+struct ubyte_layout
+{
+   GLuint bytes;      /**< bytes per texel: 1, 3 or 4 */
+   GLint shift[4];    /**< of R, G, B and A, or -1 for a constant 1.0 */
+};
+
+static const struct ubyte_layout layout_a8b8g8r8 = { 4, { 24, 16, 8, 0 } };
+static const struct ubyte_layout layout_r8g8b8a8 = { 4, { 0, 8, 16, 24 } };
+static const struct ubyte_layout layout_b8g8r8a8 = { 4, { 16, 8, 0, 24 } };
+static const struct ubyte_layout layout_bgr888 = { 3, { 16, 8, 0, -1 } };
+static const struct ubyte_layout layout_rgb888 = { 3, { 0, 8, 16, -1 } };
+static const struct ubyte_layout layout_l8 = { 1, { 0, 0, 0, -1 } };
+
+
+static const struct ubyte_layout *
+get_ubyte_layout(mesa_format format)
+{
+   switch (format) {
+   case MESA_FORMAT_A8B8G8R8_UNORM:
+      return &layout_a8b8g8r8;
+   case MESA_FORMAT_R8G8B8A8_UNORM:
+      return &layout_r8g8b8a8;
+   case MESA_FORMAT_B8G8R8A8_UNORM:
+      return &layout_b8g8r8a8;
+   case MESA_FORMAT_BGR_UNORM8:
+      return &layout_bgr888;
+   case MESA_FORMAT_RGB_UNORM8:
+      return &layout_rgb888;
+   case MESA_FORMAT_L_UNORM8:
+      return &layout_l8;
+   default:
+      return NULL;
+   }
+}
+
+
+GLboolean
+_swrast_linear_format_supported(mesa_format format)
+{
+   return get_ubyte_layout(format) != NULL ||
+          format == MESA_FORMAT_RGBA_FLOAT32;
+}
+
+
+static GLboolean
+wrap_supported(GLenum wrap, GLint size)
+{
+   return wrap == GL_CLAMP_TO_EDGE ||
+          (wrap == GL_REPEAT && _mesa_is_pow_two(size));
+}
+
+
+/**
+ * Set up \p image for sampling \p img with _swrast_sample_linear_2d_span().
+ *
+ * \return GL_FALSE if the image or the sampler state isn't supported, in
+ *         which case the generic code has to be used.
+ */
+GLboolean
+_swrast_init_linear_image(struct swrast_linear_image *image,
+                          const struct gl_sampler_object *samp,
+                          const struct gl_texture_image *img)
+{
+   const struct swrast_texture_image *swImg = swrast_texture_image_const(img);
+
+   if (img->Border != 0 ||
+       !swImg->ImageSlices ||
+       !_swrast_linear_format_supported(img->TexFormat) ||
+       !wrap_supported(samp->WrapS, img->Width2) ||
+       !wrap_supported(samp->WrapT, img->Height2))
+      return GL_FALSE;
+
+   image->map = (const GLubyte *) swImg->ImageSlices[0];
+   image->rowStride = swImg->RowStride;
+   image->width = img->Width2;
+   image->height = img->Height2;
+   image->format = img->TexFormat;
+   image->wrapS = samp->WrapS;
+   image->wrapT = samp->WrapT;
+
+   return GL_TRUE;
+}
+
+
+static inline GLuint
+load_texel(const GLubyte *row, GLint i, GLuint bytes)
+{
+   switch (bytes) {
+   case 4:
+      return ((const GLuint *) row)[i];
+   case 3:
+      row += 3 * i;
+      return row[0] | (row[1] << 8) | (row[2] << 16);
+   default:
+      return row[i];
+   }
+}
+
+
+static inline GLfloat
+lerp_2d(GLfloat a, GLfloat b,
+        GLfloat v00, GLfloat v10, GLfloat v01, GLfloat v11)
+{
+   const GLfloat temp0 = v00 + a * (v10 - v00);
+   const GLfloat temp1 = v01 + a * (v11 - v01);
+   return temp0 + b * (temp1 - temp0);
+}
+
+
+/**
+ * Compute the two texel positions and the weight of the second one for a
+ * texture coordinate, like linear_texel_locations() in s_texfilter.c.
+ */
+static inline void
+linear_location(GLenum wrap, GLint size, GLfloat s,
+                GLint *i0, GLint *i1, GLfloat *weight)
+{
+   GLfloat u;
+   GLint i;
+
+   if (wrap == GL_CLAMP_TO_EDGE)
+      s = s > 0.0F ? (s < 1.0F ? s : 1.0F) : 0.0F;
+
+   u = s * size - 0.5F;
+   i = IFLOOR(u);
+   *weight = u - (GLfloat) i;
+
+   if (wrap == GL_REPEAT) {
+      *i0 = i & (size - 1);
+      *i1 = (i + 1) & (size - 1);
+   }
+   else {
+      *i0 = CLAMP(i, 0, size - 1);
+      *i1 = CLAMP(i + 1, 0, size - 1);
+   }
+}
+
+
+static void
+sample_ubyte_texel(const struct swrast_linear_image *image,
+                   const struct ubyte_layout *layout,
+                   const GLfloat texcoord[4], GLfloat rgba[4])
+{
+   GLint i0, i1, j0, j1;
+   GLfloat a, b;
+   const GLubyte *row0, *row1;
+   GLuint t00, t10, t01, t11;
+   GLuint c;
+
+   linear_location(image->wrapS, image->width, texcoord[0], &i0, &i1, &a);
+   linear_location(image->wrapT, image->height, texcoord[1], &j0, &j1, &b);
+
+   row0 = image->map + j0 * image->rowStride;
+   row1 = image->map + j1 * image->rowStride;
+   t00 = load_texel(row0, i0, layout->bytes);
+   t10 = load_texel(row0, i1, layout->bytes);
+   t01 = load_texel(row1, i0, layout->bytes);
+   t11 = load_texel(row1, i1, layout->bytes);
+
+   for (c = 0; c < 4; c++) {
+      const GLint shift = layout->shift[c];
+
+      if (shift < 0) {
+         rgba[c] = 1.0F;
+      }
+      else {
+         rgba[c] = lerp_2d(a, b,
+                           (GLfloat) ((t00 >> shift) & 0xff),
+                           (GLfloat) ((t10 >> shift) & 0xff),
+                           (GLfloat) ((t01 >> shift) & 0xff),
+                           (GLfloat) ((t11 >> shift) & 0xff)) *
+                   (1.0F / 255.0F);
+      }
+   }
+}
+
+
+static void
+sample_float_texel(const struct swrast_linear_image *image,
+                   const GLfloat texcoord[4], GLfloat rgba[4])
+{
+   GLint i0, i1, j0, j1;
+   GLfloat a, b;
+   const GLfloat *row0, *row1;
+   GLuint c;
+
+   linear_location(image->wrapS, image->width, texcoord[0], &i0, &i1, &a);
+   linear_location(image->wrapT, image->height, texcoord[1], &j0, &j1, &b);
+
+   row0 = (const GLfloat *) (image->map + j0 * image->rowStride);
+   row1 = (const GLfloat *) (image->map + j1 * image->rowStride);
+
+   for (c = 0; c < 4; c++) {
+      rgba[c] = lerp_2d(a, b,
+                        row0[4 * i0 + c], row0[4 * i1 + c],
+                        row1[4 * i0 + c], row1[4 * i1 + c]);
+   }
+}
+
+
+#ifdef __SSE2__
+
+/**
+ * linear_location() for four texture coordinates.
+ */
+static inline void
+linear_location_sse2(GLenum wrap, GLint size, __m128 s,
+                     __m128i *i0, __m128i *i1, __m128 *weight)
+{
+   const __m128 one = _mm_set1_ps(1.0F);
+   const __m128i ione = _mm_set1_epi32(1);
+   __m128 u, f, adjust;
+   __m128i i;
+
+   if (wrap == GL_CLAMP_TO_EDGE)
+      s = _mm_max_ps(_mm_min_ps(s, one), _mm_setzero_ps());
+
+   u = _mm_sub_ps(_mm_mul_ps(s, _mm_set1_ps((GLfloat) size)),
+                  _mm_set1_ps(0.5F));
+
+   /* Truncation rounds negative values up, so step those back down. */
+   i = _mm_cvttps_epi32(u);
+   f = _mm_cvtepi32_ps(i);
+   adjust = _mm_cmplt_ps(u, f);
+   i = _mm_add_epi32(i, _mm_castps_si128(adjust));
+   f = _mm_sub_ps(f, _mm_and_ps(adjust, one));
+   *weight = _mm_sub_ps(u, f);
+
+   if (wrap == GL_REPEAT) {
+      const __m128i mask = _mm_set1_epi32(size - 1);
+      *i0 = _mm_and_si128(i, mask);
+      *i1 = _mm_and_si128(_mm_add_epi32(i, ione), mask);
+   }
+   else {
+      /* s was clamped to [0, 1], so -1 <= i <= size - 1 */
+      const __m128i max = _mm_set1_epi32(size - 1);
+      __m128i next = _mm_add_epi32(i, ione);
+      *i0 = _mm_andnot_si128(_mm_srai_epi32(i, 31), i);
+      *i1 = _mm_add_epi32(next, _mm_cmpgt_epi32(next, max));
+   }
+}
+
+
+static inline __m128
+lerp_2d_sse2(__m128 a, __m128 b, __m128 v00, __m128 v10, __m128 v01, __m128 v11)
+{
+   const __m128 temp0 = _mm_add_ps(v00, _mm_mul_ps(a, _mm_sub_ps(v10, v00)));
+   const __m128 temp1 = _mm_add_ps(v01, _mm_mul_ps(a, _mm_sub_ps(v11, v01)));
+   return _mm_add_ps(temp0, _mm_mul_ps(b, _mm_sub_ps(temp1, temp0)));
+}
+
+
+static inline __m128
+ubyte_channel_sse2(__m128i texels, GLint shift)
+{
+   const __m128i c = _mm_srl_epi32(texels, _mm_cvtsi32_si128(shift));
+   return _mm_cvtepi32_ps(_mm_and_si128(c, _mm_set1_epi32(0xff)));
+}
+
+
+/**
+ * Compute the texel positions and weights of four fragments.
+ */
+static inline void
+linear_locations_4_sse2(const struct swrast_linear_image *image,
+                        const GLfloat texcoords[][4],
+                        GLint i0[4], GLint i1[4], GLint j0[4], GLint j1[4],
+                        __m128 *a, __m128 *b)
+{
+   const __m128 s = _mm_setr_ps(texcoords[0][0], texcoords[1][0],
+                                texcoords[2][0], texcoords[3][0]);
+   const __m128 t = _mm_setr_ps(texcoords[0][1], texcoords[1][1],
+                                texcoords[2][1], texcoords[3][1]);
+   __m128i vi0, vi1, vj0, vj1;
+
+   linear_location_sse2(image->wrapS, image->width, s, &vi0, &vi1, a);
+   linear_location_sse2(image->wrapT, image->height, t, &vj0, &vj1, b);
+
+   _mm_storeu_si128((__m128i *) i0, vi0);
+   _mm_storeu_si128((__m128i *) i1, vi1);
+   _mm_storeu_si128((__m128i *) j0, vj0);
+   _mm_storeu_si128((__m128i *) j1, vj1);
+}
+
+
+static void
+sample_ubyte_4_sse2(const struct swrast_linear_image *image,
+                    const struct ubyte_layout *layout,
+                    const GLfloat texcoords[][4], GLfloat rgba[][4])
+{
+   const __m128 scale = _mm_set1_ps(1.0F / 255.0F);
+   GLint i0[4], i1[4], j0[4], j1[4];
+   GLuint t00[4], t10[4], t01[4], t11[4];
+   __m128i v00, v10, v01, v11;
+   __m128 a, b, c[4];
+   GLuint k;
+
+   linear_locations_4_sse2(image, texcoords, i0, i1, j0, j1, &a, &b);
+
+   for (k = 0; k < 4; k++) {
+      const GLubyte *row0 = image->map + j0[k] * image->rowStride;
+      const GLubyte *row1 = image->map + j1[k] * image->rowStride;
+      t00[k] = load_texel(row0, i0[k], layout->bytes);
+      t10[k] = load_texel(row0, i1[k], layout->bytes);
+      t01[k] = load_texel(row1, i0[k], layout->bytes);
+      t11[k] = load_texel(row1, i1[k], layout->bytes);
+   }
+
+   v00 = _mm_loadu_si128((const __m128i *) t00);
+   v10 = _mm_loadu_si128((const __m128i *) t10);
+   v01 = _mm_loadu_si128((const __m128i *) t01);
+   v11 = _mm_loadu_si128((const __m128i *) t11);
+
+   for (k = 0; k < 4; k++) {
+      const GLint shift = layout->shift[k];
+
+      if (shift < 0) {
+         c[k] = _mm_set1_ps(1.0F);
+      }
+      else if (k > 0 && shift == layout->shift[k - 1]) {
+         c[k] = c[k - 1];
+      }
+      else {
+         c[k] = _mm_mul_ps(lerp_2d_sse2(a, b,
+                                        ubyte_channel_sse2(v00, shift),
+                                        ubyte_channel_sse2(v10, shift),
+                                        ubyte_channel_sse2(v01, shift),
+                                        ubyte_channel_sse2(v11, shift)),
+                           scale);
+      }
+   }
+
+   /* channels of four fragments -> four fragments of RGBA */
+   _MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+
+   _mm_storeu_ps(rgba[0], c[0]);
+   _mm_storeu_ps(rgba[1], c[1]);
+   _mm_storeu_ps(rgba[2], c[2]);
+   _mm_storeu_ps(rgba[3], c[3]);
+}
+
+
+static void
+sample_float_4_sse2(const struct swrast_linear_image *image,
+                    const GLfloat texcoords[][4], GLfloat rgba[][4])
+{
+   GLint i0[4], i1[4], j0[4], j1[4];
+   GLfloat wa[4], wb[4];
+   __m128 a, b;
+   GLuint k;
+
+   linear_locations_4_sse2(image, texcoords, i0, i1, j0, j1, &a, &b);
+   _mm_storeu_ps(wa, a);
+   _mm_storeu_ps(wb, b);
+
+   for (k = 0; k < 4; k++) {
+      const GLfloat *row0 =
+         (const GLfloat *) (image->map + j0[k] * image->rowStride);
+      const GLfloat *row1 =
+         (const GLfloat *) (image->map + j1[k] * image->rowStride);
+
+      _mm_storeu_ps(rgba[k],
+                    lerp_2d_sse2(_mm_set1_ps(wa[k]), _mm_set1_ps(wb[k]),
+                                 _mm_loadu_ps(row0 + 4 * i0[k]),
+                                 _mm_loadu_ps(row0 + 4 * i1[k]),
+                                 _mm_loadu_ps(row1 + 4 * i0[k]),
+                                 _mm_loadu_ps(row1 + 4 * i1[k])));
+   }
+}
+
+#endif /* __SSE2__ */
+
+
+/**
+ * Bilinear sampling of a span of 2D texture coordinates.
+ * \p image must have been set up by _swrast_init_linear_image().
+ */
+void
+_swrast_sample_linear_2d_span(const struct swrast_linear_image *image,
+                              GLuint n, const GLfloat texcoords[][4],
+                              GLfloat rgba[][4])
+{
+   const struct ubyte_layout *layout = get_ubyte_layout(image->format);
+   GLuint i = 0;
+
+   if (layout) {
+#ifdef __SSE2__
+      for (; i + 4 <= n; i += 4)
+         sample_ubyte_4_sse2(image, layout, texcoords + i, rgba + i);
+#endif
+      for (; i < n; i++)
+         sample_ubyte_texel(image, layout, texcoords[i], rgba[i]);
+   }
+   else {
+      ASSERT(image->format == MESA_FORMAT_RGBA_FLOAT32);
+#ifdef __SSE2__
+      for (; i + 4 <= n; i += 4)
+         sample_float_4_sse2(image, texcoords + i, rgba + i);
+#endif
+      for (; i < n; i++)
+         sample_float_texel(image, texcoords[i], rgba[i]);
+   }
+}
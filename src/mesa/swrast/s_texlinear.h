@@ -0,0 +1,64 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef S_TEXLINEAR_H
+#define S_TEXLINEAR_H
+
+
+#include "main/glheader.h"
+#include "main/formats.h"
+
+struct gl_sampler_object;
+struct gl_texture_image;
+
+
+/**
+ * A mapped 2D texture image, as seen by _swrast_sample_linear_2d_span().
+ */
+struct swrast_linear_image
+{
+   const GLubyte *map;   /**< first texel of the image */
+   GLint rowStride;      /**< in bytes */
+   GLint width, height;
+   mesa_format format;
+   GLenum wrapS, wrapT;  /**< GL_CLAMP_TO_EDGE, or GL_REPEAT for POT sizes */
+};
+
+
+extern GLboolean
+_swrast_linear_format_supported(mesa_format format);
+
+extern GLboolean
+_swrast_init_linear_image(struct swrast_linear_image *image,
+                          const struct gl_sampler_object *samp,
+                          const struct gl_texture_image *img);
+
+extern void
+_swrast_sample_linear_2d_span(const struct swrast_linear_image *image,
+                              GLuint n, const GLfloat texcoords[][4],
+                              GLfloat rgba[][4]);
+
+
+#endif
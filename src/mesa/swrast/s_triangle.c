@@ -143,7 +143,7 @@ _swrast_culltriangle( struct gl_context *ctx,
 
 #define RENDER_SPAN( span )						\
    GLuint i;								\
-   GLubyte (*rgba)[4] = swrast->SpanArrays->rgba8;			\
+   GLubyte (*rgba)[4] = span.array->rgba8;				\
    span.intTex[0] -= FIXED_HALF; /* off-by-one error? */		\
    span.intTex[1] -= FIXED_HALF;					\
    for (i = 0; i < span.end; i++) {					\
@@ -201,8 +201,8 @@ _swrast_culltriangle( struct gl_context *ctx,
 
 #define RENDER_SPAN( span )						\
    GLuint i;				    				\
-   GLubyte (*rgba)[4] = swrast->SpanArrays->rgba8;			\
-   GLubyte *mask = swrast->SpanArrays->mask;                            \
+   GLubyte (*rgba)[4] = span.array->rgba8;				\
+   GLubyte *mask = span.array->mask;                                    \
    span.intTex[0] -= FIXED_HALF; /* off-by-one error? */		\
    span.intTex[1] -= FIXED_HALF;					\
    for (i = 0; i < span.end; i++) {					\
@@ -918,6 +918,23 @@ nodraw_triangle( struct gl_context *ctx,
 }
 
 
+/**
+ * Add the secondary color of a vertex to its primary color.
+ */
+void
+_swrast_add_spec_terms_vertex(SWvertex *v)
+{
+   GLfloat rSum, gSum, bSum;
+
+   rSum = CHAN_TO_FLOAT(v->color[0]) + v->attrib[VARYING_SLOT_COL1][0];
+   gSum = CHAN_TO_FLOAT(v->color[1]) + v->attrib[VARYING_SLOT_COL1][1];
+   bSum = CHAN_TO_FLOAT(v->color[2]) + v->attrib[VARYING_SLOT_COL1][2];
+   UNCLAMPED_FLOAT_TO_CHAN(v->color[0], rSum);
+   UNCLAMPED_FLOAT_TO_CHAN(v->color[1], gSum);
+   UNCLAMPED_FLOAT_TO_CHAN(v->color[2], bSum);
+}
+
+
 /*
  * This is used when separate specular color is enabled, but not
  * texturing.  We add the specular color to the primary color,
@@ -931,34 +948,16 @@ _swrast_add_spec_terms_triangle(struct gl_context *ctx, const SWvertex *v0,
    SWvertex *ncv0 = (SWvertex *)v0; /* drop const qualifier */
    SWvertex *ncv1 = (SWvertex *)v1;
    SWvertex *ncv2 = (SWvertex *)v2;
-   GLfloat rSum, gSum, bSum;
    GLchan cSave[3][4];
 
    /* save original colors */
    COPY_CHAN4( cSave[0], ncv0->color );
    COPY_CHAN4( cSave[1], ncv1->color );
    COPY_CHAN4( cSave[2], ncv2->color );
-   /* sum v0 */
-   rSum = CHAN_TO_FLOAT(ncv0->color[0]) + ncv0->attrib[VARYING_SLOT_COL1][0];
-   gSum = CHAN_TO_FLOAT(ncv0->color[1]) + ncv0->attrib[VARYING_SLOT_COL1][1];
-   bSum = CHAN_TO_FLOAT(ncv0->color[2]) + ncv0->attrib[VARYING_SLOT_COL1][2];
-   UNCLAMPED_FLOAT_TO_CHAN(ncv0->color[0], rSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv0->color[1], gSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv0->color[2], bSum);
-   /* sum v1 */
-   rSum = CHAN_TO_FLOAT(ncv1->color[0]) + ncv1->attrib[VARYING_SLOT_COL1][0];
-   gSum = CHAN_TO_FLOAT(ncv1->color[1]) + ncv1->attrib[VARYING_SLOT_COL1][1];
-   bSum = CHAN_TO_FLOAT(ncv1->color[2]) + ncv1->attrib[VARYING_SLOT_COL1][2];
-   UNCLAMPED_FLOAT_TO_CHAN(ncv1->color[0], rSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv1->color[1], gSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv1->color[2], bSum);
-   /* sum v2 */
-   rSum = CHAN_TO_FLOAT(ncv2->color[0]) + ncv2->attrib[VARYING_SLOT_COL1][0];
-   gSum = CHAN_TO_FLOAT(ncv2->color[1]) + ncv2->attrib[VARYING_SLOT_COL1][1];
-   bSum = CHAN_TO_FLOAT(ncv2->color[2]) + ncv2->attrib[VARYING_SLOT_COL1][2];
-   UNCLAMPED_FLOAT_TO_CHAN(ncv2->color[0], rSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv2->color[1], gSum);
-   UNCLAMPED_FLOAT_TO_CHAN(ncv2->color[2], bSum);
+   /* sum */
+   _swrast_add_spec_terms_vertex( ncv0 );
+   _swrast_add_spec_terms_vertex( ncv1 );
+   _swrast_add_spec_terms_vertex( ncv2 );
    /* draw */
    SWRAST_CONTEXT(ctx)->SpecTriangle( ctx, ncv0, ncv1, ncv2 );
    /* restore original colors */
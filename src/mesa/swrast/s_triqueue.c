@@ -0,0 +1,359 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file s_triqueue.c
+ * Multithreaded triangle rasterization.
+ *
+ * With SWRAST_NUM_THREADS set to more than one, the triangles that
+ * _swrast_Triangle() receives between _swrast_render_start() and
+ * _swrast_render_finish() are copied into a queue instead of being drawn
+ * right away.  When the queue fills up, when a point or line comes along
+ * and at the end of rendering, every thread walks the whole queue and
+ * writes only the spans that fall into its own bands of rows (see
+ * struct swrast_band).  So texturing, fog, depth testing and blending in
+ * _swrast_write_rgba_span() run in parallel, and each pixel still sees the
+ * triangles in submission order.
+ *
+ * The GL state can't change while the renderbuffers are mapped, so one
+ * check at the first queued triangle decides whether the whole batch can
+ * be deferred.  Stencil and occlusion queries update shared scratch
+ * buffers and counters, fragment programs share one machine and smooth
+ * triangles already split their rows among OpenMP threads, so those are
+ * drawn directly.
+ */
+
+
+#include "c11/threads.h"
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "threadpool.h"
+
+#include "s_context.h"
+#include "s_texcombine.h"
+#include "s_triangle.h"
+#include "s_triqueue.h"
+
+
+/** Number of triangles queued before they're flushed. */
+#define SWRAST_TRI_QUEUE_SIZE 1024
+
+
+struct swrast_band_job
+{
+   struct gl_context *ctx;
+   struct swrast_band band;
+};
+
+
+struct swrast_tri_queue
+{
+   struct _mesa_threadpool *pool;
+   GLuint num_threads;
+
+   /** Set between _swrast_tri_queue_begin() and _swrast_tri_queue_end() */
+   GLboolean active;
+
+   /** swrast->Triangle when the first triangle of the batch was queued */
+   swrast_tri_func triangle;
+   /** Function the queued triangles are drawn with */
+   swrast_tri_func draw;
+   /** Whether the secondary color is added to the vertices when queued */
+   GLboolean add_spec;
+
+   SWvertex *verts;   /**< 3 per queued triangle */
+   GLuint count;      /**< number of queued triangles */
+
+   struct swrast_band_job jobs[SWRAST_MAX_THREADS];
+};
+
+
+static once_flag band_key_once = ONCE_FLAG_INIT;
+static tss_t band_key;
+
+static void
+create_band_key(void)
+{
+   tss_create(&band_key, NULL);
+}
+
+
+const struct swrast_band *
+_swrast_current_band(void)
+{
+   return (const struct swrast_band *) tss_get(band_key);
+}
+
+
+/**
+ * Number of threads to rasterize with, from the SWRAST_NUM_THREADS
+ * environment variable.
+ */
+GLuint
+_swrast_num_render_threads(void)
+{
+   const char *str = _mesa_getenv("SWRAST_NUM_THREADS");
+   int threads = str ? atoi(str) : 1;
+
+   return CLAMP(threads, 1, SWRAST_MAX_THREADS);
+}
+
+
+GLboolean
+_swrast_create_tri_queue(struct gl_context *ctx, GLuint num_threads)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_tri_queue *queue;
+   GLuint i;
+
+   ASSERT(num_threads > 1 && num_threads <= SWRAST_MAX_THREADS);
+   ASSERT(num_threads <= swrast->NumThreads);
+
+   call_once(&band_key_once, create_band_key);
+
+   queue = calloc(1, sizeof(*queue));
+   if (!queue)
+      return GL_FALSE;
+
+   queue->verts = malloc(SWRAST_TRI_QUEUE_SIZE * 3 * sizeof(SWvertex));
+   queue->pool = _mesa_threadpool_create(num_threads - 1);
+   if (!queue->verts || !queue->pool) {
+      if (queue->pool)
+         _mesa_threadpool_unref(queue->pool);
+      free(queue->verts);
+      free(queue);
+      return GL_FALSE;
+   }
+
+   queue->num_threads = num_threads;
+   for (i = 0; i < num_threads; i++) {
+      queue->jobs[i].ctx = ctx;
+      queue->jobs[i].band.index = i;
+      queue->jobs[i].band.count = num_threads;
+      queue->jobs[i].band.array = swrast->SpanArrays + i;
+   }
+
+   swrast->TriQueue = queue;
+
+   return GL_TRUE;
+}
+
+
+void
+_swrast_destroy_tri_queue(struct gl_context *ctx)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_tri_queue *queue = swrast->TriQueue;
+
+   if (!queue)
+      return;
+
+   _mesa_threadpool_unref(queue->pool);
+   free(queue->verts);
+   free(queue);
+
+   swrast->TriQueue = NULL;
+}
+
+
+/**
+ * Whether the current state lets triangles be drawn from several threads.
+ */
+static GLboolean
+can_defer_triangles(struct gl_context *ctx)
+{
+   const SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   return ctx->RenderMode == GL_RENDER &&
+          !ctx->Polygon.SmoothFlag &&
+          !ctx->Query.CurrentOcclusionObject &&
+          !(swrast->_RasterMask & (STENCIL_BIT |
+                                   FRAGPROG_BIT |
+                                   ATIFRAGSHADER_BIT));
+}
+
+
+/**
+ * Queue a triangle for drawing by the rendering threads.
+ *
+ * swrast->Triangle must have been validated.
+ *
+ * \return GL_FALSE if the triangle has to be drawn directly.
+ */
+GLboolean
+_swrast_queue_triangle(struct gl_context *ctx, const SWvertex *v0,
+                       const SWvertex *v1, const SWvertex *v2)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+   struct swrast_tri_queue *queue = swrast->TriQueue;
+   SWvertex *v;
+
+   if (!queue->active)
+      return GL_FALSE;
+
+   if (queue->count > 0 &&
+       (queue->count == SWRAST_TRI_QUEUE_SIZE ||
+        queue->triangle != swrast->Triangle))
+      _swrast_flush_tri_queue(ctx);
+
+   if (queue->count == 0) {
+      if (!can_defer_triangles(ctx))
+         return GL_FALSE;
+
+      /* _swrast_add_spec_terms_triangle() writes to the vertices, so do
+       * its work here on the copies instead.
+       */
+      queue->triangle = swrast->Triangle;
+      queue->add_spec = swrast->Triangle == _swrast_add_spec_terms_triangle;
+      queue->draw = queue->add_spec ? swrast->SpecTriangle : swrast->Triangle;
+   }
+
+   v = queue->verts + 3 * queue->count++;
+   v[0] = *v0;
+   v[1] = *v1;
+   v[2] = *v2;
+
+   if (queue->add_spec) {
+      _swrast_add_spec_terms_vertex(&v[0]);
+      _swrast_add_spec_terms_vertex(&v[1]);
+      _swrast_add_spec_terms_vertex(&v[2]);
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Whether any row covered by the triangle belongs to \p band.
+ */
+static GLboolean
+band_overlaps_triangle(const struct swrast_band *band, const SWvertex *v)
+{
+   const GLfloat y0 = v[0].attrib[VARYING_SLOT_POS][1];
+   const GLfloat y1 = v[1].attrib[VARYING_SLOT_POS][1];
+   const GLfloat y2 = v[2].attrib[VARYING_SLOT_POS][1];
+   const GLint yMin = MAX2(IFLOOR(MIN3(y0, y1, y2)), 0);
+   const GLint yMax = MAX2(IFLOOR(MAX3(y0, y1, y2)), 0);
+   const GLuint first = (GLuint) yMin >> SWRAST_BAND_SHIFT;
+   const GLuint last = (GLuint) yMax >> SWRAST_BAND_SHIFT;
+   GLuint b;
+
+   if (last - first + 1 >= band->count)
+      return GL_TRUE;
+
+   for (b = first; b <= last; b++) {
+      if (b % band->count == band->index)
+         return GL_TRUE;
+   }
+
+   return GL_FALSE;
+}
+
+
+static void
+render_band(struct swrast_band_job *job)
+{
+   struct gl_context *ctx = job->ctx;
+   const struct swrast_tri_queue *queue = SWRAST_CONTEXT(ctx)->TriQueue;
+   GLuint i;
+
+   tss_set(band_key, &job->band);
+
+   for (i = 0; i < queue->count; i++) {
+      const SWvertex *v = queue->verts + 3 * i;
+
+      if (band_overlaps_triangle(&job->band, v))
+         queue->draw(ctx, &v[0], &v[1], &v[2]);
+   }
+
+   tss_set(band_key, NULL);
+}
+
+
+static void
+render_band_task(void *data)
+{
+   render_band((struct swrast_band_job *) data);
+}
+
+
+/**
+ * Draw the queued triangles, and wait for them to be done.
+ */
+void
+_swrast_flush_tri_queue(struct gl_context *ctx)
+{
+   struct swrast_tri_queue *queue = SWRAST_CONTEXT(ctx)->TriQueue;
+   struct _mesa_threadpool_task *tasks[SWRAST_MAX_THREADS];
+   GLuint i;
+
+   if (!queue || queue->count == 0)
+      return;
+
+   /* Allocate the texel buffer before the threads race for it. */
+   if (ctx->Texture._EnabledCoordUnits && !_swrast_alloc_texel_buffer(ctx)) {
+      queue->count = 0;
+      return;
+   }
+
+   /* Likewise pick the blend function here rather than in every band. */
+   _swrast_update_blend_func(ctx);
+
+   for (i = 1; i < queue->num_threads; i++) {
+      tasks[i] = _mesa_threadpool_queue_task(queue->pool, render_band_task,
+                                             &queue->jobs[i]);
+   }
+
+   render_band(&queue->jobs[0]);
+
+   /* A band whose task couldn't be run is drawn here instead. */
+   for (i = 1; i < queue->num_threads; i++) {
+      if (!tasks[i] || !_mesa_threadpool_complete_task(queue->pool, tasks[i]))
+         render_band(&queue->jobs[i]);
+   }
+
+   queue->count = 0;
+}
+
+
+/** Called from _swrast_render_start() */
+void
+_swrast_tri_queue_begin(struct gl_context *ctx)
+{
+   SWRAST_CONTEXT(ctx)->TriQueue->active = GL_TRUE;
+}
+
+
+/** Called from _swrast_render_finish(), after the queue was flushed */
+void
+_swrast_tri_queue_end(struct gl_context *ctx)
+{
+   struct swrast_tri_queue *queue = SWRAST_CONTEXT(ctx)->TriQueue;
+
+   ASSERT(queue->count == 0);
+   queue->active = GL_FALSE;
+}
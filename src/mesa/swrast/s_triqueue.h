@@ -0,0 +1,96 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef S_TRIQUEUE_H
+#define S_TRIQUEUE_H
+
+
+#include "main/glheader.h"
+#include "swrast.h"
+#include "s_span.h"
+
+struct gl_context;
+
+
+/** Log2 of the height of the bands of rows handed out to the threads. */
+#define SWRAST_BAND_SHIFT 4
+
+/** Upper limit for SWRAST_NUM_THREADS. */
+#define SWRAST_MAX_THREADS 16
+
+
+/**
+ * The rows a rendering thread owns while it draws deferred triangles.
+ *
+ * Bands of (1 << SWRAST_BAND_SHIFT) rows are dealt out round-robin, so
+ * every pixel is written by exactly one thread, which draws the triangles
+ * in the order they were queued.
+ */
+struct swrast_band
+{
+   GLuint index;          /**< which band of each round this thread owns */
+   GLuint count;          /**< number of rendering threads */
+   SWspanarrays *array;   /**< this thread's span arrays */
+};
+
+
+/**
+ * Return the band the calling thread renders, or NULL if the caller isn't
+ * one of the threads flushing the triangle queue.
+ */
+extern const struct swrast_band *
+_swrast_current_band(void);
+
+static inline GLboolean
+_swrast_band_owns_row(const struct swrast_band *band, GLint y)
+{
+   return !band || ((GLuint) y >> SWRAST_BAND_SHIFT) % band->count == band->index;
+}
+
+
+extern GLuint
+_swrast_num_render_threads(void);
+
+extern GLboolean
+_swrast_create_tri_queue(struct gl_context *ctx, GLuint num_threads);
+
+extern void
+_swrast_destroy_tri_queue(struct gl_context *ctx);
+
+extern void
+_swrast_tri_queue_begin(struct gl_context *ctx);
+
+extern GLboolean
+_swrast_queue_triangle(struct gl_context *ctx, const SWvertex *v0,
+                       const SWvertex *v1, const SWvertex *v2);
+
+extern void
+_swrast_flush_tri_queue(struct gl_context *ctx);
+
+extern void
+_swrast_tri_queue_end(struct gl_context *ctx);
+
+
+#endif
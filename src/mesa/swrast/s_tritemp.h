@@ -91,6 +91,9 @@
  */
 
 
+#include "s_triqueue.h"
+
+
 /*
  * Some code we unfortunately need to prevent negative interpolated colors.
  */
@@ -140,12 +143,18 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
    GLfixed vMin_fx, vMin_fy, vMid_fx, vMid_fy, vMax_fx, vMax_fy;
 
    SWspan span;
+   const struct swrast_band *band;
 
    (void) swrast;
 
    INIT_SPAN(span, GL_POLYGON);
    span.y = 0; /* silence warnings */
 
+   /* When drawing queued triangles, only this thread's rows are written. */
+   band = swrast->TriQueue ? _swrast_current_band() : NULL;
+   if (band)
+      span.array = band->array;
+
 #ifdef INTERP_Z
    (void) fixedToDepthShift;
 #endif
@@ -804,7 +813,8 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
                /* XXX the test for span.y > 0 _shouldn't_ be needed but
                 * it fixes a problem on 64-bit Opterons (bug 4842).
                 */
-               if (span.end > 0 && span.y >= 0) {
+               if (span.end > 0 && span.y >= 0 &&
+                   _swrast_band_owns_row(band, span.y)) {
                   const GLint len = span.end - 1;
                   (void) len;
 #ifdef INTERP_RGB
@@ -36,6 +36,7 @@
 
 #include "t_context.h"
 #include "t_pipeline.h"
+#include "t_vb_sse.h"
 #include "tnl.h"
 
 #define LIGHT_TWOSIDE       0x1
@@ -308,6 +309,85 @@ static light_func _tnl_light_spec_tab[MAX_LIGHT_FUNC];
 #include "t_vb_lighttmp.h"
 
 
+#ifdef __SSE__
+
+/* Fast lighting with infinite lights and viewer, four vertices at a time.
+ * GL_COLOR_MATERIAL changes the material per vertex, so it's left to the
+ * C code.
+ */
+static void light_fast_rgba_sse( struct gl_context *ctx,
+				 struct vertex_buffer *VB,
+				 struct tnl_pipeline_stage *stage,
+				 GLboolean twoside )
+{
+   struct light_stage_data *store = LIGHT_STAGE_DATA(stage);
+   struct tnl_sse_light lights[MAX_LIGHTS];
+   GLfloat base[2][4];
+   const struct gl_light *light;
+   const GLuint nr = VB->AttribPtr[_TNL_ATTRIB_NORMAL]->count;
+   GLuint nr_lights = 0;
+   GLuint side;
+
+   foreach (light, &ctx->Light.EnabledList) {
+      struct tnl_sse_light *l = &lights[nr_lights++];
+
+      COPY_3V(l->VP, light->_VP_inf_norm);
+      COPY_3V(l->h, light->_h_inf_norm);
+      for (side = 0; side < 2; side++) {
+	 COPY_3V(l->ambient[side], light->_MatAmbient[side]);
+	 COPY_3V(l->diffuse[side], light->_MatDiffuse[side]);
+	 COPY_3V(l->specular[side], light->_MatSpecular[side]);
+      }
+   }
+
+   COPY_3V(base[0], ctx->Light._BaseColor[0]);
+   COPY_3V(base[1], ctx->Light._BaseColor[1]);
+   base[0][3] = ctx->Light.Material.Attrib[MAT_ATTRIB_FRONT_DIFFUSE][3];
+   base[1][3] = ctx->Light.Material.Attrib[MAT_ATTRIB_BACK_DIFFUSE][3];
+
+   VB->AttribPtr[_TNL_ATTRIB_COLOR0] = &store->LitColor[0];
+   if (twoside)
+      VB->BackfaceColorPtr = &store->LitColor[1];
+
+   if (nr > 1) {
+      store->LitColor[0].stride = 16;
+      store->LitColor[1].stride = 16;
+   }
+   else {
+      store->LitColor[0].stride = 0;
+      store->LitColor[1].stride = 0;
+   }
+
+   _tnl_sse_light_infinite(nr,
+			   (const GLfloat *) VB->AttribPtr[_TNL_ATTRIB_NORMAL]->data,
+			   VB->AttribPtr[_TNL_ATTRIB_NORMAL]->stride,
+			   lights, nr_lights, (const GLfloat (*)[4]) base,
+			   TNL_CONTEXT(ctx)->_ShineTable, twoside,
+			   (GLfloat (*)[4]) store->LitColor[0].data,
+			   (GLfloat (*)[4]) store->LitColor[1].data);
+}
+
+static void light_fast_rgba_onesided_sse( struct gl_context *ctx,
+					  struct vertex_buffer *VB,
+					  struct tnl_pipeline_stage *stage,
+					  GLvector4f *input )
+{
+   (void) input;
+   light_fast_rgba_sse( ctx, VB, stage, GL_FALSE );
+}
+
+static void light_fast_rgba_twoside_sse( struct gl_context *ctx,
+					 struct vertex_buffer *VB,
+					 struct tnl_pipeline_stage *stage,
+					 GLvector4f *input )
+{
+   (void) input;
+   light_fast_rgba_sse( ctx, VB, stage, GL_TRUE );
+}
+
+#endif
+
+
 static void init_lighting_tables( void )
 {
    static int done;
@@ -317,6 +397,16 @@ static void init_lighting_tables( void )
       init_light_tab_twoside();
       init_light_tab_material();
       init_light_tab_twoside_material();
+
+#ifdef __SSE__
+      if (_tnl_sse_available()) {
+	 _tnl_light_fast_tab[0] = light_fast_rgba_onesided_sse;
+	 _tnl_light_fast_tab[LIGHT_TWOSIDE] = light_fast_rgba_twoside_sse;
+	 _tnl_light_fast_single_tab[0] = light_fast_rgba_onesided_sse;
+	 _tnl_light_fast_single_tab[LIGHT_TWOSIDE] = light_fast_rgba_twoside_sse;
+      }
+#endif
+
       done = 1;
    }
 }
@@ -0,0 +1,330 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file t_vb_sse.c
+ * SSE versions of the hottest fixed-function vertex stages.
+ *
+ * Four vertices go through each iteration, with their normals (and eye
+ * coordinates) transposed so that every lane of a register holds the same
+ * component of a different vertex.  The arithmetic is done in the same
+ * order as the C code in t_vb_lighttmp.h and t_vb_texgen.c, so the results
+ * only differ where the C compiler contracts or reorders differently.
+ *
+ * When the vertex count isn't a multiple of four, the last vertex is
+ * repeated in the unused lanes and those lanes aren't stored.
+ */
+
+
+#include "main/glheader.h"
+#include "main/imports.h"
+#include "main/macros.h"
+
+#include "t_context.h"
+#include "t_vb_sse.h"
+
+#if defined(USE_SSE_ASM)
+#include "x86/common_x86_asm.h"
+#endif
+
+
+/**
+ * Whether the SSE stages can be used: they have to be compiled in, and
+ * the CPU has to support SSE.  MESA_NO_SSE selects the C code.
+ */
+GLboolean
+_tnl_sse_available(void)
+{
+#if defined(__SSE__) && defined(USE_SSE_ASM)
+   /* _mesa_get_x86_features() honours MESA_NO_ASM and MESA_NO_SSE */
+   return cpu_has_xmm ? GL_TRUE : GL_FALSE;
+#elif defined(__SSE__)
+   return _mesa_getenv("MESA_NO_SSE") == NULL;
+#else
+   return GL_FALSE;
+#endif
+}
+
+
+#ifdef __SSE__
+
+#include <xmmintrin.h>
+
+
+/**
+ * Load the 3-component vectors of elements [i, i + 4) of a strided array,
+ * transposed.
+ */
+static inline void
+load_3v(const GLfloat *v, GLuint stride, GLuint i, GLuint count,
+        __m128 *x, __m128 *y, __m128 *z)
+{
+   const GLfloat *p[4];
+   GLuint k;
+
+   for (k = 0; k < 4; k++) {
+      const GLuint j = MIN2(i + k, count - 1);
+      p[k] = (const GLfloat *) ((const GLubyte *) v + j * stride);
+   }
+
+   *x = _mm_setr_ps(p[0][0], p[1][0], p[2][0], p[3][0]);
+   *y = _mm_setr_ps(p[0][1], p[1][1], p[2][1], p[3][1]);
+   *z = _mm_setr_ps(p[0][2], p[1][2], p[2][2], p[3][2]);
+}
+
+
+static inline __m128
+dot3(__m128 x, __m128 y, __m128 z, const GLfloat v[3])
+{
+   return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(v[0])),
+                                _mm_mul_ps(y, _mm_set1_ps(v[1]))),
+                     _mm_mul_ps(z, _mm_set1_ps(v[2])));
+}
+
+
+/** sum += s * v, for each of the three components */
+static inline void
+acc_scale_3v(__m128 sum[3], __m128 s, const GLfloat v[3])
+{
+   sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(s, _mm_set1_ps(v[0])));
+   sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(s, _mm_set1_ps(v[1])));
+   sum[2] = _mm_add_ps(sum[2], _mm_mul_ps(s, _mm_set1_ps(v[2])));
+}
+
+
+static inline void
+acc_3v(__m128 sum[3], const GLfloat v[3])
+{
+   sum[0] = _mm_add_ps(sum[0], _mm_set1_ps(v[0]));
+   sum[1] = _mm_add_ps(sum[1], _mm_set1_ps(v[1]));
+   sum[2] = _mm_add_ps(sum[2], _mm_set1_ps(v[2]));
+}
+
+
+/** Same as lookup_shininess() in t_vb_light.c */
+static inline GLfloat
+lookup_shininess(const struct tnl_shine_tab *tab, GLfloat dp)
+{
+   float f = dp * (SHINE_TABLE_SIZE - 1);
+   int k = (int) f;
+   if (k < 0 || k > SHINE_TABLE_SIZE - 2)
+      return powf(dp, tab->shininess);
+   else
+      return tab->tab[k] + (f - k) * (tab->tab[k+1] - tab->tab[k]);
+}
+
+
+/**
+ * The specular factor of the lanes set in \p mask, zero elsewhere.  The
+ * table lookup is done lane by lane, and skipped entirely when no lane
+ * faces the half-angle vector.
+ */
+static inline __m128
+specular(const struct tnl_shine_tab *tab, __m128 n_dot_h, __m128 mask)
+{
+   const int bits = _mm_movemask_ps(mask);
+   GLfloat dp[4], spec[4];
+   GLuint k;
+
+   if (!bits)
+      return _mm_setzero_ps();
+
+   _mm_storeu_ps(dp, n_dot_h);
+   for (k = 0; k < 4; k++)
+      spec[k] = (bits & (1 << k)) ? lookup_shininess(tab, dp[k]) : 0.0F;
+
+   return _mm_loadu_ps(spec);
+}
+
+
+static inline void
+store_colors(GLfloat (*color)[4], GLuint i, GLuint count,
+             const __m128 sum[3], GLfloat alpha)
+{
+   __m128 r = sum[0], g = sum[1], b = sum[2], a = _mm_set1_ps(alpha);
+   const GLuint n = MIN2(count - i, 4);
+   GLuint k;
+
+   _MM_TRANSPOSE4_PS(r, g, b, a);
+
+   if (n == 4) {
+      _mm_storeu_ps(color[i + 0], r);
+      _mm_storeu_ps(color[i + 1], g);
+      _mm_storeu_ps(color[i + 2], b);
+      _mm_storeu_ps(color[i + 3], a);
+   }
+   else {
+      const __m128 rgba[3] = { r, g, b };
+      for (k = 0; k < n; k++)
+         _mm_storeu_ps(color[i + k], rgba[k]);
+   }
+}
+
+
+/**
+ * RGBA lighting with infinite lights and an infinite viewer, without
+ * GL_COLOR_MATERIAL; see light_fast_rgba() in t_vb_lighttmp.h.
+ *
+ * \param base  _BaseColor of each side, with the diffuse alpha in [3]
+ * \param Bcolor  only written if \p twoside is set
+ */
+void
+_tnl_sse_light_infinite(GLuint count, const GLfloat *normal, GLuint nstride,
+                        const struct tnl_sse_light *lights, GLuint nr_lights,
+                        const GLfloat base[2][4],
+                        struct tnl_shine_tab *const shine[2],
+                        GLboolean twoside,
+                        GLfloat (*Fcolor)[4], GLfloat (*Bcolor)[4])
+{
+   const __m128 zero = _mm_setzero_ps();
+   GLuint i, l;
+
+   for (i = 0; i < count; i += 4) {
+      __m128 nx, ny, nz;
+      __m128 sum[2][3];
+
+      load_3v(normal, nstride, i, count, &nx, &ny, &nz);
+
+      sum[0][0] = _mm_set1_ps(base[0][0]);
+      sum[0][1] = _mm_set1_ps(base[0][1]);
+      sum[0][2] = _mm_set1_ps(base[0][2]);
+      sum[1][0] = _mm_set1_ps(base[1][0]);
+      sum[1][1] = _mm_set1_ps(base[1][1]);
+      sum[1][2] = _mm_set1_ps(base[1][2]);
+
+      for (l = 0; l < nr_lights; l++) {
+         const struct tnl_sse_light *light = &lights[l];
+         const __m128 n_dot_VP = dot3(nx, ny, nz, light->VP);
+         const __m128 n_dot_h = dot3(nx, ny, nz, light->h);
+         const __m128 front = _mm_cmpgt_ps(n_dot_VP, zero);
+         __m128 spec;
+
+         acc_3v(sum[0], light->ambient[0]);
+         acc_scale_3v(sum[0], _mm_and_ps(front, n_dot_VP), light->diffuse[0]);
+         spec = specular(shine[0], n_dot_h,
+                         _mm_and_ps(front, _mm_cmpgt_ps(n_dot_h, zero)));
+         acc_scale_3v(sum[0], spec, light->specular[0]);
+
+         if (twoside) {
+            /* every lane that isn't lit from the front, NaNs included */
+            const __m128 back = _mm_cmpngt_ps(n_dot_VP, zero);
+            const __m128 back_dot_h = _mm_sub_ps(zero, n_dot_h);
+
+            acc_3v(sum[1], light->ambient[1]);
+            acc_scale_3v(sum[1], _mm_and_ps(back, _mm_sub_ps(zero, n_dot_VP)),
+                         light->diffuse[1]);
+            spec = specular(shine[1], back_dot_h,
+                            _mm_and_ps(back, _mm_cmpgt_ps(back_dot_h, zero)));
+            acc_scale_3v(sum[1], spec, light->specular[1]);
+         }
+      }
+
+      store_colors(Fcolor, i, count, sum[0], base[0][3]);
+      if (twoside)
+         store_colors(Bcolor, i, count, sum[1], base[1][3]);
+   }
+}
+
+
+/**
+ * Reflection vectors for GL_SPHERE_MAP and GL_REFLECTION_MAP, from 3- or
+ * 4-component eye coordinates; see build_m3() and build_f3() in
+ * t_vb_texgen.c.
+ *
+ * \param fstride  in bytes
+ * \param m  the sphere map scale factors, or NULL
+ */
+void
+_tnl_sse_reflect(GLuint count, const GLfloat *coord, GLuint cstride,
+                 const GLfloat *normal, GLuint nstride,
+                 GLfloat *f, GLuint fstride, GLfloat *m)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0F);
+   const __m128 two = _mm_set1_ps(2.0F);
+   const __m128 half = _mm_set1_ps(0.5F);
+   GLuint i, k;
+
+   for (i = 0; i < count; i += 4) {
+      const GLuint n = MIN2(count - i, 4);
+      __m128 ux, uy, uz, nx, ny, nz, len, scale, two_nu, fx, fy, fz;
+      GLfloat out[3][4];
+
+      load_3v(coord, cstride, i, count, &ux, &uy, &uz);
+      load_3v(normal, nstride, i, count, &nx, &ny, &nz);
+
+      /* NORMALIZE_3FV(u), which leaves zero-length vectors alone */
+      len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ux, ux), _mm_mul_ps(uy, uy)),
+                       _mm_mul_ps(uz, uz));
+      scale = _mm_div_ps(one, _mm_sqrt_ps(len));
+      scale = _mm_or_ps(_mm_and_ps(_mm_cmpneq_ps(len, zero), scale),
+                        _mm_andnot_ps(_mm_cmpneq_ps(len, zero), one));
+      ux = _mm_mul_ps(ux, scale);
+      uy = _mm_mul_ps(uy, scale);
+      uz = _mm_mul_ps(uz, scale);
+
+      two_nu = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, ux), _mm_mul_ps(ny, uy)),
+                          _mm_mul_ps(nz, uz));
+      two_nu = _mm_mul_ps(two, two_nu);
+
+      fx = _mm_sub_ps(ux, _mm_mul_ps(nx, two_nu));
+      fy = _mm_sub_ps(uy, _mm_mul_ps(ny, two_nu));
+      fz = _mm_sub_ps(uz, _mm_mul_ps(nz, two_nu));
+
+      _mm_storeu_ps(out[0], fx);
+      _mm_storeu_ps(out[1], fy);
+      _mm_storeu_ps(out[2], fz);
+      for (k = 0; k < n; k++) {
+         GLfloat *dst = (GLfloat *) ((GLubyte *) f + (i + k) * fstride);
+         dst[0] = out[0][k];
+         dst[1] = out[1][k];
+         dst[2] = out[2][k];
+      }
+
+      if (m) {
+         const __m128 fz1 = _mm_add_ps(fz, one);
+         __m128 mm, mask;
+
+         mm = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)),
+                         _mm_mul_ps(fz1, fz1));
+         mask = _mm_cmpneq_ps(mm, zero);
+         mm = _mm_or_ps(_mm_and_ps(mask,
+                                   _mm_mul_ps(half, _mm_div_ps(one,
+                                                               _mm_sqrt_ps(mm)))),
+                        _mm_andnot_ps(mask, mm));
+
+         if (n == 4) {
+            _mm_storeu_ps(m + i, mm);
+         }
+         else {
+            _mm_storeu_ps(out[0], mm);
+            for (k = 0; k < n; k++)
+               m[i + k] = out[0][k];
+         }
+      }
+   }
+}
+
+#endif /* __SSE__ */
@@ -0,0 +1,71 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef T_VB_SSE_H
+#define T_VB_SSE_H
+
+
+#include "main/glheader.h"
+
+struct tnl_shine_tab;
+
+
+/**
+ * Per-light inputs of _tnl_sse_light_infinite(), copied out of
+ * struct gl_light.  Index 0 is the front side, 1 the back side.
+ */
+struct tnl_sse_light
+{
+   GLfloat VP[3];            /**< _VP_inf_norm */
+   GLfloat h[3];             /**< _h_inf_norm */
+   GLfloat ambient[2][3];    /**< _MatAmbient */
+   GLfloat diffuse[2][3];    /**< _MatDiffuse */
+   GLfloat specular[2][3];   /**< _MatSpecular */
+};
+
+
+extern GLboolean
+_tnl_sse_available(void);
+
+
+#ifdef __SSE__
+
+extern void
+_tnl_sse_light_infinite(GLuint count, const GLfloat *normal, GLuint nstride,
+                        const struct tnl_sse_light *lights, GLuint nr_lights,
+                        const GLfloat base[2][4],
+                        struct tnl_shine_tab *const shine[2],
+                        GLboolean twoside,
+                        GLfloat (*Fcolor)[4], GLfloat (*Bcolor)[4]);
+
+extern void
+_tnl_sse_reflect(GLuint count, const GLfloat *coord, GLuint cstride,
+                 const GLfloat *normal, GLuint nstride,
+                 GLfloat *f, GLuint fstride, GLfloat *m);
+
+#endif
+
+
+#endif
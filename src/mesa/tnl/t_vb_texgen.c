@@ -44,6 +44,7 @@
 
 #include "t_context.h"
 #include "t_pipeline.h"
+#include "t_vb_sse.h"
 
 
 /***********************************************************************
@@ -244,6 +245,47 @@ static build_f_func build_f_tab[5] = {
 };
 
 
+#ifdef __SSE__
+
+static void build_m3_sse( GLfloat f[][3], GLfloat m[],
+			  const GLvector4f *normal,
+			  const GLvector4f *eye )
+{
+   _tnl_sse_reflect( eye->count, eye->start, eye->stride,
+		     normal->start, normal->stride,
+		     &f[0][0], 3 * sizeof(GLfloat), m );
+}
+
+
+static void build_f3_sse( GLfloat *f,
+			  GLuint fstride,
+			  const GLvector4f *normal,
+			  const GLvector4f *eye )
+{
+   _tnl_sse_reflect( eye->count, eye->start, eye->stride,
+		     normal->start, normal->stride,
+		     f, fstride, NULL );
+}
+
+#endif
+
+
+static void init_texgen_tables( void )
+{
+   static int done;
+
+   if (!done) {
+#ifdef __SSE__
+      if (_tnl_sse_available()) {
+	 build_m_tab[3] = build_m_tab[4] = build_m3_sse;
+	 build_f_tab[3] = build_f_tab[4] = build_f3_sse;
+      }
+#endif
+      done = 1;
+   }
+}
+
+
 
 /* Special case texgen functions.
  */
@@ -561,6 +603,8 @@ static GLboolean alloc_texgen_data( struct gl_context *ctx,
    struct texgen_stage_data *store;
    GLuint i;
 
+   init_texgen_tables();
+
    stage->privatePtr = calloc(1, sizeof(*store));
    store = TEXGEN_STAGE_DATA(stage);
    if (!store)